@@ -1,8 +1,10 @@
 #include "PowerSystemTopology.h"
+#include "memory_accounting.h" // 拓扑结构与查询的分配计入 topology 标记
 #include <algorithm>
 #include <iostream>
 #include <queue>
 #include <stdexcept>
+#include <unordered_map>
 #include <unordered_set>
 
 // --- 拓扑构建 ---
@@ -11,6 +13,7 @@ void PowerSystemTopology::buildTopology(
     const std::vector<BranchId>& branch_ids,
     const std::vector<std::pair<BusId, BusId>>& branch_endpoints)
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (branch_ids.size() != branch_endpoints.size()) {
         throw std::invalid_argument("错误: 支路ID数量与支路端点对数量不匹配。");
     }
@@ -19,6 +22,7 @@ void PowerSystemTopology::buildTopology(
     bus_to_internal_idx.clear();
     internal_idx_to_bus_id.clear();
     branch_endpoints_map.clear();
+    csr_cache_valid = false;
 
     internal_idx_to_bus_id = bus_ids;
     bus_to_internal_idx.reserve(bus_ids.size());
@@ -54,7 +58,33 @@ void PowerSystemTopology::buildTopology(
     }
 }
 
+CsrTopology PowerSystemTopology::exportCsr() const
+{
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
+    CsrTopology csr;
+    csr.bus_ids = internal_idx_to_bus_id;
+    csr.row_offsets.reserve(getBusCount() + 1);
+    csr.row_offsets.push_back(0);
+    for (const auto& bus_connections : adjacency_list) {
+        for (const auto& conn : bus_connections) {
+            csr.adj_bus_idx.push_back(conn.internal_bus_idx);
+            csr.adj_branch_ids.push_back(conn.branch_id);
+        }
+        csr.row_offsets.push_back(static_cast<int>(csr.adj_bus_idx.size()));
+    }
+    return csr;
+}
+
 // --- 内部辅助函数 ---
+const CsrTopology& PowerSystemTopology::cachedCsr() const
+{
+    if (!csr_cache_valid) {
+        csr_cache = exportCsr();
+        csr_cache_valid = true;
+    }
+    return csr_cache;
+}
+
 int PowerSystemTopology::getBusInternalIndex(BusId bus_id) const
 {
     auto it = bus_to_internal_idx.find(bus_id);
@@ -67,6 +97,7 @@ int PowerSystemTopology::getBusInternalIndex(BusId bus_id) const
 // --- 1. 电气岛分析 ---
 std::unordered_map<BusId, int> PowerSystemTopology::findElectricalIslands(int& island_count) const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady()) {
         island_count = 0;
         return {};
@@ -111,6 +142,7 @@ std::optional<Path> PowerSystemTopology::findPath(
     BusId end_bus,
     const std::vector<BranchId>& open_branches) const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     int start_idx = getBusInternalIndex(start_bus);
     int end_idx = getBusInternalIndex(end_bus);
 
@@ -171,6 +203,7 @@ std::optional<Path> PowerSystemTopology::findPath(
 // --- 3. 查找关键线路 ---
 std::vector<BranchId> PowerSystemTopology::findCriticalLines() const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady())
         return {};
 
@@ -212,6 +245,7 @@ void PowerSystemTopology::findCriticalLinesUtil(
 // --- 4. 查找关键母线 ---
 std::vector<BusId> PowerSystemTopology::findCriticalBuses() const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady())
         return {};
 
@@ -264,6 +298,7 @@ void PowerSystemTopology::findCriticalBusesUtil(
 // --- 5. 查找所有环路 ---
 std::vector<std::vector<BusId>> PowerSystemTopology::findAllLoops() const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady())
         return {};
 
@@ -322,6 +357,7 @@ void PowerSystemTopology::findAllLoopsUtil(
 // --- 6. 计算母线连接度 ---
 std::unordered_map<BusId, int> PowerSystemTopology::getBusDegrees() const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     std::unordered_map<BusId, int> degrees;
     if (!isReady())
         return degrees;
@@ -336,6 +372,7 @@ std::unordered_map<BusId, int> PowerSystemTopology::getBusDegrees() const
 // --- 7. 辐射状网络检测 [LOGIC CORRECTED] ---
 std::unordered_map<int, bool> PowerSystemTopology::checkRadialIslands() const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady())
         return {};
 
@@ -375,6 +412,7 @@ Path PowerSystemTopology::tracePowerFlow(
     const std::vector<BusId>& source_buses,
     bool trace_downstream) const
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     if (!isReady())
         return {};
 
@@ -488,6 +526,7 @@ Path PowerSystemTopology::tracePowerFlow(
 // --- 9. 断开支路 ---
 bool PowerSystemTopology::openBranch(BranchId branch_id_to_open)
 {
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
     auto it = branch_endpoints_map.find(branch_id_to_open);
     if (it == branch_endpoints_map.end())
         return false;
@@ -517,5 +556,95 @@ bool PowerSystemTopology::openBranch(BranchId branch_id_to_open)
         v_conns.end());
 
     branch_endpoints_map.erase(it);
+    csr_cache_valid = false;
     return true;
-}
\ No newline at end of file
+}
+
+// --- 10. 多场景带电分析 ---
+ScenarioEnergization PowerSystemTopology::energizedBusesByScenario(
+    const std::vector<BusId>& source_buses,
+    const std::vector<std::vector<BranchId>>& scenario_open_branches) const
+{
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
+    ScenarioEnergization result;
+    result.bus_ids = internal_idx_to_bus_id;
+    result.scenario_count = scenario_open_branches.size();
+    const size_t bus_count = internal_idx_to_bus_id.size();
+    const size_t group_count = (result.scenario_count + 63) / 64;
+    result.lane_masks.assign(group_count * bus_count, 0);
+    if (group_count == 0 || bus_count == 0)
+        return result;
+
+    const CsrTopology& csr = cachedCsr();
+    std::vector<int> source_indices;
+    for (BusId source_id : source_buses) {
+        int idx = getBusInternalIndex(source_id);
+        if (idx != -1)
+            source_indices.push_back(idx);
+    }
+
+    // 支路ID -> 本组中该支路断开的场景位 (只记录至少在一个场景中断开的支路，其余支路在全部场景中闭合)
+    std::unordered_map<BranchId, uint64_t> open_lanes;
+    std::vector<uint64_t> edge_closed(csr.adj_branch_ids.size());
+    std::vector<int> frontier, next_frontier;
+    std::vector<char> queued(bus_count, 0);
+
+    for (size_t group = 0; group < group_count; ++group) {
+        const size_t first = group * 64;
+        const size_t lanes = std::min<size_t>(64, result.scenario_count - first);
+        const uint64_t all_lanes = lanes == 64 ? ~uint64_t(0) : ((uint64_t(1) << lanes) - 1);
+
+        open_lanes.clear();
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            for (BranchId branch_id : scenario_open_branches[first + lane])
+                open_lanes[branch_id] |= uint64_t(1) << lane;
+        }
+        for (size_t e = 0; e < edge_closed.size(); ++e) {
+            auto it = open_lanes.find(csr.adj_branch_ids[e]);
+            edge_closed[e] = all_lanes & ~(it == open_lanes.end() ? 0 : it->second);
+        }
+
+        uint64_t* reach = &result.lane_masks[group * bus_count];
+        frontier.clear();
+        for (int idx : source_indices) {
+            if (reach[idx] != all_lanes) {
+                reach[idx] = all_lanes;
+                frontier.push_back(idx);
+            }
+        }
+
+        // 前沿扫描: 前沿母线经各邻接边的闭合掩码把自身掩码传给邻居，邻居新获得场景位时进入下一轮前沿
+        while (!frontier.empty()) {
+            next_frontier.clear();
+            for (int u : frontier) {
+                const uint64_t mask = reach[u];
+                for (int k = csr.row_offsets[u]; k < csr.row_offsets[u + 1]; ++k) {
+                    const int v = csr.adj_bus_idx[k];
+                    const uint64_t gained = mask & edge_closed[k] & ~reach[v];
+                    if (gained) {
+                        reach[v] |= gained;
+                        if (!queued[v]) {
+                            queued[v] = 1;
+                            next_frontier.push_back(v);
+                        }
+                    }
+                }
+            }
+            for (int v : next_frontier)
+                queued[v] = 0;
+            frontier.swap(next_frontier);
+        }
+    }
+    return result;
+}
+
+std::vector<uint64_t> ScenarioEnergization::scenarioBitset(size_t scenario) const
+{
+    const size_t bus_count = bus_ids.size();
+    std::vector<uint64_t> bits((bus_count + 63) / 64, 0);
+    for (size_t i = 0; i < bus_count; ++i) {
+        if (isEnergized(scenario, static_cast<int>(i)))
+            bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return bits;
+}
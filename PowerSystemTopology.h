@@ -1,6 +1,8 @@
 #ifndef POWER_SYSTEM_TOPOLOGY_H
 #define POWER_SYSTEM_TOPOLOGY_H
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -25,6 +27,32 @@ struct Path {
     std::vector<BranchId> branches; // 路径经过的支路ID列表
 };
 
+// --- 压缩稀疏行 (CSR) 拓扑结构体 ---
+// 邻接表的扁平化表示: 母线 i 的所有邻接支路位于 [row_offsets[i], row_offsets[i+1]) 区间内。
+// 所有数组都是连续存储的, 不含指针, 供批量扫描和稀疏矩阵组装直接按索引遍历。
+struct CsrTopology {
+    std::vector<BusId> bus_ids; // 内部索引 -> 外部母线ID
+    std::vector<int> row_offsets; // 长度为 母线数+1
+    std::vector<int> adj_bus_idx; // 对侧母线的内部索引
+    std::vector<BranchId> adj_branch_ids; // 对应的支路ID
+};
+
+// --- 多场景带电分析结果结构体 ---
+// 每64个场景为一组，每组为每条母线保存一个64位掩码 (位并行扫描的原生布局):
+// 第 s 个场景中内部索引为 i 的母线是否带电 = lane_masks[(s / 64) * 母线数 + i] 的第 (s % 64) 位。
+struct ScenarioEnergization {
+    std::vector<BusId> bus_ids; // 内部索引 -> 外部母线ID
+    size_t scenario_count = 0;
+    std::vector<uint64_t> lane_masks;
+
+    bool isEnergized(size_t scenario, int bus_internal_idx) const
+    {
+        return (lane_masks[(scenario / 64) * bus_ids.size() + bus_internal_idx] >> (scenario % 64)) & 1;
+    }
+    // 第 scenario 个场景的带电母线位集: 第 i 位对应内部索引为 i 的母线，每64条母线一个字
+    std::vector<uint64_t> scenarioBitset(size_t scenario) const;
+};
+
 /**
  * @class PowerSystemTopology
  * @brief 一个通用的电力系统拓扑分析类
@@ -57,6 +85,12 @@ public:
         const std::vector<BranchId>& branch_ids,
         const std::vector<std::pair<BusId, BusId>>& branch_endpoints);
 
+    /**
+     * @brief 导出当前拓扑的CSR表示
+     * @return CsrTopology 扁平化的邻接结构, 内部索引顺序与本对象一致
+     */
+    CsrTopology exportCsr() const;
+
     // --- 核心拓扑分析功能 ---
     /**
      * @brief 1. 电气岛分析 (Connectivity Analysis)
@@ -127,6 +161,19 @@ public:
         const std::vector<BusId>& source_buses,
         bool trace_downstream = true) const;
 
+    /**
+     * @brief 10. 多场景带电分析 (Bit-Parallel Multi-Scenario Reachability)
+     * @details 计算同一拓扑在多组开关状态 (N-1/N-2 预想事故、恢复方案候选、蒙特卡洛停运状态) 下各母线是否与电源连通。
+     *          每条母线携带一个64位掩码 (第 s 位对应第 s 个场景)，每条CSR邻接边携带按场景展开的闭合掩码，
+     *          一次前沿扫描即同时得到64个场景的结果；场景数超过64时每64个一组依次扫描。
+     * @param source_buses 电源母线ID列表 (在所有场景中均视为带电)
+     * @param scenario_open_branches 每个场景断开的支路ID列表，场景数即其长度
+     * @return ScenarioEnergization 各场景的带电母线位集
+     */
+    ScenarioEnergization energizedBusesByScenario(
+        const std::vector<BusId>& source_buses,
+        const std::vector<std::vector<BranchId>>& scenario_open_branches) const;
+
     // --- 动态修改功能 ---
     /**
      * @brief 9. 断开支路 (Open Branch)
@@ -138,6 +185,7 @@ public:
     // --- 工具函数 ---
     bool isReady() const { return !adjacency_list.empty(); }
     int getBusCount() const { return internal_idx_to_bus_id.size(); }
+    int getBusInternalIndex(BusId bus_id) const; // 母线ID -> 内部索引，不存在时返回 -1
 
 private:
     // --- 内部数据结构 ---
@@ -145,9 +193,12 @@ private:
     std::unordered_map<BusId, int> bus_to_internal_idx; // 映射: 外部母线ID -> 内部索引
     std::vector<BusId> internal_idx_to_bus_id; // 映射: 内部索引 -> 外部母线ID
     std::unordered_map<BranchId, std::pair<BusId, BusId>> branch_endpoints_map; // 存储支路及其两端母线
+    // 多场景带电分析使用的CSR缓存: buildTopology/openBranch 后失效，下次分析时重建 (重建不是线程安全的)
+    mutable CsrTopology csr_cache;
+    mutable bool csr_cache_valid = false;
 
     // --- 内部辅助函数 ---
-    int getBusInternalIndex(BusId bus_id) const;
+    const CsrTopology& cachedCsr() const;
     void findCriticalLinesUtil(int u, std::vector<int>& disc, std::vector<int>& low, std::vector<int>& parent, std::vector<BranchId>& bridges, int& time) const;
     void findCriticalBusesUtil(int u, std::vector<int>& disc, std::vector<int>& low, std::vector<int>& parent, std::vector<bool>& is_ap, int& time) const;
     void findAllLoopsUtil(int u, int p, std::vector<int>& color, std::vector<int>& path, std::vector<std::vector<int>>& cycles_internal) const;
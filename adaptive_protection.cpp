@@ -0,0 +1,230 @@
+// adaptive_protection.cpp
+// 实现了后备保护定值组的增量重新整定。
+
+#include "adaptive_protection.h"
+#include "memory_accounting.h"
+
+#include <algorithm>
+
+void AdaptiveProtectionService::add_bus(Entity bus, bool is_source)
+{
+    bus_index_.emplace(bus, static_cast<uint32_t>(is_source_.size()));
+    is_source_.push_back(is_source);
+    bus_lines_.emplace_back();
+}
+
+void AdaptiveProtectionService::add_line(Entity line, const AdaptiveLineEnd& from, const AdaptiveLineEnd& to)
+{
+    LineModel model;
+    model.line = line;
+    const uint32_t index = static_cast<uint32_t>(lines_.size());
+    const AdaptiveLineEnd ends[2] = { from, to };
+    for (int end = 0; end < 2; ++end) {
+        model.bus[end] = bus_index(ends[end].bus);
+        model.breaker[end] = NO_BREAKER;
+        if (ends[end].breaker != 0) {
+            model.breaker[end] = static_cast<uint32_t>(breaker_open_.size());
+            breaker_index_.emplace(ends[end].breaker, model.breaker[end]);
+            breaker_open_.push_back(0);
+            breaker_line_.push_back(index);
+        }
+        bus_lines_[model.bus[end]].push_back(index);
+    }
+    line_index_.emplace(line, index);
+    lines_.push_back(model);
+}
+
+void AdaptiveProtectionService::add_main_protection(Entity line, uint32_t delay_ms)
+{
+    LineModel& model = lines_[line_index_.at(line)];
+    model.main_delay_ms = model.main_delay_ms == 0 ? delay_ms : std::min(model.main_delay_ms, delay_ms);
+}
+
+uint32_t AdaptiveProtectionService::add_backup_relay(const AdaptiveRelay& relay, const RelaySettingsGroup& initial)
+{
+    const uint32_t line = line_index_.at(relay.line);
+    const auto breaker = breaker_index_.find(relay.breaker);
+    relays_.push_back(relay);
+    relay_line_.push_back(line);
+    relay_end_.push_back(breaker != breaker_index_.end() && lines_[line].breaker[1] == breaker->second ? 1 : 0);
+    settings_.push_back(initial);
+    std::sort(settings_.back().backup_entities.begin(), settings_.back().backup_entities.end());
+    return static_cast<uint32_t>(relays_.size() - 1);
+}
+
+void AdaptiveProtectionService::finalize()
+{
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
+    relays_at_bus_.assign(is_source_.size(), {});
+    for (uint32_t r = 0; r < relays_.size(); ++r)
+        index_zone(r, true);
+    compute_distances(distance_);
+    bus_marked_.assign(is_source_.size(), 0);
+    candidate_mark_.assign(relays_.size(), 0);
+    finalized_ = true;
+}
+
+void AdaptiveProtectionService::set_breaker_open(Entity breaker, bool is_open)
+{
+    auto it = breaker_index_.find(breaker);
+    if (it == breaker_index_.end() || breaker_open_[it->second] == is_open)
+        return;
+    breaker_open_[it->second] = is_open;
+    if (!finalized_)
+        return;
+    const LineModel& line = lines_[breaker_line_[it->second]];
+    mark_bus(line.bus[0]);
+    mark_bus(line.bus[1]);
+}
+
+void AdaptiveProtectionService::mark_bus(uint32_t bus)
+{
+    if (bus_marked_[bus])
+        return;
+    bus_marked_[bus] = 1;
+    pending_buses_.push_back(bus);
+}
+
+uint32_t AdaptiveProtectionService::distance_to_source(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    return it == bus_index_.end() ? UNREACHABLE : distance_[it->second];
+}
+
+void AdaptiveProtectionService::compute_distances(std::vector<uint32_t>& out) const
+{
+    // 从全部电源母线同时出发的广度优先扫描，只经投运线路
+    out.assign(is_source_.size(), UNREACHABLE);
+    std::vector<uint32_t> frontier, next;
+    for (uint32_t b = 0; b < is_source_.size(); ++b) {
+        if (is_source_[b]) {
+            out[b] = 0;
+            frontier.push_back(b);
+        }
+    }
+    for (uint32_t depth = 1; !frontier.empty(); ++depth) {
+        next.clear();
+        for (uint32_t u : frontier) {
+            for (uint32_t l : bus_lines_[u]) {
+                const LineModel& line = lines_[l];
+                if (!in_service(line))
+                    continue;
+                const uint32_t v = line.bus[0] == u ? line.bus[1] : line.bus[0];
+                if (out[v] == UNREACHABLE) {
+                    out[v] = depth;
+                    next.push_back(v);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+}
+
+RelaySettingsGroup AdaptiveProtectionService::compute_settings(uint32_t relay) const
+{
+    const LineModel& own = lines_[relay_line_[relay]];
+    const int near_end = relay_end_[relay];
+    RelaySettingsGroup s;
+    s.delay_ms = relays_[relay].base_delay_ms;
+    if (end_closed(own, near_end))
+        s.protected_entities.push_back(own.line);
+    if (!in_service(own))
+        return s;
+
+    // 潮流方向: 离电源较远的一端为下游母线；两端等距 (含均不连通) 时方向不确定，不投后备
+    const uint32_t near_distance = distance_[own.bus[near_end]];
+    const uint32_t far_distance = distance_[own.bus[1 - near_end]];
+    if (near_distance == far_distance)
+        return s;
+    const uint32_t downstream = far_distance > near_distance ? own.bus[1 - near_end] : own.bus[near_end];
+
+    for (uint32_t l : bus_lines_[downstream]) {
+        const LineModel& line = lines_[l];
+        if (line.line == own.line || !end_closed(line, line.bus[0] == downstream ? 0 : 1))
+            continue;
+        s.backup_entities.push_back(line.line);
+        if (line.main_delay_ms != 0)
+            s.delay_ms = std::max(s.delay_ms, line.main_delay_ms + COORDINATION_INTERVAL_MS);
+    }
+    std::sort(s.backup_entities.begin(), s.backup_entities.end());
+    return s;
+}
+
+void AdaptiveProtectionService::index_zone(uint32_t relay, bool insert)
+{
+    auto update = [&](uint32_t bus) {
+        auto& list = relays_at_bus_[bus];
+        if (insert) {
+            list.push_back(relay);
+        } else {
+            auto it = std::find(list.begin(), list.end(), relay);
+            if (it != list.end()) {
+                *it = list.back();
+                list.pop_back();
+            }
+        }
+    };
+    const LineModel& own = lines_[relay_line_[relay]];
+    update(own.bus[0]);
+    update(own.bus[1]);
+    for (Entity backup : settings_[relay].backup_entities) {
+        auto it = line_index_.find(backup);
+        if (it == line_index_.end())
+            continue;
+        update(lines_[it->second].bus[0]);
+        update(lines_[it->second].bus[1]);
+    }
+}
+
+const std::vector<uint32_t>& AdaptiveProtectionService::refresh(bool recompute_all)
+{
+    changed_.clear();
+    last_recomputed_ = 0;
+    if (!finalized_ || (pending_buses_.empty() && !recompute_all))
+        return changed_;
+    ++stats_.refreshes;
+
+    // 变化区域 = 断路器变位线路的端点 (已在 pending_buses_ 中) + 离电源距离变化的母线
+    compute_distances(scratch_distance_);
+    for (uint32_t b = 0; b < distance_.size(); ++b) {
+        if (scratch_distance_[b] != distance_[b])
+            mark_bus(b);
+    }
+    distance_.swap(scratch_distance_);
+
+    // 经区域索引选出保护区与变化区域相交的继电器 (先收集再整定，整定会修改索引)
+    std::vector<uint32_t> candidates;
+    if (recompute_all) {
+        candidates.resize(relays_.size());
+        for (uint32_t r = 0; r < relays_.size(); ++r)
+            candidates[r] = r;
+    } else {
+        ++refresh_epoch_;
+        for (uint32_t b : pending_buses_) {
+            for (uint32_t r : relays_at_bus_[b]) {
+                if (candidate_mark_[r] != refresh_epoch_) {
+                    candidate_mark_[r] = refresh_epoch_;
+                    candidates.push_back(r);
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+    }
+    for (uint32_t b : pending_buses_)
+        bus_marked_[b] = 0;
+    pending_buses_.clear();
+
+    for (uint32_t r : candidates) {
+        RelaySettingsGroup s = compute_settings(r);
+        if (s == settings_[r])
+            continue;
+        index_zone(r, false);
+        settings_[r] = std::move(s);
+        index_zone(r, true);
+        changed_.push_back(r);
+    }
+    last_recomputed_ = candidates.size();
+    stats_.relays_recomputed += candidates.size();
+    stats_.settings_changed += changed_.size();
+    return changed_;
+}
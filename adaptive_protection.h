@@ -0,0 +1,130 @@
+// adaptive_protection.h
+// 自适应保护服务: 网络拓扑变化 (开关变位、网络重构) 后重新整定后备保护的定值组。
+// 带方向的后备保护装设在线路 X 的一端，其后备范围取决于 X 中潮流的方向: 潮流经 X 流入的一端 (离电源较远的一端)
+// 为下游母线，后备范围为该母线上其余经闭合断路器相连的线路；X 未投运 (任一端断路器断开) 时后备范围为空。
+// 动作延时须比所后备线路的主保护延时至少高一个配合级差 (COORDINATION_INTERVAL_MS)，不低于整定的基准延时。
+//
+// 增量整定: 服务维护一个 "母线 -> 其保护区 (本线路与后备线路的端点母线) 包含该母线的继电器" 的区域索引。
+// 每次拓扑版本变化时，变化区域为 断路器变位所在线路的端点母线 + 离电源距离 (潮流方向) 变化的母线，
+// 只有保护区与变化区域相交的继电器被重新整定，大电网中的一次开关操作不会引起全部继电器的重新计算。
+// 离电源距离由一次从全部电源母线出发的广度优先扫描求得 (与带电状态扫描同阶)。
+#ifndef ADAPTIVE_PROTECTION_H
+#define ADAPTIVE_PROTECTION_H
+
+#include "ecs_core.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 线路的一端: 该端的断路器 (0表示无断路器，视为常闭) 与所连母线
+struct AdaptiveLineEnd {
+    Entity breaker = 0;
+    Entity bus = 0;
+};
+
+// 带方向的后备保护装置
+struct AdaptiveRelay {
+    Entity device = 0; // 保护装置
+    Entity line = 0; // 装设处的线路 (即其本线路保护范围)
+    Entity breaker = 0; // 装设处的断路器，决定继电器位于线路的哪一端
+    uint32_t base_delay_ms = 0; // 整定的基准延时
+};
+
+// 定值组
+struct RelaySettingsGroup {
+    std::vector<Entity> protected_entities; // 本线路 (装设处断路器断开时为空)
+    std::vector<Entity> backup_entities; // 后备范围内的线路 (按实体编号排序)
+    uint32_t delay_ms = 0;
+
+    bool operator==(const RelaySettingsGroup& other) const
+    {
+        return protected_entities == other.protected_entities && backup_entities == other.backup_entities && delay_ms == other.delay_ms;
+    }
+};
+
+struct AdaptiveProtectionStats {
+    uint64_t refreshes = 0; // 有开关变位的拓扑版本数
+    uint64_t relays_recomputed = 0; // 被重新整定的继电器累计数
+    uint64_t settings_changed = 0; // 定值实际改变的累计次数
+};
+
+class AdaptiveProtectionService {
+public:
+    static constexpr uint32_t COORDINATION_INTERVAL_MS = 300; // 配合级差
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX; // 与电源不连通的母线的距离
+
+    // --- 建模 (须在 finalize() 之前) ---
+    void add_bus(Entity bus, bool is_source);
+    void add_line(Entity line, const AdaptiveLineEnd& from, const AdaptiveLineEnd& to);
+    // 线路主保护的动作延时 (多套时取最快者)，用于后备延时的配合
+    void add_main_protection(Entity line, uint32_t delay_ms);
+    // 登记后备保护，initial 为投运时的定值组 (finalize 时不重新整定)。返回继电器序号。
+    uint32_t add_backup_relay(const AdaptiveRelay& relay, const RelaySettingsGroup& initial);
+
+    // 建立区域索引并计算初始的离电源距离。断路器的初始位置应在此之前以 set_breaker_open 给出。
+    void finalize();
+
+    // --- 运行 ---
+    // 断路器位置变化: 记录其所在线路的两端母线为变化区域 (finalize 之后)
+    void set_breaker_open(Entity breaker, bool is_open);
+    // 自上次 refresh 以来是否有断路器变位
+    bool has_pending_changes() const { return !pending_buses_.empty(); }
+    // 新的拓扑版本: 重新整定保护区与变化区域相交的继电器 (recompute_all 时整定全部继电器)，
+    // 返回定值有变化的继电器序号 (在下一次调用前有效)
+    const std::vector<uint32_t>& refresh(bool recompute_all = false);
+
+    // --- 查询 ---
+    size_t relay_count() const { return relays_.size(); }
+    const AdaptiveRelay& relay(uint32_t index) const { return relays_[index]; }
+    const RelaySettingsGroup& settings(uint32_t index) const { return settings_[index]; }
+    size_t last_recomputed() const { return last_recomputed_; } // 上一次 refresh 重新整定的继电器数
+    uint32_t distance_to_source(Entity bus) const;
+    const AdaptiveProtectionStats& stats() const { return stats_; }
+
+private:
+    struct LineModel {
+        Entity line;
+        uint32_t bus[2]; // 两端母线的内部下标
+        uint32_t breaker[2]; // 两端断路器的下标，NO_BREAKER 表示无断路器
+        uint32_t main_delay_ms = 0; // 0表示无主保护
+    };
+    static constexpr uint32_t NO_BREAKER = UINT32_MAX;
+
+    uint32_t bus_index(Entity bus) const { return bus_index_.at(bus); }
+    bool end_closed(const LineModel& line, int end) const { return line.breaker[end] == NO_BREAKER || !breaker_open_[line.breaker[end]]; }
+    bool in_service(const LineModel& line) const { return end_closed(line, 0) && end_closed(line, 1); }
+    void compute_distances(std::vector<uint32_t>& out) const;
+    RelaySettingsGroup compute_settings(uint32_t relay) const;
+    void index_zone(uint32_t relay, bool insert);
+    void mark_bus(uint32_t bus);
+
+    std::unordered_map<Entity, uint32_t> bus_index_;
+    std::vector<uint8_t> is_source_;
+    std::vector<std::vector<uint32_t>> bus_lines_; // 母线 -> 相连线路下标
+    std::vector<LineModel> lines_;
+    std::unordered_map<Entity, uint32_t> line_index_;
+    std::unordered_map<Entity, uint32_t> breaker_index_;
+    std::vector<uint8_t> breaker_open_;
+    std::vector<uint32_t> breaker_line_; // 断路器 -> 所在线路下标
+
+    std::vector<AdaptiveRelay> relays_;
+    std::vector<uint32_t> relay_line_; // 继电器 -> 装设线路下标
+    std::vector<int> relay_end_; // 继电器位于装设线路的哪一端 (0/1)
+    std::vector<RelaySettingsGroup> settings_;
+    std::vector<std::vector<uint32_t>> relays_at_bus_; // 区域索引: 母线 -> 保护区包含该母线的继电器
+
+    std::vector<uint32_t> distance_; // 各母线离最近电源的线路数 (只经投运线路)
+    std::vector<uint32_t> scratch_distance_;
+    std::vector<uint32_t> pending_buses_; // 变化区域 (自上次 refresh 以来)
+    std::vector<uint8_t> bus_marked_;
+    std::vector<uint32_t> candidate_mark_; // 继电器在本次 refresh 中是否已被选中 (按 refresh 序号)
+    std::vector<uint32_t> changed_;
+    uint32_t refresh_epoch_ = 0;
+    size_t last_recomputed_ = 0;
+    bool finalized_ = false;
+    AdaptiveProtectionStats stats_;
+};
+
+#endif // ADAPTIVE_PROTECTION_H
@@ -1,12 +1,20 @@
 // avc_simulation.cpp
 //  包含自动电压控制 (AVC) 相关的复杂仿真场景定义与测试函数。
 //  这个文件演示了如何使用协程库构建一个包含传感器、控制器和监测器的多智能体仿真。
+#include "PowerSystemTopology.h" // 电网拓扑 (状态估计场景的网络模型)
+#include "counter_rng.h" // 基于计数器的随机数生成器
 #include "cps_coro_lib.h" // 核心协程库
 #include "ecs_core.h" // 实体组件系统核心
 #include "simulation_events_and_data.h" // 共享的事件ID和数据结构
+#include "state_estimator.h" // WLS状态估计
+#include <algorithm> // 用于 std::max
+#include <chrono> // 用于量测估计耗时
+#include <cmath> // 用于 std::sqrt 等
 #include <iomanip> // 用于 std::fixed 和 std::setprecision，以控制浮点数输出格式
 #include <iostream> // 用于标准输入输出流 (主要是 std::cout)
 #include <string> // 用于 std::string (例如在 LoadDataAvc 结构体中)
+#include <unordered_map> // 用于支路参数表
+#include <vector> // 用于量测槽位与状态数组
 
 // 电压数据结构体 (用于 VOLTAGE_CHANGE_EVENT_AVC)
 struct VoltageDataAvc {
@@ -273,4 +281,310 @@ void avc_test_realtime()
     // std::cout << "[" << current_sim_ms_avc(rt_scheduler) << "毫秒] 主程序 (实时模式): LoadMonitor任务句柄状态: " << (load_monitor_task_rt.is_done() ? "已完成/分离" : "未完成") << std::endl;
 
     std::cout << "--- 实时模式AVC复杂场景仿真结束 ---" << std::endl;
-}
\ No newline at end of file
+}
+
+// --- 状态估计场景 ---
+// 上面的场景中传感器直接发布脚本化的电压值，控制器据此动作。以下场景中各厂站的远动终端 (RTU) 每秒上送
+// 带噪声的电压幅值、注入功率与部分支路潮流，状态估计器 (WlsStateEstimator) 每秒把全部量测与网络模型协调为
+// 一致的状态，AVC控制器改为接收估计电压，单个坏量测不会直接触发控制动作。
+
+// RTU上送的一组量测 (用于 MEASUREMENT_REPORT_EVENT_AVC)，values 依次对应自 first_slot 起的连续槽位
+struct MeasurementReportAvc {
+    uint32_t rtu;
+    uint32_t first_slot;
+    std::vector<double> values;
+    cps_coro::Scheduler::time_point timestamp;
+};
+
+constexpr uint64_t SE_SCENARIO_SEED = 20240817;
+constexpr long long SE_STALE_MS = 3000; // 超过此时长未上送的RTU，其量测不参与估计
+
+// 状态估计场景的共享数据
+struct SeScenarioAvc {
+    WlsStateEstimator estimator;
+    std::vector<double> true_theta, true_vmag; // 真实电网状态 (按估计器的母线序号)
+    std::vector<double> base_vmag; // 电压幅值漂移的回归中心
+    std::vector<double> true_measurements; // 真实状态下各槽位的量测值 (每秒更新)
+    std::vector<uint32_t> rtu_first_slot; // RTU r 的量测槽位为 [rtu_first_slot[r], rtu_first_slot[r+1])
+    std::vector<long long> rtu_last_report_ms;
+    uint32_t avc_rtu = 0; // AVC 关注的母线所在的RTU
+    int avc_bus = 0; // AVC 关注的母线 (序号)
+    uint32_t avc_voltage_slot = 0;
+    BranchId avc_spare_branch = 0; // AVC母线上未配置潮流量测的一条支路 (第15秒新增量测)
+};
+
+// 状态估计统计
+struct SeRunStatsAvc {
+    uint64_t cycles = 0;
+    uint64_t iterations = 0;
+    int max_iterations = 0;
+    uint64_t unconverged = 0;
+    uint64_t unobservable = 0;
+    uint64_t stale_measurements = 0; // 因RTU超时而未参与估计的量测 (按周期累计)
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+    double first_ms = 0.0; // 第一个周期
+    double analysis_ms = 0.0; // 建模阶段的符号分解
+    uint64_t over_budget = 0; // 超过1秒周期的估计次数
+    double raw_v_error_sq = 0.0; // 电压幅值量测与真实值之差的平方和
+    double est_v_error_sq = 0.0; // 电压幅值估计与真实值之差的平方和
+    uint64_t v_samples = 0;
+    double est_theta_error_sq = 0.0;
+    uint64_t theta_samples = 0;
+};
+
+// 合成的网格状输电网: 母线排成 side x side 的方阵，行内相邻母线全部相连，行间约三分之一的列有联络线。
+// 母线ID为 1..bus_count，支路ID从 bus_count+1 开始。
+void build_se_test_grid(int bus_count, PowerSystemTopology& topology, std::unordered_map<BranchId, SeBranchParameters>& parameters,
+    std::vector<std::pair<BusId, BusId>>& endpoints, std::vector<BranchId>& branch_ids)
+{
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(bus_count))));
+    std::vector<BusId> bus_ids;
+    for (int i = 0; i < bus_count; ++i)
+        bus_ids.push_back(i + 1);
+    auto add_branch = [&](int a, int b) {
+        const BranchId id = bus_count + 1 + static_cast<BranchId>(branch_ids.size());
+        CounterRng rng(SE_SCENARIO_SEED, static_cast<uint64_t>(id), RngStream::SE_NETWORK);
+        const double x = rng.uniform(0.02, 0.08);
+        parameters[id] = { x * rng.uniform(0.1, 0.3), x, rng.uniform(0.01, 0.05) };
+        branch_ids.push_back(id);
+        endpoints.emplace_back(a + 1, b + 1);
+    };
+    for (int i = 0; i < bus_count; ++i) {
+        const int column = i % side;
+        if (column + 1 < side && i + 1 < bus_count)
+            add_branch(i, i + 1);
+        if (i + side < bus_count && (column % 3 == 0 || CounterRng::uniform_at(SE_SCENARIO_SEED, i, RngStream::SE_NETWORK, 1, 0.0, 1.0) < 0.05))
+            add_branch(i, i + side);
+    }
+    topology.buildTopology(bus_ids, branch_ids, endpoints);
+}
+
+// 电网真实状态: 每秒做一次带均值回归的随机漂移，并计算各量测槽位的真实值 (参考母线相角保持为0)
+cps_coro::Task grid_truth_coroutine_se(cps_coro::Scheduler& scheduler, SeScenarioAvc& scenario)
+{
+    const int n = scenario.estimator.bus_count();
+    for (uint32_t second = 0;; ++second) {
+        if (second > 0) {
+            for (int i = 1; i < n; ++i) {
+                CounterRng rng(SE_SCENARIO_SEED, static_cast<uint64_t>(i), RngStream::SE_STATE, second);
+                scenario.true_theta[i] += 0.0002 * rng.normal();
+                scenario.true_vmag[i] += 0.0003 * rng.normal() - 0.01 * (scenario.true_vmag[i] - scenario.base_vmag[i]);
+            }
+        }
+        scenario.estimator.evaluate(scenario.true_theta, scenario.true_vmag, scenario.true_measurements);
+        co_await cps_coro::delay(std::chrono::seconds(1));
+    }
+}
+
+// RTU 协程: 每秒 (按各自的相位) 上送一次全部量测，约2%的上送丢失。
+// AVC母线的电压互感器在第20~30秒之间输出固定的0.88 pu (与上面脚本中的严重电压跌落相同)，用于演示坏数据。
+cps_coro::Task rtu_coroutine_se(cps_coro::Scheduler& scheduler, SeScenarioAvc& scenario, uint32_t rtu)
+{
+    co_await cps_coro::delay(std::chrono::milliseconds(CounterRng(SE_SCENARIO_SEED, rtu, RngStream::SE_MEASUREMENT, 0).uniform_int(0, 999)));
+    const uint32_t first = scenario.rtu_first_slot[rtu];
+    const uint32_t last = scenario.rtu_first_slot[rtu + 1];
+    for (uint32_t sequence = 1;; ++sequence) {
+        CounterRng rng(SE_SCENARIO_SEED, rtu, RngStream::SE_MEASUREMENT, sequence);
+        if (rng.uniform() >= 0.02) {
+            MeasurementReportAvc report { rtu, first, {}, scheduler.now() };
+            report.values.reserve(last - first);
+            for (uint32_t slot = first; slot < last; ++slot)
+                report.values.push_back(scenario.true_measurements[slot] + scenario.estimator.measurement(slot).sigma * rng.normal());
+            const long long now_ms = current_sim_ms_avc(scheduler);
+            if (rtu == scenario.avc_rtu && now_ms >= 20000 && now_ms < 30000)
+                report.values[scenario.avc_voltage_slot - first] = 0.88;
+            scheduler.trigger_event(MEASUREMENT_REPORT_EVENT_AVC, report);
+        }
+        co_await cps_coro::delay(std::chrono::seconds(1));
+    }
+}
+
+// 量测接收协程: 上送到达时立即更新估计器中对应的量测槽位 (每个量测 O(1))
+cps_coro::Task measurement_receiver_coroutine_se(cps_coro::Scheduler& scheduler, SeScenarioAvc& scenario)
+{
+    while (true) {
+        const MeasurementReportAvc report = co_await cps_coro::wait_for_event<MeasurementReportAvc>(MEASUREMENT_REPORT_EVENT_AVC);
+        for (size_t k = 0; k < report.values.size(); ++k)
+            scenario.estimator.set_value(report.first_slot + static_cast<uint32_t>(k), report.values[k]);
+        scenario.rtu_last_report_ms[report.rtu] = report.timestamp.time_since_epoch().count();
+    }
+}
+
+// 状态估计协程: 全部RTU完成第一轮上送后，每秒 (第500毫秒) 运行一次估计，每5秒把AVC母线的估计电压发布给AVC控制器。
+// 第15秒在AVC母线投运一台PMU (相角量测) 并新增一条支路的潮流量测，它们落在已有的增益矩阵结构内，不引起符号分解。
+cps_coro::Task state_estimation_coroutine_se(cps_coro::Scheduler& scheduler, SeScenarioAvc& scenario, SeRunStatsAvc& stats)
+{
+    std::cout << std::fixed << std::setprecision(2);
+    co_await cps_coro::delay(std::chrono::milliseconds(1500));
+    WlsStateEstimator& estimator = scenario.estimator;
+    const int n = estimator.bus_count();
+    while (true) {
+        const long long now_ms = current_sim_ms_avc(scheduler);
+        if (now_ms >= 15000 && now_ms < 16000) {
+            const uint32_t first = static_cast<uint32_t>(estimator.measurement_count());
+            const BusId bus = estimator.bus_id(scenario.avc_bus);
+            estimator.add_measurement({ SeMeasurementType::V_ANGLE, bus, 0, 0.001 });
+            if (scenario.avc_spare_branch != 0) {
+                estimator.add_measurement({ SeMeasurementType::P_FLOW, bus, scenario.avc_spare_branch, 0.008 });
+                estimator.add_measurement({ SeMeasurementType::Q_FLOW, bus, scenario.avc_spare_branch, 0.008 });
+            }
+            scenario.rtu_first_slot.push_back(static_cast<uint32_t>(estimator.measurement_count()));
+            scenario.rtu_last_report_ms.push_back(now_ms);
+            estimator.evaluate(scenario.true_theta, scenario.true_vmag, scenario.true_measurements);
+            rtu_coroutine_se(scheduler, scenario, static_cast<uint32_t>(scenario.rtu_last_report_ms.size() - 1)).detach();
+            std::cout << "[" << now_ms << "毫秒] 状态估计: AVC母线 " << estimator.bus_id(scenario.avc_bus) << " 新投运PMU，新增量测 "
+                      << estimator.measurement_count() - first << " 个 (增量加入 " << estimator.stats().incremental_additions
+                      << " 个，符号分解累计 " << estimator.stats().symbolic_analyses << " 次)。" << std::endl;
+        }
+
+        // 超时RTU的量测不参与估计
+        for (size_t rtu = 0; rtu + 1 < scenario.rtu_first_slot.size(); ++rtu) {
+            if (now_ms - scenario.rtu_last_report_ms[rtu] <= SE_STALE_MS)
+                continue;
+            for (uint32_t slot = scenario.rtu_first_slot[rtu]; slot < scenario.rtu_first_slot[rtu + 1]; ++slot) {
+                stats.stale_measurements += estimator.available(slot);
+                estimator.set_available(slot, false);
+            }
+        }
+
+        const auto wall_start = std::chrono::steady_clock::now();
+        const SeResult result = estimator.estimate();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+        if (stats.cycles == 0)
+            stats.first_ms = ms;
+        ++stats.cycles;
+        stats.iterations += result.iterations;
+        stats.max_iterations = std::max(stats.max_iterations, result.iterations);
+        stats.unconverged += !result.converged;
+        stats.unobservable += !result.observable;
+        stats.total_ms += ms;
+        stats.max_ms = std::max(stats.max_ms, ms);
+        stats.over_budget += ms > 1000.0;
+
+        // 精度: 与当前真实状态比较 (量测取自最近一次上送)
+        for (uint32_t slot = 0; slot < estimator.measurement_count(); ++slot) {
+            const SeMeasurement& m = estimator.measurement(slot);
+            if (m.type == SeMeasurementType::V_MAGNITUDE && estimator.available(slot)) {
+                const double truth = scenario.true_vmag[estimator.index_of(m.bus)];
+                stats.raw_v_error_sq += (estimator.value(slot) - truth) * (estimator.value(slot) - truth);
+                ++stats.v_samples;
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            const double dv = estimator.vmag()[i] - scenario.true_vmag[i];
+            const double dt = estimator.theta()[i] - scenario.true_theta[i];
+            stats.est_v_error_sq += dv * dv;
+            stats.est_theta_error_sq += dt * dt;
+        }
+        stats.theta_samples += n;
+
+        if (stats.cycles % 5 == 0 || !result.observable) {
+            const SeMeasurement& worst = estimator.measurement(result.max_residual_slot);
+            static const char* const type_names[] = { "电压幅值", "相角", "注入有功", "注入无功", "支路有功", "支路无功" };
+            std::cout << "[" << now_ms << "毫秒] 状态估计: 量测 " << result.measurements << " 个，迭代 " << result.iterations << " 次，耗时 "
+                      << ms << " 毫秒，J = " << result.objective << "，最大加权残差 " << result.max_normalized_residual << " (母线 "
+                      << worst.bus << " " << type_names[static_cast<int>(worst.type)] << ")。AVC母线电压: 量测 "
+                      << estimator.value(scenario.avc_voltage_slot) << " pu，估计 " << estimator.vmag()[scenario.avc_bus] << " pu，真实 "
+                      << scenario.true_vmag[scenario.avc_bus] << " pu。" << std::endl;
+            scheduler.trigger_event(VOLTAGE_CHANGE_EVENT_AVC, VoltageDataAvc { estimator.vmag()[scenario.avc_bus], scheduler.now() });
+        }
+        co_await cps_coro::delay(std::chrono::seconds(1));
+    }
+}
+
+// 状态估计场景 (非实时): bus_count 条母线的网格状输电网，每条母线一台RTU，仿真 seconds 秒
+void avc_test_state_estimation(int bus_count, double seconds)
+{
+    std::cout << "\n--- 开始 AVC 状态估计场景仿真: " << bus_count << " 条母线, " << seconds << " 秒 ---" << std::endl;
+    bus_count = std::max(bus_count, 4);
+    cps_coro::Scheduler scheduler;
+
+    PowerSystemTopology topology;
+    std::unordered_map<BranchId, SeBranchParameters> parameters;
+    std::vector<std::pair<BusId, BusId>> endpoints;
+    std::vector<BranchId> branch_ids;
+    build_se_test_grid(bus_count, topology, parameters, endpoints, branch_ids);
+
+    SeScenarioAvc scenario;
+    WlsStateEstimator& estimator = scenario.estimator;
+    if (!estimator.build(topology, parameters, 1))
+        return;
+    const int n = estimator.bus_count();
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(bus_count))));
+
+    // 真实状态初值: 相角沿网格方向逐渐滞后，电压幅值在 0.99~1.04 pu 之间
+    scenario.true_theta.resize(n);
+    scenario.true_vmag.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const int k = estimator.bus_id(i) - 1;
+        CounterRng rng(SE_SCENARIO_SEED, static_cast<uint64_t>(i), RngStream::SE_STATE, 0);
+        scenario.true_theta[i] = k == 0 ? 0.0 : -0.002 * (k / side + k % side) + 0.002 * rng.normal();
+        scenario.true_vmag[i] = rng.uniform(0.99, 1.04);
+    }
+    scenario.base_vmag = scenario.true_vmag;
+
+    // 量测配置: 每条母线的RTU量测本母线电压幅值与注入功率，以及约40%的相连支路 (在序号较小的一端) 的潮流
+    std::vector<std::vector<BranchId>> metered(n);
+    scenario.avc_bus = estimator.index_of(bus_count / 2 + side / 2);
+    for (size_t e = 0; e < branch_ids.size(); ++e) {
+        const int from = estimator.index_of(endpoints[e].first);
+        if (from == scenario.avc_bus && scenario.avc_spare_branch == 0)
+            scenario.avc_spare_branch = branch_ids[e]; // 留给第15秒新投运的量测
+        else if (CounterRng::uniform_at(SE_SCENARIO_SEED, branch_ids[e], RngStream::SE_NETWORK, 2, 0.0, 1.0) < 0.4)
+            metered[from].push_back(branch_ids[e]);
+    }
+    for (int i = 0; i < n; ++i) {
+        scenario.rtu_first_slot.push_back(static_cast<uint32_t>(estimator.measurement_count()));
+        const BusId bus = estimator.bus_id(i);
+        const uint32_t v_slot = estimator.add_measurement({ SeMeasurementType::V_MAGNITUDE, bus, 0, 0.004 });
+        if (i == scenario.avc_bus) {
+            scenario.avc_rtu = static_cast<uint32_t>(i);
+            scenario.avc_voltage_slot = v_slot;
+        }
+        estimator.add_measurement({ SeMeasurementType::P_INJECTION, bus, 0, 0.01 });
+        estimator.add_measurement({ SeMeasurementType::Q_INJECTION, bus, 0, 0.01 });
+        for (BranchId branch : metered[i]) {
+            estimator.add_measurement({ SeMeasurementType::P_FLOW, bus, branch, 0.008 });
+            estimator.add_measurement({ SeMeasurementType::Q_FLOW, bus, branch, 0.008 });
+        }
+    }
+    scenario.rtu_first_slot.push_back(static_cast<uint32_t>(estimator.measurement_count()));
+    scenario.rtu_last_report_ms.assign(n, 0);
+    std::cout << "[0毫秒] 主程序: 网络 " << n << " 条母线、" << branch_ids.size() << " 条支路，" << n << " 台RTU，量测 "
+              << estimator.measurement_count() << " 个 (冗余度 " << estimator.measurement_count() / (2.0 * n - 1.0) << ")。" << std::endl;
+
+    // 符号分解放在建模阶段，不占用第一个1秒估计周期
+    SeRunStatsAvc stats;
+    const auto analysis_start = std::chrono::steady_clock::now();
+    estimator.prepare();
+    stats.analysis_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - analysis_start).count();
+
+    grid_truth_coroutine_se(scheduler, scenario).detach();
+    measurement_receiver_coroutine_se(scheduler, scenario).detach();
+    for (uint32_t rtu = 0; rtu < static_cast<uint32_t>(n); ++rtu)
+        rtu_coroutine_se(scheduler, scenario, rtu).detach();
+    state_estimation_coroutine_se(scheduler, scenario, stats).detach();
+    avc_coroutine_complex_avc(scheduler).detach();
+
+    scheduler.run_until(scheduler.now() + std::chrono::milliseconds(std::llround(seconds * 1000.0)));
+
+    const SeStats& se = estimator.stats();
+    std::cout << std::setprecision(2);
+    std::cout << "[" << current_sim_ms_avc(scheduler) << "毫秒] 主程序: 状态估计 " << stats.cycles << " 个周期，平均迭代 "
+              << (stats.cycles ? static_cast<double>(stats.iterations) / stats.cycles : 0.0) << " 次 (最多 " << stats.max_iterations
+              << " 次，未收敛 " << stats.unconverged << " 次，不可观 " << stats.unobservable << " 次)。" << std::endl;
+    std::cout << "[" << current_sim_ms_avc(scheduler) << "毫秒] 主程序: 每周期平均耗时 " << (stats.cycles ? stats.total_ms / stats.cycles : 0.0)
+              << " 毫秒，最长 " << stats.max_ms << " 毫秒 (超过1秒周期 " << stats.over_budget << " 次)；首个周期 " << stats.first_ms
+              << " 毫秒，建模阶段的符号分解 " << stats.analysis_ms << " 毫秒。" << std::endl;
+    std::cout << "[" << current_sim_ms_avc(scheduler) << "毫秒] 主程序: 符号分解 " << se.symbolic_analyses << " 次，数值分解 "
+              << se.numeric_factorizations << " 次，运行中增量加入量测 " << se.incremental_additions << " 个；增益矩阵上三角 "
+              << se.gain_blocks << " 个2x2块，Cholesky因子 " << se.factor_blocks << " 个2x2块。超时未参与估计的量测累计 "
+              << stats.stale_measurements << " 个。" << std::endl;
+    std::cout << std::setprecision(5);
+    std::cout << "[" << current_sim_ms_avc(scheduler) << "毫秒] 主程序: 电压幅值均方根误差: 原始量测 "
+              << (stats.v_samples ? std::sqrt(stats.raw_v_error_sq / stats.v_samples) : 0.0) << " pu，估计 "
+              << (stats.theta_samples ? std::sqrt(stats.est_v_error_sq / stats.theta_samples) : 0.0) << " pu；相角估计均方根误差 "
+              << (stats.theta_samples ? std::sqrt(stats.est_theta_error_sq / stats.theta_samples) : 0.0) << " 弧度。" << std::endl;
+    std::cout << "--- AVC 状态估计场景仿真结束 ---" << std::endl;
+}
@@ -0,0 +1,67 @@
+// columnar_writer.cpp
+// 实现了按列存储时间序列文件的流式写入。
+
+#include "columnar_writer.h"
+
+#include <cstdint>
+
+bool ColumnarWriter::open(const std::string& path, const std::vector<std::string>& columns, double start_s, double step_s,
+    size_t row_group_rows)
+{
+    close();
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_)
+        return false;
+
+    columns_ = columns.size();
+    group_capacity_ = row_group_rows ? row_group_rows : 1;
+    group_rows_ = 0;
+    group_.assign(columns_ * group_capacity_, 0.0f);
+    rows_written_ = 0;
+    bytes_written_ = 0;
+
+    auto put = [this](const void* data, size_t bytes) {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        bytes_written_ += bytes;
+    };
+    const uint32_t column_count = static_cast<uint32_t>(columns_);
+    put("CPSCOL01", 8);
+    put(&column_count, sizeof(column_count));
+    put(&start_s, sizeof(start_s));
+    put(&step_s, sizeof(step_s));
+    for (const auto& name : columns) {
+        const uint16_t len = static_cast<uint16_t>(name.size());
+        put(&len, sizeof(len));
+        put(name.data(), len);
+    }
+    return static_cast<bool>(out_);
+}
+
+void ColumnarWriter::append_row(const float* values)
+{
+    for (size_t c = 0; c < columns_; ++c)
+        group_[c * group_capacity_ + group_rows_] = values[c];
+    if (++group_rows_ == group_capacity_)
+        flush_group();
+}
+
+void ColumnarWriter::flush_group()
+{
+    if (group_rows_ == 0)
+        return;
+    const uint32_t rows = static_cast<uint32_t>(group_rows_);
+    out_.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    for (size_t c = 0; c < columns_; ++c)
+        out_.write(reinterpret_cast<const char*>(&group_[c * group_capacity_]), static_cast<std::streamsize>(group_rows_ * sizeof(float)));
+    bytes_written_ += sizeof(rows) + columns_ * group_rows_ * sizeof(float);
+    rows_written_ += group_rows_;
+    group_rows_ = 0;
+}
+
+void ColumnarWriter::close()
+{
+    if (!out_.is_open())
+        return;
+    flush_group();
+    out_.close();
+}
@@ -0,0 +1,55 @@
+// columnar_writer.h
+// 按列存储的时间序列输出文件 (流式写入)。
+// 长时间序列仿真 (例如全年1秒分辨率) 的结果行数可达数千万，逐行文本输出既慢又占空间。
+// 本写入器把数据按行组 (row group) 缓存在内存中，每满一组就按列连续写出，内存占用与总行数无关，
+// 读取方只需按列偏移跳读即可取出单列，便于后续用分析工具加载。
+//
+// 文件格式 (小端):
+//   文件头: 魔数 "CPSCOL01" (8字节) | uint32 列数 | double 起始时间 (秒) | double 时间步长 (秒)
+//           | 每列: uint16 列名字节数 + 列名 (UTF-8)
+//   行组:   uint32 行数 n | 第0列 n 个 float | 第1列 n 个 float | ...
+// 行时间不单独存储，第 k 行的时间为 起始时间 + k × 时间步长。
+#ifndef COLUMNAR_WRITER_H
+#define COLUMNAR_WRITER_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ColumnarWriter {
+public:
+    ColumnarWriter() = default;
+    ~ColumnarWriter() { close(); }
+
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+    // 创建 (覆盖) 文件并写入文件头。失败时返回 false。
+    bool open(const std::string& path, const std::vector<std::string>& columns, double start_s, double step_s,
+        size_t row_group_rows = 65536);
+
+    // 追加一行，values 的长度须等于列数
+    void append_row(const float* values);
+
+    // 写出未满的行组并关闭文件
+    void close();
+
+    bool is_open() const { return out_.is_open(); }
+    size_t column_count() const { return columns_; }
+    size_t rows_written() const { return rows_written_; }
+    size_t bytes_written() const { return bytes_written_; }
+
+private:
+    void flush_group();
+
+    std::ofstream out_;
+    size_t columns_ = 0;
+    size_t group_capacity_ = 0;
+    size_t group_rows_ = 0;
+    std::vector<float> group_; // 按列存放的当前行组: 第 c 列位于 [c × group_capacity_, (c + 1) × group_capacity_)
+    size_t rows_written_ = 0;
+    size_t bytes_written_ = 0;
+};
+
+#endif // COLUMNAR_WRITER_H
@@ -0,0 +1,153 @@
+// comm_network.h
+// 二次系统通信网络模型 (IED与控制器之间的通信通道)。
+// 保护跳闸、断路器遥控和VPP调度等指令不再以 trigger_event 瞬时广播，而是经由通信通道送达：
+// - 每条通道是一个实体，带有 CommChannelComponent (时延分布、丢包率、带宽、发送队列上限和统计量)；
+// - 报文按通道先进先出串行发送: 排队等待 + 发送时长 (报文字节数 / 带宽) + 传播与处理时延 (基础时延 + 指数分布抖动)，
+//   同一通道上的报文按发送顺序到达；发送队列积压超过上限时报文被丢弃 (尾丢弃)；
+// - 报文到达时在调度器上触发其事件ID，接收方协程仍以 wait_for_event 等待，与直接触发时写法相同。
+// 报文存放在预分配的槽位池中 (空闲链表复用，载荷按值内联存放)，在途报文由时间轮 (1ms节拍) 管理，
+// 整个网络只有一个投递协程，且仅在有报文在途时才逐节拍推进，空闲的通道和节点不产生任何调度开销。
+// 时延与丢包的随机量由 (种子, 通道实体, 报文序号) 决定，与其他通道的流量无关，可逐位复现。
+#ifndef COMM_NETWORK_H
+#define COMM_NETWORK_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "timing_wheel.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// 通信通道参数
+struct CommChannelParams {
+    double base_latency_ms = 2.0; // 基础时延 (传播 + 协议处理，毫秒)
+    double jitter_ms = 0.5; // 抖动: 在基础时延上叠加均值为该值的指数分布时延 (毫秒)
+    double loss_rate = 0.0; // 丢包率 (0~1)
+    double bandwidth_kbps = 100000.0; // 通道带宽 (kbit/s)
+    uint32_t frame_overhead_bytes = 64; // 每帧协议开销 (报头、校验等，字节)
+    uint32_t queue_limit_bytes = 64 * 1024; // 发送队列上限 (字节)，积压超过该值的新报文被丢弃
+
+    // 典型规约的参数预设
+    static CommChannelParams goose(); // IEC 61850 GOOSE，站内过程层/间隔层以太网
+    static CommChannelParams iec104(); // IEC 60870-5-104，主站至厂站的广域网
+    static CommChannelParams dnp3_serial(); // DNP3 串口 (9600bit/s) 配网终端
+};
+
+// 组件 (Component): 通信通道
+// 表示一条从 source 到 destination 的单向通信通道 (如保护装置至断路器智能终端的GOOSE链路)。
+struct CommChannelComponent : public IComponent {
+    CommChannelParams params;
+    Entity source; // 发送方实体 (0表示未指定)
+    Entity destination; // 接收方实体 (0表示未指定)
+
+    // 运行状态
+    double busy_until_ms = 0.0; // 发送端口空闲的时刻 (此前已排队的报文发送完毕)
+    double last_arrival_ms = 0.0; // 上一报文的到达时刻，用于保证同一通道按序到达
+    uint32_t next_sequence = 0; // 下一报文序号 (随机量的步号)
+
+    // 统计量
+    uint64_t sent = 0; // 被接受发送的报文数 (含途中丢失)
+    uint64_t delivered = 0;
+    uint64_t lost = 0; // 途中丢失
+    uint64_t dropped = 0; // 发送队列溢出丢弃
+    uint64_t bytes_sent = 0;
+    double total_latency_ms = 0.0; // 已送达报文的端到端时延之和 (含排队)
+    double max_latency_ms = 0.0;
+
+    CommChannelComponent(const CommChannelParams& p, Entity src, Entity dst)
+        : params(p)
+        , source(src)
+        , destination(dst)
+    {
+    }
+};
+
+// 全网统计
+struct CommNetworkStats {
+    size_t channels = 0;
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+    uint64_t lost = 0;
+    uint64_t dropped = 0;
+    uint64_t bytes_sent = 0;
+    double mean_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+    size_t pool_capacity = 0; // 报文槽位池的容量 (即同时在途报文数的峰值)
+};
+
+class CommNetwork {
+public:
+    // 报文载荷的最大字节数。载荷按值存放在槽位中，须可平凡复制 (与事件数据结构体的用法一致)。
+    static constexpr size_t MAX_PAYLOAD_BYTES = 48;
+
+    CommNetwork(Registry& registry, cps_coro::Scheduler& scheduler, uint64_t seed);
+
+    // 创建一条通道实体
+    Entity add_channel(const CommChannelParams& params, Entity source = 0, Entity destination = 0);
+
+    // 预分配报文槽位 (可选，槽位池会按需增长)
+    void reserve(size_t in_flight_messages);
+
+    // 启动投递协程。须在调度器运行前调用一次。
+    void start();
+
+    // 经通道发送报文，到达时以 event_id 触发事件并携带 payload。
+    // payload_bytes 为报文的应用层字节数 (默认为载荷结构体大小)，用于计算发送时长和队列占用。
+    // 报文被发送队列拒绝时返回 false；途中丢失对发送方不可见，仍返回 true。
+    template <typename T>
+    bool send(Entity channel, cps_coro::EventId event_id, const T& payload, uint32_t payload_bytes = sizeof(T))
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "通信报文载荷须可平凡复制");
+        static_assert(sizeof(T) <= MAX_PAYLOAD_BYTES, "通信报文载荷超过槽位容量");
+        return enqueue(channel, event_id, &payload, sizeof(T), &deliver_as<T>, payload_bytes);
+    }
+
+    CommNetworkStats stats() const;
+    size_t in_flight() const { return in_flight_; }
+
+private:
+    using DeliverFn = void (*)(cps_coro::Scheduler&, cps_coro::EventId, const void*);
+
+    // 报文槽位。在途报文在时间轮中只以槽位下标表示。
+    struct MessageSlot {
+        cps_coro::EventId event_id;
+        DeliverFn deliver;
+        CommChannelComponent* channel;
+        double sent_ms;
+        double arrival_ms;
+        alignas(std::max_align_t) unsigned char payload[MAX_PAYLOAD_BYTES];
+    };
+
+    template <typename T>
+    static void deliver_as(cps_coro::Scheduler& scheduler, cps_coro::EventId event_id, const void* payload)
+    {
+        T data;
+        std::memcpy(&data, payload, sizeof(T));
+        scheduler.trigger_event(event_id, data);
+    }
+
+    bool enqueue(Entity channel, cps_coro::EventId event_id, const void* payload, size_t size, DeliverFn deliver,
+        uint32_t payload_bytes);
+    uint32_t acquire_slot();
+    void deliver_slot(uint32_t slot);
+
+    Registry& registry_;
+    cps_coro::Scheduler& scheduler_;
+    uint64_t seed_;
+
+    std::vector<CommChannelComponent*> channels_; // 组件指针在注册表中保持稳定，缓存以便统计
+    std::unordered_map<Entity, CommChannelComponent*> channel_index_; // 发送时按通道实体查找，免去注册表的两级查找
+    std::vector<MessageSlot> slots_;
+    std::vector<uint32_t> free_slots_;
+    TimingWheel<uint32_t> wheel_;
+    size_t in_flight_ = 0;
+    cps_coro::TickDispatcher ticker_; // 投递协程在没有在途报文时挂起，有新报文时由 enqueue 恢复
+    cps_coro::Task dispatcher_;
+};
+
+#endif // COMM_NETWORK_H
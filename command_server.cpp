@@ -0,0 +1,357 @@
+// command_server.cpp
+// 实现了命令服务的帧编解码与基于 poll() 的后台 I/O 线程。
+// 仅在 POSIX 平台上可用，其他平台上 start() 返回 false。
+#include "command_server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define CPS_COMMAND_SERVER_SOCKET 1
+#endif
+
+namespace {
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value)
+{
+    const auto* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// 读取帧头: 返回帧体字节数，数据不足时返回 false
+bool frame_body_size(const uint8_t* data, size_t size, uint32_t& body, bool& malformed)
+{
+    if (size < sizeof(uint32_t))
+        return false;
+    body = get<uint32_t>(data);
+    if (body > COMMAND_MAX_FRAME_BYTES) {
+        malformed = true;
+        return false;
+    }
+    return size >= sizeof(uint32_t) + body;
+}
+
+} // namespace
+
+// --- 编解码 ---
+
+void encode_command_request(const CommandRequest& request, std::vector<uint8_t>& out)
+{
+    const uint16_t target_len = static_cast<uint16_t>(std::min<size_t>(request.target.size(), COMMAND_MAX_FRAME_BYTES - 8));
+    put<uint32_t>(out, 4 + 1 + 1 + 2 + target_len);
+    put<uint32_t>(out, request.request_id);
+    put<uint8_t>(out, static_cast<uint8_t>(request.op));
+    put<uint8_t>(out, request.arg);
+    put<uint16_t>(out, target_len);
+    out.insert(out.end(), request.target.begin(), request.target.begin() + target_len);
+}
+
+size_t decode_command_request(const uint8_t* data, size_t size, CommandRequest& out, bool& malformed)
+{
+    uint32_t body = 0;
+    if (!frame_body_size(data, size, body, malformed))
+        return 0;
+    const uint8_t* p = data + sizeof(uint32_t);
+    if (body < 8 || body != 8u + get<uint16_t>(p + 6)) {
+        malformed = true;
+        return 0;
+    }
+    out.request_id = get<uint32_t>(p);
+    out.op = static_cast<CommandOp>(p[4]);
+    out.arg = p[5];
+    out.target.assign(reinterpret_cast<const char*>(p + 8), body - 8);
+    return sizeof(uint32_t) + body;
+}
+
+void encode_command_response(const CommandResponse& response, std::vector<uint8_t>& out)
+{
+    const uint8_t value_count = static_cast<uint8_t>(std::min<size_t>(response.values.size(), 255));
+    put<uint32_t>(out, 4 + 1 + 1 + 8 + value_count);
+    put<uint32_t>(out, response.request_id);
+    put<uint8_t>(out, static_cast<uint8_t>(response.status));
+    put<uint8_t>(out, value_count);
+    put<uint64_t>(out, response.sim_time_ms);
+    out.insert(out.end(), response.values.begin(), response.values.begin() + value_count);
+}
+
+size_t decode_command_response(const uint8_t* data, size_t size, CommandResponse& out, bool& malformed)
+{
+    uint32_t body = 0;
+    if (!frame_body_size(data, size, body, malformed))
+        return 0;
+    const uint8_t* p = data + sizeof(uint32_t);
+    if (body < 14 || body != 14u + p[5]) {
+        malformed = true;
+        return 0;
+    }
+    out.request_id = get<uint32_t>(p);
+    out.status = static_cast<CommandStatus>(p[4]);
+    out.sim_time_ms = get<uint64_t>(p + 6);
+    out.values.assign(p + 14, p + body);
+    return sizeof(uint32_t) + body;
+}
+
+// --- CommandServer ---
+
+bool CommandServer::start(const std::string& socket_path)
+{
+    stop();
+#if defined(CPS_COMMAND_SERVER_SOCKET)
+    sockaddr_un addr {};
+    if (socket_path.size() >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0)
+        return false;
+    ::unlink(socket_path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd_, 16) != 0 || ::pipe(wake_fds_) != 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    for (int fd : { listen_fd_, wake_fds_[0], wake_fds_[1] })
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    socket_path_ = socket_path;
+    stats_ = {};
+    stopping_ = false;
+    io_thread_ = std::thread(&CommandServer::io_loop, this);
+    return true;
+#else
+    (void)socket_path;
+    return false;
+#endif
+}
+
+void CommandServer::stop()
+{
+#if defined(CPS_COMMAND_SERVER_SOCKET)
+    if (!io_thread_.joinable())
+        return;
+    stopping_ = true;
+    wake_io();
+    io_thread_.join();
+    ::close(listen_fd_);
+    ::close(wake_fds_[0]);
+    ::close(wake_fds_[1]);
+    listen_fd_ = wake_fds_[0] = wake_fds_[1] = -1;
+    ::unlink(socket_path_.c_str());
+    std::lock_guard<std::mutex> lock(mutex_);
+    inbound_.clear();
+    outbound_.clear();
+#endif
+}
+
+void CommandServer::wake_io()
+{
+#if defined(CPS_COMMAND_SERVER_SOCKET)
+    const uint8_t byte = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_fds_[1], &byte, 1); // 管道已满时写入失败也无妨: I/O 线程已经会被唤醒
+#endif
+}
+
+size_t CommandServer::take_batch(std::vector<CommandRequest>& batch)
+{
+    batch.clear();
+    bool was_full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(inbound_);
+        was_full = batch.size() >= COMMAND_MAX_PENDING_REQUESTS;
+        if (!batch.empty()) {
+            ++stats_.batches;
+            stats_.max_batch = std::max<uint64_t>(stats_.max_batch, batch.size());
+        }
+        if (was_full)
+            ++stats_.throttled_batches;
+    }
+    if (was_full)
+        wake_io(); // I/O 线程暂停了读取，唤醒它继续读取与解析
+    return batch.size();
+}
+
+void CommandServer::respond(std::vector<CommandResponse>& responses)
+{
+    if (responses.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (outbound_.empty())
+            outbound_.swap(responses);
+        else
+            std::move(responses.begin(), responses.end(), std::back_inserter(outbound_));
+    }
+    responses.clear();
+    wake_io();
+}
+
+CommandServerStats CommandServer::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void CommandServer::io_loop()
+{
+#if defined(CPS_COMMAND_SERVER_SOCKET)
+    struct Client {
+        int fd;
+        std::vector<uint8_t> in;
+        std::vector<uint8_t> out;
+        size_t out_offset = 0;
+    };
+    std::unordered_map<uint64_t, Client> clients;
+    uint64_t next_client = 1;
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> fd_clients;
+    std::vector<CommandRequest> parsed;
+    std::vector<CommandResponse> replies;
+    uint8_t buf[4096];
+
+    auto drop = [&](uint64_t id) {
+        auto it = clients.find(id);
+        if (it != clients.end()) {
+            ::close(it->second.fd);
+            clients.erase(it);
+        }
+    };
+
+    // 请求队列剩余的容量；为0时不再读取与解析，积压留在套接字缓冲和各连接的输入缓冲中
+    auto queue_room = [&]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return COMMAND_MAX_PENDING_REQUESTS - std::min(inbound_.size(), COMMAND_MAX_PENDING_REQUESTS);
+    };
+
+    while (!stopping_) {
+        const bool reading = queue_room() > 0;
+        fds.clear();
+        fd_clients.clear();
+        fds.push_back({ wake_fds_[0], POLLIN, 0 });
+        fds.push_back({ listen_fd_, POLLIN, 0 });
+        for (auto& [id, c] : clients) {
+            short events = reading && c.in.size() < COMMAND_CLIENT_READ_BYTES ? POLLIN : 0;
+            if (c.out_offset < c.out.size())
+                events |= POLLOUT;
+            fds.push_back({ c.fd, events, 0 });
+            fd_clients.push_back(id);
+        }
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        // 仿真线程交回的应答: 追加到各连接的发送缓冲
+        if (fds[0].revents & POLLIN) {
+            while (::read(wake_fds_[0], buf, sizeof(buf)) > 0) { }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                replies.swap(outbound_);
+            }
+            for (const auto& r : replies) {
+                auto it = clients.find(r.client);
+                if (it != clients.end())
+                    encode_command_response(r, it->second.out);
+            }
+            replies.clear();
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd;
+            while ((fd = ::accept(listen_fd_, nullptr, nullptr)) >= 0) {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+                clients.emplace(next_client++, Client { fd, {}, {} });
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.connections;
+            }
+        }
+
+        // 仿真线程可能在 poll() 期间取走了一批，这里重新计算容量；解析出的请求数不超过剩余容量
+        size_t room = queue_room();
+        for (size_t i = 2; i < fds.size(); ++i) {
+            const uint64_t id = fd_clients[i - 2];
+            Client& c = clients.at(id);
+            bool closed = (fds[i].revents & (POLLERR | POLLNVAL)) != 0;
+
+            if (!closed && (fds[i].revents & POLLIN)) {
+                ssize_t n = 1;
+                while (c.in.size() < COMMAND_CLIENT_READ_BYTES && (n = ::read(c.fd, buf, sizeof(buf))) > 0)
+                    c.in.insert(c.in.end(), buf, buf + n);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                    closed = true;
+            } else if (fds[i].revents & POLLHUP) {
+                closed = true; // 对端已关闭: 暂停读取期间仍在套接字缓冲中的请求随连接一起丢弃
+            }
+
+            // 已读入的请求 (包括上次因队列已满而留在输入缓冲中的) 在这里解析
+            if (room > 0) {
+                size_t consumed = 0;
+                bool malformed = false;
+                CommandRequest request;
+                while (room > 0) {
+                    const size_t used = decode_command_request(c.in.data() + consumed, c.in.size() - consumed, request, malformed);
+                    if (!used)
+                        break;
+                    request.client = id;
+                    parsed.push_back(std::move(request));
+                    consumed += used;
+                    --room;
+                }
+                c.in.erase(c.in.begin(), c.in.begin() + consumed);
+                if (malformed)
+                    closed = true;
+            }
+
+            if (!closed && c.out_offset < c.out.size()) {
+#if defined(MSG_NOSIGNAL)
+                const int flags = MSG_NOSIGNAL;
+#else
+                const int flags = 0;
+#endif
+                ssize_t n = ::send(c.fd, c.out.data() + c.out_offset, c.out.size() - c.out_offset, flags);
+                if (n > 0)
+                    c.out_offset += static_cast<size_t>(n);
+                else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                    closed = true;
+                if (c.out_offset == c.out.size()) {
+                    c.out.clear();
+                    c.out_offset = 0;
+                }
+            }
+
+            if (closed)
+                drop(id);
+        }
+
+        if (!parsed.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requests += parsed.size();
+            std::move(parsed.begin(), parsed.end(), std::back_inserter(inbound_));
+            parsed.clear();
+        }
+    }
+
+    for (auto& [id, c] : clients)
+        ::close(c.fd);
+#endif
+}
@@ -0,0 +1,119 @@
+// command_server.h
+// 运行中仿真的本地查询/命令服务: 通过 Unix 域套接字接收紧凑的二进制请求 (注入故障、操作断路器、查询母线带电、
+// 读取组件值)。套接字的收发全部在后台 I/O 线程中进行；请求进入队列，由仿真线程在每个仿真步开始时整批取出、
+// 执行并整批交回应答，I/O 线程再异步写回各客户端，因此仿真循环从不在 I/O 上阻塞。
+//
+// 帧格式 (小端，每帧以 uint32 帧体字节数开头，不含该字段本身):
+//   请求: uint32 帧体字节数 | uint32 请求号 | uint8 操作码 | uint8 参数 | uint16 目标名字节数 | 目标名 (UTF-8)
+//   应答: uint32 帧体字节数 | uint32 请求号 | uint8 状态 | uint8 值个数 | uint64 执行时的仿真时间 (毫秒) | 值 (每个 uint8)
+// 同一连接上的请求可以流水线发送，应答按请求号对应 (同一批内按到达顺序应答)。帧体超过 COMMAND_MAX_FRAME_BYTES
+// 或格式错误时服务端关闭该连接。排队请求达到 COMMAND_MAX_PENDING_REQUESTS 时 I/O 线程暂停读取各连接，
+// 客户端的发送因套接字缓冲写满而受阻，直到仿真线程取走这一批。
+#ifndef COMMAND_SERVER_H
+#define COMMAND_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CommandOp : uint8_t {
+    PING = 1, // 无目标，应答不含值
+    INJECT_FAULT = 2, // 目标: 线路编号
+    OPERATE_BREAKER = 3, // 目标: 断路器编号，参数: 1 分闸 / 0 合闸
+    QUERY_ENERGIZATION = 4, // 目标: 母线编号，应答值: [带电]
+    READ_COMPONENT = 5, // 目标: 断路器/母线/线路编号，应答值见 CommandComponentKind
+};
+
+// READ_COMPONENT 应答的第一个值为对象类别，其后为该类别的值
+enum class CommandComponentKind : uint8_t {
+    BREAKER = 1, // [断开, 常开, 拒动]
+    BUS = 2, // [电源母线, 带电]
+    LINE = 3, // [带电, 故障]
+};
+
+enum class CommandStatus : uint8_t {
+    OK = 0,
+    UNKNOWN_TARGET = 1, // 目标名不存在
+    BAD_REQUEST = 2, // 参数无效
+    UNSUPPORTED = 3, // 操作码不支持
+};
+
+constexpr uint32_t COMMAND_MAX_FRAME_BYTES = 4096;
+constexpr size_t COMMAND_MAX_PENDING_REQUESTS = 4096; // 等待仿真线程取走的请求上限
+constexpr size_t COMMAND_CLIENT_READ_BYTES = 65536; // 每个连接未解析输入的读取上限
+constexpr const char* COMMAND_DEFAULT_SOCKET = "/tmp/cps_sim.sock";
+
+struct CommandRequest {
+    uint64_t client = 0; // 服务端内部的连接编号 (客户端编码时忽略)
+    uint32_t request_id = 0;
+    CommandOp op = CommandOp::PING;
+    uint8_t arg = 0;
+    std::string target;
+};
+
+struct CommandResponse {
+    uint64_t client = 0;
+    uint32_t request_id = 0;
+    CommandStatus status = CommandStatus::OK;
+    uint64_t sim_time_ms = 0;
+    std::vector<uint8_t> values;
+};
+
+// --- 编解码 (服务端与客户端共用) ---
+// 解码函数返回消耗的字节数；数据不足一帧时返回0；格式错误时置 malformed 并返回0。
+void encode_command_request(const CommandRequest& request, std::vector<uint8_t>& out);
+size_t decode_command_request(const uint8_t* data, size_t size, CommandRequest& out, bool& malformed);
+void encode_command_response(const CommandResponse& response, std::vector<uint8_t>& out);
+size_t decode_command_response(const uint8_t* data, size_t size, CommandResponse& out, bool& malformed);
+
+struct CommandServerStats {
+    uint64_t connections = 0; // 累计接受的连接数
+    uint64_t requests = 0; // 累计收到的请求数
+    uint64_t batches = 0; // 仿真线程取出的非空批次数
+    uint64_t max_batch = 0; // 最大批次的请求数
+    uint64_t throttled_batches = 0; // 取出时队列已满 (I/O 线程暂停了读取) 的批次数
+};
+
+class CommandServer {
+public:
+    CommandServer() = default;
+    ~CommandServer() { stop(); }
+
+    CommandServer(const CommandServer&) = delete;
+    CommandServer& operator=(const CommandServer&) = delete;
+
+    // 在 socket_path 上监听 (已存在的同名套接字文件会被替换) 并启动 I/O 线程。失败时返回 false。
+    bool start(const std::string& socket_path);
+    // 停止 I/O 线程，关闭全部连接并删除套接字文件
+    void stop();
+    bool is_running() const { return io_thread_.joinable(); }
+
+    // --- 仿真线程接口 (均不阻塞在 I/O 上) ---
+    // 取出当前排队的全部请求 (覆盖 batch)，返回请求数
+    size_t take_batch(std::vector<CommandRequest>& batch);
+    // 交回一批应答，由 I/O 线程异步写回；连接已断开的应答被丢弃
+    void respond(std::vector<CommandResponse>& responses);
+
+    CommandServerStats stats() const;
+
+private:
+    void io_loop();
+    void wake_io();
+
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    int wake_fds_[2] = { -1, -1 }; // 仿真线程交回应答或请求停止时写入，唤醒 poll()
+    std::thread io_thread_;
+    std::atomic<bool> stopping_ { false };
+
+    mutable std::mutex mutex_;
+    std::vector<CommandRequest> inbound_;
+    std::vector<CommandResponse> outbound_;
+    CommandServerStats stats_;
+};
+
+#endif // COMMAND_SERVER_H
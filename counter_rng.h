@@ -0,0 +1,115 @@
+// counter_rng.h
+// 基于计数器的随机数生成器 (Philox4x32-10)，仅包含头文件。
+// 随机数是 (种子, 实体, 流编号, 步号, 块号) 的纯函数，不存在需要按顺序推进的共享状态：
+// 任意线程、以任意顺序、按任意方式切分设备区间，为同一设备抽取的随机数都完全相同，
+// 因此并行的场景生成和蒙特卡洛仿真与线程数无关、逐位可复现。
+//
+// 计数器与密钥的布局:
+//   counter = { 块号, 步号, 流编号, 实体ID低32位 }
+//   key     = { 种子低32位, 种子高32位 ^ 实体ID高32位 }
+// 每个块产生 128 位随机数 (两个64位值)；同一 (实体, 流, 步) 需要多个随机数时块号依次递增。
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// 本仿真中使用的随机数流编号。同一实体的不同用途使用不同的流，彼此独立，
+// 新增一种随机量时只需分配新的编号，不会改变其他随机量的取值。
+enum class RngStream : uint32_t {
+    INITIAL_SOC = 1, // 设备初始SOC
+    AGC_INTERVAL = 2, // AGC周期
+    FEEDER_LOAD = 3, // 馈线负荷
+    RELAY_OFFSET = 4, // 低频减载继电器整定偏差
+    EV_ARRIVAL = 5, // EV到达过程 (到达间隔与 thinning 接受判定)
+    EV_SESSION = 6, // EV会话属性 (停留时长与充电需求)
+    FEEDER_TOPOLOGY = 7, // 合成馈线的拓扑与母线参数
+    QSTS_CLOUD = 8, // QSTS光伏云量 (按5分钟时段)
+    QSTS_LOAD_NOISE = 9, // QSTS负荷波动 (按1分钟时段)
+    QSTS_EV_SESSION = 10, // QSTS每日EV充电会话 (按母线、按日)
+    COMM_CHANNEL = 11, // 通信通道的丢包判定与时延 (按通道、按报文序号)
+    IED_REPORT_PHASE = 12, // IED周期上送的起始相位
+    DER_CLOUD = 13, // 逆变器电压控制仿真的光伏云量 (按10秒时段)
+    SE_NETWORK = 14, // 状态估计场景的网络参数与量测配置
+    SE_STATE = 15, // 状态估计场景的真实状态 (初值与按秒漂移)
+    SE_MEASUREMENT = 16, // 状态估计场景的量测噪声与上送丢失 (按RTU、按上送序号)
+    SURROGATE_STUDY = 17, // VPP代理模型外层研究的随机扰动 (按研究序号)
+};
+
+class CounterRng {
+public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    // 以 (seed, entity, stream, step) 定位一段随机数序列；此后每次抽取从块号0开始依次消耗
+    CounterRng(uint64_t seed, uint64_t entity, RngStream stream, uint32_t step = 0)
+        : counter_ { 0u, step, static_cast<uint32_t>(stream), static_cast<uint32_t>(entity) }
+        , key_ { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) ^ static_cast<uint32_t>(entity >> 32) }
+    {
+    }
+
+    // 64位均匀随机整数
+    uint64_t next_u64()
+    {
+        if (buffered_ == 0) {
+            block_ = philox4x32(counter_, key_);
+            ++counter_[0];
+            buffered_ = 2;
+        }
+        --buffered_;
+        const size_t lane = buffered_ ? 0 : 2;
+        return (static_cast<uint64_t>(block_[lane + 1]) << 32) | block_[lane];
+    }
+
+    // (0, 1) 开区间上的均匀分布 (取高53位，不会取到0，可直接取对数)
+    double uniform() { return ((next_u64() >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
+
+    // [lo, hi) 上的均匀分布
+    double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+
+    // [lo, hi] 上的均匀整数
+    int uniform_int(int lo, int hi)
+    {
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        return lo + static_cast<int>(((next_u64() >> 32) * range) >> 32);
+    }
+
+    // 标准正态分布 (Box-Muller，每次固定消耗两个均匀数，不缓存第二个值，保证消耗个数与调用顺序无关)
+    double normal()
+    {
+        const double u1 = uniform();
+        const double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+    // 便捷函数: 直接取 (seed, entity, stream, step) 的第一个均匀数
+    static double uniform_at(uint64_t seed, uint64_t entity, RngStream stream, uint32_t step, double lo, double hi)
+    {
+        return CounterRng(seed, entity, stream, step).uniform(lo, hi);
+    }
+
+    // Philox4x32-10 分组函数 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11)
+    static Counter philox4x32(Counter ctr, Key key)
+    {
+        constexpr uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+        constexpr uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = static_cast<uint64_t>(M0) * ctr[0];
+            const uint64_t p1 = static_cast<uint64_t>(M1) * ctr[2];
+            ctr = { static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+                static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0) };
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return ctr;
+    }
+
+private:
+    Counter counter_;
+    Key key_;
+    Counter block_ {};
+    int buffered_ = 0; // block_ 中尚未取出的64位值个数
+};
+
+#endif // COUNTER_RNG_H
@@ -0,0 +1,197 @@
+// cps_command_client.cpp
+// 命令服务的本地测试客户端: 向运行中的仿真 (logic_protection_demo --serve) 发送查询与命令，
+// 也可把一组命令重复多次、以固定的流水线深度发送，用于脚本化的负载测试 (输出吞吐量与应答时延分布)。
+//
+// 用法: cps_command_client [--socket 路径] [--repeat 次数] [--pipeline 深度] [--script 文件] 命令...
+// 命令: ping | fault:<线路> | open:<断路器> | close:<断路器> | energized:<母线> | read:<名称>
+// 脚本文件每行一个命令，# 开头的行为注释。只发送一轮时逐条打印应答，否则只打印统计。
+
+#include "command_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool parse_command(const std::string& text, CommandRequest& out)
+{
+    auto colon = text.find(':');
+    std::string verb = text.substr(0, colon);
+    out.target = colon == std::string::npos ? "" : text.substr(colon + 1);
+    out.arg = 0;
+    if (verb == "ping")
+        out.op = CommandOp::PING;
+    else if (verb == "fault")
+        out.op = CommandOp::INJECT_FAULT;
+    else if (verb == "open" || verb == "close") {
+        out.op = CommandOp::OPERATE_BREAKER;
+        out.arg = verb == "open" ? 1 : 0;
+    } else if (verb == "energized")
+        out.op = CommandOp::QUERY_ENERGIZATION;
+    else if (verb == "read")
+        out.op = CommandOp::READ_COMPONENT;
+    else
+        return false;
+    return true;
+}
+
+const char* status_name(CommandStatus status)
+{
+    switch (status) {
+    case CommandStatus::OK:
+        return "ok";
+    case CommandStatus::UNKNOWN_TARGET:
+        return "unknown_target";
+    case CommandStatus::BAD_REQUEST:
+        return "bad_request";
+    case CommandStatus::UNSUPPORTED:
+        return "unsupported";
+    default:
+        return "?";
+    }
+}
+
+void print_response(const std::string& command, const CommandResponse& r)
+{
+    std::printf("%-20s -> %s @%llums", command.c_str(), status_name(r.status), (unsigned long long)r.sim_time_ms);
+    for (uint8_t v : r.values)
+        std::printf(" %u", v);
+    std::printf("\n");
+}
+
+bool write_all(int fd, const uint8_t* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string socket_path = COMMAND_DEFAULT_SOCKET;
+    size_t repeat = 1;
+    size_t pipeline = 1;
+    std::vector<std::string> commands;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (a == "--repeat" && i + 1 < argc) {
+            repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (a == "--pipeline" && i + 1 < argc) {
+            pipeline = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (a == "--script" && i + 1 < argc) {
+            std::ifstream in(argv[++i]);
+            if (!in) {
+                std::fprintf(stderr, "无法读取脚本 %s\n", argv[i]);
+                return 1;
+            }
+            for (std::string line; std::getline(in, line);) {
+                line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+                if (!line.empty() && line[0] != '#')
+                    commands.push_back(line);
+            }
+        } else {
+            commands.push_back(a);
+        }
+    }
+    if (commands.empty())
+        commands.push_back("ping");
+
+    std::vector<CommandRequest> plan(commands.size());
+    for (size_t i = 0; i < commands.size(); ++i) {
+        if (!parse_command(commands[i], plan[i])) {
+            std::fprintf(stderr, "无法识别的命令: %s\n", commands[i].c_str());
+            return 1;
+        }
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::fprintf(stderr, "无法连接命令服务 %s\n", socket_path.c_str());
+        return 1;
+    }
+
+    // 请求号即发送序号，用于查找发送时刻与原始命令
+    using clock = std::chrono::steady_clock;
+    const size_t total = plan.size() * repeat;
+    const bool verbose = repeat == 1;
+    std::vector<clock::time_point> sent_at(total);
+    std::vector<double> latencies_ms;
+    latencies_ms.reserve(total);
+    size_t status_counts[4] = {};
+    size_t sent = 0, received = 0;
+    std::vector<uint8_t> out, in;
+    uint8_t buf[4096];
+    auto start = clock::now();
+
+    while (received < total) {
+        out.clear();
+        while (sent < total && sent - received < pipeline) {
+            CommandRequest r = plan[sent % plan.size()];
+            r.request_id = static_cast<uint32_t>(sent);
+            encode_command_request(r, out);
+            sent_at[sent++] = clock::now();
+        }
+        if (!out.empty() && !write_all(fd, out.data(), out.size())) {
+            std::fprintf(stderr, "发送失败，连接已断开。\n");
+            return 1;
+        }
+
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            std::fprintf(stderr, "连接已断开 (已收到 %zu/%zu 个应答)。\n", received, total);
+            return 1;
+        }
+        in.insert(in.end(), buf, buf + n);
+        size_t consumed = 0;
+        bool malformed = false;
+        CommandResponse resp;
+        while (size_t used = decode_command_response(in.data() + consumed, in.size() - consumed, resp, malformed)) {
+            consumed += used;
+            ++received;
+            if (resp.request_id >= total)
+                continue;
+            latencies_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - sent_at[resp.request_id]).count());
+            ++status_counts[std::min<size_t>(static_cast<size_t>(resp.status), 3)];
+            if (verbose)
+                print_response(commands[resp.request_id % commands.size()], resp);
+        }
+        in.erase(in.begin(), in.begin() + consumed);
+        if (malformed) {
+            std::fprintf(stderr, "收到格式错误的应答。\n");
+            return 1;
+        }
+    }
+    double elapsed_s = std::chrono::duration<double>(clock::now() - start).count();
+    ::close(fd);
+
+    if (!verbose) {
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        auto pct = [&](double p) { return latencies_ms[std::min(latencies_ms.size() - 1, static_cast<size_t>(p * latencies_ms.size()))]; };
+        std::printf("请求 %zu 个 (流水线深度 %zu)，耗时 %.3f 秒，吞吐 %.0f 请求/秒。\n", total, pipeline, elapsed_s, total / elapsed_s);
+        std::printf("应答时延: p50 %.2f ms, p99 %.2f ms, 最大 %.2f ms。\n", pct(0.50), pct(0.99), latencies_ms.back());
+        std::printf("状态: ok %zu, unknown_target %zu, bad_request %zu, unsupported %zu。\n", status_counts[0], status_counts[1],
+            status_counts[2], status_counts[3]);
+    }
+    return 0;
+}
@@ -0,0 +1,570 @@
+// cps_coro_bench.cpp
+// cps_coro 协程调度原语与ECS、拓扑服务的微基准测试。
+// 各项测试按固定规模扫描，输出每次操作的耗时 (ns/op)、堆分配次数与字节数 (allocs/op、bytes/op)，
+// 以及可用时的硬件计数 (周期、指令、末级缓存未命中等，均为每次操作的平均值)。
+// 结果以字段顺序固定的JSON输出，便于对比不同的调度器与ECS后端实现。
+//
+// 用法: cps_coro_bench [输出文件]   (缺省输出到标准输出)
+
+#include "PowerSystemTopology.h"
+#include "adaptive_protection.h"
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "perf_counters.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// --- 堆分配计数: 替换全局 operator new/delete，统计本进程的分配次数与字节数 ---
+namespace {
+std::atomic<uint64_t> g_alloc_count { 0 };
+std::atomic<uint64_t> g_alloc_bytes { 0 };
+
+void* counted_alloc(std::size_t size)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* counted_aligned_alloc(std::size_t size, std::align_val_t align)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    std::size_t a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a))
+        return p;
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+// 一项测试的结果
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, uint64_t>> params;
+    uint64_t ops = 0;
+    double ns_per_op = 0.0;
+    double allocs_per_op = 0.0;
+    double bytes_per_op = 0.0;
+    PerfCounterValues counters;
+};
+
+// 测量区间: 构造时开始计时、计数，finish() 时结束并按操作次数折算
+class Probe {
+public:
+    explicit Probe(PerfCounterGroup& perf)
+        : perf_(perf)
+    {
+        alloc_count_ = g_alloc_count.load(std::memory_order_relaxed);
+        alloc_bytes_ = g_alloc_bytes.load(std::memory_order_relaxed);
+        perf_.reset();
+        perf_.start();
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    BenchResult finish(std::string name, std::vector<std::pair<std::string, uint64_t>> params, uint64_t ops)
+    {
+        auto end = std::chrono::steady_clock::now();
+        perf_.stop();
+        BenchResult r;
+        r.name = std::move(name);
+        r.params = std::move(params);
+        r.ops = ops;
+        double n = ops ? static_cast<double>(ops) : 1.0;
+        r.ns_per_op = std::chrono::duration<double, std::nano>(end - start_).count() / n;
+        r.allocs_per_op = (g_alloc_count.load(std::memory_order_relaxed) - alloc_count_) / n;
+        r.bytes_per_op = (g_alloc_bytes.load(std::memory_order_relaxed) - alloc_bytes_) / n;
+        r.counters = perf_.read();
+        return r;
+    }
+
+private:
+    PerfCounterGroup& perf_;
+    uint64_t alloc_count_;
+    uint64_t alloc_bytes_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 固定序列的伪随机数 (xorshift64)，保证各次运行的访问模式一致
+struct BenchRng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    uint64_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+constexpr cps_coro::EventId BENCH_EVENT = 900001;
+
+struct BenchComponent : public IComponent {
+    double value;
+    explicit BenchComponent(double v)
+        : value(v)
+    {
+    }
+};
+
+cps_coro::Task delayed_then_park(int delay_ms)
+{
+    co_await cps_coro::delay(std::chrono::milliseconds(delay_ms));
+    co_await std::suspend_always {}; // 停在此处，由 Task 析构时销毁协程帧
+}
+
+cps_coro::Task event_waiter(uint64_t& wakeups)
+{
+    while (true) {
+        co_await cps_coro::wait_for_event<uint64_t>(BENCH_EVENT);
+        ++wakeups;
+    }
+}
+
+cps_coro::Task latest_value_waiter(cps_coro::LatestValueChannel<uint64_t>& channel, uint64_t& wakeups)
+{
+    cps_coro::LatestValueReader<uint64_t> reader(channel);
+    while (true) {
+        co_await reader.next();
+        ++wakeups;
+    }
+}
+
+// 慢读者: 每读一次后自身处理 delay_ms 毫秒，期间的发布被合并
+cps_coro::Task slow_latest_value_reader(cps_coro::LatestValueChannel<uint64_t>& channel, int delay_ms, uint64_t& reads, uint64_t& conflated)
+{
+    cps_coro::LatestValueReader<uint64_t> reader(channel);
+    while (true) {
+        co_await reader.next();
+        ++reads;
+        conflated = reader.conflated();
+        co_await cps_coro::delay(std::chrono::milliseconds(delay_ms));
+    }
+}
+
+cps_coro::Task parked_task()
+{
+    co_await std::suspend_always {};
+}
+
+// delay: 插入 (创建协程并挂起到定时队列) 与到期 (推进时间、恢复协程)
+void bench_delay(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t n : { 1000ull, 10000ull, 100000ull, 1000000ull }) {
+        cps_coro::Scheduler scheduler;
+        BenchRng rng;
+        std::vector<int> delays(n);
+        for (auto& d : delays)
+            d = 1 + static_cast<int>(rng.next() % 1000);
+        std::vector<cps_coro::Task> tasks;
+        tasks.reserve(n);
+
+        Probe insert(perf);
+        for (uint64_t i = 0; i < n; ++i)
+            tasks.push_back(delayed_then_park(delays[i]));
+        out.push_back(insert.finish("delay_insert", { { "pending", n } }, n));
+
+        Probe expire(perf);
+        scheduler.run_until(scheduler.now() + std::chrono::milliseconds(2000));
+        out.push_back(expire.finish("delay_expire", { { "pending", n } }, n));
+    }
+}
+
+// trigger_event: 每次触发唤醒全部等待者，等待者恢复后重新注册
+void bench_trigger_event(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t waiters : { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull }) {
+        cps_coro::Scheduler scheduler;
+        uint64_t wakeups = 0;
+        std::vector<cps_coro::Task> tasks;
+        tasks.reserve(waiters);
+        for (uint64_t i = 0; i < waiters; ++i)
+            tasks.push_back(event_waiter(wakeups));
+        const uint64_t triggers = std::max<uint64_t>(4, 1000000 / waiters);
+
+        Probe probe(perf);
+        for (uint64_t t = 0; t < triggers; ++t)
+            scheduler.trigger_event(BENCH_EVENT, t);
+        out.push_back(probe.finish("trigger_event", { { "waiters", waiters } }, triggers));
+    }
+}
+
+// 最新值通道: 与 trigger_event 相同的等待者规模，每次发布恢复全部读者 (读者直接引用值槽，不构造处理器)
+void bench_latest_value(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t waiters : { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull }) {
+        cps_coro::Scheduler scheduler;
+        auto& channel = scheduler.latest_value_channel<uint64_t>(BENCH_EVENT);
+        uint64_t wakeups = 0;
+        std::vector<cps_coro::Task> tasks;
+        tasks.reserve(waiters);
+        for (uint64_t i = 0; i < waiters; ++i)
+            tasks.push_back(latest_value_waiter(channel, wakeups));
+        const uint64_t publishes = std::max<uint64_t>(4, 1000000 / waiters);
+
+        Probe probe(perf);
+        for (uint64_t t = 0; t < publishes; ++t)
+            channel.publish(t);
+        out.push_back(probe.finish("latest_value_publish", { { "waiters", waiters } }, publishes));
+    }
+
+    // 慢读者: 每1毫秒发布一次，读者每次读取后处理10毫秒，读取次数约为发布次数的1/10且不积压
+    cps_coro::Scheduler scheduler;
+    auto& channel = scheduler.latest_value_channel<uint64_t>(BENCH_EVENT);
+    uint64_t reads = 0, conflated = 0;
+    cps_coro::Task reader = slow_latest_value_reader(channel, 10, reads, conflated);
+    const uint64_t publishes = 100000;
+    Probe probe(perf);
+    for (uint64_t t = 0; t < publishes; ++t) {
+        channel.publish(t);
+        scheduler.run_until(scheduler.now() + std::chrono::milliseconds(1));
+    }
+    out.push_back(probe.finish("latest_value_slow_reader", { { "publishes", publishes }, { "reads", reads }, { "conflated", conflated } }, publishes));
+}
+
+// Task: 创建协程 (分配协程帧、执行到首个挂起点) 与销毁
+void bench_task(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    const uint64_t n = 1000000;
+    cps_coro::Scheduler scheduler;
+    Probe probe(perf);
+    for (uint64_t i = 0; i < n; ++i) {
+        cps_coro::Task task = parked_task();
+    }
+    out.push_back(probe.finish("task_create_destroy", { { "n", n } }, n));
+}
+
+// Registry: emplace / 随机 get / for_each
+void bench_registry(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t n : { 1000ull, 100000ull, 1000000ull }) {
+        Registry registry;
+        std::vector<Entity> entities(n);
+        for (auto& e : entities)
+            e = registry.create();
+
+        Probe emplace(perf);
+        for (uint64_t i = 0; i < n; ++i)
+            registry.emplace<BenchComponent>(entities[i], static_cast<double>(i));
+        out.push_back(emplace.finish("registry_emplace", { { "entities", n } }, n));
+
+        BenchRng rng;
+        std::vector<Entity> lookups(n);
+        for (auto& e : lookups)
+            e = entities[rng.next() % n];
+        double sum = 0.0;
+        Probe get(perf);
+        for (Entity e : lookups)
+            sum += registry.get<BenchComponent>(e)->value;
+        out.push_back(get.finish("registry_get", { { "entities", n } }, n));
+
+        Probe for_each(perf);
+        registry.for_each<BenchComponent>([&](BenchComponent& c, Entity) { sum += c.value; });
+        out.push_back(for_each.finish("registry_for_each", { { "entities", n } }, n));
+        if (sum < 0.0)
+            std::printf("%f\n", sum); // 防止编译器消除读取
+    }
+}
+
+// PowerSystemTopology::findPath: 方形网格网络上的随机母线对
+// side x side 网格拓扑: 母线 1..side*side，支路编号从 side*side+1 开始
+std::vector<BranchId> build_grid_topology(uint64_t side, PowerSystemTopology& topology)
+{
+    const uint64_t bus_count = side * side;
+    std::vector<BusId> buses;
+    std::vector<BranchId> branches;
+    std::vector<std::pair<BusId, BusId>> endpoints;
+    for (uint64_t r = 0; r < side; ++r) {
+        for (uint64_t c = 0; c < side; ++c) {
+            BusId bus = 1 + r * side + c;
+            buses.push_back(bus);
+            if (c + 1 < side) {
+                branches.push_back(bus_count + branches.size() + 1);
+                endpoints.emplace_back(bus, bus + 1);
+            }
+            if (r + 1 < side) {
+                branches.push_back(bus_count + branches.size() + 1);
+                endpoints.emplace_back(bus, bus + side);
+            }
+        }
+    }
+    topology.buildTopology(buses, branches, endpoints);
+    return branches;
+}
+
+void bench_find_path(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t side : { 10ull, 32ull, 100ull }) {
+        const uint64_t bus_count = side * side;
+        PowerSystemTopology topology;
+        build_grid_topology(side, topology);
+
+        const uint64_t queries = bus_count >= 10000 ? 200 : 2000;
+        BenchRng rng;
+        std::vector<std::pair<BusId, BusId>> pairs(queries);
+        for (auto& p : pairs)
+            p = { 1 + rng.next() % bus_count, 1 + rng.next() % bus_count };
+        size_t found = 0;
+        Probe probe(perf);
+        for (const auto& p : pairs)
+            found += topology.findPath(p.first, p.second).has_value();
+        out.push_back(probe.finish("find_path", { { "buses", bus_count } }, queries));
+        if (found > queries)
+            std::printf("%zu\n", found);
+    }
+}
+
+// 多场景带电分析: 每个场景随机断开5%的支路。lanes=64 为位并行一次扫描64个场景，lanes=1 为每个场景单独扫描。
+void bench_scenario_reachability(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    for (uint64_t side : { 32ull, 100ull }) {
+        const uint64_t bus_count = side * side;
+        PowerSystemTopology topology;
+        const auto branches = build_grid_topology(side, topology);
+
+        const uint64_t scenario_count = 256;
+        BenchRng rng;
+        std::vector<std::vector<BranchId>> scenarios(scenario_count);
+        for (auto& open : scenarios) {
+            for (size_t k = 0; k < branches.size() / 20; ++k)
+                open.push_back(branches[rng.next() % branches.size()]);
+        }
+        const std::vector<BusId> sources = { 1 };
+
+        size_t energized = 0;
+        {
+            Probe probe(perf);
+            auto result = topology.energizedBusesByScenario(sources, scenarios);
+            out.push_back(probe.finish("scenario_reachability", { { "buses", bus_count }, { "lanes", 64 } }, scenario_count));
+            energized += result.isEnergized(scenario_count - 1, 0);
+        }
+        {
+            Probe probe(perf);
+            for (const auto& open : scenarios) {
+                auto result = topology.energizedBusesByScenario(sources, { open });
+                energized += result.isEnergized(0, 0);
+            }
+            out.push_back(probe.finish("scenario_reachability", { { "buses", bus_count }, { "lanes", 1 } }, scenario_count));
+        }
+        if (energized > 2 * scenario_count)
+            std::printf("%zu\n", energized);
+    }
+}
+
+// 每次开关变位后的失电检测: 一次全网扫描与上次结果比较 vs 逐母线从电源搜索路径 (原先每条母线一个监视协程的做法)
+void bench_energization_delta(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    const uint64_t side = 32;
+    const uint64_t bus_count = side * side;
+    PowerSystemTopology topology;
+    const auto branches = build_grid_topology(side, topology);
+    const std::vector<BusId> sources = { 1 };
+
+    const uint64_t events = 32;
+    BenchRng rng;
+    std::vector<std::vector<BranchId>> open_after(events);
+    std::vector<BranchId> open;
+    for (auto& snapshot : open_after) {
+        open.push_back(branches[rng.next() % branches.size()]);
+        snapshot = open;
+    }
+
+    size_t changed = 0;
+    {
+        Probe probe(perf);
+        std::vector<uint8_t> previous(bus_count, 1), current(bus_count);
+        for (const auto& snapshot : open_after) {
+            auto result = topology.energizedBusesByScenario(sources, { snapshot });
+            for (uint64_t b = 0; b < bus_count; ++b) {
+                current[b] = result.isEnergized(0, b);
+                changed += current[b] != previous[b];
+            }
+            previous.swap(current);
+        }
+        out.push_back(probe.finish("energization_delta", { { "buses", bus_count }, { "sweep", 1 } }, events));
+    }
+    {
+        Probe probe(perf);
+        for (const auto& snapshot : open_after) {
+            for (uint64_t b = 1; b <= bus_count; ++b)
+                changed += topology.findPath(sources[0], b, snapshot).has_value();
+        }
+        out.push_back(probe.finish("energization_delta", { { "buses", bus_count }, { "sweep", 0 } }, events));
+    }
+    if (changed == 0)
+        std::printf("%zu\n", changed);
+}
+
+// 自适应保护: 一次开关变位后只重新整定保护区与变化区域相交的继电器 vs 每次整定全部继电器。
+// 网格每条线路两端各一台断路器与一套后备保护，线路均有主保护 (50ms)。
+void bench_adaptive_protection(PerfCounterGroup& perf, std::vector<BenchResult>& out)
+{
+    const uint64_t side = 100;
+    const uint64_t bus_count = side * side;
+    AdaptiveProtectionService service;
+    for (uint64_t b = 1; b <= bus_count; ++b)
+        service.add_bus(b, b == 1 || b == bus_count);
+    uint64_t line_count = 0;
+    std::vector<Entity> breakers;
+    for (uint64_t r = 0; r < side; ++r) {
+        for (uint64_t c = 0; c < side; ++c) {
+            const Entity bus = 1 + r * side + c;
+            const Entity neighbours[2] = { c + 1 < side ? bus + 1 : 0, r + 1 < side ? bus + side : 0 };
+            for (Entity other : neighbours) {
+                if (other == 0)
+                    continue;
+                const Entity line = bus_count + 1 + 3 * line_count++;
+                service.add_line(line, { line + 1, bus }, { line + 2, other });
+                service.add_main_protection(line, 50);
+                for (Entity breaker : { line + 1, line + 2 }) {
+                    service.add_backup_relay({ breaker, line, breaker, 1000 }, {});
+                    breakers.push_back(breaker);
+                }
+            }
+        }
+    }
+    service.finalize();
+    service.refresh(true);
+
+    const uint64_t events = 64;
+    BenchRng rng;
+    std::vector<Entity> toggled(events);
+    for (auto& breaker : toggled)
+        breaker = breakers[rng.next() % breakers.size()];
+
+    size_t changed = 0;
+    for (bool all : { false, true }) {
+        std::vector<uint8_t> open(bus_count + 3 * line_count + 1, 0);
+        const uint64_t recomputed_before = service.stats().relays_recomputed;
+        Probe probe(perf);
+        for (Entity breaker : toggled) {
+            open[breaker] ^= 1;
+            service.set_breaker_open(breaker, open[breaker]);
+            changed += service.refresh(all).size();
+        }
+        const uint64_t recomputed = (service.stats().relays_recomputed - recomputed_before) / events;
+        out.push_back(probe.finish("adaptive_protection", { { "relays", service.relay_count() }, { "recompute_all", all }, { "recomputed_per_event", recomputed } }, events));
+        for (Entity breaker : toggled) {
+            if (open[breaker]) {
+                open[breaker] = 0;
+                service.set_breaker_open(breaker, false);
+            }
+        }
+        service.refresh(true);
+    }
+    if (changed == 0)
+        std::printf("%zu\n", changed);
+}
+
+// JSON 字符串转义: 引号、反斜杠与控制字符 (strerror 文本和路径中可能出现)；UTF-8 字节原样输出
+std::string json_escape(const std::string& text)
+{
+    std::string out;
+    out.reserve(text.size());
+    for (unsigned char ch : text) {
+        switch (ch) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (ch < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                out += buf;
+            } else {
+                out += static_cast<char>(ch);
+            }
+        }
+    }
+    return out;
+}
+
+void write_json(std::FILE* f, const PerfCounterGroup& perf, const std::vector<BenchResult>& results)
+{
+    std::fprintf(f, "{\n  \"schema\": \"cps_coro_bench/1\",\n");
+    std::fprintf(f, "  \"perf_counters\": {\"available\": %s, \"reason\": \"%s\"},\n", perf.any_available() ? "true" : "false",
+        json_escape(perf.unavailable_reason()).c_str());
+    std::fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        std::fprintf(f, "    {\"name\": \"%s\", \"params\": {", json_escape(r.name).c_str());
+        for (size_t k = 0; k < r.params.size(); ++k)
+            std::fprintf(f, "%s\"%s\": %llu", k ? ", " : "", json_escape(r.params[k].first).c_str(), (unsigned long long)r.params[k].second);
+        std::fprintf(f, "}, \"ops\": %llu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.3f",
+            (unsigned long long)r.ops, r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+        for (size_t c = 0; c < PERF_COUNTER_COUNT; ++c) {
+            std::fprintf(f, ", \"%s_per_op\": ", perf_counter_name(static_cast<PerfCounter>(c)));
+            if (r.counters.valid[c])
+                std::fprintf(f, "%.3f", static_cast<double>(r.counters.values[c]) / (r.ops ? r.ops : 1));
+            else
+                std::fprintf(f, "null");
+        }
+        std::fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    PerfCounterGroup perf;
+    if (!perf.unavailable_reason().empty())
+        std::fprintf(stderr, "部分硬件计数器不可用 (%s)，对应字段输出为 null。\n", perf.unavailable_reason().c_str());
+
+    std::vector<BenchResult> results;
+    bench_delay(perf, results);
+    bench_trigger_event(perf, results);
+    bench_latest_value(perf, results);
+    bench_task(perf, results);
+    bench_registry(perf, results);
+    bench_find_path(perf, results);
+    bench_scenario_reachability(perf, results);
+    bench_energization_delta(perf, results);
+    bench_adaptive_protection(perf, results);
+
+    std::FILE* f = argc > 1 ? std::fopen(argv[1], "w") : stdout;
+    if (!f) {
+        std::fprintf(stderr, "无法写入 %s\n", argv[1]);
+        return 1;
+    }
+    write_json(f, perf, results);
+    if (f != stdout)
+        std::fclose(f);
+    return 0;
+}
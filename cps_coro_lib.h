@@ -12,6 +12,8 @@
 // 5. 调用调度器的方法，如 `run_one_step()` 或 `run_until(time_point)` 来执行已调度的任务。
 // 6. 使用 `scheduler.trigger_event(event_id, data)` 或
 //    `scheduler.trigger_event(event_id)` 来触发事件。
+// 7. 高频量测等只关心最新值的数据流使用最新值通道: 发布者调用 `scheduler.publish_latest(id, value)`，
+//    读者以 `LatestValueReader` 配合 `co_await reader.next()` 读取最新值。
 //
 // 为构建离散事件模拟或其他合作式多任务系统提供一个简单而灵活的框架
 
@@ -32,6 +34,8 @@
 #include <variant> // 用于 std::variant (虽然在此文件中未直接使用，但可用于更复杂的事件数据传递)
 #include <vector> // 用于 std::vector (例如在 trigger_event 中临时存储处理器)
 
+#include "memory_accounting.h" // 按子系统的内存分配统计 (CPS_MEMORY_ACCOUNTING 开启时)
+
 namespace cps_coro { // 协程相关的命名空间
 
 // 前向声明 Scheduler 类，以便 AwaiterBase 可以引用它
@@ -51,6 +55,7 @@ protected:
 
     // 允许 Scheduler 类访问 AwaiterBase 的保护成员和私有成员。
     friend class Scheduler;
+    friend class ActiveSchedulerGuard;
 
     // 默认构造函数
     AwaiterBase() = default;
@@ -83,6 +88,14 @@ public:
         void return_void() { }
         // 当协程内部有未捕获的异常时调用此函数。默认行为是终止程序。
         void unhandled_exception() { std::terminate(); }
+#ifdef CPS_MEMORY_ACCOUNTING
+        // 协程帧的分配计入 coroutine_frames 标记 (释放时由全局 operator delete 按头部记录扣减)
+        static void* operator new(std::size_t size)
+        {
+            MemTagScope mem_scope(MemTag::COROUTINE_FRAMES);
+            return ::operator new(size);
+        }
+#endif
     };
 
     // 默认构造函数，创建一个无效的 Task 对象。
@@ -159,6 +172,64 @@ private:
     std::coroutine_handle<promise_type> handle_ = nullptr;
 };
 
+// --- 最新值 (合并) 通道 ---
+// 高频量测 (例如PMU式的频率流) 只有最新值有意义。LatestValueChannel 只保存一个值槽和一个发布序号:
+// 发布者覆盖值槽并递增序号，然后恢复当前挂起的全部读者；读者恢复后直接引用值槽中的最新值，
+// 既没有按读者的数据拷贝，也不需要为每次等待构造 std::function 处理器。
+// 读者在两次读取之间错过了若干次发布时 (例如它自身还在 delay 中)，下一次读取立即得到最新值，
+// 中间的发布被合并，慢读者不会形成积压。通道由 Scheduler 按 EventId 持有 (见 Scheduler::latest_value_channel)。
+
+// 通道的类型擦除基类，使 Scheduler 可以统一持有不同值类型的通道
+class LatestValueChannelBase {
+public:
+    virtual ~LatestValueChannelBase() = default;
+    // 是否有挂起等待下一次发布的读者
+    virtual bool has_waiters() const = 0;
+};
+
+template <typename T>
+class LatestValueChannel : public LatestValueChannelBase {
+public:
+    // 覆盖值槽、递增序号，并按挂起顺序恢复此前挂起的全部读者 (与 trigger_event 相同，在发布者的调用栈中同步恢复)。
+    // 读者恢复后再次等待时进入下一轮的等待列表，不会在本次发布中被重复恢复；读者在恢复过程中再次发布也是安全的。
+    void publish(const T& value)
+    {
+        value_ = value;
+        ++sequence_;
+        if (waiters_.empty())
+            return;
+        // 两个列表交替使用，稳定运行后不再分配内存
+        std::vector<std::coroutine_handle<>> resuming = std::move(spare_);
+        resuming.clear();
+        resuming.swap(waiters_);
+        for (auto h : resuming) {
+            if (!h.done())
+                h.resume();
+        }
+        resuming.clear();
+        spare_ = std::move(resuming);
+    }
+
+    // 最新发布的值 (尚未发布时为值初始化的 T)。引用在下一次 publish() 之前有效。
+    const T& latest() const { return value_; }
+    // 累计发布次数 (0 表示尚未发布)
+    uint64_t sequence() const { return sequence_; }
+    bool has_waiters() const override { return !waiters_.empty(); }
+
+    // 由 LatestValueReader 的等待体调用: 挂起 handle 直到下一次发布
+    void add_waiter(std::coroutine_handle<> handle)
+    {
+        MemTagScope mem_scope(MemTag::EVENT_HANDLERS);
+        waiters_.push_back(handle);
+    }
+
+private:
+    T value_ {};
+    uint64_t sequence_ = 0;
+    std::vector<std::coroutine_handle<>> waiters_; // 等待下一次发布的读者
+    std::vector<std::coroutine_handle<>> spare_; // 上一轮恢复用过的列表 (保留容量)
+};
+
 // 调度器类，负责管理和执行协程任务
 // Scheduler 维护一个模拟的“当前时间”，以及三个核心数据结构：
 // 1. 就绪任务队列 (ready_tasks_)：存储可以立即执行的协程。
@@ -203,6 +274,7 @@ public:
     // 就绪任务队列通常是先进先出 (FIFO) 的。
     void schedule(std::coroutine_handle<> handle)
     {
+        MemTagScope mem_scope(MemTag::SCHEDULER_TIMERS);
         ready_tasks_.push(handle);
     }
 
@@ -212,6 +284,7 @@ public:
     {
         // timed_tasks_ 是一个 std::multimap，键是唤醒时间点，值是协程句柄。
         // emplace 直接在容器中构造元素，避免不必要的拷贝或移动。
+        MemTagScope mem_scope(MemTag::SCHEDULER_TIMERS);
         timed_tasks_.emplace(current_time_ + delay, handle);
     }
 
@@ -221,6 +294,7 @@ public:
     // 事件处理器通常由 `EventAwaiter` 在协程 `co_await` 事件时注册。
     void register_event_handler(EventId event_id, EventHandler handler)
     {
+        MemTagScope mem_scope(MemTag::EVENT_HANDLERS);
         event_handlers_.emplace(event_id, std::move(handler));
     }
 
@@ -234,8 +308,12 @@ public:
     {
         auto range = event_handlers_.equal_range(event_id); // 获取所有匹配此 event_id 的处理器迭代器范围
         std::vector<EventHandler> handlers_to_call; // 临时存储待调用的处理器，防止在遍历时修改容器导致迭代器失效
-        for (auto it = range.first; it != range.second; ++it) {
-            handlers_to_call.push_back(it->second);
+        {
+            // 只标记处理器的复制；处理器调用时恢复的协程所做的分配不属于事件处理器
+            MemTagScope mem_scope(MemTag::EVENT_HANDLERS);
+            for (auto it = range.first; it != range.second; ++it) {
+                handlers_to_call.push_back(it->second);
+            }
         }
 
         // 移除已找到的处理器 (实现一次性事件处理机制)
@@ -258,8 +336,11 @@ public:
     {
         auto range = event_handlers_.equal_range(event_id);
         std::vector<EventHandler> handlers_to_call;
-        for (auto it = range.first; it != range.second; ++it) {
-            handlers_to_call.push_back(it->second);
+        {
+            MemTagScope mem_scope(MemTag::EVENT_HANDLERS);
+            for (auto it = range.first; it != range.second; ++it) {
+                handlers_to_call.push_back(it->second);
+            }
         }
         if (range.first != range.second) {
             event_handlers_.erase(range.first, range.second);
@@ -269,6 +350,26 @@ public:
         }
     }
 
+    // 取得 (首次访问时创建) 编号为 channel_id 的最新值通道。通道与事件处理器使用各自的编号空间，
+    // 同一编号必须始终以相同的值类型 T 访问。通道随调度器一同销毁。
+    template <typename T>
+    LatestValueChannel<T>& latest_value_channel(EventId channel_id)
+    {
+        auto& slot = latest_value_channels_[channel_id];
+        if (!slot) {
+            MemTagScope mem_scope(MemTag::EVENT_HANDLERS);
+            slot = std::make_unique<LatestValueChannel<T>>();
+        }
+        return static_cast<LatestValueChannel<T>&>(*slot);
+    }
+
+    // 向编号为 channel_id 的最新值通道发布一个值 (见 LatestValueChannel::publish)
+    template <typename T>
+    void publish_latest(EventId channel_id, const T& value)
+    {
+        latest_value_channel<T>(channel_id).publish(value);
+    }
+
     // 执行一步调度循环。这是调度器的核心“脉搏”。
     // 1. 优先检查并执行就绪队列中的任务。
     // 2. 如果就绪队列为空，则检查是否有到期的定时任务。
@@ -296,10 +397,13 @@ public:
             }
 
             // 将所有已到期或早于当前模拟时间的定时任务移到就绪队列
-            while (!timed_tasks_.empty() && timed_tasks_.begin()->first <= current_time_) {
-                auto h = timed_tasks_.begin()->second; // 获取任务句柄
-                timed_tasks_.erase(timed_tasks_.begin()); // 从定时任务映射中移除
-                ready_tasks_.push(h); // 加入就绪队列
+            {
+                MemTagScope mem_scope(MemTag::SCHEDULER_TIMERS);
+                while (!timed_tasks_.empty() && timed_tasks_.begin()->first <= current_time_) {
+                    auto h = timed_tasks_.begin()->second; // 获取任务句柄
+                    timed_tasks_.erase(timed_tasks_.begin()); // 从定时任务映射中移除
+                    ready_tasks_.push(h); // 加入就绪队列
+                }
             }
 
             // 尝试在当前步骤中立即运行一个新就绪的任务 (如果刚才有任务从定时队列移入)
@@ -343,6 +447,7 @@ public:
                 set_time(next_event_time);
 
                 // 将所有在新的当前时间点或之前到期的定时任务移到就绪队列
+                MemTagScope mem_scope(MemTag::SCHEDULER_TIMERS);
                 while (!timed_tasks_.empty() && timed_tasks_.begin()->first <= current_time_) {
                     auto h = timed_tasks_.begin()->second;
                     timed_tasks_.erase(timed_tasks_.begin());
@@ -358,14 +463,20 @@ public:
         }
     }
 
-    // 检查调度器是否为空 (即没有就绪任务、没有定时任务、也没有注册的事件处理器)。
+    // 检查调度器是否为空 (即没有就绪任务、没有定时任务、没有注册的事件处理器，也没有等待最新值通道的读者)。
     // 注意: 原始的 is_empty 包含了对 event_handlers_ 的检查。对于判断“所有任务是否完成”，
     // 通常只关心 ready_tasks_ 和 timed_tasks_。
     // 此处保留原始行为。如果事件处理器可以持久存在 (非一次性)，这个检查是合理的。
     // 如果它们总是一次性的 (触发后即清除)，那么当所有协程等待的事件都被触发后，event_handlers_ 最终也会变空。
     bool is_empty() const
     {
-        return ready_tasks_.empty() && timed_tasks_.empty() && event_handlers_.empty();
+        if (!ready_tasks_.empty() || !timed_tasks_.empty() || !event_handlers_.empty())
+            return false;
+        for (const auto& [id, channel] : latest_value_channels_) {
+            if (channel->has_waiters())
+                return false;
+        }
+        return true;
     }
 
     // 检查是否有任何待处理的任务 (无论是就绪任务还是定时任务)。
@@ -382,6 +493,26 @@ private:
     std::queue<std::coroutine_handle<>> ready_tasks_; // 就绪任务队列 (FIFO)，存储等待立即执行的协程句柄
     std::multimap<time_point, std::coroutine_handle<>> timed_tasks_; // 定时任务，按计划执行时间排序的多重映射
     std::multimap<EventId, EventHandler> event_handlers_; // 事件处理器，按事件ID组织的多重映射
+    std::map<EventId, std::unique_ptr<LatestValueChannelBase>> latest_value_channels_; // 最新值通道，按通道编号组织
+};
+
+// 活动调度器守卫
+// 构造时记下当前线程的活动调度器，析构时恢复。在协程中同步运行嵌套仿真 (例如 ParallelExecutor 的块在调用线程上
+// 创建局部调度器) 时，应在局部调度器之前声明守卫，使局部调度器析构后外层调度器仍是活动调度器，
+// 外层协程随后的 delay() / 等待事件不会取到空指针。
+class ActiveSchedulerGuard {
+public:
+    ActiveSchedulerGuard()
+        : previous_(AwaiterBase::active_scheduler_)
+    {
+    }
+    ~ActiveSchedulerGuard() { AwaiterBase::active_scheduler_ = previous_; }
+
+    ActiveSchedulerGuard(const ActiveSchedulerGuard&) = delete;
+    ActiveSchedulerGuard& operator=(const ActiveSchedulerGuard&) = delete;
+
+private:
+    Scheduler* previous_;
 };
 
 // Delay 等待体 (Awaitable)，用于使协程暂停指定的时长
@@ -510,6 +641,53 @@ private:
     EventId event_id_; // 等待的事件ID
 };
 
+// LatestValueReader: 最新值通道的读者，记录自己已读到的发布序号。
+// 用法: `const T& value = co_await reader.next();` ——
+// 通道中有未读的发布时立即返回最新值而不挂起，否则挂起到下一次发布。返回的引用指向通道的值槽，
+// 在下一次发布之前有效，需要跨越挂起点保留时应复制。每个读者应只被一个协程使用。
+template <typename T>
+class LatestValueReader {
+public:
+    // 从通道的当前序号开始读: 第一次 next() 等待下一次发布
+    explicit LatestValueReader(LatestValueChannel<T>& channel)
+        : channel_(&channel)
+        , seen_(channel.sequence())
+    {
+    }
+
+    class Awaiter {
+    public:
+        explicit Awaiter(LatestValueReader& reader)
+            : reader_(reader)
+        {
+        }
+        bool await_ready() const noexcept { return reader_.channel_->sequence() != reader_.seen_; }
+        void await_suspend(std::coroutine_handle<> handle) { reader_.channel_->add_waiter(handle); }
+        const T& await_resume() noexcept
+        {
+            const uint64_t sequence = reader_.channel_->sequence();
+            reader_.conflated_ += sequence - reader_.seen_ - 1;
+            reader_.seen_ = sequence;
+            return reader_.channel_->latest();
+        }
+
+    private:
+        LatestValueReader& reader_;
+    };
+
+    Awaiter next() { return Awaiter(*this); }
+
+    // 本读者已读到的发布序号
+    uint64_t seen() const { return seen_; }
+    // 本读者因读取不及而被合并跳过的发布次数
+    uint64_t conflated() const { return conflated_; }
+
+private:
+    LatestValueChannel<T>* channel_;
+    uint64_t seen_;
+    uint64_t conflated_ = 0;
+};
+
 // 便捷函数 (Helper Function)，用于创建 Delay 等待体实例。
 // 使得 `co_await cps_coro::delay(duration)` 的写法成为可能。
 inline Delay delay(Scheduler::duration duration)
@@ -527,6 +705,52 @@ inline EventAwaiter<EventData> wait_for_event(EventId event_id)
     return EventAwaiter<EventData>(event_id);
 }
 
+// TickDispatcher: 按1毫秒节拍推进时间轮的分发协程的共用部分 (通信网络的报文投递、保护方案引擎的定时器)。
+// 没有待处理的项时协程挂起，不占用调度器的定时队列；有新项时由 wake() 直接恢复。
+// 空闲期间时间轮停在上次推进的节拍，调用方在 idle() 为 true 时应先把时间轮对齐到当前时刻再加入新项。
+class TickDispatcher {
+public:
+    TickDispatcher() = default;
+    TickDispatcher(const TickDispatcher&) = delete;
+    TickDispatcher& operator=(const TickDispatcher&) = delete;
+
+    bool idle() const { return static_cast<bool>(idle_handle_); }
+
+    // 分发协程空闲时将其放回调度器的就绪队列
+    void wake(Scheduler& scheduler)
+    {
+        if (idle_handle_) {
+            auto handle = idle_handle_;
+            idle_handle_ = nullptr;
+            scheduler.schedule(handle);
+        }
+    }
+
+    // 分发循环: has_work() 为 false 时挂起到下一次 wake()，否则每毫秒以当前节拍 (毫秒) 调用一次 tick(now_tick)
+    template <typename HasWork, typename Tick>
+    Task run(Scheduler& scheduler, HasWork has_work, Tick tick)
+    {
+        while (true) {
+            if (!has_work()) {
+                co_await IdleAwaiter { this };
+                continue;
+            }
+            co_await delay(std::chrono::milliseconds(1));
+            tick(static_cast<uint64_t>(scheduler.now().time_since_epoch().count()));
+        }
+    }
+
+private:
+    struct IdleAwaiter {
+        TickDispatcher* dispatcher;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { dispatcher->idle_handle_ = handle; }
+        void await_resume() const noexcept { }
+    };
+
+    std::coroutine_handle<> idle_handle_;
+};
+
 // --- 实时仿真接口 ---
 // RealTimeScheduler 类继承自 Scheduler，提供了将仿真时间与物理时钟时间对齐的功能。
 class RealTimeScheduler : public Scheduler {
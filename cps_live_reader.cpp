@@ -0,0 +1,110 @@
+// cps_live_reader.cpp
+// 实时状态监视: 只读映射仿真进程发布的共享内存快照 (live_state.h)，周期性地打印频率偏差、VPP总功率、
+// 断开的断路器与失电的母线。读取不会对仿真产生任何影响；仿真进程尚未启动时等待其创建共享内存段。
+//
+// 用法: cps_live_reader [共享内存名] [刷新间隔毫秒] [--once]   (缺省 /cps_live_state, 200毫秒)
+
+#include "live_state.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+
+namespace {
+
+void print_snapshot(const LiveStateSegment& segment, const LiveStateSnapshot& s)
+{
+    std::printf("[#%llu t=%.3fs]", (unsigned long long)s.publish_count, s.sim_time_s);
+    if (s.valid_fields & LIVE_FIELD_FREQUENCY)
+        std::printf(" 频率偏差 %+.4f Hz", s.freq_deviation_hz);
+    if (s.valid_fields & LIVE_FIELD_VPP_POWER)
+        std::printf(" VPP总功率 %.1f kW", s.vpp_total_power_kW);
+    if (s.valid_fields & LIVE_FIELD_BREAKERS) {
+        std::printf(" | 断开:");
+        int open_count = 0;
+        for (uint32_t i = 0; i < segment.breaker_count; ++i) {
+            if (s.breaker_open[i]) {
+                std::printf(" %s", segment.breaker_names[i]);
+                ++open_count;
+            }
+        }
+        if (open_count == 0)
+            std::printf(" 无");
+    }
+    if (s.valid_fields & LIVE_FIELD_BUSES) {
+        std::printf(" | 失电:");
+        int dead_count = 0;
+        for (uint32_t i = 0; i < segment.bus_count; ++i) {
+            if (!s.bus_energized[i]) {
+                std::printf(" %s", segment.bus_names[i]);
+                ++dead_count;
+            }
+        }
+        if (dead_count == 0)
+            std::printf(" 无");
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string name = LIVE_STATE_DEFAULT_NAME;
+    int interval_ms = 200;
+    bool once = false;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--once") == 0)
+            once = true;
+        else if (positional++ == 0)
+            name = argv[i];
+        else
+            interval_ms = std::max(1, std::stoi(argv[i]));
+    }
+
+    LiveStateReader reader;
+    uint64_t last_printed = 0;
+    bool waiting_reported = false;
+    while (true) {
+        if (!reader.is_open()) {
+            if (!reader.open(name)) {
+                if (once) {
+                    std::fprintf(stderr, "共享内存段 %s 不存在或无效。\n", name.c_str());
+                    return 1;
+                }
+                if (!waiting_reported) {
+                    std::printf("等待仿真进程创建共享内存段 %s ...\n", name.c_str());
+                    waiting_reported = true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+                continue;
+            }
+            std::printf("已连接 %s (发布进程 %lld，%u 台断路器，%u 条母线)。\n", name.c_str(),
+                (long long)reader.segment().publisher_pid, reader.segment().breaker_count, reader.segment().bus_count);
+            waiting_reported = false;
+        }
+
+        LiveStateSnapshot snapshot;
+        if (reader.read(snapshot) && snapshot.publish_count != 0 && snapshot.publish_count != last_printed) {
+            print_snapshot(reader.segment(), snapshot);
+            last_printed = snapshot.publish_count;
+        }
+        if (once)
+            return 0;
+        // 发布进程退出后共享内存名已被删除，重新等待下一次运行
+        if (::kill(static_cast<pid_t>(reader.segment().publisher_pid), 0) != 0 && errno == ESRCH) {
+            std::printf("发布进程已结束。\n");
+            reader.close();
+            last_printed = 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+}
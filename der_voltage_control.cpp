@@ -0,0 +1,190 @@
+// der_voltage_control.cpp
+// 实现了逆变器集群 Volt-VAR / Volt-Watt 曲线的批量计算，以及控制与潮流的阻尼不动点迭代。
+
+#include "der_voltage_control.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+DerVoltageFleet::DerVoltageFleet(Registry& registry, const RadialFeeder& feeder, DerVoltageSettings settings)
+    : registry_(registry)
+    , feeder_(feeder)
+    , settings_(settings)
+{
+}
+
+uint32_t DerVoltageFleet::add_curve_set(const DerCurveSet& curves)
+{
+    const VoltVarCurve& vv = curves.volt_var;
+    CurveCoefficients c;
+    c.v0 = vv.v_pu[0];
+    c.q0 = vv.q_frac[0];
+    for (int k = 0; k < 3; ++k) {
+        c.width[k] = vv.v_pu[k + 1] - vv.v_pu[k];
+        c.slope[k] = c.width[k] > 0.0 ? (vv.q_frac[k + 1] - vv.q_frac[k]) / c.width[k] : 0.0;
+    }
+    const VoltWattCurve& vw = curves.volt_watt;
+    c.vw_start = vw.v_start_pu;
+    c.vw_width = std::max(vw.v_end_pu - vw.v_start_pu, 0.0);
+    c.vw_slope = c.vw_width > 0.0 ? (1.0 - vw.p_min_frac) / c.vw_width : 0.0;
+    curves_.push_back(c);
+    return static_cast<uint32_t>(curves_.size() - 1);
+}
+
+void DerVoltageFleet::reserve(size_t inverter_count)
+{
+    for (auto* v : { &rated_kVA_, &inv_rated_, &nominal_kW_, &pv_mask_, &p_kW_, &q_kvar_ })
+        v->reserve(inverter_count);
+    entities_.reserve(inverter_count);
+    curve_of_.reserve(inverter_count);
+    bus_.reserve(inverter_count);
+}
+
+bool DerVoltageFleet::add_inverter(Entity inverter)
+{
+    auto comp = registry_.get<DerInverterComponent>(inverter);
+    if (!comp || comp->curve_set >= curves_.size() || comp->rated_kVA <= 0.0)
+        return false;
+    const int bus = feeder_.index_of(comp->bus);
+    if (bus < 0)
+        return false;
+    entities_.push_back(inverter);
+    curve_of_.push_back(comp->curve_set);
+    bus_.push_back(bus);
+    rated_kVA_.push_back(comp->rated_kVA);
+    inv_rated_.push_back(1.0 / comp->rated_kVA);
+    nominal_kW_.push_back(comp->nominal_kW);
+    pv_mask_.push_back(comp->kind == DerInverterComponent::Kind::PV ? 1.0 : 0.0);
+    p_kW_.push_back(comp->p_kW);
+    q_kvar_.push_back(comp->q_kvar);
+    return true;
+}
+
+void DerVoltageFleet::finalize()
+{
+    // 按曲线组稳定排序 (同组内保持加入顺序)，使每个曲线组的系数在其区间内为常量
+    const size_t n = entities_.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return curve_of_[a] < curve_of_[b]; });
+    auto permute = [&](auto& v) {
+        std::remove_reference_t<decltype(v)> sorted(n);
+        for (size_t i = 0; i < n; ++i)
+            sorted[i] = v[order[i]];
+        v.swap(sorted);
+    };
+    permute(entities_);
+    permute(curve_of_);
+    permute(bus_);
+    permute(rated_kVA_);
+    permute(inv_rated_);
+    permute(nominal_kW_);
+    permute(pv_mask_);
+    permute(p_kW_);
+    permute(q_kvar_);
+    v_pu_.assign(n, 1.0);
+    available_kW_.assign(n, 0.0);
+    change_frac_.assign(n, 0.0);
+
+    ranges_.clear();
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && curve_of_[j] == curve_of_[i])
+            ++j;
+        ranges_.push_back({ curve_of_[i], i, j });
+        i = j;
+    }
+    net_kW_.assign(feeder_.bus_count(), 0.0);
+    net_kvar_.assign(feeder_.bus_count(), 0.0);
+}
+
+double DerVoltageFleet::update_outputs(double pv_factor, double alpha)
+{
+    const double pv_delta = pv_factor - 1.0;
+    for (const CurveRange& range : ranges_) {
+        const size_t b = range.begin;
+        update_range(curves_[range.curve_set], range.end - b, alpha, pv_delta, v_pu_.data() + b, rated_kVA_.data() + b,
+            inv_rated_.data() + b, nominal_kW_.data() + b, pv_mask_.data() + b, available_kW_.data() + b, p_kW_.data() + b,
+            q_kvar_.data() + b, change_frac_.data() + b);
+    }
+    return change_frac_.empty() ? 0.0 : *std::max_element(change_frac_.begin(), change_frac_.end());
+}
+
+void DerVoltageFleet::update_range(const CurveCoefficients& c, size_t n, double alpha, double pv_delta,
+    const double* __restrict v, const double* __restrict rated, const double* __restrict inv_rated,
+    const double* __restrict nominal, const double* __restrict pv_mask, double* __restrict available,
+    double* __restrict p, double* __restrict q, double* __restrict change)
+{
+    // 循环内只有按值的比较选择 (clamp_value)，没有分支和归约，可由编译器自动向量化
+    for (size_t i = 0; i < n; ++i) {
+        const double dv = v[i] - c.v0;
+        const double q_frac = c.q0 + c.slope[0] * clamp_value(dv, 0.0, c.width[0])
+            + c.slope[1] * clamp_value(dv - c.width[0], 0.0, c.width[1])
+            + c.slope[2] * clamp_value(dv - c.width[0] - c.width[1], 0.0, c.width[2]);
+        const double watt_frac = 1.0 - c.vw_slope * clamp_value(v[i] - c.vw_start, 0.0, c.vw_width);
+        available[i] = nominal[i] * (1.0 + pv_mask[i] * pv_delta);
+        // 有功优先: 无功受剩余容量限制
+        const double p_target = clamp_value(watt_frac * rated[i], -rated[i], available[i]);
+        const double q_limit = std::sqrt(clamp_value(rated[i] * rated[i] - p_target * p_target, 0.0, rated[i] * rated[i]));
+        const double q_target = clamp_value(q_frac * rated[i], -q_limit, q_limit);
+        const double dp = alpha * (p_target - p[i]);
+        const double dq = alpha * (q_target - q[i]);
+        p[i] += dp;
+        q[i] += dq;
+        change[i] = (std::abs(dp) < std::abs(dq) ? std::abs(dq) : std::abs(dp)) * inv_rated[i];
+    }
+}
+
+DerStepResult DerVoltageFleet::step(const double* load_kW, const double* load_kvar, double pv_factor, double source_voltage_pu,
+    double* v_re, double* v_im)
+{
+    DerStepResult result;
+    const size_t n = entities_.size();
+    const int buses = feeder_.bus_count();
+    double alpha = settings_.damping;
+    double last_residual = 0.0;
+    for (int it = 0; it < settings_.max_iterations; ++it) {
+        // 母线净负荷 = 负荷 - 逆变器注入
+        std::copy(load_kW, load_kW + buses, net_kW_.begin());
+        std::copy(load_kvar, load_kvar + buses, net_kvar_.begin());
+        for (size_t i = 0; i < n; ++i) {
+            net_kW_[bus_[i]] -= p_kW_[i];
+            net_kvar_[bus_[i]] -= q_kvar_[i];
+        }
+        result.solution = feeder_.solve(net_kW_.data(), net_kvar_.data(), source_voltage_pu, v_re, v_im,
+            settings_.pf_tolerance_pu, settings_.pf_max_iterations, ws_);
+        for (size_t i = 0; i < n; ++i) {
+            const int b = bus_[i];
+            v_pu_[i] = std::sqrt(v_re[b] * v_re[b] + v_im[b] * v_im[b]);
+        }
+        ++result.iterations;
+        result.max_change_frac = update_outputs(pv_factor, alpha);
+        result.damping = alpha;
+        // 残差与阻尼无关；收敛判据按设定阻尼折算，未减小阻尼时与直接比较出力变化相同
+        const double residual = alpha > 0.0 ? result.max_change_frac / alpha : 0.0;
+        if (residual * settings_.damping < settings_.tolerance_frac && result.solution.converged) {
+            result.converged = true;
+            break;
+        }
+        if (it > 0 && residual >= last_residual)
+            alpha = std::max(0.5 * alpha, std::min(settings_.min_damping, settings_.damping));
+        last_residual = residual;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        result.p_kW += p_kW_[i];
+        result.q_kvar += q_kvar_[i];
+        result.curtailed_kW += pv_mask_[i] * (available_kW_[i] - p_kW_[i]);
+    }
+    return result;
+}
+
+void DerVoltageFleet::sync_to_components()
+{
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        if (auto comp = registry_.get<DerInverterComponent>(entities_[i])) {
+            comp->p_kW = p_kW_[i];
+            comp->q_kvar = q_kvar_[i];
+        }
+    }
+}
@@ -0,0 +1,151 @@
+// der_voltage_control.h
+// 分布式资源 (光伏、储能逆变器) 的电压支撑: Volt-VAR (按端电压调节无功) 与 Volt-Watt (过电压时限制有功输出)。
+// - 逆变器为带 DerInverterComponent 的实体，其所在母线电压取自辐射状馈线潮流 (RadialFeeder)；
+// - 控制曲线按曲线组登记，集群把逆变器按曲线组连续存放 (结构数组)，每轮对每个曲线组的连续区间做一次
+//   无分支的分段线性计算 (可由编译器自动向量化)，全部逆变器一轮只需一次遍历；
+// - 逆变器出力改变母线注入，进而改变电压，控制与潮流须迭代到不动点。直接以曲线值作为下一轮出力
+//   (阻尼系数为1) 在曲线较陡或馈线较弱时会来回振荡，因此每轮只向曲线值移动一个比例 (阻尼)。
+//   单台逆变器独占一段弱馈线时回路增益更大，默认阻尼仍会振荡: 残差 (出力与曲线值之差) 不再减小时
+//   本控制步内把阻尼减半，直到 min_damping。
+#ifndef DER_VOLTAGE_CONTROL_H
+#define DER_VOLTAGE_CONTROL_H
+
+#include "PowerSystemTopology.h"
+#include "ecs_core.h"
+#include "qsts_engine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 组件 (Component): 光伏或储能逆变器
+struct DerInverterComponent : public IComponent {
+    enum class Kind { PV,
+        ESS };
+    Kind kind;
+    BusId bus; // 并网母线
+    double rated_kVA; // 逆变器额定容量
+    double nominal_kW; // 光伏: 标准辐照下的可用有功；储能: 有功设定值 (放电为正)
+    uint32_t curve_set; // 使用的曲线组 (DerVoltageFleet::add_curve_set 的返回值)
+    double p_kW = 0.0; // 当前有功输出 (注入电网为正)
+    double q_kvar = 0.0; // 当前无功输出 (注入电网为正，吸收为负)
+
+    DerInverterComponent(Kind k, BusId b, double kva, double kw, uint32_t curves = 0)
+        : kind(k)
+        , bus(b)
+        , rated_kVA(kva)
+        , nominal_kW(kw)
+        , curve_set(curves)
+    {
+    }
+};
+
+// Volt-VAR 曲线: 4个拐点 (电压递增)，无功以额定容量的倍数表示，两端之外保持端点值
+struct VoltVarCurve {
+    double v_pu[4] = { 0.92, 0.98, 1.02, 1.08 };
+    double q_frac[4] = { 0.44, 0.0, 0.0, -0.44 };
+};
+
+// Volt-Watt 曲线: 电压高于 v_start 后有功上限由额定容量线性降至 v_end 处的 p_min_frac
+struct VoltWattCurve {
+    double v_start_pu = 1.06;
+    double v_end_pu = 1.10;
+    double p_min_frac = 0.2;
+};
+
+struct DerCurveSet {
+    VoltVarCurve volt_var;
+    VoltWattCurve volt_watt;
+};
+
+struct DerVoltageSettings {
+    double damping = 0.5; // 每轮出力向曲线值移动的比例 (0~1]
+    double min_damping = 0.05; // 残差不再减小时阻尼逐次减半的下限
+    double tolerance_frac = 1e-4; // 不动点收敛判据: 出力变化不超过额定容量的此比例
+    int max_iterations = 30; // 控制与潮流的最大迭代轮数
+    double pf_tolerance_pu = 1e-6;
+    int pf_max_iterations = 30;
+};
+
+// 一个控制步的结果
+struct DerStepResult {
+    int iterations = 0; // 控制与潮流的迭代轮数
+    bool converged = false;
+    double max_change_frac = 0.0; // 最后一轮的最大出力变化 (相对额定容量)
+    double damping = 0.0; // 最后一轮使用的阻尼系数 (小于设定值表示本步曾减小阻尼)
+    FeederSolution solution; // 最后一轮的潮流
+    double p_kW = 0.0; // 全部逆变器的有功与无功
+    double q_kvar = 0.0;
+    double curtailed_kW = 0.0; // Volt-Watt 限制的光伏有功
+};
+
+// 逆变器集群的电压控制
+class DerVoltageFleet {
+public:
+    DerVoltageFleet(Registry& registry, const RadialFeeder& feeder, DerVoltageSettings settings = {});
+
+    uint32_t add_curve_set(const DerCurveSet& curves); // 返回曲线组编号
+    // 把带 DerInverterComponent 的逆变器加入集群。缺少组件、母线不在馈线上或曲线组未登记时返回 false。
+    bool add_inverter(Entity inverter);
+    void reserve(size_t inverter_count);
+    // 按曲线组重排结构数组并建立各组的连续区间。须在 add_inverter 全部完成之后、第一次 step 之前调用。
+    void finalize();
+
+    // 一个控制步。load_kW / load_kvar 为各母线 (按馈线序号) 的负荷，pv_factor 为光伏可用功率相对标准辐照的比例。
+    // v_re / v_im 输入为潮流初值 (通常为上一步的结果)，输出为最后一轮的电压。
+    DerStepResult step(const double* load_kW, const double* load_kvar, double pv_factor, double source_voltage_pu,
+        double* v_re, double* v_im);
+
+    // 把出力写回各逆变器的 DerInverterComponent
+    void sync_to_components();
+
+    size_t size() const { return entities_.size(); }
+    const DerVoltageSettings& settings() const { return settings_; }
+    void set_damping(double damping) { settings_.damping = damping; }
+
+private:
+    // 曲线组的预计算系数: 分段线性函数写成 q0 + Σ 斜率 × clamp(v - 拐点, 0, 段宽)，不需分支
+    struct CurveCoefficients {
+        double v0, q0;
+        double width[3], slope[3];
+        double vw_start, vw_width, vw_slope; // Volt-Watt: 上限 = 1 - 斜率 × clamp(v - start, 0, 段宽)
+    };
+    struct CurveRange {
+        uint32_t curve_set;
+        size_t begin, end;
+    };
+
+    // 一轮: 由各逆变器端电压计算曲线值并以阻尼 alpha 更新出力，返回最大出力变化 (相对额定容量)
+    double update_outputs(double pv_factor, double alpha);
+    // 一个曲线组的连续区间 (n 个逆变器)。数组参数互不重叠 (__restrict)，编译器无需运行时别名检查即可向量化。
+    static void update_range(const CurveCoefficients& c, size_t n, double alpha, double pv_delta,
+        const double* __restrict v, const double* __restrict rated, const double* __restrict inv_rated,
+        const double* __restrict nominal, const double* __restrict pv_mask, double* __restrict available,
+        double* __restrict p, double* __restrict q, double* __restrict change);
+    static double clamp_value(double x, double lo, double hi) { return x < lo ? lo : (hi < x ? hi : x); }
+
+    Registry& registry_;
+    const RadialFeeder& feeder_;
+    DerVoltageSettings settings_;
+    std::vector<CurveCoefficients> curves_;
+    std::vector<CurveRange> ranges_;
+
+    // 逆变器状态 (SoA，finalize 后按曲线组连续)
+    std::vector<Entity> entities_;
+    std::vector<uint32_t> curve_of_;
+    std::vector<int> bus_; // 馈线序号
+    std::vector<double> rated_kVA_;
+    std::vector<double> inv_rated_; // 1 / 额定容量
+    std::vector<double> nominal_kW_;
+    std::vector<double> pv_mask_; // 光伏为1，储能为0 (可用有功 = 标称 × (1 + mask × (pv_factor - 1)))
+    std::vector<double> p_kW_, q_kvar_;
+    std::vector<double> v_pu_; // 本轮端电压
+    std::vector<double> available_kW_; // 本轮可用有功
+    std::vector<double> change_frac_; // 本轮出力变化 (相对额定容量)，与曲线计算分开求最大值以免阻碍向量化
+
+    // 潮流工作区
+    RadialFeeder::Workspace ws_;
+    std::vector<double> net_kW_, net_kvar_;
+};
+
+#endif // DER_VOLTAGE_CONTROL_H
@@ -6,11 +6,17 @@
 #define ECS_CORE_H
 
 #include "logging_utils.h"
+#include "memory_accounting.h" // 每种组件的存储计入各自的内存标记
+#include <algorithm> // 用于打包池重排时的稳定排序
 #include <cstdint> // 用于 uint64_t 等固定宽度整数类型
 #include <memory> // 用于 std::unique_ptr 等智能指针，实现组件的自动内存管理
+#include <numeric> // 用于 std::iota
+#include <stdexcept> // 用于重排顺序与打包池大小不符时抛出异常
 #include <type_traits> // 用于 std::is_base_of 等类型特性判断，例如在编译期检查组件是否继承自IComponent
 #include <typeinfo> // 用于 typeid 获取类型信息 (例如计算哈希值作为组件类型的唯一标识)
 #include <unordered_map> // 用于 std::unordered_map，提供高效的基于哈希的组件存储和检索
+#include <utility> // 用于 std::forward, std::move
+#include <vector> // 用于打包池的稠密数组
 // 定义实体ID (Entity ID) 类型，使用64位无符号整数。
 // 这提供了足够大的ID空间，以容纳大量实体。
 using Entity = uint64_t;
@@ -24,6 +30,181 @@ public:
     virtual ~IComponent() = default; // 默认的虚析构函数
 };
 
+// 紧凑句柄 (Compact Handle)
+// 32位: 低24位为打包池中的槽位索引，高8位为槽位的代数 (generation)。
+// 槽位被释放后代数加1，旧句柄随即失效，get() 返回 nullptr；代数为8位，同一槽位复用256次后会回绕。
+// 与64位的 Entity 不同，句柄只在其所属的打包池内有意义，适合在大规模设备的每步计算中代替 Entity 作为引用。
+class CompactHandle {
+public:
+    static constexpr uint32_t INDEX_BITS = 24;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t MAX_SLOTS = INDEX_MASK; // 索引全1保留给空句柄
+
+    constexpr CompactHandle() = default; // 空句柄
+    constexpr CompactHandle(uint32_t index, uint8_t generation)
+        : bits_((static_cast<uint32_t>(generation) << INDEX_BITS) | (index & INDEX_MASK))
+    {
+    }
+
+    constexpr uint32_t index() const { return bits_ & INDEX_MASK; }
+    constexpr uint8_t generation() const { return static_cast<uint8_t>(bits_ >> INDEX_BITS); }
+    constexpr bool valid() const { return index() != INDEX_MASK; }
+    constexpr uint32_t raw() const { return bits_; }
+    constexpr bool operator==(const CompactHandle& other) const { return bits_ == other.bits_; }
+    constexpr bool operator!=(const CompactHandle& other) const { return bits_ != other.bits_; }
+
+private:
+    uint32_t bits_ = INDEX_MASK;
+};
+
+// 打包池的类型擦除基类，仅用于 Registry 统一持有和销毁各类型的打包池
+class PackedPoolBase {
+public:
+    virtual ~PackedPoolBase() = default;
+};
+
+// 打包池 (Packed Pool)
+// 存放普通的、非多态的热数据组件 (不继承 IComponent，没有虚表指针，也不单独堆分配)。
+// 组件按值连续存放在稠密数组中，每步遍历只触及组件本身的字节；稠密数组旁另存一列所属实体，
+// 遍历时需要实体ID才去读它。槽位表把句柄映射到稠密下标，删除时用末尾元素填补空位 (稠密顺序随之改变)。
+// 多个打包池按相同顺序插入且从不删除时，同一设备在各池中的句柄与稠密下标都相同，可以按下标并行遍历。
+template <typename T>
+class PackedPool : public PackedPoolBase {
+    static_assert(!std::is_polymorphic<T>::value, "打包池中的组件必须是非多态类型");
+
+public:
+    // 为实体 owner 就地构造一个组件，返回其句柄
+    template <typename... Args>
+    CompactHandle emplace(Entity owner, Args&&... args)
+    {
+        MemTagScope mem_scope(mem_component_tag<T>());
+        uint32_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(slot_dense_.size());
+            if (slot >= CompactHandle::MAX_SLOTS)
+                return CompactHandle {};
+            slot_dense_.push_back(0);
+            slot_generation_.push_back(0);
+        }
+        slot_dense_[slot] = static_cast<uint32_t>(dense_.size());
+        dense_.push_back(T { std::forward<Args>(args)... });
+        dense_owner_.push_back(owner);
+        dense_slot_.push_back(slot);
+        return CompactHandle(slot, slot_generation_[slot]);
+    }
+
+    // 句柄失效 (已删除或代数不符) 时返回 nullptr
+    T* get(CompactHandle h)
+    {
+        uint32_t slot = h.index();
+        if (slot >= slot_dense_.size() || slot_generation_[slot] != h.generation() || slot_dense_[slot] == CompactHandle::INDEX_MASK)
+            return nullptr;
+        return &dense_[slot_dense_[slot]];
+    }
+
+    // 删除句柄对应的组件，末尾元素移入空位；返回是否删除成功
+    bool erase(CompactHandle h)
+    {
+        if (!get(h))
+            return false;
+        uint32_t slot = h.index();
+        uint32_t dense = slot_dense_[slot];
+        uint32_t last = static_cast<uint32_t>(dense_.size() - 1);
+        if (dense != last) {
+            dense_[dense] = std::move(dense_[last]);
+            dense_owner_[dense] = dense_owner_[last];
+            dense_slot_[dense] = dense_slot_[last];
+            slot_dense_[dense_slot_[dense]] = dense;
+        }
+        dense_.pop_back();
+        dense_owner_.pop_back();
+        dense_slot_.pop_back();
+        slot_dense_[slot] = CompactHandle::INDEX_MASK;
+        ++slot_generation_[slot];
+        free_slots_.push_back(slot);
+        return true;
+    }
+
+    // 按给定顺序重排稠密数组: order[新下标] = 旧下标 (须为 0..size()-1 的一个排列)。
+    // 句柄保持有效，只是指向的稠密下标改变。
+    void permute(const std::vector<uint32_t>& order)
+    {
+        if (order.size() != dense_.size())
+            throw std::invalid_argument("PackedPool::permute: 重排顺序的长度与打包池大小不符");
+        MemTagScope mem_scope(mem_component_tag<T>());
+        std::vector<T> dense;
+        std::vector<Entity> dense_owner;
+        std::vector<uint32_t> dense_slot;
+        dense.reserve(order.size());
+        dense_owner.reserve(order.size());
+        dense_slot.reserve(order.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            uint32_t old = order[i];
+            dense.push_back(std::move(dense_[old]));
+            dense_owner.push_back(dense_owner_[old]);
+            dense_slot.push_back(dense_slot_[old]);
+            slot_dense_[dense_slot_[old]] = i;
+        }
+        dense_.swap(dense);
+        dense_owner_.swap(dense_owner);
+        dense_slot_.swap(dense_slot);
+    }
+
+    // 按 key(const T&, Entity) 的值稳定排序 (键相同的组件保持原有相对顺序)，返回所用的重排顺序，
+    // 可再用 permute() 施加到与本池按相同顺序插入的其他打包池
+    template <typename KeyFn>
+    std::vector<uint32_t> sort(KeyFn&& key)
+    {
+        using Key = decltype(key(std::declval<const T&>(), Entity {}));
+        std::vector<Key> keys;
+        keys.reserve(dense_.size());
+        for (size_t i = 0; i < dense_.size(); ++i)
+            keys.push_back(key(static_cast<const T&>(dense_[i]), dense_owner_[i]));
+        std::vector<uint32_t> order(dense_.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        permute(order);
+        return order;
+    }
+
+    void reserve(size_t n)
+    {
+        MemTagScope mem_scope(mem_component_tag<T>());
+        dense_.reserve(n);
+        dense_owner_.reserve(n);
+        dense_slot_.reserve(n);
+        slot_dense_.reserve(n);
+        slot_generation_.reserve(n);
+    }
+
+    size_t size() const { return dense_.size(); }
+    T* data() { return dense_.data(); }
+    const T* data() const { return dense_.data(); }
+    Entity owner(size_t dense_index) const { return dense_owner_[dense_index]; }
+
+    // 按稠密顺序遍历: fn(T& 组件, Entity 所属实体)
+    template <typename Fn>
+    void for_each(Fn&& fn)
+    {
+        for (size_t i = 0; i < dense_.size(); ++i)
+            fn(dense_[i], dense_owner_[i]);
+    }
+
+    // 每个组件占用的字节数 (稠密数组中的组件本身，外加所属实体列与双向槽位映射)
+    static constexpr size_t bytes_per_element() { return sizeof(T) + sizeof(Entity) + 2 * sizeof(uint32_t) + sizeof(uint8_t); }
+
+private:
+    std::vector<T> dense_; // 组件本身 (按值连续存放)
+    std::vector<Entity> dense_owner_; // 稠密下标 -> 所属实体
+    std::vector<uint32_t> dense_slot_; // 稠密下标 -> 槽位
+    std::vector<uint32_t> slot_dense_; // 槽位 -> 稠密下标 (已删除时为 INDEX_MASK)
+    std::vector<uint8_t> slot_generation_; // 槽位 -> 代数
+    std::vector<uint32_t> free_slots_; // 可复用的槽位
+};
+
 // 注册表类 (Registry)
 // Registry 是ECS架构的核心，负责管理所有实体 (Entities) 及其关联的组件 (Components)。
 // 它提供以下功能：
@@ -38,6 +219,15 @@ public:
     // 注意：在更复杂的系统中，可能需要更完善的ID回收和管理机制。
     Entity create() { return ++last_id_; }
 
+    // 以指定的ID登记一个实体 (用于从预编译场景镜像恢复实体，保持镜像中的ID不变)。
+    // 内部计数器会同步前移，保证之后 create() 生成的ID不会与之冲突。
+    Entity create_with_id(Entity e)
+    {
+        if (e > last_id_)
+            last_id_ = e;
+        return e;
+    }
+
     // 为指定的实体 `e` 添加一个类型为 `Comp` 的组件，并就地构造它。
     // `Args&&... args` 是传递给组件 `Comp` 构造函数的参数列表 (使用完美转发)。
     // 静态断言 `static_assert` 确保 `Comp` 类型必须是 `IComponent` 的派生类。
@@ -48,6 +238,9 @@ public:
         // 编译期检查：确保组件类型 Comp 继承自 IComponent
         static_assert(std::is_base_of<IComponent, Comp>::value, "组件类型必须公有继承自 IComponent");
 
+        // 组件对象及其在两级哈希表中的节点计入该组件类型的内存标记
+        MemTagScope mem_scope(mem_component_tag<Comp>());
+
         // 使用 std::make_unique 创建组件的智能指针实例，实现自动内存管理
         auto ptr = std::make_unique<Comp>(std::forward<Args>(args)...);
         Comp* raw_ptr = ptr.get(); // 获取原始指针，用于返回对组件的引用
@@ -118,6 +311,29 @@ public:
         }
     }
 
+    // 获取 (首次使用时创建) 类型 `T` 的打包池。
+    // 打包池用于非多态的热数据组件，以 CompactHandle 而非 Entity 访问，与 emplace/get 管理的组件互不相干。
+    template <typename T>
+    PackedPool<T>& pool()
+    {
+        auto& slot = pools_[typeid(T).hash_code()];
+        if (!slot)
+            slot = std::make_unique<PackedPool<T>>();
+        return static_cast<PackedPool<T>&>(*slot);
+    }
+
+    // 局部性重排: 按 key(const Lead&, Entity) (例如所属充电站、馈线或分区编号) 稳定排序打包池 Lead，
+    // 并把同一重排施加到相关的打包池 Related... (它们须与 Lead 按相同顺序插入、大小相同)，
+    // 使各池的稠密下标保持一致。排序后同一分区的组件在每个池中都连续存放，分区内的遍历线性访存，
+    // 并行时各工作线程分得互不相交的连续区间。返回重排顺序 (order[新下标] = 旧下标)。
+    template <typename Lead, typename... Related, typename KeyFn>
+    std::vector<uint32_t> sort(KeyFn&& key)
+    {
+        std::vector<uint32_t> order = pool<Lead>().sort(std::forward<KeyFn>(key));
+        (pool<Related>().permute(order), ...);
+        return order;
+    }
+
 private:
     Entity last_id_ { 0 }; // 用于生成下一个可用实体ID的计数器，从0开始递增。
 
@@ -131,6 +347,9 @@ private:
     //   使用 `std::unique_ptr` 确保了组件对象的自动内存管理 (当组件被移除或注册表销毁时)。
     //   存储的是基类指针 `IComponent*`，实现了类型擦除，允许在同一个结构中管理不同类型的组件。
     std::unordered_map<size_t, std::unordered_map<Entity, std::unique_ptr<IComponent>>> components_;
+
+    // 打包池: 键为组件类型的哈希码，值为该类型的 PackedPool<T>
+    std::unordered_map<size_t, std::unique_ptr<PackedPoolBase>> pools_;
 };
 
 #endif // ECS_CORE_H
\ No newline at end of file
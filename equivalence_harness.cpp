@@ -0,0 +1,292 @@
+// equivalence_harness.cpp
+// 实现了运行记录、逐项比较与第一个分歧点的定位，以及按指定方式推进调度循环和周期采样的协程。
+
+#include "equivalence_harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+bool within_tolerance(double reference, double candidate, const EquivalenceTolerance& tolerance)
+{
+    if (reference == candidate || (std::isnan(reference) && std::isnan(candidate)))
+        return true;
+    const double scale = std::max(std::abs(reference), std::abs(candidate));
+    return std::abs(reference - candidate) <= tolerance.absolute + tolerance.relative * scale;
+}
+
+const char* kind_name(DivergenceKind kind)
+{
+    switch (kind) {
+    case DivergenceKind::VALUE:
+        return "数值超出容差";
+    case DivergenceKind::TIME:
+        return "时刻超出容差";
+    case DivergenceKind::MISMATCH:
+        return "记录不对应";
+    case DivergenceKind::MISSING:
+        return "候选引擎缺少记录";
+    case DivergenceKind::EXTRA:
+        return "候选引擎多出记录";
+    case DivergenceKind::STRUCTURE:
+        return "序列登记不同";
+    }
+    return "";
+}
+
+} // namespace
+
+uint32_t EquivalenceTrace::field(const std::string& name)
+{
+    auto it = field_index_.find(name);
+    if (it != field_index_.end())
+        return it->second;
+    field_names_.push_back(name);
+    const uint32_t id = static_cast<uint32_t>(field_names_.size() - 1);
+    field_index_.emplace(name, id);
+    return id;
+}
+
+std::string EquivalenceTrace::entity_label(uint64_t entity) const
+{
+    auto it = entity_names_.find(entity);
+    if (it != entity_names_.end())
+        return it->second;
+    std::string label = std::to_string(entity);
+    label.insert(label.begin(), '#');
+    return label;
+}
+
+void EquivalenceTrace::add_event(double time_s, uint64_t entity, uint32_t field, double value)
+{
+    events_.push_back({ time_s, entity, field, value });
+}
+
+uint32_t EquivalenceTrace::add_series(uint64_t entity, uint32_t field)
+{
+    series_.push_back({ entity, field });
+    return static_cast<uint32_t>(series_.size() - 1);
+}
+
+double* EquivalenceTrace::add_sample(double time_s)
+{
+    sample_times_.push_back(time_s);
+    values_.resize(values_.size() + series_.size(), 0.0);
+    return values_.data() + (sample_times_.size() - 1) * series_.size();
+}
+
+std::string EquivalenceReport::describe() const
+{
+    std::ostringstream out;
+    out.precision(10);
+    if (equivalent) {
+        out << "[" << candidate << "] 与 [" << reference << "] 等价: 比较 " << events_compared << " 个事件、" << values_compared
+            << " 个数值，最大偏差 " << max_abs_difference << "。";
+    } else {
+        out << "[" << candidate << "] 与 [" << reference << "] 不等价";
+        if (first_divergence) {
+            const EquivalenceDivergence& d = *first_divergence;
+            out << ": 第一个分歧于 " << d.time_s << " 秒 (" << (d.in_events ? "事件#" : "采样行") << d.index << ")，"
+                << kind_name(d.kind);
+            if (d.kind != DivergenceKind::STRUCTURE) {
+                out << "，实体 " << d.entity_label << " 字段 " << d.field;
+                if (d.kind == DivergenceKind::VALUE)
+                    out << ": 参考 " << d.reference_value << "，候选 " << d.candidate_value;
+                else if (d.kind == DivergenceKind::TIME || d.kind == DivergenceKind::MISMATCH)
+                    out << ": 参考时刻 " << d.reference_time_s << " 秒，候选时刻 " << d.candidate_time_s << " 秒";
+            }
+        }
+        out << "；共 " << mismatches << " 处不一致，最大偏差 " << max_abs_difference << "。";
+    }
+    return out.str();
+}
+
+EquivalenceReport compare_traces(const EquivalenceTrace& reference, const EquivalenceTrace& candidate, const EquivalenceTolerance& tolerance)
+{
+    EquivalenceReport report;
+    std::optional<EquivalenceDivergence> first_event, first_sample;
+    auto note = [&](std::optional<EquivalenceDivergence>& first, EquivalenceDivergence d, uint64_t entity, uint32_t field,
+                    const EquivalenceTrace& named_by) {
+        ++report.mismatches;
+        if (first)
+            return;
+        d.entity = entity;
+        d.entity_label = named_by.entity_label(entity);
+        d.field = named_by.field_name(field);
+        first = std::move(d);
+    };
+    auto track = [&](double a, double b) {
+        const double diff = std::abs(a - b);
+        if (std::isfinite(diff))
+            report.max_abs_difference = std::max(report.max_abs_difference, diff);
+    };
+
+    // --- 事件序列: 按序号逐条对应 ---
+    auto in_horizon = [&](const EquivalenceTrace& trace) {
+        size_t n = 0;
+        while (n < trace.events().size() && trace.events()[n].time_s < tolerance.horizon_s)
+            ++n;
+        return n;
+    };
+    const size_t ref_events = in_horizon(reference), cand_events = in_horizon(candidate);
+    for (size_t i = 0; i < std::max(ref_events, cand_events); ++i) {
+        EquivalenceDivergence d;
+        d.in_events = true;
+        d.index = i;
+        if (i >= cand_events) {
+            const auto& r = reference.events()[i];
+            d.kind = DivergenceKind::MISSING;
+            d.time_s = d.reference_time_s = r.time_s;
+            d.reference_value = r.value;
+            note(first_event, d, r.entity, r.field, reference);
+            continue;
+        }
+        if (i >= ref_events) {
+            const auto& c = candidate.events()[i];
+            d.kind = DivergenceKind::EXTRA;
+            d.time_s = d.candidate_time_s = c.time_s;
+            d.candidate_value = c.value;
+            note(first_event, d, c.entity, c.field, candidate);
+            continue;
+        }
+        const auto& r = reference.events()[i];
+        const auto& c = candidate.events()[i];
+        ++report.events_compared;
+        d.time_s = std::min(r.time_s, c.time_s);
+        d.reference_time_s = r.time_s;
+        d.candidate_time_s = c.time_s;
+        d.reference_value = r.value;
+        d.candidate_value = c.value;
+        // 字段按名称对应 (两次运行的字段登记顺序可以不同)
+        if (r.entity != c.entity || reference.field_name(r.field) != candidate.field_name(c.field)) {
+            d.kind = DivergenceKind::MISMATCH;
+        } else if (std::abs(r.time_s - c.time_s) > tolerance.time_s) {
+            d.kind = DivergenceKind::TIME;
+        } else {
+            track(r.value, c.value);
+            if (within_tolerance(r.value, c.value, tolerance))
+                continue;
+            d.kind = DivergenceKind::VALUE;
+        }
+        note(first_event, d, r.entity, r.field, reference);
+    }
+
+    // --- 时间曲线: 序列登记须相同，按行对应 ---
+    const auto& series = reference.series();
+    bool same_series = series.size() == candidate.series().size();
+    for (size_t j = 0; same_series && j < series.size(); ++j) {
+        const auto& c = candidate.series()[j];
+        same_series = series[j].entity == c.entity && reference.field_name(series[j].field) == candidate.field_name(c.field);
+    }
+    if (!same_series) {
+        ++report.mismatches;
+        EquivalenceDivergence d;
+        d.kind = DivergenceKind::STRUCTURE;
+        first_sample = d;
+    } else {
+        auto rows_in_horizon = [&](const EquivalenceTrace& trace) {
+            size_t n = 0;
+            while (n < trace.sample_count() && trace.sample_time(n) < tolerance.horizon_s)
+                ++n;
+            return n;
+        };
+        const size_t ref_rows = rows_in_horizon(reference), cand_rows = rows_in_horizon(candidate);
+        const size_t width = series.size();
+        for (size_t row = 0; row < std::max(ref_rows, cand_rows) && width > 0; ++row) {
+            EquivalenceDivergence d;
+            d.index = row;
+            if (row >= cand_rows || row >= ref_rows) {
+                const bool missing = row >= cand_rows;
+                const EquivalenceTrace& present = missing ? reference : candidate;
+                d.kind = missing ? DivergenceKind::MISSING : DivergenceKind::EXTRA;
+                d.time_s = present.sample_time(row);
+                (missing ? d.reference_time_s : d.candidate_time_s) = d.time_s;
+                note(first_sample, d, series[0].entity, series[0].field, reference);
+                report.mismatches += width - 1;
+                continue;
+            }
+            const double tr = reference.sample_time(row), tc = candidate.sample_time(row);
+            if (tr != tc) {
+                d.kind = DivergenceKind::MISMATCH;
+                d.time_s = std::min(tr, tc);
+                d.reference_time_s = tr;
+                d.candidate_time_s = tc;
+                note(first_sample, d, series[0].entity, series[0].field, reference);
+                report.mismatches += width - 1;
+                continue;
+            }
+            const double* rv = reference.sample_row(row);
+            const double* cv = candidate.sample_row(row);
+            report.values_compared += width;
+            for (size_t j = 0; j < width; ++j) {
+                track(rv[j], cv[j]);
+                if (within_tolerance(rv[j], cv[j], tolerance))
+                    continue;
+                d.kind = DivergenceKind::VALUE;
+                d.time_s = d.reference_time_s = d.candidate_time_s = tr;
+                d.reference_value = rv[j];
+                d.candidate_value = cv[j];
+                note(first_sample, d, series[j].entity, series[j].field, reference);
+            }
+        }
+    }
+
+    // 分歧点取两者中时刻较早的一个 (同一时刻以事件为先)
+    if (first_event && (!first_sample || first_event->time_s <= first_sample->time_s))
+        report.first_divergence = first_event;
+    else
+        report.first_divergence = first_sample;
+    report.equivalent = report.mismatches == 0;
+    return report;
+}
+
+std::vector<EquivalenceReport> run_equivalence_suite(const std::vector<EquivalenceEngine>& engines, const EquivalenceTolerance& tolerance)
+{
+    std::vector<EquivalenceReport> reports;
+    if (engines.empty())
+        return reports;
+    auto timed_run = [](const EquivalenceEngine& engine, EquivalenceTrace& trace) {
+        auto start = std::chrono::steady_clock::now();
+        engine.run(trace);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    EquivalenceTrace reference;
+    const double reference_elapsed_s = timed_run(engines[0], reference);
+    for (size_t e = 1; e < engines.size(); ++e) {
+        EquivalenceTrace candidate;
+        const double candidate_elapsed_s = timed_run(engines[e], candidate);
+        EquivalenceReport report = compare_traces(reference, candidate, tolerance);
+        report.reference = engines[0].name;
+        report.candidate = engines[e].name;
+        report.reference_elapsed_s = reference_elapsed_s;
+        report.candidate_elapsed_s = candidate_elapsed_s;
+        reports.push_back(std::move(report));
+    }
+    return reports;
+}
+
+void drive_scheduler(cps_coro::Scheduler& scheduler, cps_coro::Scheduler::time_point end_time, SchedulerDrive drive)
+{
+    if (drive == SchedulerDrive::RUN_UNTIL) {
+        scheduler.run_until(end_time);
+        return;
+    }
+    // 与 run_real_time_until 相同: 最后一步可能执行一个晚于 end_time 的定时任务 (比较时以 horizon_s 截止)
+    while (scheduler.now() < end_time && scheduler.has_pending_tasks())
+        scheduler.run_one_step();
+    if (scheduler.now() < end_time)
+        scheduler.set_time(end_time);
+}
+
+cps_coro::Task equivalenceSamplerTask(cps_coro::Scheduler& scheduler, EquivalenceTrace& trace, cps_coro::Scheduler::duration offset,
+    cps_coro::Scheduler::duration period, std::function<void(double*)> fill)
+{
+    co_await cps_coro::delay(offset);
+    while (true) {
+        fill(trace.add_sample(std::chrono::duration<double>(scheduler.now().time_since_epoch()).count()));
+        co_await cps_coro::delay(period);
+    }
+}
@@ -0,0 +1,138 @@
+// equivalence_harness.h
+// 仿真引擎的差分等价性校验: 同一个带种子的场景分别由参考引擎 (逐设备协程、标准调度循环) 与优化引擎 (批量内核、
+// 集合通道、其他调度路径等) 运行，记录事件序列与时间曲线并逐项比较，给出第一个分歧点 (时刻、实体、字段)。
+// - 事件序列: 按发生顺序记录 (时刻, 实体, 字段, 数值)，逐条比较，时刻与数值各有容差；
+// - 时间曲线: 先登记全部序列 (实体, 字段)，此后每个采样时刻按登记顺序提交一行数值，按行比较。
+//   数值按行连续存放 (每个值8字节)，10^3 台设备、每20毫秒一行的70秒曲线约 56MB；
+// - 采样由一个独立协程在各引擎共同的时刻读取状态，它只读不写，不改变被测引擎的行为。事件由等待对应事件ID的
+//   观察协程记录，事件处理器同步恢复，因此同一时刻连续触发的多次事件都被记录且顺序不变；
+// - 容差默认为零 (要求逐位一致)。分歧点取事件与曲线两者中时刻较早的一个；其后的分歧只计数并统计最大偏差。
+#ifndef EQUIVALENCE_HARNESS_H
+#define EQUIVALENCE_HARNESS_H
+
+#include "cps_coro_lib.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 一次运行的记录
+class EquivalenceTrace {
+public:
+    // 字段名登记 (同名返回同一编号)
+    uint32_t field(const std::string& name);
+    const std::string& field_name(uint32_t field) const { return field_names_[field]; }
+    // 实体在报告中显示的名称 (可选)
+    void name_entity(uint64_t entity, std::string name) { entity_names_[entity] = std::move(name); }
+    std::string entity_label(uint64_t entity) const;
+
+    // --- 事件序列 ---
+    void add_event(double time_s, uint64_t entity, uint32_t field, double value);
+
+    // --- 时间曲线 ---
+    // 登记一条序列，返回其列号。须在第一次 add_sample() 之前完成全部登记。
+    uint32_t add_series(uint64_t entity, uint32_t field);
+    // 新增一个采样时刻，返回本行的数值 (长度为序列数，按登记顺序填写)
+    double* add_sample(double time_s);
+
+    struct Event {
+        double time_s;
+        uint64_t entity;
+        uint32_t field;
+        double value;
+    };
+    struct Series {
+        uint64_t entity;
+        uint32_t field;
+    };
+    const std::vector<Event>& events() const { return events_; }
+    const std::vector<Series>& series() const { return series_; }
+    size_t sample_count() const { return sample_times_.size(); }
+    double sample_time(size_t row) const { return sample_times_[row]; }
+    const double* sample_row(size_t row) const { return values_.data() + row * series_.size(); }
+
+private:
+    std::vector<std::string> field_names_;
+    std::unordered_map<std::string, uint32_t> field_index_;
+    std::unordered_map<uint64_t, std::string> entity_names_;
+    std::vector<Event> events_;
+    std::vector<Series> series_;
+    std::vector<double> sample_times_;
+    std::vector<double> values_; // 按行存放，每行 series_.size() 个值
+};
+
+struct EquivalenceTolerance {
+    double absolute = 0.0; // 数值的绝对容差
+    double relative = 0.0; // 数值的相对容差 (相对两者绝对值的较大者)
+    double time_s = 0.0; // 事件时刻的容差
+    double horizon_s = std::numeric_limits<double>::infinity(); // 只比较此时刻之前的事件与采样
+};
+
+enum class DivergenceKind {
+    VALUE, // 数值超出容差
+    TIME, // 事件时刻超出容差
+    MISMATCH, // 同一序号的事件 (实体或字段) 不同，或采样时刻不同
+    MISSING, // 候选引擎缺少参考引擎的事件或采样
+    EXTRA, // 候选引擎多出事件或采样
+    STRUCTURE, // 两次运行登记的序列不同，曲线无法比较
+};
+
+// 第一个分歧点
+struct EquivalenceDivergence {
+    DivergenceKind kind = DivergenceKind::VALUE;
+    bool in_events = false; // 发生在事件序列 (否则在时间曲线)
+    size_t index = 0; // 事件序号或采样行号
+    double time_s = 0.0;
+    uint64_t entity = 0;
+    std::string entity_label;
+    std::string field;
+    double reference_value = 0.0;
+    double candidate_value = 0.0;
+    double reference_time_s = 0.0;
+    double candidate_time_s = 0.0;
+};
+
+struct EquivalenceReport {
+    std::string reference;
+    std::string candidate;
+    bool equivalent = true;
+    size_t events_compared = 0;
+    size_t values_compared = 0;
+    size_t mismatches = 0; // 超出容差或无法对应的事件与数值个数
+    double max_abs_difference = 0.0; // 可对应的数值中的最大绝对偏差
+    std::optional<EquivalenceDivergence> first_divergence;
+    double reference_elapsed_s = 0.0; // 各自运行的物理耗时
+    double candidate_elapsed_s = 0.0;
+
+    // 一行中文摘要 (等价时给出比较规模，否则给出第一个分歧点)
+    std::string describe() const;
+};
+
+EquivalenceReport compare_traces(const EquivalenceTrace& reference, const EquivalenceTrace& candidate, const EquivalenceTolerance& tolerance);
+
+// 一个被测引擎: run 在自己的调度器与注册表中运行场景并写入记录
+struct EquivalenceEngine {
+    std::string name;
+    std::function<void(EquivalenceTrace&)> run;
+};
+
+// 依次运行各引擎，第一个为参考，其余逐一与参考比较。参考的记录保留到最后，候选的记录比较后即释放。
+std::vector<EquivalenceReport> run_equivalence_suite(const std::vector<EquivalenceEngine>& engines, const EquivalenceTolerance& tolerance);
+
+// 调度循环的推进方式
+enum class SchedulerDrive {
+    RUN_UNTIL, // Scheduler::run_until: 每个时刻先清空就绪队列，再整批取出下一时刻的定时任务
+    STEP, // 逐次 run_one_step (RealTimeScheduler::run_real_time_until 的推进路径，不等待物理时钟)
+};
+void drive_scheduler(cps_coro::Scheduler& scheduler, cps_coro::Scheduler::time_point end_time, SchedulerDrive drive);
+
+// 协程任务: 从 offset 起每隔 period 在 scheduler 的当前时刻新增一个采样，并由 fill 填写本行数值
+cps_coro::Task equivalenceSamplerTask(cps_coro::Scheduler& scheduler, EquivalenceTrace& trace, cps_coro::Scheduler::duration offset,
+    cps_coro::Scheduler::duration period, std::function<void(double*)> fill);
+
+#endif // EQUIVALENCE_HARNESS_H
@@ -0,0 +1,204 @@
+// ev_session.cpp
+// 实现了充电会话的随机抽样、槽位池和事件驱动的会话推进。
+
+#include "ev_session.h"
+#include "logging_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double SECONDS_PER_HOUR = 3600.0;
+
+} // namespace
+
+EvStationConfig::EvStationConfig()
+    // 默认到达曲线: 夜间低谷，早高峰 (8~9点) 与晚高峰 (17~19点)
+    : hourly_profile { 0.10, 0.05, 0.05, 0.05, 0.10, 0.20, 0.40, 0.70, 1.00, 0.90, 0.70, 0.60,
+        0.60, 0.60, 0.60, 0.70, 0.80, 1.00, 1.00, 0.80, 0.60, 0.40, 0.30, 0.20 }
+{
+}
+
+// --- EvSessionPool ---
+
+uint32_t EvSessionPool::acquire()
+{
+    if (!free_list_.empty()) {
+        uint32_t index = free_list_.back();
+        free_list_.pop_back();
+        return index;
+    }
+    slots_.emplace_back();
+    return static_cast<uint32_t>(slots_.size() - 1);
+}
+
+void EvSessionPool::release(uint32_t index)
+{
+    ++slots_[index].generation;
+    free_list_.push_back(index);
+}
+
+// --- EvSessionEngine ---
+
+EvSessionEngine::EvSessionEngine(cps_coro::Scheduler& scheduler, uint64_t seed, double load_interval_s)
+    : scheduler_(scheduler)
+    , seed_(seed)
+    , load_interval_s_(load_interval_s)
+{
+}
+
+uint32_t EvSessionEngine::add_station(const EvStationConfig& config)
+{
+    StationState station { config, 0.0, 0.0 };
+    station.peak_profile = *std::max_element(config.hourly_profile.begin(), config.hourly_profile.end());
+    station.peak_rate_per_s = config.arrivals_per_charger_hour * config.charger_count * station.peak_profile / SECONDS_PER_HOUR;
+    stations_.push_back(station);
+    return static_cast<uint32_t>(stations_.size() - 1);
+}
+
+// 非齐次泊松过程的 thinning 抽样：以全天最大到达率生成候选时刻，再按该时刻的时段系数接受。
+// 第 k 次到达的全部候选与接受判定都取自 (种子, 站, EV_ARRIVAL, k) 这一段随机数。
+double EvSessionEngine::draw_next_arrival(uint32_t station_idx, double after_s)
+{
+    auto& station = stations_[station_idx];
+    if (station.peak_rate_per_s <= 0.0)
+        return HUGE_VAL;
+    CounterRng rng(seed_, station_idx, RngStream::EV_ARRIVAL, station.arrival_count++);
+    double t = after_s;
+    while (true) {
+        t += -std::log(rng.uniform()) / station.peak_rate_per_s;
+        int hour = static_cast<int>(std::fmod(t / SECONDS_PER_HOUR, 24.0));
+        if (rng.uniform() * station.peak_profile <= station.config.hourly_profile[hour])
+            return t;
+    }
+}
+
+// 将充电负荷按当前功率积分到负荷曲线，直至 time_s
+void EvSessionEngine::advance_load_to(double time_s)
+{
+    while (load_time_s_ < time_s) {
+        size_t bucket = static_cast<size_t>(load_time_s_ / load_interval_s_);
+        double bucket_end = (bucket + 1) * load_interval_s_;
+        double segment_end = std::min(time_s, bucket_end);
+        if (load_profile_kW_.size() <= bucket)
+            load_profile_kW_.resize(bucket + 1, 0.0);
+        load_profile_kW_[bucket] += current_load_kW_ * (segment_end - load_time_s_) / load_interval_s_;
+        load_time_s_ = segment_end;
+    }
+}
+
+void EvSessionEngine::handle_arrival(uint32_t station_idx, uint32_t arrival_idx, double time_s)
+{
+    auto& station = stations_[station_idx];
+    ++stats_.arrivals;
+
+    // 会话属性按到达序号定位随机数，与站内占用情况和抽取顺序无关
+    CounterRng rng(seed_, station_idx, RngStream::EV_SESSION, arrival_idx);
+    double dwell_h = std::exp(station.config.dwell_log_mean + station.config.dwell_log_sigma * rng.normal());
+    double energy_kWh = std::exp(station.config.energy_log_mean + station.config.energy_log_sigma * rng.normal());
+
+    if (station.busy_chargers >= station.config.charger_count) {
+        ++stats_.rejected;
+    } else {
+        ++station.busy_chargers;
+        uint32_t slot_idx = pool_.acquire();
+        auto& slot = pool_[slot_idx];
+        slot.station = station_idx;
+        slot.arrival_s = time_s;
+        slot.departure_s = time_s + dwell_h * SECONDS_PER_HOUR;
+        slot.energy_demand_kWh = energy_kWh;
+        double full_s = time_s + energy_kWh / station.config.charger_power_kW * SECONDS_PER_HOUR;
+        slot.charge_end_s = std::min(full_s, slot.departure_s);
+
+        current_load_kW_ += station.config.charger_power_kW;
+        stats_.peak_load_kW = std::max(stats_.peak_load_kW, current_load_kW_);
+        ++stats_.sessions_started;
+        stats_.peak_active_sessions = std::max(stats_.peak_active_sessions, pool_.active_count());
+        session_events_.push({ slot.charge_end_s, slot_idx, slot.generation, SessionEventKind::CHARGE_END });
+        session_events_.push({ slot.departure_s, slot_idx, slot.generation, SessionEventKind::DEPARTURE });
+    }
+
+    uint32_t next_idx = station.arrival_count;
+    arrivals_.push({ draw_next_arrival(station_idx, time_s), station_idx, next_idx });
+}
+
+void EvSessionEngine::handle_session_event(const SessionEvent& ev)
+{
+    auto& slot = pool_[ev.slot];
+    if (slot.generation != ev.generation)
+        return;
+    auto& station = stations_[slot.station];
+    if (ev.kind == SessionEventKind::CHARGE_END) {
+        current_load_kW_ -= station.config.charger_power_kW;
+        stats_.energy_delivered_kWh += station.config.charger_power_kW * (slot.charge_end_s - slot.arrival_s) / SECONDS_PER_HOUR;
+    } else {
+        --station.busy_chargers;
+        ++stats_.sessions_completed;
+        pool_.release(ev.slot);
+    }
+}
+
+// 协程任务：每次唤醒处理所有已到期 (精确到毫秒) 的到达与会话事件，再休眠到下一个事件时刻
+cps_coro::Task EvSessionEngine::run(double horizon_s)
+{
+    const double start_s = scheduler_.now().time_since_epoch().count() / 1000.0;
+    load_time_s_ = start_s;
+    for (uint32_t i = 0; i < stations_.size(); ++i) {
+        uint32_t arrival_idx = stations_[i].arrival_count;
+        arrivals_.push({ draw_next_arrival(i, start_s), i, arrival_idx });
+    }
+
+    if (g_console_logger) {
+        g_console_logger->info("[{}毫秒] [EV会话] 已启动 {} 个充电站的会话生成，仿真至 {:.1f} 小时。",
+            scheduler_.now().time_since_epoch().count(), stations_.size(), horizon_s / SECONDS_PER_HOUR);
+    }
+
+    while (true) {
+        double next_arrival = arrivals_.empty() ? HUGE_VAL : arrivals_.top().time_s;
+        double next_session = session_events_.empty() ? HUGE_VAL : session_events_.top().time_s;
+        double next_s = std::min(next_arrival, next_session);
+        if (next_s > horizon_s)
+            break;
+
+        long long wake_ms = static_cast<long long>(std::ceil(next_s * 1000.0));
+        long long now_ms = scheduler_.now().time_since_epoch().count();
+        if (wake_ms > now_ms)
+            co_await cps_coro::delay(cps_coro::Scheduler::duration(wake_ms - now_ms));
+
+        // 处理所有不晚于当前毫秒的事件，按精确时刻的先后依次推进
+        const double now_s = wake_ms / 1000.0;
+        while (true) {
+            next_arrival = arrivals_.empty() ? HUGE_VAL : arrivals_.top().time_s;
+            next_session = session_events_.empty() ? HUGE_VAL : session_events_.top().time_s;
+            if (std::min(next_arrival, next_session) > now_s)
+                break;
+            if (next_session <= next_arrival) {
+                SessionEvent ev = session_events_.top();
+                session_events_.pop();
+                advance_load_to(ev.time_s);
+                handle_session_event(ev);
+            } else {
+                StationArrival arrival = arrivals_.top();
+                arrivals_.pop();
+                advance_load_to(arrival.time_s);
+                handle_arrival(arrival.station, arrival.index, arrival.time_s);
+            }
+        }
+    }
+    advance_load_to(horizon_s);
+
+    if (g_console_logger) {
+        g_console_logger->info("[{}毫秒] [EV会话] 会话生成已到达仿真终点。", scheduler_.now().time_since_epoch().count());
+    }
+}
+
+void EvSessionEngine::log_summary() const
+{
+    if (!g_console_logger)
+        return;
+    g_console_logger->info("[EV会话] 到达 {} 辆，接入 {} 次，因无空闲桩离开 {} 辆，已离开 {} 次。",
+        stats_.arrivals, stats_.sessions_started, stats_.rejected, stats_.sessions_completed);
+    g_console_logger->info("[EV会话] 累计充电量 {:.1f} MWh，最大同时接入 {} 辆，最大充电负荷 {:.1f} MW，槽位池容量 {}。",
+        stats_.energy_delivered_kWh / 1000.0, stats_.peak_active_sessions, stats_.peak_load_kW / 1000.0, pool_.capacity());
+}
@@ -0,0 +1,145 @@
+// ev_session.h
+// 电动汽车充电会话 (到达/离开) 随机过程引擎。
+// 每个充电站按可配置的分布生成车辆到达时刻、停留时长和充电需求：
+// - 到达过程为按小时时段系数调制的非齐次泊松过程 (thinning 抽样)；
+// - 停留时长与充电需求服从对数正态分布。
+// 到达事件按站惰性生成 (每站只保留下一次到达)。随机数由 CounterRng 按 (种子, 站序号, 流, 到达序号) 定位，
+// 每站的到达序列和每次会话的属性都与其他站及处理顺序无关。
+// 会话状态存放在池化的槽位中，车辆接入/离开只是槽位的取出和归还，不创建或销毁ECS实体，
+// 因此 10^5 台充电桩、数百万次会话的24小时仿真可以远快于实时完成。
+#ifndef EV_SESSION_H
+#define EV_SESSION_H
+
+#include "counter_rng.h"
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// 充电站配置
+struct EvStationConfig {
+    Entity station_entity = 0; // 充电站实体ID (可选，用于日志或与其他系统关联)
+    int charger_count = 10; // 充电桩数量
+    double charger_power_kW = 7.0; // 单桩充电功率 (kW)
+    double arrivals_per_charger_hour = 0.5; // 时段系数为1时，每桩每小时的平均到达车辆数
+    std::array<double, 24> hourly_profile; // 到达率的小时时段系数 (0点~23点)
+    double dwell_log_mean = 0.7; // 停留时长 ln(小时) 的均值
+    double dwell_log_sigma = 0.6; // 停留时长 ln(小时) 的标准差
+    double energy_log_mean = 2.5; // 充电需求 ln(kWh) 的均值
+    double energy_log_sigma = 0.5; // 充电需求 ln(kWh) 的标准差
+
+    EvStationConfig();
+};
+
+// 会话槽位: 一次接入的车辆状态
+struct EvSessionSlot {
+    uint32_t station = 0; // 所在充电站序号
+    uint32_t generation = 0; // 槽位代数，每次归还后递增，用于识别过期事件
+    double arrival_s = 0.0; // 到达时刻 (秒)
+    double departure_s = 0.0; // 离开时刻 (秒)
+    double energy_demand_kWh = 0.0; // 充电需求 (kWh)
+    double charge_end_s = 0.0; // 充满 (或离开) 的时刻 (秒)
+};
+
+// 会话槽位池: 以空闲链表复用槽位，取出/归还均为 O(1)
+class EvSessionPool {
+public:
+    uint32_t acquire();
+    void release(uint32_t index);
+    EvSessionSlot& operator[](uint32_t index) { return slots_[index]; }
+    const EvSessionSlot& operator[](uint32_t index) const { return slots_[index]; }
+    size_t active_count() const { return slots_.size() - free_list_.size(); }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<EvSessionSlot> slots_;
+    std::vector<uint32_t> free_list_;
+};
+
+// 会话统计
+struct EvSessionStats {
+    uint64_t arrivals = 0; // 到达车辆数
+    uint64_t sessions_started = 0; // 成功接入的会话数
+    uint64_t rejected = 0; // 因站内无空闲充电桩而离开的车辆数
+    uint64_t sessions_completed = 0; // 已离开的会话数
+    double energy_delivered_kWh = 0.0; // 累计充电量 (kWh)
+    size_t peak_active_sessions = 0; // 同时接入的最大会话数
+    double peak_load_kW = 0.0; // 最大充电总功率 (kW)
+};
+
+// 充电会话引擎
+class EvSessionEngine {
+public:
+    // seed: 随机数种子；load_interval_s: 充电负荷曲线的统计间隔 (秒)
+    EvSessionEngine(cps_coro::Scheduler& scheduler, uint64_t seed, double load_interval_s = 900.0);
+
+    // 添加一个充电站，返回其序号
+    uint32_t add_station(const EvStationConfig& config);
+
+    // 协程任务：从当前仿真时间起运行到 horizon_s (秒) 为止
+    cps_coro::Task run(double horizon_s);
+
+    const EvSessionStats& stats() const { return stats_; }
+    // 各统计间隔内的平均充电功率 (kW)
+    const std::vector<double>& load_profile_kW() const { return load_profile_kW_; }
+    size_t pool_capacity() const { return pool_.capacity(); }
+    void log_summary() const;
+
+private:
+    enum class SessionEventKind : uint8_t {
+        CHARGE_END, // 充电完成 (充电负荷减少)
+        DEPARTURE // 车辆离开 (释放充电桩与槽位)
+    };
+
+    struct SessionEvent {
+        double time_s;
+        uint32_t slot;
+        uint32_t generation;
+        SessionEventKind kind;
+        // 同一时刻先处理充电完成再处理离开 (停留时间不足以充满时两者重合)
+        bool operator>(const SessionEvent& other) const
+        {
+            return time_s > other.time_s || (time_s == other.time_s && kind > other.kind);
+        }
+    };
+
+    struct StationArrival {
+        double time_s;
+        uint32_t station;
+        uint32_t index; // 本站的到达序号
+        bool operator>(const StationArrival& other) const { return time_s > other.time_s; }
+    };
+
+    struct StationState {
+        EvStationConfig config;
+        double peak_rate_per_s; // 全天最大到达率 (用于 thinning 抽样)
+        double peak_profile; // 全天最大时段系数
+        uint32_t arrival_count = 0; // 已抽取的到达次数 (即下一次到达的序号，用作随机数步号)
+        int busy_chargers = 0;
+    };
+
+    double draw_next_arrival(uint32_t station_idx, double after_s);
+    void handle_arrival(uint32_t station_idx, uint32_t arrival_idx, double time_s);
+    void handle_session_event(const SessionEvent& ev);
+    void advance_load_to(double time_s);
+
+    cps_coro::Scheduler& scheduler_;
+    uint64_t seed_;
+    double load_interval_s_;
+
+    std::vector<StationState> stations_;
+    EvSessionPool pool_;
+    std::priority_queue<StationArrival, std::vector<StationArrival>, std::greater<>> arrivals_; // 每站只保留下一次到达
+    std::priority_queue<SessionEvent, std::vector<SessionEvent>, std::greater<>> session_events_;
+
+    EvSessionStats stats_;
+    double current_load_kW_ = 0.0;
+    double load_time_s_ = 0.0; // 负荷曲线已积分到的时刻
+    std::vector<double> load_profile_kW_;
+};
+
+#endif // EV_SESSION_H
@@ -3,9 +3,13 @@
 
 #include "frequency_system.h"
 #include "logging_utils.h" // 引入日志工具，用于 g_console_logger, g_data_file_logger
+#include "phase_profiler.h" // 按仿真阶段的性能统计
 #include <chrono> // C++时间库，用于获取仿真时间
 #include <cmath> // 标准数学函数库，用于 std::abs, std::sin, std::cos, std::exp 等
+#include <cstdio> // std::snprintf (集合预言机的数据行)
+#include <cstring> // std::memcpy (集合内核的通道向量读写)
 #include <iomanip> // 用于输出格式化，如 std::fixed, std::setprecision (虽然主要通过spdlog格式化)
+#include <stdexcept> // std::invalid_argument
 #include <string> // 为 individualDeviceFrequencyResponseTask 增加
 
 // 全局调度器指针 - 任务可能需要访问它以获取当前仿真时间或触发事件 (如果未通过参数显式传递)
@@ -57,13 +61,56 @@ double calculate_frequency_deviation(double t_relative)
     return f_dev; // 返回计算得到的频率偏差 (Hz)
 }
 
+// calculate_load_step_frequency_response 函数实现
+// 解析模型对应的扰动大小为 P_f_coeff_fs (标幺)，按线性比例换算到任意负荷阶跃。
+double calculate_load_step_frequency_response(double t_relative, double delta_load_pu)
+{
+    return calculate_frequency_deviation(t_relative) * (delta_load_pu / P_f_coeff_fs);
+}
+
+// LoadStepSuperposition 实现
+// 单次阶跃 ΔP 的响应为 -ΔP/M2 · e^{-Nτ} · (M + M1·sin(Mτ) - M·cos(Mτ))，τ 为阶跃后的时间；
+// 平移 dt 时 e^{-Nτ} 乘以 e^{-N·dt}，(cos, sin) 按角度 M·dt 旋转。
+void LoadStepSuperposition::shifted(double dt, double& decay, double& decay_cos, double& decay_sin) const
+{
+    const double attenuation = std::exp(-N_f_coeff_fs * dt);
+    const double c = std::cos(M_f_coeff_fs * dt);
+    const double s = std::sin(M_f_coeff_fs * dt);
+    decay = decay_sum_ * attenuation;
+    decay_cos = (decay_cos_sum_ * c - decay_sin_sum_ * s) * attenuation;
+    decay_sin = (decay_sin_sum_ * c + decay_cos_sum_ * s) * attenuation;
+}
+
+void LoadStepSuperposition::add_step(double time_s, double delta_load_pu)
+{
+    double decay = 0.0, decay_cos = 0.0, decay_sin = 0.0;
+    if (step_count_ > 0)
+        shifted(time_s - reference_time_s_, decay, decay_cos, decay_sin);
+    reference_time_s_ = time_s;
+    decay_sum_ = decay + delta_load_pu;
+    decay_cos_sum_ = decay_cos + delta_load_pu; // τ = 0 时 cos = 1, sin = 0
+    decay_sin_sum_ = decay_sin;
+    ++step_count_;
+}
+
+double LoadStepSuperposition::deviation(double time_s) const
+{
+    if (step_count_ == 0)
+        return 0.0;
+    double decay, decay_cos, decay_sin;
+    shifted(time_s - reference_time_s_, decay, decay_cos, decay_sin);
+    return -(M_f_coeff_fs * decay + M1_f_coeff_fs * decay_sin - M_f_coeff_fs * decay_cos) / M2_f_coeff_fs;
+}
+
 // frequencyOracleTask 协程任务实现
 // 模拟频率预言机，周期性地计算并发布系统频率信息。
 cps_coro::Task frequencyOracleTask(Registry& registry,
     const std::vector<Entity>& ev_entities,
     const std::vector<Entity>& ess_entities,
     double disturbance_start_time_s, // 扰动开始的仿真时间 (秒)
-    double simulation_step_ms) // 预言机更新和发布事件的时间步长 (毫秒)
+    double simulation_step_ms, // 预言机更新和发布事件的时间步长 (毫秒)
+    FrequencyModelAdjuster* adjuster, // 可选的频率模型修正
+    const FrequencyResponseFleet* fleet) // 可选的批量频率响应集群
 {
     // 使用控制台日志记录任务启动信息
     if (g_console_logger && g_scheduler) {
@@ -80,6 +127,10 @@ cps_coro::Task frequencyOracleTask(Registry& registry,
         g_data_file_logger->info("仿真时间_毫秒\t仿真时间_秒\t相对扰动时间_秒\t频率偏差_赫兹\tVPP总功率_千瓦");
     }
 
+    // 频率信息以最新值通道发布: 各读者每次只读到最新的频率偏差，读取不及的读者不会积压旧值
+    cps_coro::LatestValueChannel<FrequencyInfo>* frequency_channel =
+        g_scheduler ? &g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT) : nullptr;
+
     while (true) { // 无限循环，模拟持续的频率信息发布
         // 协程等待 (挂起)，直到指定的仿真步长时间过去
         co_await cps_coro::delay(cps_coro::Scheduler::duration(static_cast<long long>(simulation_step_ms)));
@@ -93,21 +144,26 @@ cps_coro::Task frequencyOracleTask(Registry& registry,
 
         // 根据相对时间计算当前的频率偏差
         double freq_dev_hz = calculate_frequency_deviation(relative_time_s);
+        if (adjuster) { // 叠加扰动后其他子系统 (如低频减载) 引起的频率变化
+            freq_dev_hz = adjuster->adjust_deviation(current_sim_time_s, freq_dev_hz);
+        }
 
         // 填充频率信息结构体
         FrequencyInfo freq_info;
         freq_info.current_sim_time_seconds = current_sim_time_s;
         freq_info.freq_deviation_hz = freq_dev_hz;
 
-        // 如果调度器有效，触发频率更新事件，将最新的频率信息广播给其他协程
-        if (g_scheduler) {
-            g_scheduler->trigger_event(FREQUENCY_UPDATE_EVENT, freq_info);
+        // 如果调度器有效，发布最新的频率信息
+        // (等待中的设备协程在发布过程中被依次恢复并完成状态更新，整体计入设备更新阶段)
+        if (frequency_channel) {
+            PhaseScope phase(SimPhase::DEVICE_UPDATE);
+            frequency_channel->publish(freq_info);
         }
 
         // (可选) 计算并记录当前VPP（EV充电桩和ESS单元）的总功率输出
         // 注意：这个总功率计算是在频率预言机中完成的，用于日志记录。
         // 每个独立设备协程会更新自己的功率，这个总和是事后聚合的。
-        double total_vpp_power_kw = 0;
+        double total_vpp_power_kw = fleet ? fleet->total_power_kW() : 0.0;
         // 累加所有EV充电桩的功率
         for (Entity entity_id : ev_entities) {
             if (auto state_comp = registry.get<PhysicalStateComponent>(entity_id)) { // 安全地获取组件
@@ -123,6 +179,8 @@ cps_coro::Task frequencyOracleTask(Registry& registry,
 
         // 将当前时刻的仿真状态（时间、频率偏差、总功率）记录到数据文件
         if (g_data_file_logger) {
+            PhaseScope phase(SimPhase::LOGGING);
+            MemTagScope mem_scope(MemTag::LOGGING);
             g_data_file_logger->info("{:.0f}\t{:.3f}\t{:.3f}\t{:.5f}\t{:.2f}", // 格式化输出
                 current_sim_time_ms,
                 current_sim_time_s,
@@ -154,8 +212,11 @@ cps_coro::Task individualDeviceFrequencyResponseTask(Registry& registry, Entity
         co_return; // 提前退出协程
     }
 
+    if (!g_scheduler) {
+        co_return; // 没有调度器时无法读取频率通道
+    }
+
     // 每个设备协程维护自己的状态变量
-    double last_processed_event_time_s = -1.0; // 上次处理的事件的仿真时间 (秒)
     double device_last_full_update_time_s = -1.0; // 此设备上次执行完整状态更新的仿真时间 (秒)
     double device_last_full_update_freq_dev_hz = 0.0; // 上次完整更新时此设备的频率偏差 (Hz)
 
@@ -163,14 +224,11 @@ cps_coro::Task individualDeviceFrequencyResponseTask(Registry& registry, Entity
     const double FREQUENCY_CHANGE_THRESHOLD_HZ = 0.005; // 频率偏差变化阈值 (Hz)，稍微灵敏一些
     const double TIME_THRESHOLD_SECONDS = 0.5; // 时间间隔阈值 (秒)，更新更频繁一些
 
-    while (true) { // 无限循环，持续监听和响应频率事件
-        FrequencyInfo current_freq_info = co_await cps_coro::wait_for_event<FrequencyInfo>(FREQUENCY_UPDATE_EVENT);
+    // 频率最新值通道的读者: 每次读取都是尚未处理过的最新一次发布，无需再检查过时或重复的频率信息
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
 
-        // 检查收到的事件是否是过时的 (即其仿真时间早于或等于上次已处理的事件时间)
-        if (current_freq_info.current_sim_time_seconds <= last_processed_event_time_s) {
-            continue; // 如果是旧事件或时间戳相同的重复事件，则跳过处理，继续等待新事件
-        }
-        last_processed_event_time_s = current_freq_info.current_sim_time_seconds; // 更新上次成功处理的事件时间
+    while (true) { // 无限循环，持续监听和响应频率更新
+        const FrequencyInfo& current_freq_info = co_await frequency_reader.next();
 
         bool perform_update = false; // 标志位，指示本轮是否需要对此设备执行状态更新
         double dt_since_last_update = 0.0; // 距离上次更新的时间间隔 (秒)
@@ -296,4 +354,416 @@ cps_coro::Task individualDeviceFrequencyResponseTask(Registry& registry, Entity
             device_last_full_update_freq_dev_hz = current_freq_info.freq_deviation_hz;
         } // 结束 perform_update 的条件块
     } // 循环继续，等待下一个频率事件
-}
\ No newline at end of file
+}
+
+// --- FrequencyResponseFleet: 设备集群的批量频率响应 ---
+
+FrequencyResponseFleet::FrequencyResponseFleet(Registry& registry)
+    : registry_(registry)
+    , hot_(registry.pool<DeviceResponseHot>())
+    , droop_(registry.pool<DeviceDroopParams>())
+    , soc_limits_(registry.pool<DeviceSocLimits>())
+    , partitions_(registry.pool<DevicePartition>())
+{
+}
+
+void FrequencyResponseFleet::reserve(size_t device_count)
+{
+    hot_.reserve(device_count);
+    droop_.reserve(device_count);
+    soc_limits_.reserve(device_count);
+    partitions_.reserve(device_count);
+}
+
+CompactHandle FrequencyResponseFleet::add_device(Entity device, uint32_t partition)
+{
+    auto config = registry_.get<FrequencyControlConfigComponent>(device);
+    auto state = registry_.get<PhysicalStateComponent>(device);
+    if (!config || !state)
+        return CompactHandle {};
+
+    bool is_ev = config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE;
+    CompactHandle h = hot_.emplace(device, state->current_power_kW, state->soc, -1.0, 0.0);
+    droop_.emplace(device, config->base_power_kW, config->gain_kW_per_Hz, config->deadband_Hz, config->max_output_kW, config->min_output_kW,
+        is_ev ? 50.0 : 2000.0, is_ev);
+    soc_limits_.emplace(device, config->soc_min_threshold, config->soc_max_threshold);
+    partitions_.emplace(device, partition);
+    return h;
+}
+
+void FrequencyResponseFleet::sort_by_partition()
+{
+    registry_.sort<DevicePartition, DeviceResponseHot, DeviceDroopParams, DeviceSocLimits>(
+        [](const DevicePartition& p, Entity) { return p.partition; });
+
+    partition_ranges_.clear();
+    const DevicePartition* parts = partitions_.data();
+    for (size_t i = 0; i < partitions_.size(); ++i) {
+        if (partition_ranges_.empty() || partition_ranges_.back().partition != parts[i].partition)
+            partition_ranges_.push_back({ parts[i].partition, i, i + 1 });
+        else
+            partition_ranges_.back().end = i + 1;
+    }
+}
+
+std::vector<double> FrequencyResponseFleet::partition_power_kW() const
+{
+    std::vector<double> power(partition_ranges_.size(), 0.0);
+    const DeviceResponseHot* hot = hot_.data();
+    for (size_t r = 0; r < partition_ranges_.size(); ++r)
+        for (size_t i = partition_ranges_[r].begin; i < partition_ranges_[r].end; ++i)
+            power[r] += hot[i].current_power_kW;
+    return power;
+}
+
+// 逐设备的判断与计算与 individualDeviceFrequencyResponseTask 完全相同 (包括运算顺序)，注释从略
+void FrequencyResponseFleet::step(const FrequencyInfo& info)
+{
+    if (info.current_sim_time_seconds <= last_processed_event_time_s_)
+        return;
+    last_processed_event_time_s_ = info.current_sim_time_seconds;
+
+    const double FREQUENCY_CHANGE_THRESHOLD_HZ = 0.005;
+    const double TIME_THRESHOLD_SECONDS = 0.5;
+    const double t = info.current_sim_time_seconds;
+    const double df = info.freq_deviation_hz;
+    const double abs_df = std::abs(df);
+
+    DeviceResponseHot* hot = hot_.data();
+    const DeviceDroopParams* droop = droop_.data();
+    const DeviceSocLimits* limits = soc_limits_.data();
+    const size_t n = hot_.size();
+    for (size_t i = 0; i < n; ++i) {
+        DeviceResponseHot& s = hot[i];
+        double dt = 0.0;
+        if (s.last_update_time_s >= 0) {
+            dt = t - s.last_update_time_s;
+            if (dt < 0)
+                dt = 0;
+            if (!(std::abs(df - s.last_update_freq_dev_hz) > FREQUENCY_CHANGE_THRESHOLD_HZ) && !(dt >= TIME_THRESHOLD_SECONDS))
+                continue; // 未满足更新条件: 只触及了热数据
+        }
+
+        const DeviceDroopParams& p = droop[i];
+        if (s.last_update_time_s >= 0 && dt > 1e-6) {
+            double energy_change_kWh = s.current_power_kW * (dt / 3600.0);
+            s.soc -= (energy_change_kWh / p.battery_capacity_kWh);
+            s.soc = std::max(0.0, std::min(1.0, s.soc));
+        }
+
+        double power = p.base_power_kW;
+        if (abs_df > p.deadband_Hz) {
+            if (df < 0) {
+                power = -p.gain_kW_per_Hz * (df + p.deadband_Hz);
+                if (p.is_ev) {
+                    if (power > 0 && s.soc < limits[i].soc_min_threshold)
+                        power = 0.0;
+                    else if (s.soc < limits[i].soc_min_threshold && p.base_power_kW < 0 && power < 0)
+                        power = 0.0;
+                }
+            } else {
+                double power_change_due_to_freq = -p.gain_kW_per_Hz * (df - p.deadband_Hz);
+                power = p.base_power_kW + power_change_due_to_freq;
+            }
+        }
+        power = std::max(p.min_output_kW, std::min(p.max_output_kW, power));
+        if (p.is_ev) {
+            if (power < 0 && s.soc >= limits[i].soc_max_threshold)
+                power = 0.0;
+            if (power > 0 && s.soc <= limits[i].soc_min_threshold)
+                power = 0.0;
+        }
+
+        s.current_power_kW = power;
+        s.last_update_time_s = t;
+        s.last_update_freq_dev_hz = df;
+    }
+
+    if (trace_)
+        trace_->record(t, hot);
+}
+
+cps_coro::Task FrequencyResponseFleet::run()
+{
+    if (g_console_logger)
+        g_console_logger->info("[频率响应集群] 批量任务已激活，{} 台设备，每台占用打包存储 {} 字节 (每步遍历的热数据 {} 字节)。",
+            size(), bytes_per_device(), hot_bytes_per_device());
+    if (!g_scheduler)
+        co_return;
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
+    while (true)
+        step(co_await frequency_reader.next());
+}
+
+double FrequencyResponseFleet::total_power_kW() const
+{
+    double total = 0.0;
+    const DeviceResponseHot* hot = hot_.data();
+    for (size_t i = 0; i < hot_.size(); ++i)
+        total += hot[i].current_power_kW;
+    return total;
+}
+
+void FrequencyResponseFleet::sync_to_components()
+{
+    hot_.for_each([this](DeviceResponseHot& s, Entity device) {
+        if (auto state = registry_.get<PhysicalStateComponent>(device)) {
+            state->current_power_kW = s.current_power_kW;
+            state->soc = s.soc;
+        }
+    });
+}
+
+// --- EnsembleFrequencyFleet: 集合仿真的批量频率响应 ---
+
+EnsembleFrequencyFleet::EnsembleFrequencyFleet(Registry& registry, const std::vector<EnsembleVariant>& variants)
+    : registry_(registry)
+    , hot_(registry.pool<EnsembleDeviceHot>())
+    , droop_(registry.pool<DeviceDroopParams>())
+    , soc_limits_(registry.pool<DeviceSocLimits>())
+    , variants_(variants)
+{
+    if (variants_.empty() || variants_.size() > ENSEMBLE_LANES)
+        throw std::invalid_argument("集合仿真的变体数必须在 1 到 " + std::to_string(ENSEMBLE_LANES) + " 之间");
+    for (size_t k = 0; k < ENSEMBLE_LANES; ++k) {
+        EnsembleVariant v = k < variants_.size() ? variants_[k] : EnsembleVariant {};
+        deadband_scale_[k] = v.deadband_scale;
+        gain_scale_[k] = v.gain_scale;
+    }
+}
+
+void EnsembleFrequencyFleet::reserve(size_t device_count)
+{
+    hot_.reserve(device_count);
+    droop_.reserve(device_count);
+    soc_limits_.reserve(device_count);
+}
+
+CompactHandle EnsembleFrequencyFleet::add_device(Entity device)
+{
+    auto config = registry_.get<FrequencyControlConfigComponent>(device);
+    auto state = registry_.get<PhysicalStateComponent>(device);
+    if (!config || !state)
+        return CompactHandle {};
+
+    bool is_ev = config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE;
+    CompactHandle h = hot_.emplace(device);
+    EnsembleDeviceHot* s = hot_.get(h);
+    for (size_t k = 0; k < ENSEMBLE_LANES; ++k) {
+        s->current_power_kW[k] = state->current_power_kW;
+        s->soc[k] = state->soc;
+        s->last_update_time_s[k] = -1.0;
+        s->last_update_freq_dev_hz[k] = 0.0;
+    }
+    droop_.emplace(device, config->base_power_kW, config->gain_kW_per_Hz, config->deadband_Hz, config->max_output_kW, config->min_output_kW,
+        is_ev ? 50.0 : 2000.0, is_ev);
+    soc_limits_.emplace(device, config->soc_min_threshold, config->soc_max_threshold);
+    return h;
+}
+
+#if defined(__GNUC__)
+// 通道向量: 2 个 double 组成的 GCC/Clang 向量类型，恰为 SSE2/NEON 的寄存器宽度 (更宽的目标上由编译器合并)。
+// 8 通道宽的向量在基线 x86-64 上会被逐元素拆成标量比较，因此每台设备的 8 个通道分 4 组处理。
+// 比较运算得到逐通道掩码，a ? b : c 按掩码逐通道选择。
+constexpr size_t ENSEMBLE_VECTOR_LANES = 2;
+typedef double EnsembleLaneVec __attribute__((vector_size(sizeof(double) * ENSEMBLE_VECTOR_LANES)));
+static_assert(ENSEMBLE_LANES % ENSEMBLE_VECTOR_LANES == 0, "集合通道数必须是向量宽度的整数倍");
+#endif
+
+// 每个通道的运算与 FrequencyResponseFleet::step() 相同 (包括运算顺序，结果逐位一致)，
+// 只是把逐设备的条件分支改写为先对一组通道计算、再按逐通道掩码选择；一组内全部通道都无需更新时跳过。
+void EnsembleFrequencyFleet::step(const EnsembleFrequencyInfo& info)
+{
+    if (info.current_sim_time_seconds <= last_processed_event_time_s_)
+        return;
+    last_processed_event_time_s_ = info.current_sim_time_seconds;
+
+    const double FREQUENCY_CHANGE_THRESHOLD_HZ = 0.005;
+    const double TIME_THRESHOLD_SECONDS = 0.5;
+    const double t = info.current_sim_time_seconds;
+
+    EnsembleDeviceHot* hot = hot_.data();
+    const DeviceDroopParams* droop = droop_.data();
+    const DeviceSocLimits* limits = soc_limits_.data();
+    const size_t n = hot_.size();
+#if defined(__GNUC__)
+    using Vec = EnsembleLaneVec;
+    const Vec zero = {};
+    const Vec t_v = zero + t;
+
+    for (size_t i = 0; i < n; ++i) {
+        EnsembleDeviceHot& s = hot[i];
+        const DeviceDroopParams& p = droop[i];
+        for (size_t o = 0; o < ENSEMBLE_LANES; o += ENSEMBLE_VECTOR_LANES) {
+            Vec df, last_t, last_df;
+            std::memcpy(&df, info.freq_deviation_hz + o, sizeof(Vec));
+            std::memcpy(&last_t, s.last_update_time_s + o, sizeof(Vec));
+            std::memcpy(&last_df, s.last_update_freq_dev_hz + o, sizeof(Vec));
+            Vec dt = t_v - last_t;
+            dt = dt < 0 ? zero : dt;
+            const Vec df_change = df - last_df;
+            const auto update = (last_t < 0) | ((df_change < 0 ? -df_change : df_change) > FREQUENCY_CHANGE_THRESHOLD_HZ)
+                | (dt >= TIME_THRESHOLD_SECONDS);
+            if ((update[0] | update[1]) == 0)
+                continue; // 本组通道都未满足更新条件: 只触及了热数据
+
+            Vec last_power, last_soc, gain_scale, deadband_scale;
+            std::memcpy(&last_power, s.current_power_kW + o, sizeof(Vec));
+            std::memcpy(&last_soc, s.soc + o, sizeof(Vec));
+            std::memcpy(&gain_scale, gain_scale_ + o, sizeof(Vec));
+            std::memcpy(&deadband_scale, deadband_scale_ + o, sizeof(Vec));
+            Vec drained = last_soc - (last_power * (dt / 3600.0)) / p.battery_capacity_kWh;
+            drained = drained < 1.0 ? drained : zero + 1.0;
+            drained = 0.0 < drained ? drained : zero;
+            const Vec soc = ((last_t >= 0) & (dt > 1e-6)) ? drained : last_soc;
+
+            const Vec gain = p.gain_kW_per_Hz * gain_scale;
+            const Vec deadband = p.deadband_Hz * deadband_scale;
+            Vec under = -gain * (df + deadband);
+            if (p.is_ev) {
+                const auto soc_low = (soc < limits[i].soc_min_threshold) & ((under > 0) | ((p.base_power_kW < 0) & (under < 0)));
+                under = soc_low ? zero : under;
+            }
+            const Vec over = p.base_power_kW + (-gain * (df - deadband));
+            Vec power = df < 0 ? under : over;
+            power = (df < 0 ? -df : df) > deadband ? power : zero + p.base_power_kW;
+            power = power < p.max_output_kW ? power : zero + p.max_output_kW;
+            power = p.min_output_kW < power ? power : zero + p.min_output_kW;
+            if (p.is_ev) {
+                power = ((power < 0) & (soc >= limits[i].soc_max_threshold)) ? zero : power;
+                power = ((power > 0) & (soc <= limits[i].soc_min_threshold)) ? zero : power;
+            }
+
+            const Vec next_power = update ? power : last_power;
+            const Vec next_soc = update ? soc : last_soc;
+            const Vec next_t = update ? t_v : last_t;
+            const Vec next_df = update ? df : last_df;
+            std::memcpy(s.current_power_kW + o, &next_power, sizeof(Vec));
+            std::memcpy(s.soc + o, &next_soc, sizeof(Vec));
+            std::memcpy(s.last_update_time_s + o, &next_t, sizeof(Vec));
+            std::memcpy(s.last_update_freq_dev_hz + o, &next_df, sizeof(Vec));
+        }
+    }
+#else
+    // 无向量扩展的编译器: 逐通道执行与 FrequencyResponseFleet::step() 相同的分支代码
+    for (size_t i = 0; i < n; ++i) {
+        EnsembleDeviceHot& s = hot[i];
+        const DeviceDroopParams& p = droop[i];
+        for (size_t k = 0; k < ENSEMBLE_LANES; ++k) {
+            const double df = info.freq_deviation_hz[k];
+            double dt = 0.0;
+            if (s.last_update_time_s[k] >= 0) {
+                dt = t - s.last_update_time_s[k];
+                if (dt < 0)
+                    dt = 0;
+                if (!(std::abs(df - s.last_update_freq_dev_hz[k]) > FREQUENCY_CHANGE_THRESHOLD_HZ) && !(dt >= TIME_THRESHOLD_SECONDS))
+                    continue;
+                if (dt > 1e-6) {
+                    s.soc[k] -= (s.current_power_kW[k] * (dt / 3600.0)) / p.battery_capacity_kWh;
+                    s.soc[k] = std::max(0.0, std::min(1.0, s.soc[k]));
+                }
+            }
+            const double soc = s.soc[k];
+            const double gain = p.gain_kW_per_Hz * gain_scale_[k];
+            const double deadband = p.deadband_Hz * deadband_scale_[k];
+            double power = p.base_power_kW;
+            if (std::abs(df) > deadband) {
+                if (df < 0) {
+                    power = -gain * (df + deadband);
+                    if (p.is_ev && soc < limits[i].soc_min_threshold && (power > 0 || (p.base_power_kW < 0 && power < 0)))
+                        power = 0.0;
+                } else {
+                    power = p.base_power_kW + (-gain * (df - deadband));
+                }
+            }
+            power = std::max(p.min_output_kW, std::min(p.max_output_kW, power));
+            if (p.is_ev) {
+                if (power < 0 && soc >= limits[i].soc_max_threshold)
+                    power = 0.0;
+                if (power > 0 && soc <= limits[i].soc_min_threshold)
+                    power = 0.0;
+            }
+            s.current_power_kW[k] = power;
+            s.last_update_time_s[k] = t;
+            s.last_update_freq_dev_hz[k] = df;
+        }
+    }
+#endif
+}
+
+cps_coro::Task EnsembleFrequencyFleet::run()
+{
+    if (g_console_logger)
+        g_console_logger->info("[集合频率响应集群] 批量任务已激活，{} 台设备 x {} 个变体，每台设备每步遍历的热数据 {} 字节。",
+            size(), lane_count(), hot_bytes_per_device());
+    if (!g_scheduler)
+        co_return;
+    cps_coro::LatestValueReader<EnsembleFrequencyInfo> frequency_reader(
+        g_scheduler->latest_value_channel<EnsembleFrequencyInfo>(ENSEMBLE_FREQUENCY_UPDATE_EVENT));
+    while (true)
+        step(co_await frequency_reader.next());
+}
+
+std::array<double, ENSEMBLE_LANES> EnsembleFrequencyFleet::total_power_kW() const
+{
+    std::array<double, ENSEMBLE_LANES> total {};
+    const EnsembleDeviceHot* hot = hot_.data();
+    for (size_t i = 0; i < hot_.size(); ++i)
+        for (size_t k = 0; k < ENSEMBLE_LANES; ++k)
+            total[k] += hot[i].current_power_kW[k];
+    return total;
+}
+
+// ensembleFrequencyOracleTask 协程任务实现
+// 解析模型对扰动幅值线性，各变体的频率偏差由同一次模型计算按倍数缩放得到。
+cps_coro::Task ensembleFrequencyOracleTask(const EnsembleFrequencyFleet& fleet, double disturbance_start_time_s, double simulation_step_ms)
+{
+    double disturbance_scale[ENSEMBLE_LANES];
+    for (size_t k = 0; k < ENSEMBLE_LANES; ++k)
+        disturbance_scale[k] = k < fleet.lane_count() ? fleet.variants()[k].disturbance_scale : 1.0;
+
+    if (g_console_logger)
+        g_console_logger->info("[集合频率预言机] 任务已激活，{} 个变体。扰动将于仿真时间 {:.1f}秒开始。更新步长: {}毫秒。", fleet.lane_count(),
+            disturbance_start_time_s, simulation_step_ms);
+
+    if (g_data_file_logger) {
+        std::string header = "仿真时间_毫秒\t仿真时间_秒\t相对扰动时间_秒";
+        for (size_t k = 0; k < fleet.lane_count(); ++k)
+            header += "\t频率偏差_赫兹_变体" + std::to_string(k) + "\tVPP总功率_千瓦_变体" + std::to_string(k);
+        g_data_file_logger->info(header);
+    }
+
+    std::string line;
+    while (true) {
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(static_cast<long long>(simulation_step_ms)));
+
+        double current_sim_time_ms = g_scheduler ? g_scheduler->now().time_since_epoch().count() : 0.0;
+        double current_sim_time_s = current_sim_time_ms / 1000.0;
+        double relative_time_s = current_sim_time_s - disturbance_start_time_s;
+        double base_freq_dev_hz = calculate_frequency_deviation(relative_time_s);
+
+        EnsembleFrequencyInfo info;
+        info.current_sim_time_seconds = current_sim_time_s;
+        for (size_t k = 0; k < ENSEMBLE_LANES; ++k)
+            info.freq_deviation_hz[k] = base_freq_dev_hz * disturbance_scale[k];
+
+        if (g_scheduler) {
+            PhaseScope phase(SimPhase::DEVICE_UPDATE);
+            g_scheduler->publish_latest(ENSEMBLE_FREQUENCY_UPDATE_EVENT, info);
+        }
+
+        if (g_data_file_logger) {
+            PhaseScope phase(SimPhase::LOGGING);
+            MemTagScope mem_scope(MemTag::LOGGING);
+            auto total_power_kw = fleet.total_power_kW();
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "%.0f\t%.3f\t%.3f", current_sim_time_ms, current_sim_time_s, relative_time_s);
+            line = buf;
+            for (size_t k = 0; k < fleet.lane_count(); ++k) {
+                std::snprintf(buf, sizeof(buf), "\t%.5f\t%.2f", info.freq_deviation_hz[k], total_power_kw[k]);
+                line += buf;
+            }
+            g_data_file_logger->info(line);
+        }
+    }
+}
@@ -8,6 +8,8 @@
 #include "cps_coro_lib.h" // 协程库，用于定义异步任务 (cps_coro::Task)
 #include "ecs_core.h" // ECS核心库，用于定义和管理组件 (IComponent) 和实体 (Entity)
 #include "simulation_events_and_data.h" // 包含仿真中共享的事件ID和数据结构定义
+#include "trace_writer.h" // 逐设备时间序列的压缩输出
+#include <array>
 #include <cmath>
 #include <string>
 #include <vector>
@@ -52,24 +54,230 @@ struct FrequencyControlConfigComponent : public IComponent {
         double soc_min = 0.0, double soc_max = 1.0);
 };
 
+// --- 打包存储的设备频率响应数据 (热/冷分离) ---
+// 以下为普通结构体 (不继承 IComponent)，存放在 Registry::pool<T>() 的打包池中，由 FrequencyResponseFleet 批量更新。
+// 字段按访问频率拆分，使每个频率步的遍历触及尽量少的缓存行:
+// 热数据: 每个频率步对每台设备都要读写 (更新条件判断、功率汇总)，32字节，每条缓存行2台设备
+struct DeviceResponseHot {
+    double current_power_kW; // 当前功率 (kW)，含义同 PhysicalStateComponent
+    double soc; // 荷电状态
+    double last_update_time_s; // 上次完整更新的仿真时间 (秒)，负值表示尚未更新
+    double last_update_freq_dev_hz; // 上次完整更新时的频率偏差 (Hz)
+};
+
+// 温数据: 只在设备满足更新条件时读取的下垂参数与电池容量
+struct DeviceDroopParams {
+    double base_power_kW;
+    double gain_kW_per_Hz;
+    double deadband_Hz;
+    double max_output_kW;
+    double min_output_kW;
+    double battery_capacity_kWh; // 由设备类型推导 (EV 50kWh, ESS 2000kWh)
+    bool is_ev; // 是否为EV充电桩 (只有EV施加SOC约束)
+};
+
+// 冷数据: SOC上下限，只有EV在计算出的功率需要约束时读取
+struct DeviceSocLimits {
+    double soc_min_threshold;
+    double soc_max_threshold;
+};
+
+// 设备的归属分区 (充电站、馈线或并行计算的分区编号)，只在局部性重排和按分区汇总时读取
+struct DevicePartition {
+    uint32_t partition;
+};
+
+// 一个分区在打包池中的连续下标区间 [begin, end)
+struct PartitionRange {
+    uint32_t partition;
+    size_t begin;
+    size_t end;
+};
+
+// 设备集群的批量频率响应
+// 与为每台设备启动一个 individualDeviceFrequencyResponseTask 等价 (相同的更新条件、下垂与SOC约束，结果逐位一致)，
+// 但只有一个协程读取频率最新值通道 (FREQUENCY_UPDATE_EVENT)，每次发布后按稠密下标顺序遍历打包池完成全部设备的更新。
+// 各打包池按相同顺序插入且从不删除，局部性重排时一致地重排，同一设备在各池中的句柄与稠密下标始终相同。
+class FrequencyResponseFleet {
+public:
+    explicit FrequencyResponseFleet(Registry& registry);
+
+    // 把设备的 FrequencyControlConfigComponent 与 PhysicalStateComponent 复制到打包池，此后该设备由本集群更新。
+    // partition: 设备所属的分区 (例如充电站编号)。设备缺少任一组件时返回空句柄。
+    CompactHandle add_device(Entity device, uint32_t partition = 0);
+    void reserve(size_t device_count);
+
+    // 按分区编号对全部打包池做一致的局部性重排 (句柄不变)，并重建分区区间表。
+    // 设备按分区依次加入时重排为恒等排列，结果不变；设备交错加入或经过增删后，重排使同一分区的设备重新连续存放。
+    void sort_by_partition();
+    // 分区区间表 (按分区编号升序，sort_by_partition() 之后有效)，可直接作为并行工作线程的连续区间
+    const std::vector<PartitionRange>& partition_ranges() const { return partition_ranges_; }
+    // 按分区汇总当前功率: 每个分区一次线性遍历其连续区间，结果与 partition_ranges() 一一对应
+    std::vector<double> partition_power_kW() const;
+
+    // 批量内核: 对一个频率事件更新全部设备
+    void step(const FrequencyInfo& info);
+    // 协程任务: 读取频率最新值通道 (FREQUENCY_UPDATE_EVENT) 并执行 step()
+    cps_coro::Task run();
+
+    // 全部设备的当前功率之和 (按加入顺序累加)
+    double total_power_kW() const;
+    // 把打包池中的功率与SOC写回各设备的 PhysicalStateComponent (仿真结束后供其他模块读取)
+    void sync_to_components();
+
+    // 逐设备曲线输出: 非空时每步结束把热数据整体交给写入器 (一次 memcpy，压缩在写入器的后台线程进行)。
+    // 记录按打包池的存储顺序排列，步长为 hot_bytes_per_device()；设置后不应再增删设备或重排。
+    void set_trace(DeviceTraceWriter* trace) { trace_ = trace; }
+
+    size_t size() const { return hot_.size(); }
+    // 每台设备在打包池中占用的字节数 (组件本身与句柄映射)，以及每步遍历实际触及的热数据字节数
+    static constexpr size_t bytes_per_device()
+    {
+        return PackedPool<DeviceResponseHot>::bytes_per_element() + PackedPool<DeviceDroopParams>::bytes_per_element()
+            + PackedPool<DeviceSocLimits>::bytes_per_element() + PackedPool<DevicePartition>::bytes_per_element();
+    }
+    static constexpr size_t hot_bytes_per_device() { return sizeof(DeviceResponseHot); }
+
+private:
+    Registry& registry_;
+    PackedPool<DeviceResponseHot>& hot_;
+    PackedPool<DeviceDroopParams>& droop_;
+    PackedPool<DeviceSocLimits>& soc_limits_;
+    PackedPool<DevicePartition>& partitions_;
+    std::vector<PartitionRange> partition_ranges_;
+    DeviceTraceWriter* trace_ = nullptr;
+    double last_processed_event_time_s_ = -1.0;
+};
+
+// --- 集合仿真 (Ensemble): 在SIMD通道中同时推进多个参数变体 ---
+// 参数扫描 (扰动幅值、死区、增益) 原本需要为每个变体完整地运行一次仿真，重复相同的调度与控制流。
+// 集合仿真把设备状态扩展为 ENSEMBLE_LANES 宽的向量，预言机每步发布全部变体的频率偏差，
+// 批量内核对每台设备一次向量化地推进全部变体，调度开销与参数/打包池的内存访问由全部变体分摊。
+
+// 一个参数变体: 相对基准场景的倍数。三个倍数均为1时，该通道与基准场景 (FrequencyResponseFleet) 的结果逐位一致。
+struct EnsembleVariant {
+    double disturbance_scale = 1.0; // 扰动幅值倍数 (频率模型线性，频率偏差按比例缩放)
+    double deadband_scale = 1.0; // 各设备死区的倍数
+    double gain_scale = 1.0; // 各设备下垂增益的倍数
+};
+
+// 集合热数据: 每个字段为 ENSEMBLE_LANES 宽的向量，同一设备的全部变体连续存放 (256字节，4条缓存行)。
+// 各字段含义同 DeviceResponseHot。
+struct EnsembleDeviceHot {
+    double current_power_kW[ENSEMBLE_LANES];
+    double soc[ENSEMBLE_LANES];
+    double last_update_time_s[ENSEMBLE_LANES];
+    double last_update_freq_dev_hz[ENSEMBLE_LANES];
+};
+
+// 设备集群的集合频率响应
+// 每个通道的更新条件、下垂与SOC约束与 FrequencyResponseFleet::step() 相同；条件分支改为逐通道掩码选择，
+// 使通道循环可以向量化。下垂参数与SOC上下限存放在与 FrequencyResponseFleet 相同的打包池中，
+// 因此同一注册表中的设备只能加入其中一种集群。
+class EnsembleFrequencyFleet {
+public:
+    // variants: 至多 ENSEMBLE_LANES 个变体，超出时抛出 std::invalid_argument；其余通道按基准参数计算但不输出
+    EnsembleFrequencyFleet(Registry& registry, const std::vector<EnsembleVariant>& variants);
+
+    // 把设备的 FrequencyControlConfigComponent 与 PhysicalStateComponent 复制到打包池 (全部通道相同的初始状态)。
+    // 设备缺少任一组件时返回空句柄。
+    CompactHandle add_device(Entity device);
+    void reserve(size_t device_count);
+
+    // 批量内核: 对一个集合频率事件更新全部设备的全部通道
+    void step(const EnsembleFrequencyInfo& info);
+    // 协程任务: 读取 ENSEMBLE_FREQUENCY_UPDATE_EVENT 最新值通道并执行 step()
+    cps_coro::Task run();
+
+    // 各通道全部设备的当前功率之和 (按存储顺序累加)
+    std::array<double, ENSEMBLE_LANES> total_power_kW() const;
+
+    const std::vector<EnsembleVariant>& variants() const { return variants_; }
+    size_t lane_count() const { return variants_.size(); }
+    size_t size() const { return hot_.size(); }
+    static constexpr size_t hot_bytes_per_device() { return sizeof(EnsembleDeviceHot); }
+
+private:
+    Registry& registry_;
+    PackedPool<EnsembleDeviceHot>& hot_;
+    PackedPool<DeviceDroopParams>& droop_;
+    PackedPool<DeviceSocLimits>& soc_limits_;
+    std::vector<EnsembleVariant> variants_;
+    double deadband_scale_[ENSEMBLE_LANES];
+    double gain_scale_[ENSEMBLE_LANES];
+    double last_processed_event_time_s_ = -1.0;
+};
+
 // 函数：计算频率偏差
 // 根据扰动发生后的相对时间 `t_relative` (单位：秒) 来计算系统频率的理论偏差值 (单位：Hz)。
 // 这个函数通常基于一个简化的电力系统频率响应模型 (如单机等效模型或特定传递函数)。
 // 返回计算得到的频率偏差值。
 double calculate_frequency_deviation(double t_relative);
 
+// 函数：计算负荷阶跃引起的频率偏差
+// 频率模型是线性的，`calculate_frequency_deviation` 即为标幺功率缺额 P_f 的阶跃响应。
+// 因此任意大小的负荷变化 `delta_load_pu` (标幺值，正值为负荷增加，负值为切除负荷) 在
+// 其发生后 `t_relative` 秒引起的频率偏差可按比例缩放得到，用于叠加切负荷等后续功率变化的影响。
+double calculate_load_step_frequency_response(double t_relative, double delta_load_pu);
+
+// 负荷阶跃响应的增量叠加
+// 阶跃响应由 e^{-Nt}、e^{-Nt}·sin(Mt)、e^{-Nt}·cos(Mt) 三项线性组合而成，任意多次阶跃的合成响应只需维护
+// 这三项的加权和 (以最近一次阶跃的时刻为参考，加入新阶跃时把和平移到新时刻)，加入与查询均为 O(1)，
+// 与逐次叠加 calculate_load_step_frequency_response 的结果在舍入误差内一致。
+// 阶跃须按时间顺序加入，查询时刻不早于最近一次阶跃的时刻。
+class LoadStepSuperposition {
+public:
+    void add_step(double time_s, double delta_load_pu);
+    // 全部已加入阶跃在 time_s 时刻引起的频率偏差 (Hz)
+    double deviation(double time_s) const;
+    size_t step_count() const { return step_count_; }
+
+private:
+    // 把三项加权和从参考时刻平移 dt 秒
+    void shifted(double dt, double& decay, double& decay_cos, double& decay_sin) const;
+
+    double reference_time_s_ = 0.0;
+    double decay_sum_ = 0.0; // Σ ΔP·e^{-Nτ}
+    double decay_cos_sum_ = 0.0; // Σ ΔP·e^{-Nτ}·cos(Mτ)
+    double decay_sin_sum_ = 0.0; // Σ ΔP·e^{-Nτ}·sin(Mτ)
+    size_t step_count_ = 0;
+};
+
+// 频率模型修正接口
+// 解析频率模型只描述初始扰动本身；扰动发生后其他子系统引起的功率变化 (如低频减载切除的负荷)
+// 通过实现此接口叠加到频率预言机发布的频率偏差上。
+class FrequencyModelAdjuster {
+public:
+    virtual ~FrequencyModelAdjuster() = default;
+
+    // sim_time_s: 当前仿真时间 (秒)；base_deviation_hz: 解析模型给出的频率偏差 (Hz)。
+    // 返回修正后的频率偏差 (Hz)。
+    virtual double adjust_deviation(double sim_time_s, double base_deviation_hz) = 0;
+};
+
 // 协程任务：频率预言机 (Frequency Oracle Task)
 // 此协程模拟一个外部的“频率预言机”或频率测量单元。
 // 它会根据 `calculate_frequency_deviation` 函数定义的模型，周期性地计算当前的系统频率偏差，
-// 并通过触发 `FREQUENCY_UPDATE_EVENT` 事件，将此信息广播给仿真中的其他部分 (如VPP控制器)。
+// 并发布到编号为 `FREQUENCY_UPDATE_EVENT` 的最新值通道，供仿真中的其他部分 (如VPP控制器) 读取。
 // registry: ECS注册表的引用，用于可能访问某些全局状态或实体信息 (在此例中主要用于统计总功率)。
 // ev_entities: 包含所有电动汽车充电桩实体的向量。
 // ess_entities: 包含所有储能单元实体的向量。
 // disturbance_start_time_s: 系统发生频率扰动 (例如，发电机跳闸或负荷突变) 的仿真开始时间 (秒)。
 // simulation_step_ms: 频率预言机更新和发布频率事件的时间步长 (毫秒)。
+// adjuster: 可选的频率模型修正 (例如叠加低频减载切除负荷的效果)，为空时直接使用解析模型。
+// fleet: 可选的批量频率响应集群，非空时VPP总功率取自集群的打包池 (此时设备实体列表应为空)。
 cps_coro::Task frequencyOracleTask(Registry& registry,
     const std::vector<Entity>& ev_entities,
     const std::vector<Entity>& ess_entities,
+    double disturbance_start_time_s,
+    double simulation_step_ms,
+    FrequencyModelAdjuster* adjuster = nullptr,
+    const FrequencyResponseFleet* fleet = nullptr);
+
+// 协程任务：集合频率预言机
+// 与 frequencyOracleTask 相同的解析频率模型与步长，每步按各变体的扰动幅值倍数缩放频率偏差，
+// 以 ENSEMBLE_FREQUENCY_UPDATE_EVENT 最新值通道一次发布全部变体的频率偏差，并把每个变体的频率偏差与VPP总功率写入数据文件。
+cps_coro::Task ensembleFrequencyOracleTask(const EnsembleFrequencyFleet& fleet,
     double disturbance_start_time_s,
     double simulation_step_ms);
 
@@ -82,7 +290,7 @@ cps_coro::Task frequencyOracleTask(Registry& registry,
 
 // 协程任务：单个设备频率响应任务 (VPP中的独立设备)
 // 此协程模拟VPP中单个设备 (如EV充电桩、ESS) 如何响应频率变化。
-// 它会等待 FREQUENCY_UPDATE_EVENT 事件，获取当前的频率偏差信息。
+// 它读取频率最新值通道 (FREQUENCY_UPDATE_EVENT)，获取最新的频率偏差信息。
 // 然后，根据此设备的 FrequencyControlConfigComponent 和 PhysicalStateComponent，
 // 计算并更新其功率输出 (或消耗)，以参与一次频率调节。
 // registry: ECS注册表的引用，用于访问和修改此设备实体的组件数据。
@@ -0,0 +1,163 @@
+// live_state.cpp
+// 实现了实时状态快照的共享内存发布 (顺序锁写入) 与只读读取。
+// 仅在 POSIX 平台上可用，其他平台上 open() 返回 false。
+#include "live_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CPS_LIVE_STATE_SHM 1
+#endif
+
+namespace {
+
+void copy_names(char (*dst)[LIVE_STATE_NAME_BYTES], const std::vector<std::string>& names, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = std::min(names[i].size(), LIVE_STATE_NAME_BYTES - 1);
+        if (len < names[i].size()) {
+            while (len > 0 && (static_cast<unsigned char>(names[i][len]) & 0xC0) == 0x80)
+                --len; // 不在 UTF-8 字符中间截断
+        }
+        std::memcpy(dst[i], names[i].data(), len);
+        dst[i][len] = '\0';
+    }
+}
+
+} // namespace
+
+// --- LiveStatePublisher ---
+
+bool LiveStatePublisher::open(const std::string& name, const std::vector<std::string>& breaker_names, const std::vector<std::string>& bus_names)
+{
+    close();
+#if defined(CPS_LIVE_STATE_SHM)
+    ::shm_unlink(name.c_str()); // 上次运行异常退出时遗留的段
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644);
+    if (fd < 0)
+        return false;
+    if (::ftruncate(fd, sizeof(LiveStateSegment)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+    void* addr = ::mmap(nullptr, sizeof(LiveStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+
+    // 新段由内核清零；序号为0表示尚未发布。魔数最后写入，读者见到魔数即可使用名称表。
+    segment_ = static_cast<LiveStateSegment*>(addr);
+    name_ = name;
+    publish_count_ = 0;
+    segment_->version = LIVE_STATE_VERSION;
+    segment_->segment_bytes = sizeof(LiveStateSegment);
+    segment_->publisher_pid = static_cast<int64_t>(::getpid());
+    segment_->breaker_count = static_cast<uint32_t>(std::min(breaker_names.size(), LIVE_STATE_MAX_BREAKERS));
+    segment_->bus_count = static_cast<uint32_t>(std::min(bus_names.size(), LIVE_STATE_MAX_BUSES));
+    copy_names(segment_->breaker_names, breaker_names, segment_->breaker_count);
+    copy_names(segment_->bus_names, bus_names, segment_->bus_count);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(segment_->magic, LIVE_STATE_MAGIC, sizeof(LIVE_STATE_MAGIC));
+    return true;
+#else
+    (void)name;
+    (void)breaker_names;
+    (void)bus_names;
+    return false;
+#endif
+}
+
+void LiveStatePublisher::close()
+{
+#if defined(CPS_LIVE_STATE_SHM)
+    if (!segment_)
+        return;
+    ::munmap(segment_, sizeof(LiveStateSegment));
+    ::shm_unlink(name_.c_str());
+    segment_ = nullptr;
+#endif
+}
+
+void LiveStatePublisher::publish(const LiveStateSnapshot& snapshot)
+{
+    if (!segment_)
+        return;
+    // 顺序锁写入: 序号置为奇数 -> 写快照 -> 序号置为下一个偶数
+    uint64_t seq = segment_->sequence.load(std::memory_order_relaxed);
+    segment_->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&segment_->snapshot, &snapshot, sizeof(LiveStateSnapshot));
+    segment_->snapshot.publish_count = ++publish_count_;
+    segment_->sequence.store(seq + 2, std::memory_order_release);
+}
+
+// --- LiveStateReader ---
+
+bool LiveStateReader::open(const std::string& name)
+{
+    close();
+#if defined(CPS_LIVE_STATE_SHM)
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(LiveStateSegment))) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = ::mmap(nullptr, sizeof(LiveStateSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    const auto* segment = static_cast<const LiveStateSegment*>(addr);
+    bool valid = std::memcmp(segment->magic, LIVE_STATE_MAGIC, sizeof(LIVE_STATE_MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid || segment->version != LIVE_STATE_VERSION || segment->segment_bytes != sizeof(LiveStateSegment)) {
+        ::munmap(addr, sizeof(LiveStateSegment));
+        return false;
+    }
+    segment_ = segment;
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+void LiveStateReader::close()
+{
+#if defined(CPS_LIVE_STATE_SHM)
+    if (!segment_)
+        return;
+    ::munmap(const_cast<LiveStateSegment*>(segment_), sizeof(LiveStateSegment));
+    segment_ = nullptr;
+#endif
+}
+
+bool LiveStateReader::read(LiveStateSnapshot& out, int max_attempts) const
+{
+    if (!segment_)
+        return false;
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        uint64_t before = segment_->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield(); // 写入方正在写，稍后重读
+            continue;
+        }
+        std::memcpy(&out, &segment_->snapshot, sizeof(LiveStateSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment_->sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+// live_state.h
+// 实时状态导出: 仿真线程把固定布局的状态快照 (频率偏差、VPP总功率、断路器分合、母线带电) 写入 POSIX 共享内存，
+// 本机的监视程序 (例如 cps_live_reader 或外部看板) 以只读方式映射同一段共享内存读取最新快照。
+// 快照由顺序锁 (seqlock) 保护: 写入前后各递增一次序号 (写入期间序号为奇数)，读者复制快照后核对序号，
+// 序号为奇数或前后不一致即重读。写入方从不等待读者，读者只读映射，因此不会对仿真产生任何影响。
+//
+// 共享内存段布局 (LiveStateSegment):
+//   魔数 "CPSLIVE1" | 版本 | 段字节数 | 发布进程号 | 断路器数 | 母线数 | 断路器名称表 | 母线名称表   (打开时写入一次)
+//   | 序号 (std::atomic<uint64_t>) | LiveStateSnapshot                                                  (每次发布)
+// 名称表与快照中的状态数组下标一一对应。
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr char LIVE_STATE_MAGIC[8] = { 'C', 'P', 'S', 'L', 'I', 'V', 'E', '1' };
+constexpr uint32_t LIVE_STATE_VERSION = 1;
+constexpr size_t LIVE_STATE_MAX_BREAKERS = 64;
+constexpr size_t LIVE_STATE_MAX_BUSES = 64;
+constexpr size_t LIVE_STATE_NAME_BYTES = 32; // 含结尾0，超长名称被截断
+constexpr const char* LIVE_STATE_DEFAULT_NAME = "/cps_live_state";
+
+// 快照中有效的字段
+enum LiveStateField : uint32_t {
+    LIVE_FIELD_FREQUENCY = 1u << 0,
+    LIVE_FIELD_VPP_POWER = 1u << 1,
+    LIVE_FIELD_BREAKERS = 1u << 2,
+    LIVE_FIELD_BUSES = 1u << 3,
+};
+
+// 固定布局的状态快照 (不含指针，可直接按字节复制)
+struct LiveStateSnapshot {
+    uint64_t publish_count; // 发布序号 (由发布者填写，从1开始)
+    uint32_t valid_fields; // LiveStateField 的组合
+    uint32_t reserved;
+    double sim_time_s; // 仿真时间 (秒)
+    double freq_deviation_hz; // 系统频率偏差 (Hz)
+    double vpp_total_power_kW; // VPP总功率 (kW)
+    uint8_t breaker_open[LIVE_STATE_MAX_BREAKERS]; // 1: 断开，0: 闭合
+    uint8_t bus_energized[LIVE_STATE_MAX_BUSES]; // 1: 带电，0: 失电
+};
+
+struct LiveStateSegment {
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_bytes;
+    int64_t publisher_pid;
+    uint32_t breaker_count;
+    uint32_t bus_count;
+    char breaker_names[LIVE_STATE_MAX_BREAKERS][LIVE_STATE_NAME_BYTES];
+    char bus_names[LIVE_STATE_MAX_BUSES][LIVE_STATE_NAME_BYTES];
+    alignas(64) std::atomic<uint64_t> sequence; // 偶数: 快照稳定；奇数: 正在写入
+    LiveStateSnapshot snapshot;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "共享内存中的序号必须是无锁原子量");
+
+// 写入方 (仿真线程)
+class LiveStatePublisher {
+public:
+    LiveStatePublisher() = default;
+    ~LiveStatePublisher() { close(); }
+
+    LiveStatePublisher(const LiveStatePublisher&) = delete;
+    LiveStatePublisher& operator=(const LiveStatePublisher&) = delete;
+
+    // 创建 (或重建) 名为 name 的共享内存段并写入名称表。超出容量的断路器/母线被忽略。失败时返回 false。
+    bool open(const std::string& name, const std::vector<std::string>& breaker_names = {}, const std::vector<std::string>& bus_names = {});
+    // 解除映射并删除共享内存名 (已映射的读者仍可读到最后一个快照)
+    void close();
+    bool is_open() const { return segment_ != nullptr; }
+
+    size_t breaker_count() const { return segment_ ? segment_->breaker_count : 0; }
+    size_t bus_count() const { return segment_ ? segment_->bus_count : 0; }
+
+    // 以顺序锁发布一个快照 (publish_count 由本函数填写)。未打开时不做任何事。
+    void publish(const LiveStateSnapshot& snapshot);
+    uint64_t publish_count() const { return publish_count_; }
+
+private:
+    LiveStateSegment* segment_ = nullptr;
+    std::string name_;
+    uint64_t publish_count_ = 0;
+};
+
+// 读取方 (监视进程)，只读映射
+class LiveStateReader {
+public:
+    LiveStateReader() = default;
+    ~LiveStateReader() { close(); }
+
+    LiveStateReader(const LiveStateReader&) = delete;
+    LiveStateReader& operator=(const LiveStateReader&) = delete;
+
+    // 映射名为 name 的共享内存段并校验魔数与版本。段不存在或无效时返回 false。
+    bool open(const std::string& name);
+    void close();
+    bool is_open() const { return segment_ != nullptr; }
+
+    const LiveStateSegment& segment() const { return *segment_; }
+
+    // 读取一个一致的快照。写入方持续写入导致 max_attempts 次都未读到稳定快照时返回 false。
+    bool read(LiveStateSnapshot& out, int max_attempts = 1000) const;
+
+private:
+    const LiveStateSegment* segment_ = nullptr;
+};
+
+#endif // LIVE_STATE_H
@@ -1,6 +1,7 @@
 // logging_utils.cpp
 // 实现了 logging_utils.h 中声明的日志初始化和关闭函数。
 #include "logging_utils.h"
+#include "memory_accounting.h" // 日志记录器的分配计入 logging 标记
 #include "spdlog/sinks/basic_file_sink.h" // 用于创建线程安全的文件日志输出目标 (sink)
 #include "spdlog/sinks/stdout_color_sinks.h" // 用于创建线程安全的彩色控制台日志输出目标 (sink)
 #include <iostream> // 用于在日志初始化本身失败时，通过 std::cerr 输出错误信息
@@ -12,6 +13,7 @@ std::shared_ptr<spdlog::logger> g_data_file_logger { nullptr };
 // initialize_loggers 函数实现
 void initialize_loggers(const std::string& data_log_filename, bool truncate_data_log)
 {
+    MemTagScope mem_scope(MemTag::LOGGING);
     try {
         // 1. 配置和创建控制台日志记录器 (Console Logger)
         //    spdlog::stdout_color_mt 创建一个线程安全 (mt) 的、支持彩色的标准输出日志记录器。
@@ -2,26 +2,111 @@
 #include "ecs_core.h"
 #include "logging_utils.h"
 #include "logic_protection_system.h"
+#include "memory_accounting.h"
+#include "phase_profiler.h"
 
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <string>
 
-int main()
+extern void test_protection_schemes(size_t feeder_count, double seconds);
+extern void test_logic_equivalence(int seconds);
+
+// 用法: logic_protection_demo [选项]            运行保护与网络重构协同仿真 (选项可组合)
+//   --live [共享内存名]      按物理时钟实时运行，并把断路器与母线状态发布到共享内存 (cps_live_reader 读取)
+//   --serve [套接字路径]     按物理时钟实时运行，并在 Unix 域套接字上提供命令服务 (cps_command_client 访问)
+//   --schemes [馈线数]       改为运行保护方案引擎的大规模同时故障仿真 (重合闸与失灵保护，默认10^4条馈线)
+//   --equivalence            改为运行调度推进路径的差分等价性校验 (事件序列与断路器状态曲线)
+//   --seconds <秒>           仿真时长 (默认20秒)
+int main(int argc, char* argv[])
 {
+    bool live = false;
+    bool serve = false;
+    size_t scheme_feeders = 0;
+    bool equivalence = false;
+    std::string live_name = LIVE_STATE_DEFAULT_NAME;
+    std::string socket_path = COMMAND_DEFAULT_SOCKET;
+    int seconds = 20;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0;
+        if (std::strcmp(argv[i], "--live") == 0) {
+            live = true;
+            if (has_value)
+                live_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0) {
+            serve = true;
+            if (has_value)
+                socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--schemes") == 0) {
+            scheme_feeders = has_value ? std::stoul(argv[++i]) : 10000;
+        } else if (std::strcmp(argv[i], "--equivalence") == 0) {
+            equivalence = true;
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && has_value) {
+            seconds = std::stoi(argv[++i]);
+        }
+    }
+
     initialize_loggers("logic_protection.log", true);
+    PhaseProfiler::instance().enable_from_env(); // CPS_PHASE_PROFILE=1 时按阶段统计
+    if (scheme_feeders > 0) {
+        test_protection_schemes(scheme_feeders, seconds);
+        for (const auto& line : PhaseProfiler::instance().report_lines())
+            std::cout << line << "\n";
+        shutdown_loggers();
+        return 0;
+    }
+    if (equivalence) {
+        test_logic_equivalence(seconds);
+        shutdown_loggers();
+        return 0;
+    }
     std::cout << "--- 主动配电网CPS统一行为建模与高效仿真平台 ---\n";
     std::cout << "--- 场景: 保护与网络重构协同仿真 ---\n\n";
 
-    cps_coro::Scheduler scheduler;
+    cps_coro::RealTimeScheduler scheduler; // 非实时运行时与 Scheduler 完全相同
     Registry registry;
 
     LogicProtectionSystem protection_sim(registry, scheduler);
-    protection_sim.initialize_scenario_entities();
-    protection_sim.simulate_fault_and_reconfiguration_scenario().detach();
+    {
+        PhaseScope phase(SimPhase::SETUP);
+        protection_sim.initialize_scenario_entities();
+        protection_sim.simulate_fault_and_reconfiguration_scenario().detach();
+    }
+    LiveStatePublisher live_state;
+    if (live) {
+        if (protection_sim.start_live_state_export(live_state, live_name, std::chrono::milliseconds(20)))
+            std::cout << "实时状态已发布到共享内存 " << live_name << " (每20毫秒)。\n";
+        else
+            std::cout << "警告: 无法创建共享内存 " << live_name << "，不发布实时状态。\n";
+    }
+    CommandServer command_server;
+    if (serve) {
+        if (protection_sim.start_command_service(command_server, socket_path, std::chrono::milliseconds(10)))
+            std::cout << "命令服务已在 " << socket_path << " 上启动 (每10毫秒处理一批请求)。\n";
+        else
+            std::cout << "警告: 无法在 " << socket_path << " 上启动命令服务。\n";
+    }
 
-    scheduler.run_until(scheduler.now() + std::chrono::seconds(20));
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        if (live || serve)
+            scheduler.run_real_time_until(scheduler.now() + std::chrono::seconds(seconds));
+        else
+            scheduler.run_until(scheduler.now() + std::chrono::seconds(seconds));
+    }
 
     std::cout << "\n--- 仿真循环结束 ---\n";
+    if (command_server.is_running()) {
+        CommandServerStats stats = command_server.stats();
+        std::cout << "命令服务: 连接 " << stats.connections << " 个, 请求 " << stats.requests << " 个, 批次 " << stats.batches
+                  << " 个 (最大批次 " << stats.max_batch << " 个请求，队列满 " << stats.throttled_batches << " 次)。\n";
+        command_server.stop();
+    }
+    for (const auto& line : PhaseProfiler::instance().report_lines())
+        std::cout << line << "\n";
+    for (const auto& line : memory_report_lines())
+        std::cout << line << "\n";
     shutdown_loggers();
     return 0;
 }
\ No newline at end of file
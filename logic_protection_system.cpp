@@ -1,11 +1,30 @@
 // logic_protection_system.cpp
 #include "logic_protection_system.h"
+#include "equivalence_harness.h"
+#include "logging_utils.h"
+#include "phase_profiler.h"
+#include <algorithm>
+#include <map>
 #include <string>
 #include <unordered_set>
 
 LogicProtectionSystem::LogicProtectionSystem(Registry& registry, cps_coro::Scheduler& scheduler)
     : registry_(registry)
     , scheduler_(scheduler)
+    , comm_(registry, scheduler, 20240601)
+    , schemes_(
+          scheduler,
+          [this](Entity source, Entity breaker, LogicBreakerCommand::CommandType command) {
+              // 保护段的跳闸命令经该保护装置的GOOSE通道送达；失灵保护与重合闸在间隔内直接作用于断路器
+              auto channel = trip_channels_.find(source);
+              if (channel != trip_channels_.end()) {
+                  comm_.send(channel->second, to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { breaker, command });
+              } else {
+                  PhaseScope phase(SimPhase::EVENT_DISPATCH);
+                  scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { breaker, command });
+              }
+          },
+          [this](const ProtectionSchemeEvent& event) { log_scheme_event(event); })
 {
 }
 
@@ -81,19 +100,72 @@ void LogicProtectionSystem::initialize_scenario_entities()
     log_lp_info(scheduler_, "保护装置配置完成 (已模拟方向性并使用真实延时).");
 
     reconfig_system_entity = registry_.create();
-    for (const auto& pair : breaker_entities)
-        breaker_logic_task(pair.second).detach();
     for (const auto& pair : protection_entities)
-        protection_device_logic_task(pair.second).detach();
+        trip_channels_[pair.second] = comm_.add_channel(CommChannelParams::goose(), pair.second);
+    scada_channel_ = comm_.add_channel(CommChannelParams::iec104(), reconfig_system_entity);
+    comm_.start();
+    log_lp_info(scheduler_, "通信通道配置完成: 保护跳闸经GOOSE通道, 重构遥控经IEC104通道下发.");
+    for (const auto& pair : breaker_entities) {
+        schemes_.add_breaker(pair.second, {}, {}, registry_.get<BreakerStateComponent>(pair.second)->is_open);
+        breaker_logic_task(pair.second).detach();
+    }
+    for (const auto& pair : protection_entities) {
+        auto prot_comp = registry_.get<ProtectionDeviceComponent>(pair.second);
+        const auto& lines = prot_comp->type == ProtectionDeviceComponent::Type::MAIN ? prot_comp->protected_entities : prot_comp->backup_protected_entities;
+        for (Entity line : lines) {
+            device_stages_[pair.second].push_back(schemes_.add_stage({ pair.second, line,
+                static_cast<uint32_t>(prot_comp->trip_delay.count()), prot_comp->commanded_breaker_entities }));
+        }
+    }
+    schemes_.start();
+
+    // 自适应保护: 按断路器所连母线确定线路两端，登记主保护延时与各后备保护的投运定值
+    std::unordered_map<Entity, std::pair<AdaptiveLineEnd, AdaptiveLineEnd>> line_ends;
+    for (const auto& pair : bus_entities)
+        adaptive_.add_bus(pair.second, registry_.get<BusIdentityComponent>(pair.second)->is_power_source);
+    for (const auto& pair : line_entities) {
+        auto line_comp = registry_.get<LineIdentityComponent>(pair.second);
+        line_ends[pair.second] = { { 0, line_comp->from_bus_entity }, { 0, line_comp->to_bus_entity } };
+    }
+    for (const auto& pair : breaker_entities) {
+        auto breaker_comp = registry_.get<BreakerIdentityComponent>(pair.second);
+        auto& ends = line_ends.at(breaker_comp->associated_line_entity);
+        (breaker_comp->connected_bus_entity == ends.first.bus ? ends.first : ends.second).breaker = pair.second;
+    }
+    for (const auto& pair : line_entities)
+        adaptive_.add_line(pair.second, line_ends[pair.second].first, line_ends[pair.second].second);
+    std::map<std::string, Entity> sorted_devices(protection_entities.begin(), protection_entities.end());
+    for (const auto& [key, device] : sorted_devices) {
+        auto prot_comp = registry_.get<ProtectionDeviceComponent>(device);
+        const uint32_t delay_ms = static_cast<uint32_t>(prot_comp->trip_delay.count());
+        if (prot_comp->type == ProtectionDeviceComponent::Type::MAIN) {
+            for (Entity line : prot_comp->protected_entities)
+                adaptive_.add_main_protection(line, delay_ms);
+        } else if (!prot_comp->protected_entities.empty() && !prot_comp->commanded_breaker_entities.empty()) {
+            adaptive_.add_backup_relay({ device, prot_comp->protected_entities[0], prot_comp->commanded_breaker_entities[0], delay_ms },
+                { prot_comp->protected_entities, prot_comp->backup_protected_entities, delay_ms });
+        }
+    }
+    for (const auto& pair : breaker_entities)
+        adaptive_.set_breaker_open(pair.second, registry_.get<BreakerStateComponent>(pair.second)->is_open);
+    adaptive_.finalize();
+    log_lp_info(scheduler_, "自适应保护: 已登记 %zu 套后备保护, 开关变位后只重新整定保护区受影响的保护.", adaptive_.relay_count());
+
+    fault_pickup_task().detach();
     network_reconfiguration_logic_task().detach();
-    log_lp_info(scheduler_, "为所有非电源母线启动失电监视任务...");
+    log_lp_info(scheduler_, "启动带电状态发布任务: 每次开关变位后统一计算一次全部母线的带电状态, 只为状态变化的母线发出事件...");
     for (const auto& pair : bus_entities) {
         auto bus_comp = registry_.get<BusIdentityComponent>(pair.second);
-        if (bus_comp && !bus_comp->is_power_source) {
-            supply_check_task(pair.second).detach();
-            log_lp_info(scheduler_, "  -> 已启动对母线 [%s] 的监视.", bus_comp->name.c_str());
-        }
+        if (!bus_comp)
+            continue;
+        monitored_buses_.push_back(pair.second);
+        if (bus_comp->is_power_source)
+            source_buses_.push_back(static_cast<BusId>(pair.second));
+        else
+            log_lp_info(scheduler_, "  -> 母线 [%s] 已纳入失电监视.", bus_comp->name.c_str());
     }
+    bus_energized_ = compute_bus_energization();
+    energization_publisher_task().detach();
     log_lp_info(scheduler_, "==> 所有协程任务已启动. 初始化完成. <==");
 }
 
@@ -121,7 +193,7 @@ cps_coro::Task LogicProtectionSystem::network_reconfiguration_logic_task()
         if (option) {
             auto breaker_to_close_name = registry_.get<BreakerIdentityComponent>(option->breaker_to_close)->name;
             log_lp_info(scheduler_, "网络重构决策完成: 最优方案是合上断路器 [%s].", breaker_to_close_name.c_str());
-            scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { option->breaker_to_close, LogicBreakerCommand::CommandType::CLOSE });
+            comm_.send(scada_channel_, to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { option->breaker_to_close, LogicBreakerCommand::CommandType::CLOSE });
 
             co_await cps_coro::delay(std::chrono::milliseconds(200));
 
@@ -143,7 +215,10 @@ cps_coro::Task LogicProtectionSystem::simulate_fault_and_reconfiguration_scenari
 
     log_lp_info(scheduler_, "### 故障注入: 在线路 [L2] 注入永久性故障. ###");
     active_fault_line_ = line_entities["L2"]; // 记录活动故障
-    scheduler_.trigger_event(to_underlying(EventID::LOGIC_FAULT_EVENT), LogicFaultInfo { active_fault_line_ });
+    {
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
+        scheduler_.trigger_event(to_underlying(EventID::LOGIC_FAULT_EVENT), LogicFaultInfo { active_fault_line_ });
+    }
 
     co_await cps_coro::delay(std::chrono::seconds(15));
 
@@ -159,6 +234,11 @@ cps_coro::Task LogicProtectionSystem::simulate_fault_and_reconfiguration_scenari
 
     bool success = get_state_str("1DL") == "打开" && get_state_str("2DL") == "闭合" && get_state_str("3DL") == "闭合" && get_state_str("4DL") == "打开" && get_state_str("5DL") == "闭合" && get_state_str("6DL") == "闭合";
 
+    auto comm_stats = comm_.stats();
+    log_lp_info(scheduler_, "通信统计: 通道 %zu 条, 发送 %llu 帧, 送达 %llu 帧, 丢失 %llu 帧, 平均时延 %.2fms, 最大时延 %.2fms.",
+        comm_stats.channels, (unsigned long long)comm_stats.sent, (unsigned long long)comm_stats.delivered,
+        (unsigned long long)(comm_stats.lost + comm_stats.dropped), comm_stats.mean_latency_ms, comm_stats.max_latency_ms);
+
     if (success) {
         log_lp_info(scheduler_, "+++ 验证成功: 保护与重构序列完全符合预期! +++");
     } else {
@@ -169,6 +249,7 @@ cps_coro::Task LogicProtectionSystem::simulate_fault_and_reconfiguration_scenari
 
 std::optional<ReconfigurationOption> LogicProtectionSystem::find_reconfiguration_option(Entity lost_bus_entity, Entity faulted_line)
 {
+    PhaseScope phase(SimPhase::TOPOLOGY_QUERY);
     auto lost_bus_name = registry_.get<BusIdentityComponent>(lost_bus_entity)->name;
 
     // 通用安全前置条件检查
@@ -202,6 +283,24 @@ std::optional<ReconfigurationOption> LogicProtectionSystem::find_reconfiguration
     ReconfigurationOption best_option;
     best_option.path_length = std::numeric_limits<int>::max(); // 重置
     log_lp_info(scheduler_, "决策分析: 开始搜索最佳恢复路径...");
+
+    // 位并行预筛: 每个候选开关对应一个场景 (当前断开的线路中去掉该开关所在线路)，一次扫描得到全部场景的带电母线。
+    // 合上候选开关后失电母线仍不带电的候选不可能存在恢复路径，跳过其逐一路径搜索。
+    const auto current_open_lines = get_currently_open_lines();
+    std::vector<std::vector<BranchId>> candidate_scenarios;
+    std::unordered_map<Entity, size_t> candidate_scenario_index;
+    registry_.for_each<BreakerStateComponent>([&](BreakerStateComponent& state, Entity breaker_entity) {
+        auto breaker_id = registry_.get<BreakerIdentityComponent>(breaker_entity);
+        if (!state.is_normally_open || !breaker_id || !registry_.get<LineIdentityComponent>(breaker_id->associated_line_entity))
+            return;
+        auto& scenario = candidate_scenarios.emplace_back(current_open_lines);
+        scenario.erase(std::remove(scenario.begin(), scenario.end(), breaker_id->associated_line_entity), scenario.end());
+        candidate_scenario_index[breaker_entity] = candidate_scenarios.size() - 1;
+    });
+    const auto screening = topology_.energizedBusesByScenario(
+        { static_cast<BusId>(bus_entities["1M"]), static_cast<BusId>(bus_entities["5M"]) }, candidate_scenarios);
+    const int lost_bus_idx = topology_.getBusInternalIndex(lost_bus_entity);
+
     registry_.for_each<BreakerStateComponent>([&](BreakerStateComponent& state, Entity breaker_entity) {
         if (!state.is_normally_open)
             return;
@@ -215,6 +314,8 @@ std::optional<ReconfigurationOption> LogicProtectionSystem::find_reconfiguration
             return;
 
         log_lp_info(scheduler_, "  -> 正在评估候选开关 [%s]...", breaker_id->name.c_str());
+        if (lost_bus_idx == -1 || !screening.isEnergized(candidate_scenario_index.at(breaker_entity), lost_bus_idx))
+            return;
 
         Entity endpoint1 = line_on_breaker->from_bus_entity;
         Entity endpoint2 = line_on_breaker->to_bus_entity;
@@ -255,45 +356,61 @@ std::optional<ReconfigurationOption> LogicProtectionSystem::find_reconfiguration
     return std::nullopt;
 }
 
-cps_coro::Task LogicProtectionSystem::protection_device_logic_task(Entity p_entity)
+// 故障启动任务: 按故障线路启动相关保护段的计时。计时、到期跳闸以及故障切除后的复归由保护方案引擎完成，
+// 保护装置不再各自睡眠到期后再检查线路是否仍带电。
+cps_coro::Task LogicProtectionSystem::fault_pickup_task()
 {
-    auto prot_comp = registry_.get<ProtectionDeviceComponent>(p_entity);
-    if (!prot_comp)
-        co_return;
-
     while (true) {
         LogicFaultInfo fault_info = co_await cps_coro::wait_for_event<LogicFaultInfo>(to_underlying(EventID::LOGIC_FAULT_EVENT));
-
-        bool is_relevant = false;
-        if (prot_comp->type == ProtectionDeviceComponent::Type::MAIN) {
-            for (auto p_line : prot_comp->protected_entities) {
-                if (p_line == fault_info.faulted_line_entity) {
-                    is_relevant = true;
-                    break;
-                }
-            }
-        } else { // BACKUP
-            for (auto b_line : prot_comp->backup_protected_entities) {
-                if (b_line == fault_info.faulted_line_entity) {
-                    is_relevant = true;
-                    break;
-                }
+        for (const auto& pair : protection_entities) {
+            auto prot_comp = registry_.get<ProtectionDeviceComponent>(pair.second);
+            // 只启动当前定值组范围内的保护段 (自适应保护可能已将该线路移出后备范围)
+            const auto& lines = prot_comp->type == ProtectionDeviceComponent::Type::MAIN ? prot_comp->protected_entities : prot_comp->backup_protected_entities;
+            if (std::find(lines.begin(), lines.end(), fault_info.faulted_line_entity) == lines.end())
+                continue;
+            for (uint32_t stage : device_stages_[pair.second]) {
+                if (schemes_.stage(stage).supervised_element != fault_info.faulted_line_entity)
+                    continue;
+                log_lp_info(scheduler_, "保护 [%s] 检测到相关故障, 启动计时 (延时: %lldms).", prot_comp->name.c_str(), prot_comp->trip_delay.count());
+                schemes_.pickup(stage);
             }
         }
+    }
+}
 
-        if (is_relevant) {
-            log_lp_info(scheduler_, "保护 [%s] 检测到相关故障, 启动计时 (延时: %lldms).", prot_comp->name.c_str(), prot_comp->trip_delay.count());
-            co_await cps_coro::delay(prot_comp->trip_delay);
-
-            if (is_line_energized(fault_info.faulted_line_entity)) {
-                log_lp_info(scheduler_, "保护 [%s] 计时结束, 故障仍存在, 发出跳闸命令!", prot_comp->name.c_str());
-                for (auto breaker : prot_comp->commanded_breaker_entities) {
-                    scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { breaker, LogicBreakerCommand::CommandType::OPEN });
-                }
-            } else {
-                log_lp_info(scheduler_, "保护 [%s] 计时结束, 故障已被其他保护清除, 复归.", prot_comp->name.c_str());
-            }
-        }
+void LogicProtectionSystem::log_scheme_event(const ProtectionSchemeEvent& event)
+{
+    using Kind = ProtectionSchemeEvent::Kind;
+    if (event.kind == Kind::STAGE_TRIP || event.kind == Kind::STAGE_RESET) {
+        auto prot_comp = registry_.get<ProtectionDeviceComponent>(schemes_.stage(event.index).device);
+        if (!prot_comp)
+            return;
+        if (event.kind == Kind::STAGE_TRIP)
+            log_lp_info(scheduler_, "保护 [%s] 计时结束, 故障仍存在, 发出跳闸命令!", prot_comp->name.c_str());
+        else if (adaptive_reset_)
+            log_lp_info(scheduler_, "保护 [%s] 的后备范围已不含故障线路, 取消计时并复归.", prot_comp->name.c_str());
+        else
+            log_lp_info(scheduler_, "保护 [%s] 计时中故障已被其他保护清除, 取消计时并复归.", prot_comp->name.c_str());
+        return;
+    }
+    auto breaker_comp = registry_.get<BreakerIdentityComponent>(event.breaker);
+    if (!breaker_comp)
+        return;
+    switch (event.kind) {
+    case Kind::BREAKER_FAILURE:
+        log_lp_info(scheduler_, "!!! 失灵保护: 断路器 [%s] 跳闸失败, 跳开后备断路器.", breaker_comp->name.c_str());
+        break;
+    case Kind::RECLOSE:
+        log_lp_info(scheduler_, "重合闸: 断路器 [%s] 第%u次重合.", breaker_comp->name.c_str(), event.shot);
+        break;
+    case Kind::RECLOSE_SUCCESS:
+        log_lp_info(scheduler_, "重合闸: 断路器 [%s] 重合成功, 复归.", breaker_comp->name.c_str());
+        break;
+    case Kind::LOCKOUT:
+        log_lp_info(scheduler_, "重合闸: 断路器 [%s] 闭锁.", breaker_comp->name.c_str());
+        break;
+    default:
+        break;
     }
 }
 
@@ -318,6 +435,9 @@ cps_coro::Task LogicProtectionSystem::breaker_logic_task(Entity breaker_entity)
                     co_await cps_coro::delay(std::chrono::milliseconds(20));
                     state_comp->is_open = true;
                     log_lp_info(scheduler_, ">>> 断路器 [%s] 已成功打开.", id_comp->name.c_str());
+                    schemes_.on_breaker_status(breaker_entity, true);
+                    adaptive_.set_breaker_open(breaker_entity, true);
+                    PhaseScope phase(SimPhase::EVENT_DISPATCH);
                     scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_STATUS_CHANGED_EVENT), LogicBreakerStatus { breaker_entity, true });
                 }
             }
@@ -327,33 +447,239 @@ cps_coro::Task LogicProtectionSystem::breaker_logic_task(Entity breaker_entity)
                 co_await cps_coro::delay(std::chrono::milliseconds(100));
                 state_comp->is_open = false;
                 log_lp_info(scheduler_, ">>> 断路器 [%s] 已成功闭合.", id_comp->name.c_str());
+                schemes_.on_breaker_status(breaker_entity, false);
+                adaptive_.set_breaker_open(breaker_entity, false);
+                PhaseScope phase(SimPhase::EVENT_DISPATCH);
                 scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_STATUS_CHANGED_EVENT), LogicBreakerStatus { breaker_entity, false });
             }
         }
     }
 }
 
-cps_coro::Task LogicProtectionSystem::supply_check_task(Entity bus_entity)
+// 带电状态发布任务: 取代逐母线的失电监视协程。每次开关变位只做一次全网电源可达性扫描，与上次结果比较，
+// 只为状态变化的母线发出 LOGIC_BUS_ENERGIZATION_CHANGED_EVENT (非电源母线失电时另发 LOGIC_SUPPLY_LOSS_EVENT)。
+// 未受影响的母线不产生任何开销。
+cps_coro::Task LogicProtectionSystem::energization_publisher_task()
 {
-    auto bus_id_comp = registry_.get<BusIdentityComponent>(bus_entity);
-    if (!bus_id_comp)
-        co_return;
-
-    bool was_energized = true;
     while (true) {
         co_await cps_coro::wait_for_event<LogicBreakerStatus>(to_underlying(EventID::LOGIC_BREAKER_STATUS_CHANGED_EVENT));
-        co_await cps_coro::delay(std::chrono::milliseconds(10));
+        co_await cps_coro::delay(std::chrono::milliseconds(10)); // 等待变位稳定，期间的其他变位一并计入本次扫描
+
+        std::vector<uint8_t> energized = compute_bus_energization();
+        if (energized != bus_energized_) {
+            std::vector<uint8_t> previous = std::move(bus_energized_);
+            bus_energized_ = std::move(energized);
+            ++energization_version_;
+
+            PhaseScope phase(SimPhase::EVENT_DISPATCH);
+            for (Entity bus : monitored_buses_) {
+                const int idx = topology_.getBusInternalIndex(bus);
+                if (idx < 0 || previous[idx] == bus_energized_[idx])
+                    continue;
+                const bool now_energized = bus_energized_[idx] != 0;
+                scheduler_.trigger_event(to_underlying(EventID::LOGIC_BUS_ENERGIZATION_CHANGED_EVENT),
+                    LogicBusEnergizationChange { bus, now_energized, energization_version_ });
+                auto bus_id_comp = registry_.get<BusIdentityComponent>(bus);
+                if (!now_energized && bus_id_comp && !bus_id_comp->is_power_source) {
+                    log_lp_info(scheduler_, "!!! 监视器: 检测到母线 [%s] 已失电!", bus_id_comp->name.c_str());
+                    scheduler_.trigger_event(to_underlying(EventID::LOGIC_SUPPLY_LOSS_EVENT), LogicSupplyLossInfo { bus });
+                }
+            }
+            // 线路两端母线均已失电的保护段: 故障已被切除，取消计时
+            schemes_.reset_cleared_stages([this](Entity line) { return !is_line_energized_in(bus_energized_, line); });
+        }
+        // 带电状态不变的变位 (如线路一端断开) 也可能改变潮流方向与后备范围
+        apply_adaptive_settings();
+    }
+}
 
-        bool is_energized = is_bus_connected_to_source(bus_entity);
+// 自适应保护: 重新整定保护区与本次变位区域相交的后备保护，定值变化时写回组件。
+// 移出后备范围且正在计时的保护段被复归；新纳入后备范围的线路增加保护段；延时变化从下一次启动起生效。
+void LogicProtectionSystem::apply_adaptive_settings()
+{
+    PhaseScope phase(SimPhase::TOPOLOGY_QUERY);
+    for (uint32_t r : adaptive_.refresh()) {
+        const AdaptiveRelay& relay = adaptive_.relay(r);
+        const RelaySettingsGroup& settings = adaptive_.settings(r);
+        auto prot_comp = registry_.get<ProtectionDeviceComponent>(relay.device);
+        if (!prot_comp)
+            continue;
+        log_lp_info(scheduler_, "自适应保护: 保护 [%s] 定值更新: 后备范围 [%s] -> [%s], 延时 %lldms -> %ums.", prot_comp->name.c_str(),
+            describe_lines(prot_comp->backup_protected_entities).c_str(), describe_lines(settings.backup_entities).c_str(),
+            (long long)prot_comp->trip_delay.count(), settings.delay_ms);
+        prot_comp->protected_entities = settings.protected_entities;
+        prot_comp->backup_protected_entities = settings.backup_entities;
+        prot_comp->trip_delay = std::chrono::milliseconds(settings.delay_ms);
+
+        auto& stages = device_stages_[relay.device];
+        for (uint32_t stage : stages) {
+            schemes_.set_stage_delay(stage, settings.delay_ms);
+            const Entity line = schemes_.stage(stage).supervised_element;
+            if (schemes_.is_stage_armed(stage) && std::find(settings.backup_entities.begin(), settings.backup_entities.end(), line) == settings.backup_entities.end()) {
+                adaptive_reset_ = true;
+                schemes_.reset(stage);
+                adaptive_reset_ = false;
+            }
+        }
+        for (Entity line : settings.backup_entities) {
+            const bool has_stage = std::any_of(stages.begin(), stages.end(), [&](uint32_t stage) { return schemes_.stage(stage).supervised_element == line; });
+            if (!has_stage)
+                stages.push_back(schemes_.add_stage({ relay.device, line, settings.delay_ms, prot_comp->commanded_breaker_entities }));
+        }
+    }
+}
 
-        if (was_energized && !is_energized) {
-            log_lp_info(scheduler_, "!!! 监视器: 检测到母线 [%s] 已失电!", bus_id_comp->name.c_str());
-            scheduler_.trigger_event(to_underlying(EventID::LOGIC_SUPPLY_LOSS_EVENT), LogicSupplyLossInfo { bus_entity });
+std::string LogicProtectionSystem::describe_lines(const std::vector<Entity>& lines)
+{
+    std::string text;
+    for (Entity line : lines) {
+        auto line_comp = registry_.get<LineIdentityComponent>(line);
+        if (!text.empty())
+            text += ", ";
+        text += line_comp ? line_comp->name : std::to_string(line);
+    }
+    return text.empty() ? "无" : text;
+}
+
+bool LogicProtectionSystem::start_live_state_export(LiveStatePublisher& publisher, const std::string& shm_name, cps_coro::Scheduler::duration period)
+{
+    // 按编号 ("1DL"、"1M" 等) 排序，使共享内存中的下标与运行无关
+    std::map<std::string, Entity> sorted_breakers(breaker_entities.begin(), breaker_entities.end());
+    std::map<std::string, Entity> sorted_buses(bus_entities.begin(), bus_entities.end());
+    std::vector<Entity> breakers, buses;
+    std::vector<std::string> breaker_names, bus_names;
+    for (const auto& [key, entity] : sorted_breakers) {
+        auto id_comp = registry_.get<BreakerIdentityComponent>(entity);
+        breakers.push_back(entity);
+        breaker_names.push_back(id_comp ? id_comp->name : key);
+    }
+    for (const auto& [key, entity] : sorted_buses) {
+        auto id_comp = registry_.get<BusIdentityComponent>(entity);
+        buses.push_back(entity);
+        bus_names.push_back(id_comp ? id_comp->name : key);
+    }
+    if (!publisher.open(shm_name, breaker_names, bus_names))
+        return false;
+    breakers.resize(publisher.breaker_count());
+    buses.resize(publisher.bus_count());
+    live_state_task(publisher, std::move(breakers), std::move(buses), period).detach();
+    return true;
+}
+
+cps_coro::Task LogicProtectionSystem::live_state_task(LiveStatePublisher& publisher, std::vector<Entity> breakers, std::vector<Entity> buses,
+    cps_coro::Scheduler::duration period)
+{
+    LiveStateSnapshot snapshot {};
+    snapshot.valid_fields = LIVE_FIELD_BREAKERS | LIVE_FIELD_BUSES;
+    while (true) {
+        snapshot.sim_time_s = std::chrono::duration<double>(scheduler_.now().time_since_epoch()).count();
+        for (size_t i = 0; i < breakers.size(); ++i) {
+            auto state = registry_.get<BreakerStateComponent>(breakers[i]);
+            snapshot.breaker_open[i] = state && state->is_open ? 1 : 0;
         }
-        was_energized = is_energized;
+        for (size_t i = 0; i < buses.size(); ++i)
+            snapshot.bus_energized[i] = is_bus_connected_to_source(buses[i]) ? 1 : 0;
+        publisher.publish(snapshot);
+        co_await cps_coro::delay(period);
     }
 }
 
+bool LogicProtectionSystem::start_command_service(CommandServer& server, const std::string& socket_path, cps_coro::Scheduler::duration period)
+{
+    if (!server.start(socket_path))
+        return false;
+    command_service_task(server, period).detach();
+    return true;
+}
+
+cps_coro::Task LogicProtectionSystem::command_service_task(CommandServer& server, cps_coro::Scheduler::duration period)
+{
+    std::vector<CommandRequest> batch;
+    std::vector<CommandResponse> responses;
+    while (true) {
+        if (server.take_batch(batch) > 0) {
+            for (const auto& request : batch)
+                responses.push_back(execute_command(request));
+            server.respond(responses);
+        }
+        co_await cps_coro::delay(period);
+    }
+}
+
+CommandResponse LogicProtectionSystem::execute_command(const CommandRequest& request)
+{
+    CommandResponse response;
+    response.client = request.client;
+    response.request_id = request.request_id;
+    response.sim_time_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(scheduler_.now().time_since_epoch()).count());
+    auto find = [&request](const std::unordered_map<std::string, Entity>& entities) -> Entity {
+        auto it = entities.find(request.target);
+        return it == entities.end() ? 0 : it->second;
+    };
+
+    switch (request.op) {
+    case CommandOp::PING:
+        break;
+    case CommandOp::INJECT_FAULT: {
+        Entity line = find(line_entities);
+        if (!line) {
+            response.status = CommandStatus::UNKNOWN_TARGET;
+            break;
+        }
+        log_lp_info(scheduler_, "### 命令服务: 在线路 [%s] 注入故障. ###", request.target.c_str());
+        active_fault_line_ = line;
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
+        scheduler_.trigger_event(to_underlying(EventID::LOGIC_FAULT_EVENT), LogicFaultInfo { line });
+        break;
+    }
+    case CommandOp::OPERATE_BREAKER: {
+        Entity breaker = find(breaker_entities);
+        if (!breaker) {
+            response.status = CommandStatus::UNKNOWN_TARGET;
+            break;
+        }
+        if (request.arg > 1) {
+            response.status = CommandStatus::BAD_REQUEST;
+            break;
+        }
+        auto command = request.arg ? LogicBreakerCommand::CommandType::OPEN : LogicBreakerCommand::CommandType::CLOSE;
+        log_lp_info(scheduler_, "命令服务: %s断路器 [%s].", request.arg ? "分开" : "合上", request.target.c_str());
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
+        scheduler_.trigger_event(to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT), LogicBreakerCommand { breaker, command });
+        break;
+    }
+    case CommandOp::QUERY_ENERGIZATION: {
+        Entity bus = find(bus_entities);
+        if (!bus)
+            response.status = CommandStatus::UNKNOWN_TARGET;
+        else
+            response.values.push_back(is_bus_connected_to_source(bus) ? 1 : 0);
+        break;
+    }
+    case CommandOp::READ_COMPONENT:
+        if (Entity breaker = find(breaker_entities)) {
+            auto state = registry_.get<BreakerStateComponent>(breaker);
+            auto id_comp = registry_.get<BreakerIdentityComponent>(breaker);
+            response.values = { static_cast<uint8_t>(CommandComponentKind::BREAKER), static_cast<uint8_t>(state && state->is_open),
+                static_cast<uint8_t>(state && state->is_normally_open), static_cast<uint8_t>(id_comp && id_comp->is_stuck_on_trip_cmd) };
+        } else if (Entity bus = find(bus_entities)) {
+            auto id_comp = registry_.get<BusIdentityComponent>(bus);
+            response.values = { static_cast<uint8_t>(CommandComponentKind::BUS), static_cast<uint8_t>(id_comp && id_comp->is_power_source),
+                static_cast<uint8_t>(is_bus_connected_to_source(bus)) };
+        } else if (Entity line = find(line_entities)) {
+            response.values = { static_cast<uint8_t>(CommandComponentKind::LINE), static_cast<uint8_t>(is_line_energized(line)),
+                static_cast<uint8_t>(line == active_fault_line_) };
+        } else {
+            response.status = CommandStatus::UNKNOWN_TARGET;
+        }
+        break;
+    default:
+        response.status = CommandStatus::UNSUPPORTED;
+        break;
+    }
+    return response;
+}
+
 std::vector<BranchId> LogicProtectionSystem::get_currently_open_lines()
 {
     std::unordered_set<Entity> open_lines_set;
@@ -370,12 +696,36 @@ std::vector<BranchId> LogicProtectionSystem::get_currently_open_lines()
 
 bool LogicProtectionSystem::is_bus_connected_to_source(BusId target_bus)
 {
+    PhaseScope phase(SimPhase::TOPOLOGY_QUERY);
     auto open_lines = get_currently_open_lines();
     bool connected_to_A = topology_.findPath(bus_entities["1M"], target_bus, open_lines).has_value();
     bool connected_to_E = topology_.findPath(bus_entities["5M"], target_bus, open_lines).has_value();
     return connected_to_A || connected_to_E;
 }
 
+std::vector<uint8_t> LogicProtectionSystem::compute_bus_energization()
+{
+    PhaseScope phase(SimPhase::TOPOLOGY_QUERY);
+    const auto result = topology_.energizedBusesByScenario(source_buses_, { get_currently_open_lines() });
+    std::vector<uint8_t> energized(result.bus_ids.size());
+    for (size_t i = 0; i < energized.size(); ++i)
+        energized[i] = result.isEnergized(0, static_cast<int>(i)) ? 1 : 0;
+    return energized;
+}
+
+bool LogicProtectionSystem::is_line_energized_in(const std::vector<uint8_t>& bus_energized, Entity line_entity)
+{
+    auto line_id_comp = registry_.get<LineIdentityComponent>(line_entity);
+    if (!line_id_comp)
+        return false;
+    for (Entity bus : { line_id_comp->from_bus_entity, line_id_comp->to_bus_entity }) {
+        const int idx = topology_.getBusInternalIndex(bus);
+        if (idx >= 0 && bus_energized[idx])
+            return true;
+    }
+    return false;
+}
+
 bool LogicProtectionSystem::is_line_energized(Entity line_entity)
 {
     auto line_id_comp = registry_.get<LineIdentityComponent>(line_entity);
@@ -386,4 +736,103 @@ bool LogicProtectionSystem::is_line_energized(Entity line_entity)
     bool to_bus_energized = is_bus_connected_to_source(line_id_comp->to_bus_entity);
 
     return from_bus_energized || to_bus_energized;
-}
\ No newline at end of file
+}
+
+// --- 差分等价性校验 ---
+
+// 观察协程: 每次 event_id 触发时调用 record (只读，事件处理器同步恢复，同一时刻的连续触发都被记录)
+template <typename EventData, typename RecordFn>
+static cps_coro::Task equivalenceEventObserver(cps_coro::EventId event_id, RecordFn record)
+{
+    while (true) {
+        EventData data = co_await cps_coro::wait_for_event<EventData>(event_id);
+        record(data);
+    }
+}
+
+// 保护与网络重构协同仿真的差分等价性校验: 同一场景 (固定的故障与通信种子) 分别以 Scheduler::run_until (参考) 与
+// 逐次 run_one_step (RealTimeScheduler 的推进路径) 运行，记录故障、断路器命令与变位、母线带电变化与失电事件，
+// 以及每10毫秒全部断路器的分合状态，逐项比较。自检运行令 4DL 拒动，校验应在 4DL 上报告第一个分歧。
+void test_logic_equivalence(int seconds)
+{
+    if (g_console_logger)
+        g_console_logger->info("--- 保护与网络重构的差分等价性校验: {} 秒 ---", seconds);
+
+    auto make_engine = [seconds](SchedulerDrive drive, const std::string& stuck_breaker) {
+        return [=](EquivalenceTrace& trace) {
+            cps_coro::RealTimeScheduler scheduler;
+            Registry registry;
+            LogicProtectionSystem sim(registry, scheduler);
+            sim.initialize_scenario_entities();
+
+            std::vector<Entity> breakers;
+            registry.for_each<BreakerIdentityComponent>([&](BreakerIdentityComponent& id, Entity e) {
+                breakers.push_back(e);
+                trace.name_entity(e, id.name);
+                if (id.name == stuck_breaker)
+                    id.is_stuck_on_trip_cmd = true;
+            });
+            std::sort(breakers.begin(), breakers.end());
+            registry.for_each<BusIdentityComponent>([&](BusIdentityComponent& id, Entity e) { trace.name_entity(e, id.name); });
+            registry.for_each<LineIdentityComponent>([&](LineIdentityComponent& id, Entity e) { trace.name_entity(e, id.name); });
+
+            auto now_s = [&scheduler] { return std::chrono::duration<double>(scheduler.now().time_since_epoch()).count(); };
+            const uint32_t fault = trace.field("fault");
+            const uint32_t command = trace.field("breaker_command");
+            const uint32_t status = trace.field("breaker_open");
+            const uint32_t energized = trace.field("bus_energized");
+            const uint32_t supply_loss = trace.field("supply_loss");
+            EquivalenceTrace* out = &trace;
+            equivalenceEventObserver<LogicFaultInfo>(to_underlying(EventID::LOGIC_FAULT_EVENT),
+                [=](const LogicFaultInfo& e) { out->add_event(now_s(), e.faulted_line_entity, fault, 1.0); })
+                .detach();
+            equivalenceEventObserver<LogicBreakerCommand>(to_underlying(EventID::LOGIC_BREAKER_COMMAND_EVENT),
+                [=](const LogicBreakerCommand& e) { out->add_event(now_s(), e.breaker_entity, command, static_cast<double>(e.command)); })
+                .detach();
+            equivalenceEventObserver<LogicBreakerStatus>(to_underlying(EventID::LOGIC_BREAKER_STATUS_CHANGED_EVENT),
+                [=](const LogicBreakerStatus& e) { out->add_event(now_s(), e.breaker_entity, status, e.is_open ? 1.0 : 0.0); })
+                .detach();
+            equivalenceEventObserver<LogicBusEnergizationChange>(to_underlying(EventID::LOGIC_BUS_ENERGIZATION_CHANGED_EVENT),
+                [=](const LogicBusEnergizationChange& e) { out->add_event(now_s(), e.bus_entity, energized, e.energized ? 1.0 : 0.0); })
+                .detach();
+            equivalenceEventObserver<LogicSupplyLossInfo>(to_underlying(EventID::LOGIC_SUPPLY_LOSS_EVENT),
+                [=](const LogicSupplyLossInfo& e) { out->add_event(now_s(), e.bus_entity, supply_loss, 1.0); })
+                .detach();
+
+            for (Entity breaker : breakers)
+                trace.add_series(breaker, status);
+            equivalenceSamplerTask(scheduler, trace, std::chrono::milliseconds(5), std::chrono::milliseconds(10), [&registry, breakers](double* row) {
+                for (size_t i = 0; i < breakers.size(); ++i)
+                    row[i] = registry.get<BreakerStateComponent>(breakers[i])->is_open ? 1.0 : 0.0;
+            }).detach();
+
+            sim.simulate_fault_and_reconfiguration_scenario().detach();
+            drive_scheduler(scheduler, scheduler.now() + std::chrono::seconds(seconds), drive);
+        };
+    };
+
+    const std::vector<EquivalenceEngine> engines = {
+        { "run_until (参考)", make_engine(SchedulerDrive::RUN_UNTIL, "") },
+        { "逐步推进", make_engine(SchedulerDrive::STEP, "") },
+        { "自检: 4DL拒动", make_engine(SchedulerDrive::RUN_UNTIL, "断路器4DL") },
+    };
+    EquivalenceTolerance tolerance;
+    tolerance.horizon_s = seconds;
+    const auto reports = run_equivalence_suite(engines, tolerance);
+
+    size_t equivalent = 0;
+    bool self_check_located = false;
+    for (size_t r = 0; r < reports.size(); ++r) {
+        const EquivalenceReport& report = reports[r];
+        if (r + 1 == reports.size())
+            self_check_located = !report.equivalent && report.first_divergence && report.first_divergence->entity_label == "断路器4DL";
+        else
+            equivalent += report.equivalent;
+        if (g_console_logger)
+            g_console_logger->info("{}", report.describe());
+    }
+    if (g_console_logger) {
+        g_console_logger->info("等价性校验: {}/{} 个候选引擎与参考一致；自检偏差{}。", equivalent, reports.size() - 1,
+            self_check_located ? "已定位到拒动的断路器" : "未被正确定位");
+    }
+}
@@ -2,8 +2,13 @@
 #define LOGIC_PROTECTION_SYSTEM_H
 
 #include "PowerSystemTopology.h"
+#include "adaptive_protection.h"
+#include "command_server.h"
+#include "comm_network.h"
 #include "cps_coro_lib.h"
 #include "ecs_core.h"
+#include "live_state.h"
+#include "protection_scheme_engine.h"
 #include "simulation_events_and_data.h"
 
 #include <chrono>
@@ -94,29 +99,59 @@ public:
     void initialize_scenario_entities();
     cps_coro::Task simulate_fault_and_reconfiguration_scenario();
 
+    // 实时状态导出: 以 shm_name 创建共享内存段 (断路器与母线按编号排序)，此后每隔 period 发布一次
+    // 断路器分合状态与母线带电状态。须在 initialize_scenario_entities() 之后调用；创建失败时返回 false。
+    bool start_live_state_export(LiveStatePublisher& publisher, const std::string& shm_name, cps_coro::Scheduler::duration period);
+
+    // 本地命令服务: 在 socket_path 上启动 server，此后每隔 period 取出一批排队的请求，在仿真线程中依次执行并整批应答。
+    // 目标名使用场景中的编号 ("L2"、"1DL"、"2M" 等)。须在 initialize_scenario_entities() 之后调用；启动失败时返回 false。
+    bool start_command_service(CommandServer& server, const std::string& socket_path, cps_coro::Scheduler::duration period);
+
 private:
     Registry& registry_;
     cps_coro::Scheduler& scheduler_;
     PowerSystemTopology topology_; // 拓扑接口
+    CommNetwork comm_; // 二次系统通信网络: 断路器命令经通信通道送达
+    ProtectionSchemeEngine schemes_; // 保护段计时 (故障切除后取消)、失灵保护与重合闸
+    AdaptiveProtectionService adaptive_; // 开关变位后按变化区域重新整定后备保护定值组
+    bool adaptive_reset_ = false; // 正在因定值更新复归保护段 (用于日志区分复归原因)
 
     std::unordered_map<std::string, Entity> bus_entities;
     std::unordered_map<std::string, Entity> line_entities;
     std::unordered_map<std::string, Entity> breaker_entities;
     std::unordered_map<std::string, Entity> protection_entities;
     Entity reconfig_system_entity;
+    std::unordered_map<Entity, Entity> trip_channels_; // 保护装置 -> 其至断路器智能终端的GOOSE通道
+    std::unordered_map<Entity, std::vector<uint32_t>> device_stages_; // 保护装置 -> 其在方案引擎中的保护段 (每条保护线路一段)
+    Entity scada_channel_ = 0; // 重构主站 -> 厂站的IEC104遥控通道
 
     //  用于存储当前活动故障的成员变量
     Entity active_fault_line_ = 0;
 
+    // 带电状态发布: 每次开关变位后对全部母线做一次电源可达性扫描，只为状态变化的母线发出事件
+    std::vector<BusId> source_buses_; // 电源母线
+    std::vector<Entity> monitored_buses_; // 全部母线，按事件发出顺序 (非电源母线失电时另发 LOGIC_SUPPLY_LOSS_EVENT)
+    std::vector<uint8_t> bus_energized_; // 按拓扑内部索引的上次带电状态
+    uint64_t energization_version_ = 0;
+
     // 协程任务
-    cps_coro::Task protection_device_logic_task(Entity protection_entity);
+    cps_coro::Task fault_pickup_task();
     cps_coro::Task breaker_logic_task(Entity breaker_entity);
     cps_coro::Task network_reconfiguration_logic_task();
-    cps_coro::Task supply_check_task(Entity bus_entity_to_check);
+    cps_coro::Task energization_publisher_task();
+    cps_coro::Task live_state_task(LiveStatePublisher& publisher, std::vector<Entity> breakers, std::vector<Entity> buses,
+        cps_coro::Scheduler::duration period);
+    cps_coro::Task command_service_task(CommandServer& server, cps_coro::Scheduler::duration period);
+    CommandResponse execute_command(const CommandRequest& request);
+    void log_scheme_event(const ProtectionSchemeEvent& event);
+    void apply_adaptive_settings(); // 取出自适应保护重新整定的结果，写回保护装置组件并同步方案引擎中的保护段
+    std::string describe_lines(const std::vector<Entity>& lines);
 
     // 辅助函数
     bool is_bus_connected_to_source(BusId target_bus);
+    std::vector<uint8_t> compute_bus_energization(); // 一次扫描求出全部母线的带电状态 (按拓扑内部索引)
     bool is_line_energized(Entity line_entity);
+    bool is_line_energized_in(const std::vector<uint8_t>& bus_energized, Entity line_entity); // 按一次扫描的结果判断
     std::vector<BranchId> get_currently_open_lines();
 
     // 动态决策函数现在需要知道哪个是故障线路
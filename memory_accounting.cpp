@@ -0,0 +1,184 @@
+// memory_accounting.cpp
+// 实现了按标记统计内存分配的全局 operator new/delete 以及统计报告。
+// 未定义 CPS_MEMORY_ACCOUNTING 时只保留空的报告函数。
+
+#include "memory_accounting.h"
+
+#include <cstdio>
+
+#ifdef CPS_MEMORY_ACCOUNTING
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+namespace {
+
+// 标记表只包含可常量初始化的成员，保证在任何静态对象构造 (及其内存分配) 之前即可使用
+struct MemTagStats {
+    std::atomic<int64_t> live { 0 };
+    std::atomic<int64_t> peak { 0 };
+    std::atomic<uint64_t> count { 0 };
+    char name[64] {};
+};
+
+MemTagStats g_mem_tags[MEM_TAG_CAPACITY];
+std::atomic<uint16_t> g_mem_tag_count { static_cast<uint16_t>(MemTag::COUNT) };
+
+const char* const FIXED_TAG_NAMES[] = { "other", "scheduler_timers", "event_handlers", "coroutine_frames", "topology", "logging" };
+static_assert(sizeof(FIXED_TAG_NAMES) / sizeof(FIXED_TAG_NAMES[0]) == static_cast<size_t>(MemTag::COUNT), "固定标记名称与 MemTag 不一致");
+
+// 每块内存前的头部，大小为16字节以保持 operator new 的默认对齐
+struct AllocHeader {
+    uint64_t size; // 请求的字节数
+    uint32_t offset; // 用户指针相对于实际分配起点的偏移
+    uint16_t tag;
+    uint16_t reserved;
+};
+static_assert(sizeof(AllocHeader) == 16, "AllocHeader 必须为16字节");
+
+constexpr size_t DEFAULT_ALIGN = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void charge(uint16_t tag, size_t bytes)
+{
+    MemTagStats& s = g_mem_tags[tag];
+    int64_t live = s.live.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+    int64_t peak = s.peak.load(std::memory_order_relaxed);
+    while (live > peak && !s.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+    s.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* tagged_alloc(size_t size, size_t align) noexcept
+{
+    // 头部紧邻用户指针之前；对齐要求超过默认值时，偏移取对齐值以保证用户指针对齐
+    const size_t offset = align > DEFAULT_ALIGN ? align : sizeof(AllocHeader);
+    void* base = nullptr;
+    if (align > DEFAULT_ALIGN)
+        base = std::aligned_alloc(align, (offset + size + align - 1) / align * align);
+    else
+        base = std::malloc(offset + size);
+    if (!base)
+        return nullptr;
+
+    char* user = static_cast<char*>(base) + offset;
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(user) - 1;
+    uint16_t tag = g_mem_current_tag < MEM_TAG_CAPACITY ? g_mem_current_tag : 0;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->tag = tag;
+    header->reserved = 0;
+    charge(tag, size);
+    return user;
+}
+
+void tagged_free(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+    const AllocHeader* header = static_cast<const AllocHeader*>(ptr) - 1;
+    g_mem_tags[header->tag].live.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+    std::free(static_cast<char*>(ptr) - header->offset);
+}
+
+void* tagged_alloc_or_throw(size_t size, size_t align)
+{
+    void* p = tagged_alloc(size == 0 ? 1 : size, align);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+uint16_t mem_register_component_tag(const std::type_info& type)
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint16_t tag = g_mem_tag_count.load(std::memory_order_relaxed);
+    if (tag >= MEM_TAG_CAPACITY)
+        return static_cast<uint16_t>(MemTag::OTHER);
+
+    const char* type_name = type.name();
+#if defined(__GNUC__)
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type_name, nullptr, nullptr, &status); // 以 malloc 分配，不计入统计
+    if (status == 0 && demangled)
+        type_name = demangled;
+#endif
+    std::snprintf(g_mem_tags[tag].name, sizeof(g_mem_tags[tag].name), "component:%s", type_name);
+#if defined(__GNUC__)
+    std::free(demangled);
+#endif
+    g_mem_tag_count.store(tag + 1, std::memory_order_release);
+    return tag;
+}
+
+std::vector<std::string> memory_report_lines()
+{
+    // 报告本身的分配不计入任何子系统
+    MemTagScope scope(MemTag::OTHER);
+    std::vector<std::string> lines;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "[内存统计] %-48s %12s %12s %12s", "tag", "live_KB", "peak_KB", "allocs");
+    lines.emplace_back(buf);
+
+    int64_t total_live = 0;
+    uint64_t total_count = 0;
+    const uint16_t tag_count = g_mem_tag_count.load(std::memory_order_acquire);
+    for (uint16_t t = 0; t < tag_count; ++t) {
+        const MemTagStats& s = g_mem_tags[t];
+        uint64_t count = s.count.load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        int64_t live = s.live.load(std::memory_order_relaxed);
+        total_live += live;
+        total_count += count;
+        const char* name = t < static_cast<uint16_t>(MemTag::COUNT) ? FIXED_TAG_NAMES[t] : s.name;
+        std::snprintf(buf, sizeof(buf), "[内存统计] %-48s %12.1f %12.1f %12llu", name, live / 1024.0,
+            s.peak.load(std::memory_order_relaxed) / 1024.0, (unsigned long long)count);
+        lines.emplace_back(buf);
+    }
+    // 各标记峰值出现的时刻不同，合计行只给出当前占用与分配次数
+    std::snprintf(buf, sizeof(buf), "[内存统计] %-48s %12.1f %12s %12llu", "total", total_live / 1024.0, "-", (unsigned long long)total_count);
+    lines.emplace_back(buf);
+    return lines;
+}
+
+// --- 全局 operator new/delete 的替换 ---
+
+void* operator new(std::size_t size) { return tagged_alloc_or_throw(size, DEFAULT_ALIGN); }
+void* operator new[](std::size_t size) { return tagged_alloc_or_throw(size, DEFAULT_ALIGN); }
+void* operator new(std::size_t size, std::align_val_t align) { return tagged_alloc_or_throw(size, static_cast<size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return tagged_alloc_or_throw(size, static_cast<size_t>(align)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return tagged_alloc(size == 0 ? 1 : size, DEFAULT_ALIGN); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return tagged_alloc(size == 0 ? 1 : size, DEFAULT_ALIGN); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return tagged_alloc(size == 0 ? 1 : size, static_cast<size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return tagged_alloc(size == 0 ? 1 : size, static_cast<size_t>(align)); }
+
+void operator delete(void* ptr) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr) noexcept { tagged_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { tagged_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { tagged_free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { tagged_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { tagged_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { tagged_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { tagged_free(ptr); }
+
+#else
+
+uint16_t mem_register_component_tag(const std::type_info&) { return 0; }
+
+std::vector<std::string> memory_report_lines() { return {}; }
+
+#endif // CPS_MEMORY_ACCOUNTING
@@ -0,0 +1,86 @@
+// memory_accounting.h
+// 按子系统标记的内存分配统计 (可选功能，CMake 选项 CPS_MEMORY_ACCOUNTING，默认关闭)。
+// 开启后替换全局 operator new/delete: 每块内存前附加一个16字节的头部，记录分配时所处的标记和大小，
+// 释放时据此扣减，因此一块内存无论在哪里释放都计入分配它的子系统。
+// 各子系统在分配内存的代码段上放置 MemTagScope (调度器定时任务、事件处理器、协程帧、每种组件的存储、
+// 拓扑、日志)，未处于任何标记内的分配计入 other。程序结束时 memory_report_lines() 输出每个标记的
+// 当前占用、峰值占用和分配次数。
+// 关闭时 MemTagScope 为空类型，不产生任何代码；全局 operator new 也保持标准库的实现。
+//
+// 注意: 只统计经由 operator new 的分配。spdlog 的文件缓冲等通过 malloc/stdio 取得的内存不在统计之内。
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+// 固定的子系统标记；每种组件的存储在首次使用时另行登记动态标记
+enum class MemTag : uint16_t {
+    OTHER = 0, // 未标记的分配
+    SCHEDULER_TIMERS, // 调度器定时任务与就绪队列
+    EVENT_HANDLERS, // 事件处理器 (std::function) 及其临时副本
+    COROUTINE_FRAMES, // 协程帧
+    TOPOLOGY, // 网络拓扑结构与查询
+    LOGGING, // 日志记录器与日志格式化
+    COUNT
+};
+
+constexpr size_t MEM_TAG_CAPACITY = 128; // 固定标记与动态标记的总数上限，超出的动态标记计入 other
+
+// 为组件类型登记一个动态标记 (名称为 "component:<类型名>")，返回标记编号
+uint16_t mem_register_component_tag(const std::type_info& type);
+
+// 每个有分配记录的标记一行 (当前占用、峰值占用、分配次数)，外加合计行；未开启统计时为空
+std::vector<std::string> memory_report_lines();
+
+#ifdef CPS_MEMORY_ACCOUNTING
+
+// 当前线程所处的标记，由全局 operator new 读取
+inline thread_local uint16_t g_mem_current_tag = 0;
+
+// 标记作用域: 构造时切换当前线程的标记，析构时恢复
+class MemTagScope {
+public:
+    explicit MemTagScope(uint16_t tag)
+        : saved_(g_mem_current_tag)
+    {
+        g_mem_current_tag = tag;
+    }
+    explicit MemTagScope(MemTag tag)
+        : MemTagScope(static_cast<uint16_t>(tag))
+    {
+    }
+    ~MemTagScope() { g_mem_current_tag = saved_; }
+
+    MemTagScope(const MemTagScope&) = delete;
+    MemTagScope& operator=(const MemTagScope&) = delete;
+
+private:
+    uint16_t saved_;
+};
+
+// 组件类型 Comp 的标记 (每种类型只登记一次)
+template <typename Comp>
+uint16_t mem_component_tag()
+{
+    static const uint16_t tag = mem_register_component_tag(typeid(Comp));
+    return tag;
+}
+
+#else
+
+class MemTagScope {
+public:
+    explicit MemTagScope(uint16_t) { }
+    explicit MemTagScope(MemTag) { }
+};
+
+template <typename Comp>
+constexpr uint16_t mem_component_tag() { return 0; }
+
+#endif // CPS_MEMORY_ACCOUNTING
+
+#endif // MEMORY_ACCOUNTING_H
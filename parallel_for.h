@@ -0,0 +1,140 @@
+// parallel_for.h
+// 轻量级的数据并行执行器，仅包含头文件。
+// 协程调度器本身是单线程的；当某个协程需要对大规模设备列 (数十万至百万级) 做一次批量计算时，
+// 可以通过 ParallelExecutor 把区间切分为固定大小的块，交给常驻工作线程与调用线程共同处理，
+// 调用在所有块完成后才返回，因此对协程而言仍是一次同步调用。
+//
+// 块的划分只取决于区间长度和块大小，与线程数无关：需要归约时，调用者按块号写入各自的部分结果
+// 再按块号顺序合并，即可得到与线程数无关、逐位可复现的结果。
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ParallelExecutor {
+public:
+    // threads: 总并行度 (含调用线程)。0 表示使用硬件并发数。
+    explicit ParallelExecutor(unsigned threads = 0)
+    {
+        unsigned n = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < n; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~ParallelExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+    ParallelExecutor(const ParallelExecutor&) = delete;
+    ParallelExecutor& operator=(const ParallelExecutor&) = delete;
+
+    unsigned concurrency() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    // 区间 [0, n) 按 chunk_size 划分后的块数
+    static size_t chunk_count(size_t n, size_t chunk_size) { return (n + chunk_size - 1) / chunk_size; }
+
+    // 对区间 [0, n) 的每个块调用 fn(chunk_index, begin, end)，全部完成后返回。
+    // 只有一个块或没有工作线程时直接在调用线程上顺序执行。
+    template <typename Fn>
+    void parallel_for(size_t n, size_t chunk_size, Fn&& fn)
+    {
+        const size_t chunks = chunk_count(n, chunk_size);
+        if (chunks == 0)
+            return;
+        if (chunks == 1 || workers_.empty()) {
+            for (size_t c = 0; c < chunks; ++c)
+                fn(c, c * chunk_size, std::min(n, (c + 1) * chunk_size));
+            return;
+        }
+
+        std::function<void(size_t)> job = [&](size_t c) { fn(c, c * chunk_size, std::min(n, (c + 1) * chunk_size)); };
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            job_ = &job;
+            job_chunks_ = chunks;
+            next_chunk_.store(0, std::memory_order_relaxed);
+            pending_chunks_ = chunks;
+            ++job_generation_;
+        }
+        cv_.notify_all();
+
+        size_t done = run_chunks(job, chunks); // 调用线程同样参与计算
+
+        // 还须等待所有已领取任务的工作线程退出，之后 job (位于本栈帧) 才能安全销毁
+        std::unique_lock<std::mutex> lock(mtx_);
+        pending_chunks_ -= done;
+        done_cv_.wait(lock, [this] { return pending_chunks_ == 0 && active_workers_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    // 领取并执行块，直至没有剩余块；返回本线程完成的块数
+    size_t run_chunks(const std::function<void(size_t)>& job, size_t chunks)
+    {
+        size_t done = 0;
+        for (size_t c = next_chunk_.fetch_add(1, std::memory_order_relaxed); c < chunks;
+             c = next_chunk_.fetch_add(1, std::memory_order_relaxed)) {
+            job(c);
+            ++done;
+        }
+        return done;
+    }
+
+    void finish_chunks(size_t done)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pending_chunks_ -= done;
+        --active_workers_;
+        if (pending_chunks_ == 0 && active_workers_ == 0)
+            done_cv_.notify_one();
+    }
+
+    void worker_loop()
+    {
+        size_t seen_generation = 0;
+        while (true) {
+            const std::function<void(size_t)>* job = nullptr;
+            size_t chunks = 0;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [&] { return stopping_ || (job_ && job_generation_ != seen_generation); });
+                if (stopping_)
+                    return;
+                seen_generation = job_generation_;
+                job = job_;
+                chunks = job_chunks_;
+                ++active_workers_;
+            }
+            finish_chunks(run_chunks(*job, chunks));
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mtx_;
+    std::condition_variable cv_; // 通知工作线程有新任务
+    std::condition_variable done_cv_; // 通知调用线程全部块已完成
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t job_chunks_ = 0;
+    size_t job_generation_ = 0;
+    size_t pending_chunks_ = 0;
+    size_t active_workers_ = 0; // 已领取当前任务、尚未退出的工作线程数
+    std::atomic<size_t> next_chunk_ { 0 };
+    bool stopping_ = false;
+};
+
+#endif // PARALLEL_FOR_H
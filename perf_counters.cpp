@@ -0,0 +1,155 @@
+// perf_counters.cpp
+// 实现了基于 perf_event_open 的硬件性能计数器读取。非Linux平台上全部计数器不可用。
+
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* perf_counter_name(PerfCounter counter)
+{
+    switch (counter) {
+    case PerfCounter::CYCLES:
+        return "cycles";
+    case PerfCounter::INSTRUCTIONS:
+        return "instructions";
+    case PerfCounter::LLC_MISSES:
+        return "llc_misses";
+    case PerfCounter::BRANCH_MISSES:
+        return "branch_misses";
+    case PerfCounter::CONTEXT_SWITCHES:
+        return "context_switches";
+    default:
+        return "unknown";
+    }
+}
+
+PerfCounterValues& PerfCounterValues::operator+=(const PerfCounterValues& other)
+{
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        values[i] += other.values[i];
+        valid[i] = valid[i] || other.valid[i];
+    }
+    return *this;
+}
+
+#if defined(__linux__)
+
+namespace {
+
+int open_counter(uint32_t type, uint64_t config, bool exclude_kernel, bool inherit)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.inherit = inherit ? 1 : 0;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+PerfCounterGroup::PerfCounterGroup(bool include_child_threads)
+{
+    struct Spec {
+        uint32_t type;
+        uint64_t config;
+    };
+    const std::array<Spec, PERF_COUNTER_COUNT> specs { {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    } };
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        // 优先统计用户态与内核态；perf_event_paranoid >= 2 时只允许统计用户态
+        int fd = open_counter(specs[i].type, specs[i].config, false, include_child_threads);
+        if (fd < 0)
+            fd = open_counter(specs[i].type, specs[i].config, true, include_child_threads);
+        if (fd < 0 && reason_.empty())
+            reason_ = std::string("perf_event_open(") + perf_counter_name(static_cast<PerfCounter>(i)) + "): " + std::strerror(errno);
+        fds_[i] = fd;
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+    for (int fd : fds_)
+        if (fd >= 0)
+            close(fd);
+}
+
+void PerfCounterGroup::reset()
+{
+    for (int fd : fds_)
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+}
+
+void PerfCounterGroup::start()
+{
+    for (int fd : fds_)
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void PerfCounterGroup::stop()
+{
+    for (int fd : fds_)
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+PerfCounterValues PerfCounterGroup::read() const
+{
+    PerfCounterValues result;
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds_[i] < 0)
+            continue;
+        uint64_t data[3] = { 0, 0, 0 }; // 计数值, 启用时长, 实际运行时长
+        if (::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+            continue;
+        // 多路复用时计数器只在部分时间运行，按比例折算
+        double scale = (data[2] > 0 && data[2] < data[1]) ? static_cast<double>(data[1]) / data[2] : 1.0;
+        result.values[i] = static_cast<uint64_t>(data[0] * scale);
+        result.valid[i] = true;
+    }
+    return result;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup(bool)
+    : reason_("当前平台不支持 perf_event_open")
+{
+    fds_.fill(-1);
+}
+
+PerfCounterGroup::~PerfCounterGroup() = default;
+void PerfCounterGroup::reset() { }
+void PerfCounterGroup::start() { }
+void PerfCounterGroup::stop() { }
+PerfCounterValues PerfCounterGroup::read() const { return {}; }
+
+#endif
+
+bool PerfCounterGroup::any_available() const
+{
+    for (int fd : fds_)
+        if (fd >= 0)
+            return true;
+    return false;
+}
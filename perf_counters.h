@@ -0,0 +1,64 @@
+// perf_counters.h
+// 硬件性能计数器 (Linux perf_event_open) 的简单封装。
+// 为当前线程打开一组计数器 (周期数、指令数、末级缓存未命中、分支预测失败、上下文切换)，
+// 通过 start()/stop() 在任意代码区间上累计计数，read() 读取累计值。
+// 内核禁止访问 (perf_event_paranoid 限制、容器或虚拟机未暴露PMU) 或非Linux平台时，
+// 对应计数器标记为不可用，读数为空，调用方照常运行，只是不输出该计数。
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class PerfCounter : size_t {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    LLC_MISSES, // 末级缓存未命中
+    BRANCH_MISSES,
+    CONTEXT_SWITCHES,
+    COUNT
+};
+
+constexpr size_t PERF_COUNTER_COUNT = static_cast<size_t>(PerfCounter::COUNT);
+
+// 计数器名称 (用于日志和JSON输出)
+const char* perf_counter_name(PerfCounter counter);
+
+// 一组计数器的读数。计数器因多路复用未全程运行时，已按运行时间比例折算。
+struct PerfCounterValues {
+    std::array<uint64_t, PERF_COUNTER_COUNT> values {};
+    std::array<bool, PERF_COUNTER_COUNT> valid {};
+
+    bool has(PerfCounter c) const { return valid[static_cast<size_t>(c)]; }
+    uint64_t get(PerfCounter c) const { return values[static_cast<size_t>(c)]; }
+    PerfCounterValues& operator+=(const PerfCounterValues& other);
+};
+
+class PerfCounterGroup {
+public:
+    // 打开计数器 (初始为停止状态，计数为0)。
+    // include_child_threads 为 true 时，此后创建的线程继承计数器，线程结束时其计数并入本组。
+    explicit PerfCounterGroup(bool include_child_threads = false);
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool available(PerfCounter c) const { return fds_[static_cast<size_t>(c)] >= 0; }
+    bool any_available() const;
+    // 首个打开失败的计数器及其错误信息 (全部可用时为空)
+    const std::string& unavailable_reason() const { return reason_; }
+
+    void reset(); // 累计计数清零
+    void start(); // 开始 (继续) 计数
+    void stop(); // 暂停计数
+    PerfCounterValues read() const; // 读取累计计数
+
+private:
+    std::array<int, PERF_COUNTER_COUNT> fds_;
+    std::string reason_;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,125 @@
+// phase_profiler.cpp
+// 实现了按仿真阶段的耗时与硬件计数统计。
+
+#include "phase_profiler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const char* sim_phase_name(SimPhase phase)
+{
+    switch (phase) {
+    case SimPhase::SETUP:
+        return "setup";
+    case SimPhase::RUN_UNTIL:
+        return "run_until";
+    case SimPhase::EVENT_DISPATCH:
+        return "event_dispatch";
+    case SimPhase::DEVICE_UPDATE:
+        return "device_update";
+    case SimPhase::TOPOLOGY_QUERY:
+        return "topology_query";
+    case SimPhase::LOGGING:
+        return "logging";
+    default:
+        return "unknown";
+    }
+}
+
+PhaseProfiler& PhaseProfiler::instance()
+{
+    static PhaseProfiler profiler;
+    return profiler;
+}
+
+void PhaseProfiler::enable_from_env(bool include_child_threads)
+{
+    const char* env = std::getenv("CPS_PHASE_PROFILE");
+    if (enabled_ || !env || !*env || std::strcmp(env, "0") == 0)
+        return;
+    perf_ = std::make_unique<PerfCounterGroup>(include_child_threads);
+    perf_->start(); // 计数器持续运行，阶段切换时读取增量
+    last_counters_ = perf_->read();
+    last_time_ = std::chrono::steady_clock::now();
+    enabled_ = true;
+}
+
+void PhaseProfiler::charge_current()
+{
+    auto now = std::chrono::steady_clock::now();
+    PerfCounterValues counters = perf_->read();
+    if (!stack_.empty()) {
+        PhaseTotals& t = totals_[static_cast<size_t>(stack_.back())];
+        t.wall_ns += std::chrono::duration<double, std::nano>(now - last_time_).count();
+        for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (counters.valid[i]) {
+                t.counters.values[i] += counters.values[i] - last_counters_.values[i];
+                t.counters.valid[i] = true;
+            }
+        }
+    }
+    last_time_ = now;
+    last_counters_ = counters;
+}
+
+void PhaseProfiler::enter(SimPhase phase)
+{
+    if (!enabled_)
+        return;
+    charge_current();
+    stack_.push_back(phase);
+    ++totals_[static_cast<size_t>(phase)].calls;
+}
+
+void PhaseProfiler::leave()
+{
+    if (!enabled_ || stack_.empty())
+        return;
+    charge_current();
+    stack_.pop_back();
+}
+
+std::vector<std::string> PhaseProfiler::report_lines() const
+{
+    std::vector<std::string> lines;
+    if (!enabled_)
+        return lines;
+
+    char buf[256];
+    if (!perf_->unavailable_reason().empty())
+        lines.push_back("[阶段统计] 部分硬件计数器不可用 (" + perf_->unavailable_reason() + ")，对应列显示为 -");
+    std::snprintf(buf, sizeof(buf), "[阶段统计] %-15s %10s %11s %12s %12s %6s %12s %12s %10s", "phase", "calls", "wall_ms",
+        "cycles_M", "instr_M", "IPC", "llc_miss_K", "br_miss_K", "ctx_sw");
+    lines.emplace_back(buf);
+
+    auto column = [](const PerfCounterValues& v, PerfCounter c, double scale, const char* fmt) {
+        char cell[32];
+        if (v.has(c))
+            std::snprintf(cell, sizeof(cell), fmt, v.get(c) / scale);
+        else
+            std::snprintf(cell, sizeof(cell), "%s", "-");
+        return std::string(cell);
+    };
+    for (size_t p = 0; p < SIM_PHASE_COUNT; ++p) {
+        const PhaseTotals& t = totals_[p];
+        if (t.calls == 0)
+            continue;
+        std::string ipc = "-";
+        if (t.counters.has(PerfCounter::CYCLES) && t.counters.has(PerfCounter::INSTRUCTIONS) && t.counters.get(PerfCounter::CYCLES) > 0) {
+            std::snprintf(buf, sizeof(buf), "%.2f",
+                static_cast<double>(t.counters.get(PerfCounter::INSTRUCTIONS)) / t.counters.get(PerfCounter::CYCLES));
+            ipc = buf;
+        }
+        std::snprintf(buf, sizeof(buf), "[阶段统计] %-15s %10llu %11.3f %12s %12s %6s %12s %12s %10s", sim_phase_name(static_cast<SimPhase>(p)),
+            (unsigned long long)t.calls, t.wall_ns / 1.0e6,
+            column(t.counters, PerfCounter::CYCLES, 1.0e6, "%.2f").c_str(),
+            column(t.counters, PerfCounter::INSTRUCTIONS, 1.0e6, "%.2f").c_str(),
+            ipc.c_str(),
+            column(t.counters, PerfCounter::LLC_MISSES, 1.0e3, "%.1f").c_str(),
+            column(t.counters, PerfCounter::BRANCH_MISSES, 1.0e3, "%.1f").c_str(),
+            column(t.counters, PerfCounter::CONTEXT_SWITCHES, 1.0, "%.0f").c_str());
+        lines.emplace_back(buf);
+    }
+    return lines;
+}
@@ -0,0 +1,94 @@
+// phase_profiler.h
+// 按仿真阶段统计耗时与硬件计数 (可选功能，默认关闭)。
+// 设置环境变量 CPS_PHASE_PROFILE=1 后，各演示程序在命名阶段 (场景构建、调度循环、事件分发、设备更新、
+// 拓扑查询、日志输出) 的入口和出口读取 perf_event_open 计数器 (见 perf_counters.h)，
+// 程序结束时输出每个阶段的调用次数、物理耗时、周期、指令、末级缓存未命中、分支预测失败和上下文切换。
+// 阶段可以嵌套，统计为独占值: 内层阶段的开销不计入外层阶段。
+// 内核禁止访问计数器时只统计调用次数与物理耗时。关闭时每个阶段标记只有一次分支判断。
+//
+// 注意: 阶段标记 (PhaseScope) 只能包围不含 co_await 的代码段，否则挂起期间其他任务的开销会计入该阶段。
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include "perf_counters.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class SimPhase : size_t {
+    SETUP = 0, // 场景构建与任务启动
+    RUN_UNTIL, // 调度循环 (扣除下列嵌套阶段后的剩余部分)
+    EVENT_DISPATCH, // 事件触发与处理器分发
+    DEVICE_UPDATE, // 设备状态更新
+    TOPOLOGY_QUERY, // 拓扑查询
+    LOGGING, // 日志与数据输出
+    COUNT
+};
+
+constexpr size_t SIM_PHASE_COUNT = static_cast<size_t>(SimPhase::COUNT);
+
+const char* sim_phase_name(SimPhase phase);
+
+class PhaseProfiler {
+public:
+    // 进程内唯一的实例
+    static PhaseProfiler& instance();
+
+    // 若环境变量 CPS_PHASE_PROFILE 已设置且不为 "0"，启用统计并开始计数。
+    // include_child_threads: 计数器由此后创建的线程继承 (用于多线程基准程序，线程的计数在其结束时并入当时所处的阶段)。
+    void enable_from_env(bool include_child_threads = false);
+
+    bool enabled() const { return enabled_; }
+    // 进入/离开阶段 (未启用时为空操作)；一般通过 PhaseScope 使用
+    void enter(SimPhase phase);
+    void leave();
+
+    // 统计结果 (每个有调用的阶段一行，外加计数器可用性说明)；未启用时为空
+    std::vector<std::string> report_lines() const;
+
+private:
+    struct PhaseTotals {
+        uint64_t calls = 0;
+        double wall_ns = 0.0;
+        PerfCounterValues counters;
+    };
+
+    // 把上次标记以来的增量计入当前栈顶阶段
+    void charge_current();
+
+    bool enabled_ = false;
+    std::unique_ptr<PerfCounterGroup> perf_;
+    std::vector<SimPhase> stack_;
+    std::chrono::steady_clock::time_point last_time_;
+    PerfCounterValues last_counters_;
+    std::array<PhaseTotals, SIM_PHASE_COUNT> totals_;
+};
+
+// 阶段标记: 构造时进入阶段，析构时离开
+class PhaseScope {
+public:
+    explicit PhaseScope(SimPhase phase)
+        : active_(PhaseProfiler::instance().enabled())
+    {
+        if (active_)
+            PhaseProfiler::instance().enter(phase);
+    }
+    ~PhaseScope()
+    {
+        if (active_)
+            PhaseProfiler::instance().leave();
+    }
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    bool active_;
+};
+
+#endif // PHASE_PROFILER_H
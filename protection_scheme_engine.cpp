@@ -0,0 +1,450 @@
+// protection_scheme_engine.cpp
+// 实现了保护方案引擎 (定时保护段、断路器失灵保护、自动重合闸) 与其大规模同时故障仿真。
+
+#include "protection_scheme_engine.h"
+#include "logging_utils.h"
+#include "phase_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+extern long get_peak_memory_usage_kb();
+
+ProtectionSchemeEngine::ProtectionSchemeEngine(cps_coro::Scheduler& scheduler, CommandSink command_sink, EventObserver observer)
+    : scheduler_(scheduler)
+    , command_sink_(std::move(command_sink))
+    , observer_(std::move(observer))
+    , wheel_(4096)
+{
+}
+
+void ProtectionSchemeEngine::add_breaker(Entity breaker, const RecloseSettings& reclose, const BreakerFailureSettings& failure, bool is_open)
+{
+    breaker_index_.emplace(breaker, static_cast<uint32_t>(breakers_.size()));
+    BreakerScheme& b = breakers_.emplace_back();
+    b.entity = breaker;
+    b.reclose = reclose;
+    b.failure = failure;
+    b.is_open = is_open;
+}
+
+uint32_t ProtectionSchemeEngine::add_stage(const ProtectionStageSettings& settings)
+{
+    stages_.push_back(settings);
+    stage_generation_.push_back(0);
+    armed_pos_.push_back(NOT_ARMED);
+    return static_cast<uint32_t>(stages_.size() - 1);
+}
+
+void ProtectionSchemeEngine::reserve(size_t breakers, size_t stages)
+{
+    breakers_.reserve(breakers);
+    breaker_index_.reserve(breakers);
+    stages_.reserve(stages);
+    stage_generation_.reserve(stages);
+    armed_pos_.reserve(stages);
+}
+
+void ProtectionSchemeEngine::start()
+{
+    // 后备断路器可能在被引用之后才注册，统一在此解析为下标
+    for (auto& b : breakers_) {
+        b.backup_index.clear();
+        for (Entity backup : b.failure.backup_breakers) {
+            auto it = breaker_index_.find(backup);
+            if (it != breaker_index_.end())
+                b.backup_index.push_back(it->second);
+        }
+    }
+    dispatcher_ = ticker_.run(scheduler_, [this] { return armed_ != 0; }, [this](uint64_t now_tick) {
+        ++stats_.ticks;
+        wheel_.advance(now_tick, [this](const SchemeTimer& timer, uint64_t) { on_timer_expired(timer); });
+    });
+}
+
+bool ProtectionSchemeEngine::pickup(uint32_t stage)
+{
+    if (armed_pos_[stage] != NOT_ARMED)
+        return false;
+    armed_pos_[stage] = static_cast<uint32_t>(armed_stages_.size());
+    armed_stages_.push_back(stage);
+    arm(TimerKind::STAGE, stage, ++stage_generation_[stage], stages_[stage].delay_ms);
+    return true;
+}
+
+bool ProtectionSchemeEngine::reset(uint32_t stage)
+{
+    const uint32_t pos = armed_pos_[stage];
+    if (pos == NOT_ARMED)
+        return false;
+    // 从计时列表中以末尾元素填补 (O(1))，并使时间轮中的定时器项失效
+    armed_stages_[pos] = armed_stages_.back();
+    armed_pos_[armed_stages_[pos]] = pos;
+    armed_stages_.pop_back();
+    armed_pos_[stage] = NOT_ARMED;
+    ++stage_generation_[stage];
+    disarm();
+    ++stats_.timers_cancelled;
+    ++stats_.stage_resets;
+    notify(ProtectionSchemeEvent::Kind::STAGE_RESET, 0, stage);
+    return true;
+}
+
+void ProtectionSchemeEngine::trip(Entity breaker)
+{
+    auto it = breaker_index_.find(breaker);
+    if (it == breaker_index_.end())
+        return;
+    BreakerScheme& b = breakers_[it->second];
+    if (b.is_open)
+        return;
+    b.trip_pending = true;
+    if (b.failure.delay_ms > 0 && !b.failure_armed) {
+        b.failure_armed = true;
+        arm(TimerKind::BREAKER_FAILURE, it->second, ++b.failure_generation, b.failure.delay_ms);
+    }
+}
+
+void ProtectionSchemeEngine::issue_trip(uint32_t breaker, Entity source)
+{
+    trip(breakers_[breaker].entity);
+    command_sink_(source, breakers_[breaker].entity, LogicBreakerCommand::CommandType::OPEN);
+}
+
+void ProtectionSchemeEngine::on_breaker_status(Entity breaker, bool is_open)
+{
+    auto it = breaker_index_.find(breaker);
+    if (it == breaker_index_.end())
+        return;
+    const uint32_t index = it->second;
+    BreakerScheme& b = breakers_[index];
+    b.is_open = is_open;
+
+    if (!is_open) {
+        // 重合闸自己发出的合闸处于复归时间内，无需处理；其他合闸 (手动/遥控) 使重合闸复位
+        if (b.state == RecloseState::DEAD_TIME || b.state == RecloseState::LOCKOUT) {
+            cancel_reclose(b);
+            b.state = RecloseState::READY;
+            b.shots_used = 0;
+        }
+        return;
+    }
+
+    // 分闸: 跳闸成功，取消失灵计时
+    if (b.failure_armed) {
+        b.failure_armed = false;
+        ++b.failure_generation;
+        disarm();
+        ++stats_.timers_cancelled;
+    }
+    const bool protection_trip = b.trip_pending;
+    b.trip_pending = false;
+    if (b.state == RecloseState::LOCKOUT)
+        return;
+    if (!protection_trip) {
+        // 手动/遥控分闸不启动重合闸
+        cancel_reclose(b);
+        b.state = RecloseState::READY;
+        b.shots_used = 0;
+        return;
+    }
+    if (b.reclose.dead_times_ms.empty())
+        return;
+    cancel_reclose(b); // 复归时间内再次跳闸: 取消复归计时
+    if (b.shots_used < b.reclose.dead_times_ms.size()) {
+        b.state = RecloseState::DEAD_TIME;
+        b.reclose_armed = true;
+        arm(TimerKind::RECLOSE, index, ++b.reclose_generation, b.reclose.dead_times_ms[b.shots_used]);
+    } else {
+        lockout(index);
+    }
+}
+
+RecloseState ProtectionSchemeEngine::reclose_state(Entity breaker) const
+{
+    auto it = breaker_index_.find(breaker);
+    return it == breaker_index_.end() ? RecloseState::READY : breakers_[it->second].state;
+}
+
+void ProtectionSchemeEngine::arm(TimerKind kind, uint32_t index, uint32_t generation, uint32_t delay_ms)
+{
+    // 推进协程空闲期间时间轮停在上次推进的节拍，先将其对齐到当前时刻 (此时轮中只有已取消的项)
+    const uint64_t now_tick = static_cast<uint64_t>(scheduler_.now().time_since_epoch().count());
+    if (ticker_.idle())
+        wheel_.advance(now_tick, [](const SchemeTimer&, uint64_t) {});
+    wheel_.schedule(now_tick + delay_ms, { index, generation, kind });
+    ++armed_;
+    ++stats_.timers_armed;
+    stats_.max_armed = std::max(stats_.max_armed, armed_);
+    ticker_.wake(scheduler_);
+}
+
+void ProtectionSchemeEngine::cancel_reclose(BreakerScheme& b)
+{
+    if (!b.reclose_armed)
+        return;
+    b.reclose_armed = false;
+    ++b.reclose_generation;
+    disarm();
+    ++stats_.timers_cancelled;
+}
+
+void ProtectionSchemeEngine::lockout(uint32_t breaker)
+{
+    BreakerScheme& b = breakers_[breaker];
+    cancel_reclose(b);
+    if (b.reclose.dead_times_ms.empty() || b.state == RecloseState::LOCKOUT)
+        return; // 未投重合闸的断路器无需闭锁
+    b.state = RecloseState::LOCKOUT;
+    ++stats_.lockouts;
+    notify(ProtectionSchemeEvent::Kind::LOCKOUT, b.entity);
+}
+
+void ProtectionSchemeEngine::notify(ProtectionSchemeEvent::Kind kind, Entity breaker, uint32_t index, uint32_t shot)
+{
+    if (observer_)
+        observer_(ProtectionSchemeEvent { kind, breaker, index, shot });
+}
+
+void ProtectionSchemeEngine::on_timer_expired(const SchemeTimer& timer)
+{
+    switch (timer.kind) {
+    case TimerKind::STAGE: {
+        const uint32_t stage = timer.index;
+        if (timer.generation != stage_generation_[stage] || armed_pos_[stage] == NOT_ARMED)
+            return;
+        const uint32_t pos = armed_pos_[stage];
+        armed_stages_[pos] = armed_stages_.back();
+        armed_pos_[armed_stages_[pos]] = pos;
+        armed_stages_.pop_back();
+        armed_pos_[stage] = NOT_ARMED;
+        disarm();
+        ++stats_.timers_expired;
+        ++stats_.stage_trips;
+        notify(ProtectionSchemeEvent::Kind::STAGE_TRIP, 0, stage);
+        const ProtectionStageSettings& s = stages_[stage];
+        for (Entity breaker : s.trip_breakers) {
+            auto it = breaker_index_.find(breaker);
+            if (it != breaker_index_.end())
+                issue_trip(it->second, s.device);
+            else
+                command_sink_(s.device, breaker, LogicBreakerCommand::CommandType::OPEN);
+        }
+        break;
+    }
+    case TimerKind::BREAKER_FAILURE: {
+        BreakerScheme& b = breakers_[timer.index];
+        if (timer.generation != b.failure_generation || !b.failure_armed)
+            return;
+        b.failure_armed = false;
+        disarm();
+        ++stats_.timers_expired;
+        ++stats_.breaker_failures;
+        notify(ProtectionSchemeEvent::Kind::BREAKER_FAILURE, b.entity);
+        // 失灵断路器与其后备断路器均闭锁重合闸，再跳开后备断路器
+        lockout(timer.index);
+        for (uint32_t backup : b.backup_index)
+            lockout(backup);
+        for (uint32_t backup : b.backup_index)
+            issue_trip(backup, 0);
+        break;
+    }
+    case TimerKind::RECLOSE: {
+        BreakerScheme& b = breakers_[timer.index];
+        if (timer.generation != b.reclose_generation || !b.reclose_armed)
+            return;
+        b.reclose_armed = false;
+        disarm();
+        ++stats_.timers_expired;
+        if (b.state == RecloseState::DEAD_TIME) {
+            // 无电流间隔结束: 重合并开始复归计时
+            ++b.shots_used;
+            ++stats_.recloses;
+            b.state = RecloseState::RECLAIM;
+            b.reclose_armed = true;
+            arm(TimerKind::RECLOSE, timer.index, ++b.reclose_generation, b.reclose.reclaim_ms);
+            notify(ProtectionSchemeEvent::Kind::RECLOSE, b.entity, 0, b.shots_used);
+            command_sink_(0, b.entity, LogicBreakerCommand::CommandType::CLOSE);
+        } else if (b.state == RecloseState::RECLAIM) {
+            if (b.is_open) {
+                lockout(timer.index); // 重合命令未能合上断路器
+            } else {
+                b.state = RecloseState::READY;
+                b.shots_used = 0;
+                ++stats_.reclose_successes;
+                notify(ProtectionSchemeEvent::Kind::RECLOSE_SUCCESS, b.entity);
+            }
+        }
+        break;
+    }
+    }
+}
+
+// --- 大规模同时故障仿真 ---
+
+namespace {
+
+// 故障按馈线序号分类: 瞬时性故障在第一次跳闸后消失，半永久性故障在第二次跳闸后消失，永久性故障不消失
+constexpr uint32_t PERMANENT_FAULT = UINT32_MAX;
+constexpr size_t FEEDERS_PER_BUS = 16;
+
+uint32_t fault_trips_for(size_t feeder)
+{
+    switch (feeder % 10) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+        return 1;
+    case 5:
+    case 6:
+        return 2;
+    case 7:
+        return PERMANENT_FAULT;
+    default:
+        return 0; // 无故障
+    }
+}
+
+// 一次系统的简化模型: 每段母线一台进线断路器和若干馈线断路器，馈线保护为定时限过流 (引擎中的保护段)
+struct SchemeScalePlant {
+    struct Breaker {
+        bool is_open = false;
+        bool stuck = false; // 跳闸拒动
+        uint32_t bus = 0;
+        uint32_t feeder = UINT32_MAX; // 进线断路器为 UINT32_MAX
+    };
+
+    cps_coro::Scheduler& scheduler;
+    ProtectionSchemeEngine* engine = nullptr;
+    std::vector<Entity> entities; // 断路器实体 (即下标 + 1)
+    std::vector<Breaker> breakers;
+    std::vector<uint32_t> incomer; // 各母线的进线断路器下标
+    std::vector<uint32_t> feeder_breaker;
+    std::vector<uint32_t> feeder_stage;
+    std::vector<uint32_t> fault_trips_left; // 故障消失前还需的跳闸次数，0为无故障
+    uint64_t stuck_commands = 0;
+
+    explicit SchemeScalePlant(cps_coro::Scheduler& s)
+        : scheduler(s)
+    {
+    }
+
+    bool feeder_energized(uint32_t feeder) const
+    {
+        const Breaker& b = breakers[feeder_breaker[feeder]];
+        return !b.is_open && !breakers[incomer[b.bus]].is_open;
+    }
+
+    // 断路器机构: 分闸20ms，合闸100ms，动作完成后通知引擎并更新故障与保护启动状态
+    cps_coro::Task operate(uint32_t index, LogicBreakerCommand::CommandType command)
+    {
+        Breaker& b = breakers[index];
+        const bool open = command == LogicBreakerCommand::CommandType::OPEN;
+        if (b.is_open == open)
+            co_return;
+        if (open && b.stuck) {
+            ++stuck_commands;
+            co_return;
+        }
+        co_await cps_coro::delay(std::chrono::milliseconds(open ? 20 : 100));
+        if (b.is_open == open)
+            co_return;
+        b.is_open = open;
+        engine->on_breaker_status(entities[index], open);
+
+        if (b.feeder != UINT32_MAX) {
+            uint32_t& left = fault_trips_left[b.feeder];
+            if (open && left != 0 && left != PERMANENT_FAULT)
+                --left;
+            else if (!open && left != 0 && feeder_energized(b.feeder))
+                engine->pickup(feeder_stage[b.feeder]); // 重合于故障
+        } else if (open) {
+            // 进线断路器分闸: 该母线全部馈线失电，保护返回
+            for (uint32_t f = b.bus * FEEDERS_PER_BUS; f < feeder_breaker.size() && f < (b.bus + 1) * FEEDERS_PER_BUS; ++f)
+                engine->reset(feeder_stage[f]);
+        }
+    }
+};
+
+} // namespace
+
+// 保护方案引擎的规模仿真: feeder_count 条馈线 (每16条一段母线，每段母线一台进线断路器) 在同一时刻发生故障。
+// 馈线断路器投两次重合闸 (0.3秒、3秒) 与失灵保护 (150ms，后备为本母线进线断路器)；每100条馈线中有1台断路器拒动。
+void test_protection_schemes(size_t feeder_count, double seconds)
+{
+    if (g_console_logger)
+        g_console_logger->info("--- 保护方案引擎仿真: {} 条馈线同时故障, {:.1f} 秒 ---", feeder_count, seconds);
+
+    cps_coro::Scheduler scheduler;
+    SchemeScalePlant plant(scheduler);
+    ProtectionSchemeEngine engine(scheduler, [&plant](Entity, Entity breaker, LogicBreakerCommand::CommandType command) {
+        plant.operate(static_cast<uint32_t>(breaker - 1), command).detach();
+    });
+    plant.engine = &engine;
+
+    const size_t bus_count = (feeder_count + FEEDERS_PER_BUS - 1) / FEEDERS_PER_BUS;
+    engine.reserve(feeder_count + bus_count, feeder_count);
+    auto add_plant_breaker = [&](uint32_t bus, uint32_t feeder) {
+        plant.entities.push_back(static_cast<Entity>(plant.breakers.size() + 1));
+        plant.breakers.push_back({ false, false, bus, feeder });
+        return static_cast<uint32_t>(plant.breakers.size() - 1);
+    };
+    for (uint32_t bus = 0; bus < bus_count; ++bus) {
+        plant.incomer.push_back(add_plant_breaker(bus, UINT32_MAX));
+        engine.add_breaker(plant.entities.back());
+    }
+    const RecloseSettings reclose { { 300, 3000 }, 5000 };
+    size_t faulted = 0, permanent = 0, stuck = 0;
+    for (uint32_t f = 0; f < feeder_count; ++f) {
+        const uint32_t bus = f / FEEDERS_PER_BUS;
+        const uint32_t index = add_plant_breaker(bus, f);
+        plant.breakers[index].stuck = f % 100 == 3;
+        stuck += plant.breakers[index].stuck;
+        plant.feeder_breaker.push_back(index);
+        plant.fault_trips_left.push_back(fault_trips_for(f));
+        faulted += plant.fault_trips_left.back() != 0;
+        permanent += plant.fault_trips_left.back() == PERMANENT_FAULT;
+        engine.add_breaker(plant.entities[index], reclose, { 150, { plant.entities[plant.incomer[bus]] } });
+        plant.feeder_stage.push_back(engine.add_stage({ plant.entities[index], plant.entities[index], 60, { plant.entities[index] } }));
+    }
+    engine.start();
+
+    // 0.1秒时全部故障馈线同时故障，各馈线保护启动
+    [](SchemeScalePlant& p) -> cps_coro::Task {
+        co_await cps_coro::delay(std::chrono::milliseconds(100));
+        for (uint32_t f = 0; f < p.feeder_stage.size(); ++f) {
+            if (p.fault_trips_left[f] != 0)
+                p.engine->pickup(p.feeder_stage[f]);
+        }
+    }(plant).detach();
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(static_cast<long long>(seconds * 1000.0)) });
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    size_t feeders_in_service = 0, buses_lost = 0;
+    for (uint32_t f = 0; f < feeder_count; ++f)
+        feeders_in_service += plant.feeder_energized(f);
+    for (uint32_t bus = 0; bus < bus_count; ++bus)
+        buses_lost += plant.breakers[plant.incomer[bus]].is_open;
+
+    if (g_console_logger) {
+        const auto& s = engine.stats();
+        g_console_logger->info("故障馈线 {} 条 (其中永久性故障 {} 条)，拒动断路器 {} 台。", faulted, permanent, stuck);
+        g_console_logger->info("保护段动作 {} 次、复归 {} 次；重合 {} 次，重合成功 {} 次，闭锁 {} 次；断路器失灵 {} 次 (拒动命令 {} 条)，失电母线 {} 段。",
+            s.stage_trips, s.stage_resets, s.recloses, s.reclose_successes, s.lockouts, s.breaker_failures, plant.stuck_commands,
+            buses_lost);
+        g_console_logger->info("定时器: 启动 {} 个，到期动作 {} 个，到期前取消 {} 个，同时计时峰值 {} 个；推进节拍 {} 个。",
+            s.timers_armed, s.timers_expired, s.timers_cancelled, s.max_armed, s.ticks);
+        g_console_logger->info("仿真结束时在运馈线 {}/{} 条。仿真实际物理执行耗时: {:.3f} 秒。", feeders_in_service, feeder_count,
+            real_time_elapsed_seconds.count());
+        long peak_mem_kb = get_peak_memory_usage_kb();
+        if (peak_mem_kb != -1)
+            g_console_logger->info("本次仿真峰值内存使用 (近似值): {} KB (约 {:.2f} MB)。", peak_mem_kb, peak_mem_kb / 1024.0);
+    }
+}
@@ -0,0 +1,196 @@
+// protection_scheme_engine.h
+// 保护方案引擎: 定时保护段 (如后备保护的动作延时)、断路器失灵保护 (50BF) 与自动重合闸 (79) 的通用实现。
+// - 保护段启动后计时，到期即向所控断路器发跳闸命令；故障在到期前被其他保护切除时由调用者复归该段，计时被取消，
+//   不再像逐装置协程那样睡眠到期后再检查线路是否仍带电；
+// - 每次跳闸命令都为该断路器启动失灵计时，断路器确认分闸即取消；到期仍未分闸则判为失灵，
+//   跳开其后备断路器 (同母线断路器、对侧断路器等) 并闭锁这些断路器的重合闸；
+// - 保护跳闸引起的分闸启动重合闸: 按各次重合的无电流间隔 (dead time) 重合，重合后进入复归时间 (reclaim)，
+//   复归时间内再次跳闸则进行下一次重合，次数用尽则闭锁，复归时间结束则重合成功并复位。
+// 全部定时器放在一个时间轮 (1ms节拍) 中，定时器项只含下标、类型和代数；取消只需增加对应代数 (O(1))，
+// 过期项在到期时被丢弃。整个引擎只有一个推进协程，且仅在有定时器计时中时才逐节拍推进，
+// 因此可在成千上万台断路器同时故障时使用。
+#ifndef PROTECTION_SCHEME_ENGINE_H
+#define PROTECTION_SCHEME_ENGINE_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "simulation_events_and_data.h"
+#include "timing_wheel.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// 自动重合闸定值。dead_times_ms 为空表示不投重合闸。
+struct RecloseSettings {
+    std::vector<uint32_t> dead_times_ms; // 各次重合的无电流间隔 (毫秒)，元素个数即重合次数
+    uint32_t reclaim_ms = 5000; // 复归时间 (毫秒): 重合后在此时间内未再跳闸即视为重合成功
+};
+
+// 断路器失灵保护定值。delay_ms 为0表示不投失灵保护。
+struct BreakerFailureSettings {
+    uint32_t delay_ms = 0; // 失灵判定时间 (毫秒): 跳闸命令发出后超过此时间仍未分闸即判为失灵
+    std::vector<Entity> backup_breakers; // 失灵时跳开的后备断路器
+};
+
+// 定时保护段定值
+struct ProtectionStageSettings {
+    Entity device = 0; // 所属保护装置 (用于调用者识别和通信通道选择)
+    Entity supervised_element = 0; // 所保护的元件 (线路等)，调用者据此判断故障是否已被切除
+    uint32_t delay_ms = 0; // 动作延时 (毫秒)
+    std::vector<Entity> trip_breakers; // 动作时跳开的断路器
+};
+
+enum class RecloseState : uint8_t {
+    READY, // 合位或未启动重合闸
+    DEAD_TIME, // 保护跳闸后等待重合
+    RECLAIM, // 已重合，复归时间计时中
+    LOCKOUT, // 重合次数用尽或被失灵保护闭锁，须手动合闸复位
+};
+
+// 引擎对外报告的动作 (用于日志与统计)
+struct ProtectionSchemeEvent {
+    enum class Kind : uint8_t {
+        STAGE_TRIP, // 保护段计时到期，发出跳闸命令 (index 为保护段序号)
+        STAGE_RESET, // 保护段在计时中被复归 (index 为保护段序号)
+        BREAKER_FAILURE, // 断路器失灵，跳开后备断路器
+        RECLOSE, // 发出重合命令 (shot 为第几次重合，从1开始)
+        RECLOSE_SUCCESS, // 复归时间结束，重合成功
+        LOCKOUT, // 重合闸闭锁
+    };
+    Kind kind;
+    Entity breaker = 0; // 断路器 (保护段事件为0)
+    uint32_t index = 0; // 保护段序号 (仅保护段事件)
+    uint32_t shot = 0;
+};
+
+struct ProtectionSchemeStats {
+    uint64_t timers_armed = 0; // 启动的定时器总数
+    uint64_t timers_cancelled = 0; // 到期前被取消的定时器
+    uint64_t timers_expired = 0; // 到期并动作的定时器
+    uint64_t ticks = 0; // 推进协程推进的节拍数
+    uint64_t stage_trips = 0;
+    uint64_t stage_resets = 0;
+    uint64_t breaker_failures = 0;
+    uint64_t recloses = 0;
+    uint64_t reclose_successes = 0;
+    uint64_t lockouts = 0;
+    size_t max_armed = 0; // 同时计时中的定时器数峰值
+};
+
+class ProtectionSchemeEngine {
+public:
+    // 引擎发出的断路器命令经 command_sink 交给调用者 (直接触发事件或经通信通道发送)。
+    // source 为发出命令的保护装置 (保护段跳闸)；失灵保护和重合闸发出的命令 source 为0。
+    using CommandSink = std::function<void(Entity source, Entity breaker, LogicBreakerCommand::CommandType command)>;
+    using EventObserver = std::function<void(const ProtectionSchemeEvent& event)>;
+
+    ProtectionSchemeEngine(cps_coro::Scheduler& scheduler, CommandSink command_sink, EventObserver observer = {});
+
+    // --- 配置 (须在 start() 之前) ---
+    void add_breaker(Entity breaker, const RecloseSettings& reclose = {}, const BreakerFailureSettings& failure = {},
+        bool is_open = false);
+    uint32_t add_stage(const ProtectionStageSettings& settings); // 返回保护段序号 (start() 之后也可调用，用于自适应保护新增的后备范围)
+    void reserve(size_t breakers, size_t stages);
+    // 修改保护段的动作延时 (定值组切换)，从下一次启动起生效，不影响正在进行的计时
+    void set_stage_delay(uint32_t stage, uint32_t delay_ms) { stages_[stage].delay_ms = delay_ms; }
+
+    // 启动推进协程。须在调度器运行前调用一次。
+    void start();
+
+    // --- 输入 ---
+    // 保护段启动 (检测到区内故障)。该段已在计时中时返回 false。
+    bool pickup(uint32_t stage);
+    // 保护段复归 (故障已被切除)。该段在计时中时取消计时并返回 true。
+    bool reset(uint32_t stage);
+    // 对全部计时中的保护段调用 is_cleared(supervised_element)，复归返回 true 的段，返回复归的段数。
+    // 开销只与计时中的段数有关。
+    template <typename Fn>
+    size_t reset_cleared_stages(Fn&& is_cleared)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < armed_stages_.size();) {
+            const uint32_t stage = armed_stages_[i];
+            if (is_cleared(stages_[stage].supervised_element) && reset(stage))
+                ++count; // reset 把末尾的段换到位置 i，不前进
+            else
+                ++i;
+        }
+        return count;
+    }
+    // 外部保护 (未由引擎计时的主保护等) 对断路器发出跳闸命令: 启动失灵计时并标记为保护跳闸
+    void trip(Entity breaker);
+    // 断路器位置变化 (由断路器模型在动作完成时调用)
+    void on_breaker_status(Entity breaker, bool is_open);
+
+    // --- 查询 ---
+    RecloseState reclose_state(Entity breaker) const;
+    bool is_stage_armed(uint32_t stage) const { return armed_pos_[stage] != NOT_ARMED; }
+    const ProtectionStageSettings& stage(uint32_t index) const { return stages_[index]; }
+    size_t stage_count() const { return stages_.size(); }
+    size_t breaker_count() const { return breakers_.size(); }
+    size_t armed_timers() const { return armed_; }
+    const ProtectionSchemeStats& stats() const { return stats_; }
+
+private:
+    static constexpr uint32_t NOT_ARMED = UINT32_MAX;
+
+    enum class TimerKind : uint8_t { STAGE,
+        BREAKER_FAILURE,
+        RECLOSE }; // RECLOSE 兼作无电流间隔与复归时间 (同一断路器两者不会同时计时)
+
+    // 时间轮中的定时器项: 代数与当前代数不一致表示已被取消
+    struct SchemeTimer {
+        uint32_t index;
+        uint32_t generation;
+        TimerKind kind;
+    };
+
+    // 断路器的方案状态 (按注册顺序的下标)
+    struct BreakerScheme {
+        Entity entity;
+        RecloseSettings reclose;
+        BreakerFailureSettings failure;
+        std::vector<uint32_t> backup_index; // failure.backup_breakers 中已注册断路器的下标
+        bool is_open;
+        bool trip_pending = false; // 已发出保护跳闸命令，尚未分闸
+        RecloseState state = RecloseState::READY;
+        uint32_t shots_used = 0;
+        uint32_t failure_generation = 0;
+        uint32_t reclose_generation = 0;
+        bool failure_armed = false;
+        bool reclose_armed = false;
+    };
+
+    void arm(TimerKind kind, uint32_t index, uint32_t generation, uint32_t delay_ms);
+    void disarm() { --armed_; }
+    void on_timer_expired(const SchemeTimer& timer);
+    void issue_trip(uint32_t breaker, Entity source);
+    void cancel_reclose(BreakerScheme& b);
+    void lockout(uint32_t breaker);
+    void notify(ProtectionSchemeEvent::Kind kind, Entity breaker, uint32_t index = 0, uint32_t shot = 0);
+
+    cps_coro::Scheduler& scheduler_;
+    CommandSink command_sink_;
+    EventObserver observer_;
+
+    std::vector<BreakerScheme> breakers_;
+    std::unordered_map<Entity, uint32_t> breaker_index_;
+
+    // 保护段 (SoA)
+    std::vector<ProtectionStageSettings> stages_;
+    std::vector<uint32_t> stage_generation_;
+    std::vector<uint32_t> armed_pos_; // 在 armed_stages_ 中的位置，NOT_ARMED 表示未计时
+    std::vector<uint32_t> armed_stages_; // 计时中的保护段
+
+    TimingWheel<SchemeTimer> wheel_;
+    size_t armed_ = 0; // 计时中 (未取消、未到期) 的定时器数
+    cps_coro::TickDispatcher ticker_; // 推进协程在没有计时中的定时器时挂起，有定时器启动时由 arm 恢复
+    cps_coro::Task dispatcher_;
+    ProtectionSchemeStats stats_;
+};
+
+#endif // PROTECTION_SCHEME_ENGINE_H
@@ -0,0 +1,606 @@
+// qsts_engine.cpp
+// 实现了辐射状馈线的前推回代潮流，以及按时间块并行、块边界状态交接的QSTS仿真。
+
+#include "qsts_engine.h"
+#include "columnar_writer.h"
+#include "counter_rng.h"
+#include "logging_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <queue>
+
+namespace {
+
+constexpr double SECONDS_PER_DAY = 86400.0;
+constexpr double PI = 3.141592653589793;
+constexpr double LOAD_Q_RATIO = 0.3; // 负荷无功/有功比 (功率因数约0.96)
+constexpr double CLOUD_SLOT_S = 300.0; // 云量时段长度 (秒)
+constexpr double NOISE_SLOT_S = 60.0; // 负荷波动时段长度 (秒)
+constexpr double HANDOFF_POWER_TOLERANCE_kW = 1e-3; // 块边界交接的功率量测容差
+
+// 居民负荷日曲线 (0点~23点，相对峰值)
+constexpr double LOAD_SHAPE[24] = { 0.42, 0.38, 0.36, 0.35, 0.36, 0.42, 0.55, 0.66, 0.68, 0.64, 0.62, 0.61,
+    0.60, 0.59, 0.60, 0.64, 0.72, 0.85, 0.96, 1.00, 0.95, 0.82, 0.66, 0.52 };
+
+int day_of_year(double t_s)
+{
+    return static_cast<int>(std::fmod(std::floor(t_s / SECONDS_PER_DAY), 365.0));
+}
+
+} // namespace
+
+// --- RadialFeeder ---
+
+bool RadialFeeder::build(const PowerSystemTopology& topology, BusId source_bus,
+    const std::unordered_map<BranchId, QstsBranchImpedance>& impedances, double base_kVA)
+{
+    bus_ids_.clear();
+    index_.clear();
+    parent_.clear();
+    r_pu_.clear();
+    x_pu_.clear();
+    base_kVA_ = base_kVA;
+
+    CsrTopology csr = topology.exportCsr();
+    auto source_it = std::find(csr.bus_ids.begin(), csr.bus_ids.end(), source_bus);
+    if (source_it == csr.bus_ids.end()) {
+        if (g_console_logger)
+            g_console_logger->error("[QSTS] 电源母线 {} 不在拓扑中。", source_bus);
+        return false;
+    }
+
+    // 自电源广度优先遍历，按访问顺序编号；遇到已访问的非父支路说明存在环路
+    const int n = static_cast<int>(csr.bus_ids.size());
+    std::vector<int> order_of(n, -1);
+    std::vector<BranchId> parent_branch;
+    std::queue<int> frontier;
+    const int source_idx = static_cast<int>(source_it - csr.bus_ids.begin());
+    order_of[source_idx] = 0;
+    frontier.push(source_idx);
+    bus_ids_.push_back(source_bus);
+    parent_.push_back(-1);
+    parent_branch.push_back(-1);
+    r_pu_.push_back(0.0);
+    x_pu_.push_back(0.0);
+
+    while (!frontier.empty()) {
+        const int u = frontier.front();
+        frontier.pop();
+        const int u_order = order_of[u];
+        for (int k = csr.row_offsets[u]; k < csr.row_offsets[u + 1]; ++k) {
+            const int v = csr.adj_bus_idx[k];
+            const BranchId branch = csr.adj_branch_ids[k];
+            if (branch == parent_branch[u_order])
+                continue;
+            if (order_of[v] >= 0) {
+                if (g_console_logger)
+                    g_console_logger->error("[QSTS] 支路 {} 构成环路，馈线不是辐射状。", branch);
+                return false;
+            }
+            auto imp = impedances.find(branch);
+            if (imp == impedances.end()) {
+                if (g_console_logger)
+                    g_console_logger->error("[QSTS] 支路 {} 缺少阻抗参数。", branch);
+                return false;
+            }
+            order_of[v] = static_cast<int>(bus_ids_.size());
+            bus_ids_.push_back(csr.bus_ids[v]);
+            parent_.push_back(u_order);
+            parent_branch.push_back(branch);
+            r_pu_.push_back(imp->second.r_pu);
+            x_pu_.push_back(imp->second.x_pu);
+            frontier.push(v);
+        }
+    }
+
+    for (int i = 0; i < bus_count(); ++i)
+        index_[bus_ids_[i]] = i;
+    return true;
+}
+
+int RadialFeeder::index_of(BusId bus) const
+{
+    auto it = index_.find(bus);
+    return it == index_.end() ? -1 : it->second;
+}
+
+// 前推回代: 由当前电压计算各母线注入电流并自末端向首端累加为支路电流 (回代)，
+// 再自首端向末端逐段扣除支路压降得到新电压 (前推)，直至电压的最大变化量小于容差。
+// 复数运算展开为实部/虚部，避免 std::complex 乘除法的非有限值检查开销。
+FeederSolution RadialFeeder::solve(const double* p_kW, const double* q_kvar, double source_voltage_pu,
+    double* v_re, double* v_im, double tolerance_pu, int max_iterations, Workspace& ws) const
+{
+    const int n = bus_count();
+    ws.i_re.resize(n);
+    ws.i_im.resize(n);
+    double* i_re = ws.i_re.data();
+    double* i_im = ws.i_im.data();
+    const int* parent = parent_.data();
+    const double* r = r_pu_.data();
+    const double* x = x_pu_.data();
+    const double inv_base = 1.0 / base_kVA_;
+
+    FeederSolution sol;
+    v_re[0] = source_voltage_pu;
+    v_im[0] = 0.0;
+    for (int it = 0; it < max_iterations; ++it) {
+        ++sol.iterations;
+        // 回代: I = conj(S / V)
+        for (int i = 0; i < n; ++i) {
+            const double p = p_kW[i] * inv_base;
+            const double q = q_kvar[i] * inv_base;
+            const double inv_mag2 = 1.0 / (v_re[i] * v_re[i] + v_im[i] * v_im[i]);
+            i_re[i] = (p * v_re[i] + q * v_im[i]) * inv_mag2;
+            i_im[i] = (p * v_im[i] - q * v_re[i]) * inv_mag2;
+        }
+        for (int i = n - 1; i > 0; --i) {
+            i_re[parent[i]] += i_re[i];
+            i_im[parent[i]] += i_im[i];
+        }
+
+        // 前推: V = V_parent - Z · I
+        double max_dv = 0.0;
+        for (int i = 1; i < n; ++i) {
+            const int pi = parent[i];
+            const double nr = v_re[pi] - (r[i] * i_re[i] - x[i] * i_im[i]);
+            const double ni = v_im[pi] - (r[i] * i_im[i] + x[i] * i_re[i]);
+            max_dv = std::max(max_dv, std::max(std::abs(nr - v_re[i]), std::abs(ni - v_im[i])));
+            v_re[i] = nr;
+            v_im[i] = ni;
+        }
+        if (max_dv < tolerance_pu) {
+            sol.converged = true;
+            break;
+        }
+    }
+
+    // 首端功率 S = V0 · conj(I0)，线路损耗 Σ r|I|²，电压幅值范围
+    sol.head_kW = source_voltage_pu * i_re[0] * base_kVA_;
+    sol.head_kvar = -source_voltage_pu * i_im[0] * base_kVA_;
+    double losses = 0.0;
+    double min_mag2 = std::numeric_limits<double>::max();
+    double max_mag2 = 0.0;
+    for (int i = 0; i < n; ++i) {
+        losses += r[i] * (i_re[i] * i_re[i] + i_im[i] * i_im[i]);
+        const double mag2 = v_re[i] * v_re[i] + v_im[i] * v_im[i];
+        min_mag2 = std::min(min_mag2, mag2);
+        max_mag2 = std::max(max_mag2, mag2);
+    }
+    sol.losses_kW = losses * base_kVA_;
+    sol.min_voltage_pu = std::sqrt(min_mag2);
+    sol.max_voltage_pu = std::sqrt(max_mag2);
+    return sol;
+}
+
+// --- QstsEngine ---
+
+// 一个时间块的计算结果
+struct QstsEngine::ChunkResult {
+    QstsSummary summary;
+    QstsState start_state; // 本块计算时使用的起始状态
+    QstsState end_state; // 本块结束时的状态
+};
+
+// 一段连续仿真的工作状态 (曲线缓存、潮流工作区、输出文件)
+struct QstsEngine::Span {
+    double end_s = 0.0;
+    QstsState* state = nullptr;
+    ChunkResult* result = nullptr;
+
+    std::vector<double> p_kW, q_kvar;
+    RadialFeeder::Workspace ws;
+    double total_pv_kW = 0.0;
+
+    // 随机曲线按时段缓存: 当前时段及下一时段端点的取值 (时段内线性插值)
+    long long cloud_slot = -1;
+    double cloud_a = 1.0, cloud_b = 1.0;
+    long long noise_slot = -1;
+    double noise_a = 0.0, noise_b = 0.0;
+    // EV会话窗口: 前一天与当天 (跨零点的会话在次日仍在充电)
+    long long ev_day = std::numeric_limits<long long>::min();
+    std::vector<double> ev_start_prev, ev_end_prev, ev_start, ev_end;
+
+    ColumnarWriter summary_out;
+    ColumnarWriter voltage_out;
+    uint64_t step_index = 0;
+    uint64_t voltage_every = 1;
+    std::vector<float> voltage_row;
+};
+
+QstsEngine::QstsEngine(const RadialFeeder& feeder, ParallelExecutor& executor, QstsSettings settings)
+    : feeder_(feeder)
+    , executor_(executor)
+    , settings_(std::move(settings))
+    , load_kW_(feeder.bus_count(), 0.0)
+    , pv_kW_(feeder.bus_count(), 0.0)
+    , ev_kW_(feeder.bus_count(), 0.0)
+{
+}
+
+void QstsEngine::set_bus(BusId bus, double load_kW, double pv_kW, double ev_charger_kW)
+{
+    const int idx = feeder_.index_of(bus);
+    if (idx < 0) {
+        if (g_console_logger)
+            g_console_logger->error("[QSTS] 母线 {} 不在馈线上。", bus);
+        return;
+    }
+    load_kW_[idx] = load_kW;
+    pv_kW_[idx] = pv_kW;
+    ev_kW_[idx] = ev_charger_kW;
+}
+
+void QstsEngine::add_ess(BusId bus, double power_kW, double energy_kWh, double initial_soc)
+{
+    const int idx = feeder_.index_of(bus);
+    if (idx < 0) {
+        if (g_console_logger)
+            g_console_logger->error("[QSTS] 储能所在母线 {} 不在馈线上。", bus);
+        return;
+    }
+    ess_bus_.push_back(idx);
+    ess_power_kW_.push_back(power_kW);
+    ess_energy_kWh_.push_back(energy_kWh);
+    ess_initial_soc_.push_back(initial_soc);
+}
+
+void QstsEngine::set_regulation_bus(BusId bus)
+{
+    const int idx = feeder_.index_of(bus);
+    if (idx >= 0)
+        regulation_bus_ = idx;
+}
+
+QstsState QstsEngine::initial_state() const
+{
+    QstsState state;
+    state.head_kW = std::numeric_limits<double>::quiet_NaN(); // 尚无量测，储能第一步不动作
+    state.ess_soc = ess_initial_soc_;
+    state.v_re.assign(feeder_.bus_count(), 1.0);
+    state.v_im.assign(feeder_.bus_count(), 0.0);
+    return state;
+}
+
+bool QstsEngine::states_match(const QstsState& a, const QstsState& b) const
+{
+    if (a.tap != b.tap || std::abs(a.tap_timer_s - b.tap_timer_s) > 1e-9)
+        return false;
+    if (std::isnan(a.head_kW) != std::isnan(b.head_kW))
+        return false;
+    if (!std::isnan(a.head_kW) && std::abs(a.head_kW - b.head_kW) > HANDOFF_POWER_TOLERANCE_kW)
+        return false;
+    if (std::abs(a.ess_kW - b.ess_kW) > HANDOFF_POWER_TOLERANCE_kW)
+        return false;
+    for (size_t k = 0; k < a.ess_soc.size(); ++k) {
+        if (std::abs(a.ess_soc[k] - b.ess_soc[k]) > settings_.handoff_soc_tolerance)
+            return false;
+    }
+    return true; // 电压只作潮流初值，不影响收敛后的结果，无须一致
+}
+
+void QstsEngine::run_span(double begin_s, double end_s, QstsState& state, size_t chunk, ChunkResult* result) const
+{
+    if (end_s <= begin_s)
+        return;
+    const int n = feeder_.bus_count();
+    Span span;
+    span.end_s = end_s;
+    span.state = &state;
+    span.result = result;
+    span.p_kW.resize(n);
+    span.q_kvar.resize(n);
+    for (double pv : pv_kW_)
+        span.total_pv_kW += pv;
+
+    if (result) {
+        result->summary = QstsSummary {};
+        result->summary.min_voltage_pu = std::numeric_limits<double>::max();
+        if (!settings_.output_dir.empty()) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "qsts_summary_%04zu.col", chunk);
+            span.summary_out.open((std::filesystem::path(settings_.output_dir) / name).string(),
+                { "head_kW", "head_kvar", "losses_kW", "v_min_pu", "v_max_pu", "v_reg_pu", "tap", "pv_kW", "ev_kW", "ess_kW", "ess_soc",
+                    "iterations" },
+                begin_s, settings_.step_s);
+
+            std::vector<std::string> columns;
+            for (int i = 0; i < n; ++i)
+                columns.push_back("V_" + std::to_string(feeder_.bus_id(i)));
+            std::snprintf(name, sizeof(name), "qsts_voltage_%04zu.col", chunk);
+            span.voltage_out.open((std::filesystem::path(settings_.output_dir) / name).string(), columns, begin_s,
+                settings_.voltage_log_interval_s, 1024);
+            span.voltage_every = std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(settings_.voltage_log_interval_s / settings_.step_s)));
+            span.voltage_row.resize(n);
+        }
+    }
+
+    // 每个时间块使用各自的调度器 (调度器是线程局部的)，以仿真步长为周期推进。
+    // 块也可能在调用线程上执行，守卫在局部调度器析构后恢复调用线程原先的活动调度器。
+    cps_coro::ActiveSchedulerGuard restore_active_scheduler;
+    cps_coro::Scheduler scheduler;
+    scheduler.set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(std::llround(begin_s * 1000.0)) });
+    cps_coro::Task task = span_task(span, scheduler);
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(std::llround(end_s * 1000.0)) });
+
+    if (result) {
+        span.summary_out.close();
+        span.voltage_out.close();
+        result->summary.bytes_written = span.summary_out.bytes_written() + span.voltage_out.bytes_written();
+    }
+}
+
+cps_coro::Task QstsEngine::span_task(Span& span, cps_coro::Scheduler& scheduler) const
+{
+    const QstsSettings& s = settings_;
+    const double dt = s.step_s;
+    const int n = feeder_.bus_count();
+    QstsState& state = *span.state;
+    const auto step = cps_coro::Scheduler::duration(std::llround(dt * 1000.0));
+
+    while (true) {
+        const double t = scheduler.now().time_since_epoch().count() / 1000.0;
+        const int doy = day_of_year(t);
+        const double hour = std::fmod(t, SECONDS_PER_DAY) / 3600.0;
+
+        // 1. 负荷系数: 日曲线 × 季节系数 × 分钟级波动
+        const long long noise_slot = static_cast<long long>(std::floor(t / NOISE_SLOT_S));
+        if (noise_slot != span.noise_slot) {
+            span.noise_slot = noise_slot;
+            span.noise_a = CounterRng(s.seed, 0, RngStream::QSTS_LOAD_NOISE, static_cast<uint32_t>(noise_slot)).normal();
+            span.noise_b = CounterRng(s.seed, 0, RngStream::QSTS_LOAD_NOISE, static_cast<uint32_t>(noise_slot + 1)).normal();
+        }
+        const int h0 = static_cast<int>(hour);
+        const double hf = hour - h0;
+        const double shape = LOAD_SHAPE[h0] + (LOAD_SHAPE[(h0 + 1) % 24] - LOAD_SHAPE[h0]) * hf;
+        const double season = 1.0 + 0.12 * std::cos(4.0 * PI * (doy - 20) / 365.0); // 冬夏双峰
+        const double nf = (t - noise_slot * NOISE_SLOT_S) / NOISE_SLOT_S;
+        const double load_factor = shape * season * (1.0 + 0.02 * (span.noise_a + (span.noise_b - span.noise_a) * nf));
+
+        // 2. 光伏系数: 晴空曲线 × 云量 (每5分钟一个随机时段，时段间线性过渡)
+        double pv_factor = 0.0;
+        const double day_length_h = 12.0 + 3.0 * std::sin(2.0 * PI * (doy - 80) / 365.0);
+        const double sunrise_h = 12.5 - 0.5 * day_length_h;
+        if (hour > sunrise_h && hour < sunrise_h + day_length_h) {
+            const long long cloud_slot = static_cast<long long>(std::floor(t / CLOUD_SLOT_S));
+            if (cloud_slot != span.cloud_slot) {
+                auto cloud_at = [&](long long slot) {
+                    CounterRng rng(s.seed, 0, RngStream::QSTS_CLOUD, static_cast<uint32_t>(slot));
+                    return rng.uniform() < 0.6 ? 1.0 : rng.uniform(0.2, 0.9);
+                };
+                span.cloud_slot = cloud_slot;
+                span.cloud_a = cloud_at(cloud_slot);
+                span.cloud_b = cloud_at(cloud_slot + 1);
+            }
+            const double cf = (t - span.cloud_slot * CLOUD_SLOT_S) / CLOUD_SLOT_S;
+            const double clear = std::sin(PI * (hour - sunrise_h) / day_length_h);
+            const double peak = 0.8 + 0.15 * std::sin(2.0 * PI * (doy - 80) / 365.0);
+            pv_factor = peak * clear * (span.cloud_a + (span.cloud_b - span.cloud_a) * cf);
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const double load = load_kW_[i] * load_factor;
+            span.p_kW[i] = load - pv_kW_[i] * pv_factor;
+            span.q_kvar[i] = LOAD_Q_RATIO * load;
+        }
+
+        // 3. EV充电: 每个母线每天至多一次会话，由 (种子, 母线, 日序号) 决定
+        const long long day = static_cast<long long>(std::floor(t / SECONDS_PER_DAY));
+        if (day != span.ev_day) {
+            auto draw = [&](long long d, std::vector<double>& start, std::vector<double>& end) {
+                start.assign(ev_buses_.size(), 0.0);
+                end.assign(ev_buses_.size(), 0.0);
+                for (size_t k = 0; k < ev_buses_.size(); ++k) {
+                    const int b = ev_buses_[k];
+                    CounterRng rng(s.seed, static_cast<uint64_t>(feeder_.bus_id(b)), RngStream::QSTS_EV_SESSION, static_cast<uint32_t>(d));
+                    if (rng.uniform() > 0.8)
+                        continue; // 当天不充电
+                    const double arrival_h = std::clamp(17.5 + 1.5 * rng.normal(), 14.0, 23.5);
+                    const double energy_kWh = std::exp(2.3 + 0.5 * rng.normal());
+                    const double duration_h = std::min(energy_kWh / ev_kW_[b], 12.0);
+                    start[k] = d * SECONDS_PER_DAY + arrival_h * 3600.0;
+                    end[k] = start[k] + duration_h * 3600.0;
+                }
+            };
+            if (day == span.ev_day + 1) {
+                span.ev_start_prev.swap(span.ev_start);
+                span.ev_end_prev.swap(span.ev_end);
+            } else {
+                draw(day - 1, span.ev_start_prev, span.ev_end_prev);
+            }
+            draw(day, span.ev_start, span.ev_end);
+            span.ev_day = day;
+        }
+        double ev_total_kW = 0.0;
+        for (size_t k = 0; k < ev_buses_.size(); ++k) {
+            if ((t >= span.ev_start[k] && t < span.ev_end[k]) || (t >= span.ev_start_prev[k] && t < span.ev_end_prev[k])) {
+                const int b = ev_buses_[k];
+                span.p_kW[b] += ev_kW_[b];
+                ev_total_kW += ev_kW_[b];
+            }
+        }
+
+        // 4. 储能削峰填谷: 以上一步的首端功率加回储能出力估计不含储能的净负荷
+        double ess_total_kW = 0.0;
+        if (!std::isnan(state.head_kW) && !ess_bus_.empty()) {
+            const double net_kW = state.head_kW + state.ess_kW;
+            double desired_kW = 0.0;
+            if (s.ess_discharge_above_kW > 0.0 && net_kW > s.ess_discharge_above_kW)
+                desired_kW = net_kW - s.ess_discharge_above_kW;
+            else if (net_kW < s.ess_charge_below_kW)
+                desired_kW = net_kW - s.ess_charge_below_kW;
+            if (desired_kW != 0.0) {
+                const bool discharge = desired_kW > 0.0;
+                double available_kW = 0.0;
+                for (size_t k = 0; k < ess_bus_.size(); ++k) {
+                    const double headroom = discharge ? state.ess_soc[k] - s.ess_soc_min : s.ess_soc_max - state.ess_soc[k];
+                    available_kW += std::clamp(headroom * ess_energy_kWh_[k] * 3600.0 / dt, 0.0, ess_power_kW_[k]);
+                }
+                const double scale = available_kW > 0.0 ? std::min(1.0, std::abs(desired_kW) / available_kW) : 0.0;
+                for (size_t k = 0; k < ess_bus_.size(); ++k) {
+                    const double headroom = discharge ? state.ess_soc[k] - s.ess_soc_min : s.ess_soc_max - state.ess_soc[k];
+                    double p = std::clamp(headroom * ess_energy_kWh_[k] * 3600.0 / dt, 0.0, ess_power_kW_[k]) * scale;
+                    if (!discharge)
+                        p = -p;
+                    state.ess_soc[k] -= p * dt / 3600.0 / ess_energy_kWh_[k];
+                    span.p_kW[ess_bus_[k]] -= p;
+                    ess_total_kW += p;
+                }
+            }
+        }
+        state.ess_kW = ess_total_kW;
+
+        // 5. 潮流 (以上一步电压为初值)
+        const double source_v = 1.0 + state.tap * s.tap_step_pu;
+        FeederSolution sol = feeder_.solve(span.p_kW.data(), span.q_kvar.data(), source_v, state.v_re.data(), state.v_im.data(),
+            s.tolerance_pu, s.max_iterations, span.ws);
+        state.head_kW = sol.head_kW;
+
+        // 6. 有载调压: 调节母线电压越出死区并持续达到延时后调整一档
+        const double v_reg = std::hypot(state.v_re[regulation_bus_], state.v_im[regulation_bus_]);
+        bool tap_changed = false;
+        if (std::abs(v_reg - s.regulator_target_pu) > s.regulator_band_pu) {
+            state.tap_timer_s += dt;
+            if (state.tap_timer_s >= s.regulator_delay_s) {
+                const int new_tap = std::clamp(state.tap + (v_reg < s.regulator_target_pu ? 1 : -1), -s.max_tap, s.max_tap);
+                tap_changed = new_tap != state.tap;
+                state.tap = new_tap;
+                state.tap_timer_s = 0.0;
+            }
+        } else {
+            state.tap_timer_s = 0.0;
+        }
+
+        // 7. 统计与输出
+        if (span.result) {
+            QstsSummary& sum = span.result->summary;
+            ++sum.steps;
+            sum.iterations += sol.iterations;
+            sum.max_iterations = std::max(sum.max_iterations, sol.iterations);
+            if (!sol.converged)
+                ++sum.unconverged_steps;
+            sum.min_voltage_pu = std::min(sum.min_voltage_pu, sol.min_voltage_pu);
+            sum.max_voltage_pu = std::max(sum.max_voltage_pu, sol.max_voltage_pu);
+            sum.energy_MWh += sol.head_kW * dt / 3.6e6;
+            sum.losses_MWh += sol.losses_kW * dt / 3.6e6;
+            sum.pv_MWh += span.total_pv_kW * pv_factor * dt / 3.6e6;
+            sum.ev_MWh += ev_total_kW * dt / 3.6e6;
+            sum.peak_head_kW = std::max(sum.peak_head_kW, sol.head_kW);
+            if (tap_changed)
+                ++sum.tap_changes;
+
+            if (span.summary_out.is_open()) {
+                double soc_sum = 0.0;
+                for (double soc : state.ess_soc)
+                    soc_sum += soc;
+                const float row[] = { static_cast<float>(sol.head_kW), static_cast<float>(sol.head_kvar), static_cast<float>(sol.losses_kW),
+                    static_cast<float>(sol.min_voltage_pu), static_cast<float>(sol.max_voltage_pu), static_cast<float>(v_reg),
+                    static_cast<float>(state.tap), static_cast<float>(span.total_pv_kW * pv_factor), static_cast<float>(ev_total_kW),
+                    static_cast<float>(ess_total_kW), static_cast<float>(state.ess_soc.empty() ? 0.0 : soc_sum / state.ess_soc.size()),
+                    static_cast<float>(sol.iterations) };
+                span.summary_out.append_row(row);
+            }
+            if (span.voltage_out.is_open() && span.step_index % span.voltage_every == 0) {
+                for (int i = 0; i < n; ++i)
+                    span.voltage_row[i] = static_cast<float>(std::hypot(state.v_re[i], state.v_im[i]));
+                span.voltage_out.append_row(span.voltage_row.data());
+            }
+        }
+        ++span.step_index;
+
+        co_await cps_coro::delay(step);
+    }
+}
+
+QstsSummary QstsEngine::run(double start_s, double duration_s)
+{
+    auto wall_start = std::chrono::steady_clock::now();
+    ev_buses_.clear();
+    for (int i = 0; i < feeder_.bus_count(); ++i) {
+        if (ev_kW_[i] > 0.0)
+            ev_buses_.push_back(i);
+    }
+    if (!settings_.output_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(settings_.output_dir, ec);
+        if (ec && g_console_logger)
+            g_console_logger->error("[QSTS] 无法创建输出目录 {}: {}", settings_.output_dir, ec.message());
+        // 删除上一次运行留下的块文件，避免块数不同时混入旧结果
+        for (const auto& entry : std::filesystem::directory_iterator(settings_.output_dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if ((name.rfind("qsts_summary_", 0) == 0 || name.rfind("qsts_voltage_", 0) == 0) && entry.path().extension() == ".col")
+                std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    const double end_s = start_s + duration_s;
+    const size_t chunks = std::max<size_t>(1, static_cast<size_t>(std::ceil(duration_s / settings_.chunk_s - 1e-9)));
+    auto chunk_begin = [&](size_t c) { return start_s + c * settings_.chunk_s; };
+    auto chunk_end = [&](size_t c) { return std::min(end_s, start_s + (c + 1) * settings_.chunk_s); };
+    std::vector<ChunkResult> results(chunks);
+
+    // 第1轮: 各块并行计算，块起点状态由预热时段估计 (第一块使用真实初始状态)
+    executor_.parallel_for(chunks, 1, [&](size_t c, size_t, size_t) {
+        QstsState state = initial_state();
+        if (c > 0)
+            run_span(std::max(start_s, chunk_begin(c) - settings_.warmup_s), chunk_begin(c), state, c, nullptr);
+        results[c].start_state = state;
+        run_span(chunk_begin(c), chunk_end(c), state, c, &results[c]);
+        results[c].end_state = std::move(state);
+    });
+    size_t chunk_runs = chunks;
+    int passes = 1;
+
+    // 后续各轮: 起始状态与前一块结束状态不一致的块，以前一块的结束状态重算 (可并行)，直至全部边界一致
+    while (true) {
+        std::vector<size_t> rerun;
+        std::vector<QstsState> starts;
+        for (size_t c = 1; c < chunks; ++c) {
+            if (!states_match(results[c].start_state, results[c - 1].end_state)) {
+                rerun.push_back(c);
+                starts.push_back(results[c - 1].end_state);
+            }
+        }
+        if (rerun.empty())
+            break;
+        executor_.parallel_for(rerun.size(), 1, [&](size_t k, size_t, size_t) {
+            const size_t c = rerun[k];
+            QstsState state = starts[k];
+            results[c].start_state = state;
+            run_span(chunk_begin(c), chunk_end(c), state, c, &results[c]);
+            results[c].end_state = std::move(state);
+        });
+        chunk_runs += rerun.size();
+        ++passes;
+    }
+
+    // 按块序号合并结果
+    QstsSummary total;
+    total.min_voltage_pu = std::numeric_limits<double>::max();
+    for (const auto& r : results) {
+        const QstsSummary& s = r.summary;
+        total.steps += s.steps;
+        total.iterations += s.iterations;
+        total.max_iterations = std::max(total.max_iterations, s.max_iterations);
+        total.unconverged_steps += s.unconverged_steps;
+        total.min_voltage_pu = std::min(total.min_voltage_pu, s.min_voltage_pu);
+        total.max_voltage_pu = std::max(total.max_voltage_pu, s.max_voltage_pu);
+        total.energy_MWh += s.energy_MWh;
+        total.losses_MWh += s.losses_MWh;
+        total.pv_MWh += s.pv_MWh;
+        total.ev_MWh += s.ev_MWh;
+        total.peak_head_kW = std::max(total.peak_head_kW, s.peak_head_kW);
+        total.tap_changes += s.tap_changes;
+        total.bytes_written += s.bytes_written;
+    }
+    total.chunks = chunks;
+    total.chunk_runs = chunk_runs;
+    total.handoff_passes = passes;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - wall_start;
+    total.elapsed_s = elapsed.count();
+    return total;
+}
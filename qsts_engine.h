@@ -0,0 +1,171 @@
+// qsts_engine.h
+// 准稳态时间序列 (Quasi-Static Time-Series, QSTS) 仿真引擎。
+// 用于配电馈线上分布式光伏、EV充电和储能的长时段 (数天至全年，1秒至1小时分辨率) 运行研究：
+// - 调度器以大步长 (仿真步长) 推进，每步更新负荷/光伏/EV曲线、储能与有载调压的控制状态，
+//   再以上一步的电压为初值做一次辐射状潮流 (前推回代)，电压变化很小时通常一次迭代即收敛；
+// - 仿真时段被划分为相互独立的时间块并行计算。每块先从块起点之前的预热时段开始运行 (预热结果不输出)，
+//   以此估计块起点的状态；所有块完成后检查相邻块边界上的状态交接 (储能SOC、分接头位置与计时等)，
+//   与前一块的结束状态不一致的块以正确的起始状态重新计算，直至全部边界一致；
+// - 结果以列存储文件流式输出 (每块一个文件)：逐步的馈线汇总量，以及按较长间隔抽样的各母线电压。
+#ifndef QSTS_ENGINE_H
+#define QSTS_ENGINE_H
+
+#include "PowerSystemTopology.h"
+#include "cps_coro_lib.h"
+#include "parallel_for.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 支路阻抗 (标幺值)
+struct QstsBranchImpedance {
+    double r_pu;
+    double x_pu;
+};
+
+// 一次潮流计算的结果摘要
+struct FeederSolution {
+    int iterations = 0;
+    bool converged = false;
+    double head_kW = 0.0; // 馈线首端注入有功 (kW)
+    double head_kvar = 0.0; // 馈线首端注入无功 (kvar)
+    double losses_kW = 0.0; // 线路有功损耗 (kW)
+    double min_voltage_pu = 0.0;
+    double max_voltage_pu = 0.0;
+};
+
+// 辐射状馈线模型与前推回代潮流求解器。
+// 母线按自电源起的广度优先顺序重新编号，每条母线 (电源母线除外) 的父母线序号小于自身，
+// 支路阻抗按子母线存放，因此回代和前推都是对连续数组的一次顺序遍历。
+class RadialFeeder {
+public:
+    // 求解器工作区 (支路电流)。并行计算时每个线程使用各自的工作区。
+    struct Workspace {
+        std::vector<double> i_re, i_im;
+    };
+
+    // 由拓扑构建馈线。source_bus 为电源 (变电站) 母线；impedances 给出每条支路的阻抗。
+    // 电源所在电气岛若不是辐射状或缺少支路阻抗，返回 false。
+    bool build(const PowerSystemTopology& topology, BusId source_bus,
+        const std::unordered_map<BranchId, QstsBranchImpedance>& impedances, double base_kVA);
+
+    int bus_count() const { return static_cast<int>(bus_ids_.size()); }
+    int index_of(BusId bus) const; // 不在馈线上时返回 -1
+    BusId bus_id(int index) const { return bus_ids_[index]; }
+    double base_kVA() const { return base_kVA_; }
+
+    // 前推回代潮流。p_kW / q_kvar 为各母线负荷 (消耗为正)，v_re / v_im 输入为初值、输出为结果。
+    FeederSolution solve(const double* p_kW, const double* q_kvar, double source_voltage_pu,
+        double* v_re, double* v_im, double tolerance_pu, int max_iterations, Workspace& ws) const;
+
+private:
+    std::vector<BusId> bus_ids_; // 馈线序号 -> 母线ID
+    std::unordered_map<BusId, int> index_;
+    std::vector<int> parent_; // 父母线序号 (电源母线为 -1)
+    std::vector<double> r_pu_; // 连接父母线的支路电阻
+    std::vector<double> x_pu_; // 连接父母线的支路电抗
+    double base_kVA_ = 1000.0;
+};
+
+// QSTS仿真配置
+struct QstsSettings {
+    uint64_t seed = 1; // 光伏云量、EV会话等随机量的种子
+    double step_s = 1.0; // 仿真步长 (秒)
+    double chunk_s = 86400.0; // 并行时间块长度 (秒)
+    double warmup_s = 6.0 * 3600.0; // 每块的预热时长 (秒)，用于估计块起点状态
+    double tolerance_pu = 1e-5; // 潮流收敛容差 (标幺值)
+    int max_iterations = 30; // 潮流最大迭代次数
+    double handoff_soc_tolerance = 1e-6; // 块边界状态交接的SOC容差
+    double voltage_log_interval_s = 3600.0; // 各母线电压的抽样输出间隔 (秒)
+    std::string output_dir = "qsts_output"; // 列存储输出目录 (为空则不输出)
+
+    // 有载调压变压器 (OLTC)，调节指定母线电压
+    double regulator_target_pu = 1.0;
+    double regulator_band_pu = 0.0125; // 半带宽
+    double regulator_delay_s = 30.0; // 越限持续时间达到该值才动作
+    double tap_step_pu = 0.00625;
+    int max_tap = 16;
+
+    // 储能削峰填谷: 首端功率高于上阈值时放电，低于下阈值时充电
+    double ess_discharge_above_kW = 0.0;
+    double ess_charge_below_kW = 0.0;
+    double ess_soc_min = 0.1;
+    double ess_soc_max = 0.95;
+};
+
+// 块边界交接的状态
+struct QstsState {
+    int tap = 0; // 分接头位置
+    double tap_timer_s = 0.0; // 越限计时
+    double head_kW = 0.0; // 上一步的首端功率 (储能控制的量测输入)
+    double ess_kW = 0.0; // 上一步的储能总出力 (放电为正)
+    std::vector<double> ess_soc;
+    std::vector<double> v_re, v_im; // 上一步的电压 (潮流初值)
+};
+
+// 仿真结果汇总
+struct QstsSummary {
+    uint64_t steps = 0;
+    uint64_t iterations = 0;
+    int max_iterations = 0;
+    uint64_t unconverged_steps = 0;
+    double min_voltage_pu = 0.0;
+    double max_voltage_pu = 0.0;
+    double energy_MWh = 0.0; // 首端供电量
+    double losses_MWh = 0.0;
+    double pv_MWh = 0.0;
+    double ev_MWh = 0.0;
+    double peak_head_kW = 0.0;
+    uint64_t tap_changes = 0;
+    size_t chunks = 0;
+    size_t chunk_runs = 0; // 块计算次数 (含状态交接不一致后的重算)
+    int handoff_passes = 0;
+    size_t bytes_written = 0;
+    double elapsed_s = 0.0; // 物理耗时
+};
+
+class QstsEngine {
+public:
+    QstsEngine(const RadialFeeder& feeder, ParallelExecutor& executor, QstsSettings settings);
+
+    // 设置母线上的负荷与分布式资源: 基准负荷 (kW)、光伏容量 (kW)、EV充电桩功率 (kW，0表示无)
+    void set_bus(BusId bus, double load_kW, double pv_kW, double ev_charger_kW);
+    // 在母线上添加储能
+    void add_ess(BusId bus, double power_kW, double energy_kWh, double initial_soc);
+    // 有载调压变压器调节的母线 (默认为电源母线)
+    void set_regulation_bus(BusId bus);
+
+    // 仿真 [start_s, start_s + duration_s)
+    QstsSummary run(double start_s, double duration_s);
+
+private:
+    struct ChunkResult;
+    struct Span;
+
+    QstsState initial_state() const;
+    // 在 [begin_s, end_s) 上推进状态；result 非空时输出到第 chunk 块的文件并统计结果
+    void run_span(double begin_s, double end_s, QstsState& state, size_t chunk, ChunkResult* result) const;
+    // 协程任务: 每个仿真步长唤醒一次，推进一步
+    cps_coro::Task span_task(Span& span, cps_coro::Scheduler& scheduler) const;
+    bool states_match(const QstsState& a, const QstsState& b) const;
+
+    const RadialFeeder& feeder_;
+    ParallelExecutor& executor_;
+    QstsSettings settings_;
+
+    // 母线数据 (按馈线序号)
+    std::vector<double> load_kW_;
+    std::vector<double> pv_kW_;
+    std::vector<double> ev_kW_;
+    std::vector<int> ev_buses_; // 有EV充电桩的母线序号
+    // 储能 (SoA)
+    std::vector<int> ess_bus_;
+    std::vector<double> ess_power_kW_;
+    std::vector<double> ess_energy_kWh_;
+    std::vector<double> ess_initial_soc_;
+    int regulation_bus_ = 0;
+};
+
+#endif // QSTS_ENGINE_H
@@ -0,0 +1,265 @@
+// scenario_image.cpp
+// 实现了场景镜像的编译 (写出) 与映射加载。
+#include "scenario_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ADN_SCENARIO_IMAGE_MMAP 1
+#endif
+
+namespace {
+
+// 各段按缓存行对齐
+constexpr uint64_t SECTION_ALIGNMENT = 64;
+constexpr char SCENARIO_IMAGE_MAGIC[8] = { 'A', 'D', 'N', 'S', 'C', 'N', '\0', '\0' };
+
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+// --- ScenarioImageBuilder ---
+
+uint32_t ScenarioImageBuilder::add_name(std::string_view name)
+{
+    name_blob_.append(name.data(), name.size());
+    name_offsets_.push_back(static_cast<uint32_t>(name_blob_.size()));
+    return static_cast<uint32_t>(name_offsets_.size() - 2);
+}
+
+void ScenarioImageBuilder::add_device(const ScenarioDeviceRecord& config, const ScenarioStateRecord& state)
+{
+    devices_.push_back(config);
+    states_.push_back(state);
+    if (config.entity > max_entity_id_)
+        max_entity_id_ = config.entity;
+}
+
+void ScenarioImageBuilder::add_task(const ScenarioTaskRecord& task)
+{
+    tasks_.push_back(task);
+    if (task.entity > max_entity_id_)
+        max_entity_id_ = task.entity;
+}
+
+size_t ScenarioImageBuilder::write(const std::string& path) const
+{
+    ScenarioImageHeader header {};
+    std::memcpy(header.magic, SCENARIO_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = SCENARIO_IMAGE_VERSION;
+    header.byte_order_mark = SCENARIO_IMAGE_BYTE_ORDER_MARK;
+    header.initial_time_ms = initial_time_ms_;
+    header.max_entity_id = max_entity_id_;
+    header.section_count = static_cast<uint32_t>(ScenarioSectionId::COUNT);
+
+    struct PendingSection {
+        ScenarioSectionId id;
+        const void* data;
+        uint32_t element_size;
+        uint64_t count;
+    };
+    const PendingSection pending[] = {
+        { ScenarioSectionId::DEVICE_CONFIG, devices_.data(), sizeof(ScenarioDeviceRecord), devices_.size() },
+        { ScenarioSectionId::DEVICE_STATE, states_.data(), sizeof(ScenarioStateRecord), states_.size() },
+        { ScenarioSectionId::NAME_OFFSETS, name_offsets_.data(), sizeof(uint32_t), name_offsets_.size() },
+        { ScenarioSectionId::NAME_BLOB, name_blob_.data(), 1, name_blob_.size() },
+        { ScenarioSectionId::TASKS, tasks_.data(), sizeof(ScenarioTaskRecord), tasks_.size() },
+    };
+
+    // 第一遍: 计算每个段的偏移
+    uint64_t cursor = sizeof(ScenarioImageHeader);
+    for (const auto& sec : pending) {
+        uint64_t bytes = sec.element_size * sec.count;
+        cursor = align_up(cursor, SECTION_ALIGNMENT);
+        auto& entry = header.sections[static_cast<size_t>(sec.id)];
+        entry.id = static_cast<uint32_t>(sec.id);
+        entry.element_size = sec.element_size;
+        entry.offset = cursor;
+        entry.count = sec.count;
+        cursor += bytes;
+    }
+    header.file_size = align_up(cursor, SECTION_ALIGNMENT);
+
+    // 第二遍: 写出文件头和各段数据 (段间空隙以0填充)
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("无法创建场景镜像文件: " + path);
+    }
+    std::vector<char> padding(SECTION_ALIGNMENT, 0);
+    uint64_t written = 0;
+    auto write_bytes = [&](const void* data, uint64_t bytes) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written += bytes;
+    };
+    auto pad_to = [&](uint64_t offset) {
+        while (written < offset) {
+            uint64_t chunk = std::min<uint64_t>(offset - written, padding.size());
+            write_bytes(padding.data(), chunk);
+        }
+    };
+
+    write_bytes(&header, sizeof(header));
+    for (const auto& sec : pending) {
+        const auto& entry = header.sections[static_cast<size_t>(sec.id)];
+        pad_to(entry.offset);
+        if (sec.count > 0)
+            write_bytes(sec.data, sec.element_size * sec.count);
+    }
+    pad_to(header.file_size);
+
+    if (!out) {
+        throw std::runtime_error("写入场景镜像文件失败: " + path);
+    }
+    return static_cast<size_t>(written);
+}
+
+// --- ScenarioImage ---
+
+ScenarioImage::~ScenarioImage()
+{
+    close();
+}
+
+void ScenarioImage::open(const std::string& path)
+{
+    close();
+
+#if defined(ADN_SCENARIO_IMAGE_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("无法打开场景镜像文件: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ScenarioImageHeader))) {
+        ::close(fd);
+        throw std::runtime_error("场景镜像文件过小或无法读取: " + path);
+    }
+    // 整体只读映射, 页按需由页缓存载入
+    void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后即可关闭文件描述符
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("映射场景镜像文件失败: " + path);
+    }
+    base_ = static_cast<std::byte*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    mapped_ = true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("无法打开场景镜像文件: " + path);
+    }
+    size_t file_size = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+    fallback_buffer_.resize(file_size);
+    in.read(reinterpret_cast<char*>(fallback_buffer_.data()), static_cast<std::streamsize>(file_size));
+    base_ = fallback_buffer_.data();
+    size_ = file_size;
+    mapped_ = false;
+#endif
+
+    // --- 校验文件头与段目录 ---
+    const auto& hdr = header();
+    auto fail = [&](const std::string& reason) {
+        close();
+        throw std::runtime_error("场景镜像无效 (" + reason + "): " + path);
+    };
+    if (std::memcmp(hdr.magic, SCENARIO_IMAGE_MAGIC, sizeof(hdr.magic)) != 0)
+        fail("文件标识不匹配");
+    if (hdr.version != SCENARIO_IMAGE_VERSION)
+        fail("版本不匹配");
+    if (hdr.byte_order_mark != SCENARIO_IMAGE_BYTE_ORDER_MARK)
+        fail("字节序不匹配");
+    if (hdr.file_size > size_ || hdr.section_count != static_cast<uint32_t>(ScenarioSectionId::COUNT))
+        fail("文件头损坏");
+
+    const uint32_t expected_sizes[] = {
+        sizeof(ScenarioDeviceRecord), sizeof(ScenarioStateRecord), sizeof(uint32_t), 1, sizeof(ScenarioTaskRecord)
+    };
+    for (uint32_t i = 0; i < hdr.section_count; ++i) {
+        const auto& entry = hdr.sections[i];
+        if (entry.id != i || entry.element_size != expected_sizes[i])
+            fail("段目录与当前记录布局不一致");
+        // 先比较偏移再以除法比较个数，避免构造的偏移或个数使乘法与加法溢出
+        if (entry.offset > hdr.file_size || entry.count > (hdr.file_size - entry.offset) / entry.element_size)
+            fail("段越界");
+    }
+    if (devices().size() != header().sections[static_cast<size_t>(ScenarioSectionId::DEVICE_STATE)].count)
+        fail("设备配置与状态数量不一致");
+
+    // --- 校验名称表与记录中的索引 ---
+    auto offsets = section<uint32_t>(ScenarioSectionId::NAME_OFFSETS);
+    const size_t blob_size = section<char>(ScenarioSectionId::NAME_BLOB).size();
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        if (offsets[i] > blob_size || (i > 0 && offsets[i] < offsets[i - 1]))
+            fail("名称表偏移损坏");
+    }
+    const size_t names = name_count();
+    std::unordered_set<uint64_t> device_entities;
+    device_entities.reserve(devices().size());
+    for (const auto& rec : devices()) {
+        if (rec.entity > hdr.max_entity_id || (rec.name_index != SCENARIO_NO_NAME && rec.name_index >= names))
+            fail("设备记录的实体ID或名称索引越界");
+        device_entities.insert(rec.entity);
+    }
+    for (const auto& task : tasks()) {
+        if (task.entity > hdr.max_entity_id || (task.name_index != SCENARIO_NO_NAME && task.name_index >= names))
+            fail("任务记录的实体ID或名称索引越界");
+        switch (static_cast<ScenarioTaskKind>(task.kind)) {
+        case ScenarioTaskKind::DEVICE_FREQUENCY_RESPONSE:
+            // 设备协程以名称表中的名称启动，必须带有名称
+            if (task.name_index == SCENARIO_NO_NAME)
+                fail("设备任务缺少名称");
+            // 启动时读取该实体的设备组件，实体须有对应的设备记录
+            if (device_entities.count(task.entity) == 0)
+                fail("设备任务所指的实体没有设备记录");
+            break;
+        case ScenarioTaskKind::FREQUENCY_ORACLE:
+        case ScenarioTaskKind::GENERATOR:
+        case ScenarioTaskKind::LOAD:
+            break;
+        default:
+            fail("未知的任务类型");
+        }
+    }
+}
+
+void ScenarioImage::close()
+{
+    if (!base_)
+        return;
+#if defined(ADN_SCENARIO_IMAGE_MMAP)
+    if (mapped_)
+        ::munmap(base_, size_);
+#endif
+    fallback_buffer_.clear();
+    fallback_buffer_.shrink_to_fit();
+    base_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+size_t ScenarioImage::name_count() const
+{
+    auto offsets = section<uint32_t>(ScenarioSectionId::NAME_OFFSETS);
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+std::string_view ScenarioImage::name(uint32_t index) const
+{
+    if (index == SCENARIO_NO_NAME || index >= name_count())
+        return {};
+    auto offsets = section<uint32_t>(ScenarioSectionId::NAME_OFFSETS);
+    auto blob = section<char>(ScenarioSectionId::NAME_BLOB);
+    return { blob.data() + offsets[index], offsets[index + 1] - offsets[index] };
+}
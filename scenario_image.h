@@ -0,0 +1,160 @@
+// scenario_image.h
+// 预编译场景镜像 (Scenario Image)。
+// 将一个完整场景 (设备组件的稠密数组、名称表、初始调度状态) 编译为
+// 一个可重定位的二进制文件: 文件内部只使用相对偏移，不含任何指针。
+// 仿真进程通过 mmap 以只读方式映射镜像，成千上万个批处理进程共享同一份页缓存，启动时无需重新解析
+// 和推导场景 (随机数生成、参数计算)。加载器仍按记录把组件逐条登记到注册表，启动耗时与设备数成正比，
+// 设备状态在注册表中修改，镜像本身始终只读。
+#ifndef SCENARIO_IMAGE_H
+#define SCENARIO_IMAGE_H
+
+#include "ecs_core.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 镜像中的段 (Section) 标识
+enum class ScenarioSectionId : uint32_t {
+    DEVICE_CONFIG = 0, // ScenarioDeviceRecord[] 设备配置 (只读)
+    DEVICE_STATE, // ScenarioStateRecord[] 设备初始物理状态
+    NAME_OFFSETS, // uint32_t[] 名称表偏移 (长度 = 名称数 + 1)
+    NAME_BLOB, // char[] 名称字符数据 (UTF-8, 不含结尾0)
+    TASKS, // ScenarioTaskRecord[] 初始调度状态: 需要启动的协程任务表
+    COUNT
+};
+
+// 设备配置记录 (对应 FrequencyControlConfigComponent)
+struct ScenarioDeviceRecord {
+    uint64_t entity; // 实体ID (加载后保持不变)
+    uint32_t device_type; // FrequencyControlConfigComponent::DeviceType 的整数值
+    uint32_t name_index; // 名称表中的索引
+    double base_power_kW;
+    double gain_kW_per_Hz;
+    double deadband_Hz;
+    double max_output_kW;
+    double min_output_kW;
+    double soc_min_threshold;
+    double soc_max_threshold;
+};
+
+// 设备物理状态记录 (对应 PhysicalStateComponent) 的初始值
+struct ScenarioStateRecord {
+    double current_power_kW;
+    double soc;
+};
+
+// 初始调度状态中的任务类型
+enum class ScenarioTaskKind : uint32_t {
+    DEVICE_FREQUENCY_RESPONSE = 1, // individualDeviceFrequencyResponseTask
+    FREQUENCY_ORACLE = 2, // frequencyOracleTask, param0=扰动开始时间(s), param1=步长(ms)
+    GENERATOR = 3, // generatorTask
+    LOAD = 4 // loadTask
+};
+
+// 任务表记录: 加载后按表中顺序启动协程，保证与原始构建流程相同的启动顺序
+struct ScenarioTaskRecord {
+    uint64_t entity; // 任务关联的实体 (无关联时为0)
+    uint32_t kind; // ScenarioTaskKind
+    uint32_t name_index; // 名称表索引 (无名称时为 UINT32_MAX)
+    double param0;
+    double param1;
+};
+
+// 段目录项
+struct ScenarioSectionEntry {
+    uint32_t id; // ScenarioSectionId
+    uint32_t element_size; // 单个元素的字节数，用于加载时校验记录布局
+    uint64_t offset; // 相对文件起始的字节偏移
+    uint64_t count; // 元素个数
+};
+
+// 文件头
+struct ScenarioImageHeader {
+    char magic[8]; // "ADNSCN\0\0"
+    uint32_t version;
+    uint32_t byte_order_mark; // 0x01020304, 用于检测字节序不一致
+    uint64_t file_size;
+    int64_t initial_time_ms; // 调度器初始仿真时间
+    uint64_t max_entity_id; // 镜像中使用的最大实体ID
+    uint32_t section_count;
+    uint32_t reserved;
+    ScenarioSectionEntry sections[static_cast<size_t>(ScenarioSectionId::COUNT)];
+};
+
+constexpr uint32_t SCENARIO_IMAGE_VERSION = 2;
+constexpr uint32_t SCENARIO_IMAGE_BYTE_ORDER_MARK = 0x01020304u;
+constexpr uint32_t SCENARIO_NO_NAME = 0xFFFFFFFFu;
+
+// 场景镜像编译器: 收集场景数据并写出镜像文件
+class ScenarioImageBuilder {
+public:
+    // 添加一个名称，返回其在名称表中的索引
+    uint32_t add_name(std::string_view name);
+
+    // 添加一个设备 (配置 + 初始状态)
+    void add_device(const ScenarioDeviceRecord& config, const ScenarioStateRecord& state);
+
+    // 添加一个需要在加载后启动的协程任务
+    void add_task(const ScenarioTaskRecord& task);
+
+    void set_initial_time_ms(int64_t t) { initial_time_ms_ = t; }
+
+    // 将镜像写入文件。失败时抛出 std::runtime_error。
+    // 返回写出的总字节数。
+    size_t write(const std::string& path) const;
+
+private:
+    std::vector<ScenarioDeviceRecord> devices_;
+    std::vector<ScenarioStateRecord> states_;
+    std::vector<uint32_t> name_offsets_ { 0 };
+    std::string name_blob_;
+    std::vector<ScenarioTaskRecord> tasks_;
+    int64_t initial_time_ms_ = 0;
+    uint64_t max_entity_id_ = 0;
+};
+
+// 已映射的场景镜像 (只读视图)
+class ScenarioImage {
+public:
+    ScenarioImage() = default;
+    ~ScenarioImage();
+
+    ScenarioImage(const ScenarioImage&) = delete;
+    ScenarioImage& operator=(const ScenarioImage&) = delete;
+
+    // 映射镜像文件并校验文件头、段目录、名称表偏移、记录中的名称索引和实体ID，以及设备任务所指的实体
+    // 确有设备记录，损坏的镜像在此被拒绝，之后的访问不会越界。失败时抛出 std::runtime_error。
+    void open(const std::string& path);
+    void close();
+    bool is_open() const { return base_ != nullptr; }
+
+    const ScenarioImageHeader& header() const { return *reinterpret_cast<const ScenarioImageHeader*>(base_); }
+
+    std::span<const ScenarioDeviceRecord> devices() const { return section<ScenarioDeviceRecord>(ScenarioSectionId::DEVICE_CONFIG); }
+    std::span<const ScenarioStateRecord> states() const { return section<ScenarioStateRecord>(ScenarioSectionId::DEVICE_STATE); }
+    std::span<const ScenarioTaskRecord> tasks() const { return section<ScenarioTaskRecord>(ScenarioSectionId::TASKS); }
+
+    size_t name_count() const;
+    std::string_view name(uint32_t index) const;
+
+    size_t mapped_bytes() const { return size_; }
+
+private:
+    template <typename T>
+    std::span<const T> section(ScenarioSectionId id) const
+    {
+        const auto& entry = header().sections[static_cast<size_t>(id)];
+        return { reinterpret_cast<const T*>(base_ + entry.offset), static_cast<size_t>(entry.count) };
+    }
+
+    std::byte* base_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false; // true: mmap映射; false: 回退为读入堆内存
+    std::vector<std::byte> fallback_buffer_;
+};
+
+#endif // SCENARIO_IMAGE_H
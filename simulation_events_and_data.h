@@ -6,6 +6,7 @@
 
 #include "cps_coro_lib.h" // 引入协程库以使用 cps_coro::EventId 类型
 #include "ecs_core.h" // 引入ECS核心库以使用 Entity 类型
+#include "phase_profiler.h" // 按仿真阶段的性能统计
 
 // --- 通用仿真事件ID ---
 // 这些事件ID用于跨不同仿真模块的通用交互和信令。
@@ -29,12 +30,20 @@ enum class EventID : uint64_t {
     LOGIC_FAULT_EVENT = 3001, // 逻辑故障事件
     LOGIC_BREAKER_COMMAND_EVENT = 3002, // 逻辑断路器命令事件
     LOGIC_BREAKER_STATUS_CHANGED_EVENT = 3003, // 逻辑断路器状态改变事件
-    LOGIC_SUPPLY_LOSS_EVENT = 3004 // 逻辑母线失电事件
+    LOGIC_SUPPLY_LOSS_EVENT = 3004, // 逻辑母线失电事件
+    LOGIC_BUS_ENERGIZATION_CHANGED_EVENT = 3005 // 母线带电状态变化事件 (每条状态变化的母线一次)
 };
 
 // --- 频率-有功响应系统专用事件ID ---
 // 这些事件ID专用于频率和有功功率响应仿真模块。
-constexpr cps_coro::EventId FREQUENCY_UPDATE_EVENT = 200; // 系统频率更新事件 (通报当前系统频率或频率偏差)
+// 频率更新以最新值通道 (cps_coro::LatestValueChannel) 发布，以下编号为通道编号。
+constexpr cps_coro::EventId FREQUENCY_UPDATE_EVENT = 200; // 系统频率更新 (FrequencyInfo: 当前系统频率偏差)
+constexpr cps_coro::EventId ENSEMBLE_FREQUENCY_UPDATE_EVENT = 201; // 集合仿真的频率更新 (EnsembleFrequencyInfo: 全部参数变体的频率偏差)
+
+// --- 通信网络仿真专用事件ID ---
+// 这些事件经通信通道 (CommNetwork) 送达，用于大规模IED与主站之间的通信仿真。
+constexpr cps_coro::EventId IED_STATUS_REPORT_EVENT = 300; // IED向主站上送的状态报告
+constexpr cps_coro::EventId IED_TRIP_COMMAND_EVENT = 301; // 保护IED经GOOSE发给断路器智能终端的跳闸命令
 
 // --- 事件ID定义 (AVC仿真场景专用) ---
 // 为避免与项目中其他部分的事件ID潜在冲突，并保持此仿真示例的模块化，
@@ -42,6 +51,7 @@ constexpr cps_coro::EventId FREQUENCY_UPDATE_EVENT = 200; // 系统频率更新
 // 假设这里使用专用的ID：
 constexpr cps_coro::EventId VOLTAGE_CHANGE_EVENT_AVC = 10000; // 电压变化事件ID (AVC场景)
 constexpr cps_coro::EventId LOAD_CHANGE_EVENT_AVC = 10001; // 负荷变化事件ID (AVC场景)
+constexpr cps_coro::EventId MEASUREMENT_REPORT_EVENT_AVC = 10002; // RTU量测上送事件ID (状态估计场景)
 
 // --- 核心数据结构 ---
 
@@ -74,11 +84,49 @@ struct FrequencyInfo {
                               // 负值表示频率降低 (欠频)，正值表示频率升高 (过频)。
 };
 
+// 集合仿真中同时推进的参数变体数 (SIMD通道数)。8个double即一个AVX-512寄存器或两个AVX2寄存器。
+constexpr size_t ENSEMBLE_LANES = 8;
+
+// 集合频率信息结构体 (ENSEMBLE_FREQUENCY_UPDATE_EVENT 通道发布的数据)
+// 同一仿真时刻各参数变体的频率偏差，第 k 个元素属于第 k 个变体。
+struct EnsembleFrequencyInfo {
+    double current_sim_time_seconds; // 事件发生时的当前仿真时间 (单位: 秒)
+    double freq_deviation_hz[ENSEMBLE_LANES]; // 各变体的频率偏差 (单位: Hz)
+};
+
+// 切负荷请求结构体 (LOAD_SHED_REQUEST_EVENT 携带的数据)
+// 由稳定控制或调度等上层应用发出，请求低频减载子系统立即切除指定容量的负荷。
+struct LoadShedRequest {
+    double amount_kW = 0.0; // 请求切除的负荷容量 (kW)
+    Entity requester_entity = 0; // 请求方实体ID，0表示未指定
+};
+
+// 功率调整请求结构体 (POWER_ADJUST_REQUEST_EVENT 携带的数据)
+// 由AGC等二次调频应用发出，给出VPP整体的有功功率目标。
+struct PowerAdjustRequest {
+    double target_kW = 0.0; // VPP总有功功率目标 (kW)，正值为向电网输出
+    Entity requester_entity = 0; // 请求方实体ID，0表示未指定
+};
+
+// IED状态报告 (IED_STATUS_REPORT_EVENT 携带的数据)
+struct IedStatusReport {
+    Entity ied_entity = 0; // 上送报告的IED
+    double sent_time_ms = 0.0; // 报告发出时的仿真时间 (ms)，用于统计端到端时延
+};
+
+// IED跳闸命令 (IED_TRIP_COMMAND_EVENT 携带的数据)
+struct IedTripCommand {
+    Entity ied_entity = 0; // 发出跳闸命令的保护IED
+    double fault_time_ms = 0.0; // 故障发生时的仿真时间 (ms)，用于统计故障切除时间
+};
+
 // --- 辅助日志函数---
 // 该函数用于在控制台和日志文件中输出带有仿真时间戳的格式化日志信息。
 template <typename... Args>
 inline void log_lp_info(cps_coro::Scheduler& scheduler, const char* user_format_str, Args&&... args)
 {
+    PhaseScope phase(SimPhase::LOGGING);
+    MemTagScope mem_scope(MemTag::LOGGING);
     if (g_console_logger) {
         char time_prefix_buf[64];
         snprintf(time_prefix_buf, sizeof(time_prefix_buf), "[LP-Sim @ %lldms] ", (long long)scheduler.now().time_since_epoch().count());
@@ -123,6 +171,13 @@ struct LogicSupplyLossInfo {
     Entity bus_entity;
 };
 
+// 母线带电状态变化 (边沿触发: 只为状态确有变化的母线发出)
+struct LogicBusEnergizationChange {
+    Entity bus_entity;
+    bool energized; // 变化后的状态
+    uint64_t topology_version; // 带电状态版本号: 每次开关变位后带电状态有变化时加1，同一次变位引起的各条变化版本号相同
+};
+
 // --- 便捷的事件ID转换函数 ---
 // 允许在需要 uint64_t 的地方直接使用 EventID 枚举值，解决了 "to_underlying was not declared" 的问题。
 template <typename E>
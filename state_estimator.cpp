@@ -0,0 +1,624 @@
+// state_estimator.cpp
+// 实现了WLS状态估计的量测函数与雅可比矩阵、增益矩阵的符号分解 (最小度排序、消去树) 与 2x2 块的数值Cholesky分解。
+
+#include "state_estimator.h"
+#include "logging_utils.h"
+#include "memory_accounting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <set>
+
+namespace {
+
+// 最小度排序 (显式消去图): 每步消去当前度最小的母线 (度相同时取序号小者)，并把它的相邻母线两两相连。
+// 电网的耦合图稀疏且接近平面，消去过程中各邻接表保持较短。
+std::vector<int> minimum_degree_order(std::vector<std::vector<int>> adj)
+{
+    const int n = static_cast<int>(adj.size());
+    std::set<std::pair<size_t, int>> queue;
+    for (int v = 0; v < n; ++v)
+        queue.emplace(adj[v].size(), v);
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> merged;
+    while (!queue.empty()) {
+        const int v = queue.begin()->second;
+        queue.erase(queue.begin());
+        order.push_back(v);
+        const std::vector<int> clique = std::move(adj[v]);
+        adj[v].clear();
+        for (int u : clique) {
+            queue.erase({ adj[u].size(), u });
+            merged.clear();
+            std::set_union(adj[u].begin(), adj[u].end(), clique.begin(), clique.end(), std::back_inserter(merged));
+            merged.erase(std::remove_if(merged.begin(), merged.end(), [&](int w) { return w == u || w == v; }), merged.end());
+            adj[u].swap(merged);
+            queue.emplace(adj[u].size(), u);
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+bool WlsStateEstimator::build(const PowerSystemTopology& topology, const std::unordered_map<BranchId, SeBranchParameters>& branches,
+    BusId reference_bus, SeSettings settings)
+{
+    settings_ = settings;
+    CsrTopology csr = topology.exportCsr();
+    const int n = static_cast<int>(csr.bus_ids.size());
+    bus_ids_ = csr.bus_ids;
+    index_.clear();
+    for (int i = 0; i < n; ++i)
+        index_.emplace(bus_ids_[i], i);
+    if (index_.find(reference_bus) == index_.end()) {
+        if (g_console_logger)
+            g_console_logger->error("[SE] 参考母线 {} 不在拓扑中。", reference_bus);
+        return false;
+    }
+
+    // 支路与节点导纳矩阵: 每条支路在CSR中出现两次，只取 i < j 的一次
+    branch_index_.clear();
+    br_from_.clear();
+    br_to_.clear();
+    br_g_.clear();
+    br_b_.clear();
+    br_bsh_.clear();
+    g_ii_.assign(n, 0.0);
+    b_ii_.assign(n, 0.0);
+    std::vector<std::vector<std::pair<int, std::pair<double, double>>>> offdiag(n);
+    for (int i = 0; i < n; ++i) {
+        for (int k = csr.row_offsets[i]; k < csr.row_offsets[i + 1]; ++k) {
+            const int j = csr.adj_bus_idx[k];
+            if (j <= i)
+                continue;
+            const BranchId id = csr.adj_branch_ids[k];
+            auto it = branches.find(id);
+            if (it == branches.end()) {
+                if (g_console_logger)
+                    g_console_logger->error("[SE] 支路 {} 缺少参数。", id);
+                return false;
+            }
+            const SeBranchParameters& p = it->second;
+            const double den = p.r_pu * p.r_pu + p.x_pu * p.x_pu;
+            const double g = p.r_pu / den;
+            const double b = -p.x_pu / den;
+            branch_index_.emplace(id, static_cast<uint32_t>(br_from_.size()));
+            br_from_.push_back(i);
+            br_to_.push_back(j);
+            br_g_.push_back(g);
+            br_b_.push_back(b);
+            br_bsh_.push_back(0.5 * p.b_pu);
+            for (int end : { i, j }) {
+                g_ii_[end] += g;
+                b_ii_[end] += b + 0.5 * p.b_pu;
+            }
+            offdiag[i].push_back({ j, { -g, -b } });
+            offdiag[j].push_back({ i, { -g, -b } });
+        }
+    }
+    y_ptr_.assign(1, 0);
+    y_col_.clear();
+    y_g_.clear();
+    y_b_.clear();
+    for (int i = 0; i < n; ++i) {
+        auto& row = offdiag[i];
+        std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& [j, y] : row) {
+            if (!y_col_.empty() && static_cast<int>(y_col_.size()) > y_ptr_.back() && y_col_.back() == j) {
+                y_g_.back() += y.first; // 并联支路
+                y_b_.back() += y.second;
+                continue;
+            }
+            y_col_.push_back(j);
+            y_g_.push_back(y.first);
+            y_b_.push_back(y.second);
+        }
+        y_ptr_.push_back(static_cast<int>(y_col_.size()));
+    }
+    term_a_.assign(y_col_.size(), 0.0);
+    term_b_.assign(y_col_.size(), 0.0);
+    sum_a_.assign(n, 0.0);
+    sum_b_.assign(n, 0.0);
+
+    specs_.clear();
+    m_bus_.clear();
+    m_other_.clear();
+    m_branch_.clear();
+    weight_.clear();
+    value_.clear();
+    available_.clear();
+    row_cols_.clear();
+    col_begin_.assign(1, 0);
+    max_row_ = 0;
+    row_pos_.clear();
+    pos_begin_.assign(1, 0);
+    structure_dirty_ = true;
+    stats_ = {};
+    flat_start();
+
+    // 槽位0: 参考母线相角伪量测
+    set_value(add_measurement({ SeMeasurementType::V_ANGLE, reference_bus, 0, settings_.reference_sigma }), 0.0);
+    return true;
+}
+
+int WlsStateEstimator::index_of(BusId bus) const
+{
+    auto it = index_.find(bus);
+    return it == index_.end() ? -1 : it->second;
+}
+
+void WlsStateEstimator::flat_start()
+{
+    theta_.assign(bus_ids_.size(), 0.0);
+    vmag_.assign(bus_ids_.size(), 1.0);
+}
+
+uint32_t WlsStateEstimator::add_measurement(const SeMeasurement& measurement)
+{
+    const int bus = index_of(measurement.bus);
+    if (bus < 0 || measurement.sigma <= 0.0)
+        return NO_SLOT;
+    int other = -1;
+    uint32_t branch = 0;
+    const auto type = measurement.type;
+    const bool is_flow = type == SeMeasurementType::P_FLOW || type == SeMeasurementType::Q_FLOW;
+    if (is_flow) {
+        auto it = branch_index_.find(measurement.branch);
+        if (it == branch_index_.end())
+            return NO_SLOT;
+        branch = it->second;
+        if (br_from_[branch] == bus)
+            other = br_to_[branch];
+        else if (br_to_[branch] == bus)
+            other = br_from_[branch];
+        else
+            return NO_SLOT;
+    }
+
+    const uint32_t slot = static_cast<uint32_t>(specs_.size());
+    specs_.push_back(measurement);
+    m_bus_.push_back(bus);
+    m_other_.push_back(other);
+    m_branch_.push_back(branch);
+    weight_.push_back(1.0 / (measurement.sigma * measurement.sigma));
+    value_.push_back(0.0);
+    available_.push_back(0);
+
+    const uint32_t theta_col = 2 * static_cast<uint32_t>(bus);
+    switch (type) {
+    case SeMeasurementType::V_MAGNITUDE:
+        row_cols_.push_back(theta_col + 1);
+        break;
+    case SeMeasurementType::V_ANGLE:
+        row_cols_.push_back(theta_col);
+        break;
+    case SeMeasurementType::P_INJECTION:
+    case SeMeasurementType::Q_INJECTION:
+        row_cols_.push_back(theta_col);
+        row_cols_.push_back(theta_col + 1);
+        for (int k = y_ptr_[bus]; k < y_ptr_[bus + 1]; ++k) {
+            row_cols_.push_back(2 * static_cast<uint32_t>(y_col_[k]));
+            row_cols_.push_back(2 * static_cast<uint32_t>(y_col_[k]) + 1);
+        }
+        break;
+    case SeMeasurementType::P_FLOW:
+    case SeMeasurementType::Q_FLOW:
+        row_cols_.push_back(theta_col);
+        row_cols_.push_back(theta_col + 1);
+        row_cols_.push_back(2 * static_cast<uint32_t>(other));
+        row_cols_.push_back(2 * static_cast<uint32_t>(other) + 1);
+        break;
+    }
+    col_begin_.push_back(row_cols_.size());
+    max_row_ = std::max(max_row_, row_length(slot));
+
+    // 已有符号分解时尝试就地补入；结构不包含此量测的耦合时在下一次估计前重做符号分解
+    if (!structure_dirty_) {
+        if (locate_positions(slot))
+            ++stats_.incremental_additions;
+        else
+            structure_dirty_ = true;
+    }
+    return slot;
+}
+
+void WlsStateEstimator::compute_bus_terms(const double* theta, const double* vmag) const
+{
+    const int n = bus_count();
+    for (int i = 0; i < n; ++i) {
+        double sa = 0.0, sb = 0.0;
+        for (int k = y_ptr_[i]; k < y_ptr_[i + 1]; ++k) {
+            const int j = y_col_[k];
+            const double d = theta[i] - theta[j];
+            const double c = std::cos(d);
+            const double s = std::sin(d);
+            const double a = y_g_[k] * c + y_b_[k] * s;
+            const double b = y_g_[k] * s - y_b_[k] * c;
+            term_a_[k] = a;
+            term_b_[k] = b;
+            sa += vmag[j] * a;
+            sb += vmag[j] * b;
+        }
+        sum_a_[i] = sa;
+        sum_b_[i] = sb;
+    }
+}
+
+double WlsStateEstimator::measure(uint32_t slot, const double* theta, const double* vmag, double* h) const
+{
+    const int i = m_bus_[slot];
+    const double vi = vmag[i];
+    switch (specs_[slot].type) {
+    case SeMeasurementType::V_MAGNITUDE:
+        h[0] = 1.0;
+        return vi;
+    case SeMeasurementType::V_ANGLE:
+        h[0] = 1.0;
+        return theta[i];
+    case SeMeasurementType::P_INJECTION: {
+        // P_i = V_i² G_ii + V_i Σ V_j (G_ij cos θij + B_ij sin θij)
+        h[0] = -vi * sum_b_[i];
+        h[1] = 2.0 * vi * g_ii_[i] + sum_a_[i];
+        size_t t = 2;
+        for (int k = y_ptr_[i]; k < y_ptr_[i + 1]; ++k, t += 2) {
+            h[t] = vi * vmag[y_col_[k]] * term_b_[k];
+            h[t + 1] = vi * term_a_[k];
+        }
+        return vi * vi * g_ii_[i] + vi * sum_a_[i];
+    }
+    case SeMeasurementType::Q_INJECTION: {
+        // Q_i = -V_i² B_ii + V_i Σ V_j (G_ij sin θij - B_ij cos θij)
+        h[0] = vi * sum_a_[i];
+        h[1] = -2.0 * vi * b_ii_[i] + sum_b_[i];
+        size_t t = 2;
+        for (int k = y_ptr_[i]; k < y_ptr_[i + 1]; ++k, t += 2) {
+            h[t] = -vi * vmag[y_col_[k]] * term_a_[k];
+            h[t + 1] = vi * term_b_[k];
+        }
+        return -vi * vi * b_ii_[i] + vi * sum_b_[i];
+    }
+    case SeMeasurementType::P_FLOW:
+    case SeMeasurementType::Q_FLOW: {
+        const uint32_t e = m_branch_[slot];
+        const int j = m_other_[slot];
+        const double vj = vmag[j];
+        const double d = theta[i] - theta[j];
+        const double c = std::cos(d);
+        const double s = std::sin(d);
+        const double g = br_g_[e], b = br_b_[e], bsh = br_bsh_[e];
+        const double gc_bs = g * c + b * s;
+        const double gs_bc = g * s - b * c;
+        if (specs_[slot].type == SeMeasurementType::P_FLOW) {
+            // P_ij = V_i² g - V_i V_j (g cos θij + b sin θij)
+            h[0] = vi * vj * gs_bc;
+            h[1] = 2.0 * vi * g - vj * gc_bs;
+            h[2] = -vi * vj * gs_bc;
+            h[3] = -vi * gc_bs;
+            return vi * vi * g - vi * vj * gc_bs;
+        }
+        // Q_ij = -V_i² (b + b_sh) - V_i V_j (g sin θij - b cos θij)
+        h[0] = -vi * vj * gc_bs;
+        h[1] = -2.0 * vi * (b + bsh) - vj * gs_bc;
+        h[2] = vi * vj * gc_bs;
+        h[3] = -vi * gs_bc;
+        return -vi * vi * (b + bsh) - vi * vj * gs_bc;
+    }
+    }
+    return 0.0;
+}
+
+void WlsStateEstimator::evaluate(const std::vector<double>& theta, const std::vector<double>& vmag, std::vector<double>& out) const
+{
+    compute_bus_terms(theta.data(), vmag.data());
+    std::vector<double> h(max_row_);
+    out.resize(specs_.size());
+    for (uint32_t slot = 0; slot < specs_.size(); ++slot)
+        out[slot] = measure(slot, theta.data(), vmag.data(), h.data());
+}
+
+void WlsStateEstimator::analyze()
+{
+    MemTagScope mem_scope(MemTag::TOPOLOGY);
+    const int n = bus_count();
+
+    // 母线间的耦合: 同一雅可比行中出现的母线两两耦合
+    std::vector<std::vector<int>> coupled(n);
+    std::vector<int> row_buses;
+    for (uint32_t slot = 0; slot < specs_.size(); ++slot) {
+        row_buses.clear();
+        for (size_t c = col_begin_[slot]; c < col_begin_[slot + 1]; ++c) {
+            const int bus = static_cast<int>(row_cols_[c] >> 1);
+            if (row_buses.empty() || row_buses.back() != bus)
+                row_buses.push_back(bus);
+        }
+        for (int u : row_buses) {
+            for (int w : row_buses) {
+                if (u != w)
+                    coupled[u].push_back(w);
+            }
+        }
+    }
+    for (auto& list : coupled) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    // 按母线排序，每条母线的相角与幅值相邻编号
+    const std::vector<int> order = minimum_degree_order(coupled);
+    std::vector<int> bus_position(n);
+    for (int k = 0; k < n; ++k)
+        bus_position[order[k]] = k;
+    perm_.resize(2 * static_cast<size_t>(n));
+    for (int b = 0; b < n; ++b) {
+        perm_[2 * b] = 2 * bus_position[b];
+        perm_[2 * b + 1] = 2 * bus_position[b] + 1;
+    }
+
+    // G 的上三角块结构 (置换后按块列压缩，列内块行号递增)
+    gain_ptr_.assign(n + 1, 0);
+    gain_row_.clear();
+    for (int position = 0; position < n; ++position) {
+        const size_t first = gain_row_.size();
+        for (int a : coupled[order[position]]) {
+            if (bus_position[a] < position)
+                gain_row_.push_back(bus_position[a]);
+        }
+        gain_row_.push_back(position);
+        std::sort(gain_row_.begin() + first, gain_row_.end());
+        gain_ptr_[position + 1] = static_cast<int>(gain_row_.size());
+    }
+    gain_.assign(4 * gain_row_.size(), 0.0);
+
+    // 块消去树
+    parent_.assign(n, -1);
+    std::vector<int> ancestor(n, -1);
+    for (int k = 0; k < n; ++k) {
+        for (int p = gain_ptr_[k]; p < gain_ptr_[k + 1]; ++p) {
+            for (int i = gain_row_[p]; i != -1 && i < k;) {
+                const int next = ancestor[i];
+                ancestor[i] = k;
+                if (next == -1)
+                    parent_[i] = k;
+                i = next;
+            }
+        }
+    }
+
+    // L 的块列计数: 第 k 块行的非零块列为块消去树上由 G 第 k 块列各块行可达的节点
+    work_stack_.assign(n, 0);
+    work_mark_.assign(n, 0);
+    work_x_.assign(4 * static_cast<size_t>(n), 0.0);
+    std::vector<int> counts(n, 1);
+    for (int k = 0; k < n; ++k) {
+        for (int t = elimination_reach(k); t < n; ++t)
+            ++counts[work_stack_[t]];
+    }
+    l_ptr_.assign(n + 1, 0);
+    for (int k = 0; k < n; ++k)
+        l_ptr_[k + 1] = l_ptr_[k] + counts[k];
+    l_row_.assign(l_ptr_[n], 0);
+    l_x_.assign(4 * static_cast<size_t>(l_ptr_[n]), 0.0);
+    work_next_.assign(n, 0);
+
+    row_pos_.clear();
+    pos_begin_.assign(1, 0);
+    for (uint32_t slot = 0; slot < specs_.size(); ++slot)
+        locate_positions(slot);
+
+    structure_dirty_ = false;
+    ++stats_.symbolic_analyses;
+    stats_.gain_blocks = gain_row_.size();
+    stats_.factor_blocks = l_row_.size();
+}
+
+bool WlsStateEstimator::locate_positions(uint32_t slot)
+{
+    const uint32_t* cols = row_cols_.data() + col_begin_[slot];
+    const size_t len = row_length(slot);
+    for (size_t a = 0; a < len; ++a) {
+        for (size_t b = a; b < len; ++b) {
+            // 置换后的母线较小者为块行；同一母线时取块内上三角 (相角在前)
+            int pa = perm_[cols[a]];
+            int pb = perm_[cols[b]];
+            if (pa > pb)
+                std::swap(pa, pb);
+            const int row = pa >> 1;
+            const int col = pb >> 1;
+            const auto first = gain_row_.begin() + gain_ptr_[col];
+            const auto last = gain_row_.begin() + gain_ptr_[col + 1];
+            const auto it = std::lower_bound(first, last, row);
+            if (it == last || *it != row) {
+                row_pos_.resize(pos_begin_.back());
+                return false;
+            }
+            row_pos_.push_back(static_cast<uint32_t>(4 * (it - gain_row_.begin()) + 2 * (pa & 1) + (pb & 1)));
+        }
+    }
+    pos_begin_.push_back(row_pos_.size());
+    return true;
+}
+
+int WlsStateEstimator::elimination_reach(int k)
+{
+    const int n = static_cast<int>(parent_.size());
+    int top = n;
+    work_mark_[k] = 1;
+    for (int p = gain_ptr_[k]; p < gain_ptr_[k + 1]; ++p) {
+        int i = gain_row_[p];
+        if (i > k)
+            continue;
+        // 沿消去树上行直到已标记的节点，路径按逆序压入栈顶
+        int len = 0;
+        for (; !work_mark_[i]; i = parent_[i]) {
+            work_stack_[len++] = i;
+            work_mark_[i] = 1;
+        }
+        while (len > 0)
+            work_stack_[--top] = work_stack_[--len];
+    }
+    for (int t = top; t < n; ++t)
+        work_mark_[work_stack_[t]] = 0;
+    work_mark_[k] = 0;
+    return top;
+}
+
+bool WlsStateEstimator::factorize()
+{
+    // 上视 (up-looking) 块Cholesky: 逐块行求 L 的第 k 块行。块 (a, b) 存于 [2a + b]。
+    // 以 L 的前 k 块行为系数做块前代 Y = L⁻¹ G(0:k-1, k)，则 L(k, i) = Y_iᵀ，对角块为 G_kk - Σ Y_iᵀ Y_i 的Cholesky因子。
+    const int n = static_cast<int>(parent_.size());
+    std::copy(l_ptr_.begin(), l_ptr_.end() - 1, work_next_.begin());
+    double* x = work_x_.data();
+    for (int k = 0; k < n; ++k) {
+        const int top = elimination_reach(k);
+        const int diag_p = gain_ptr_[k + 1] - 1;
+        for (int p = gain_ptr_[k]; p < diag_p; ++p)
+            std::copy(&gain_[4 * p], &gain_[4 * p] + 4, x + 4 * gain_row_[p]);
+        double d00 = gain_[4 * diag_p], d01 = gain_[4 * diag_p + 1], d11 = gain_[4 * diag_p + 3];
+        const double g00 = d00, g11 = d11;
+        for (int t = top; t < n; ++t) {
+            const int i = work_stack_[t];
+            double* xi = x + 4 * i;
+            const double* lii = &l_x_[4 * l_ptr_[i]];
+            const double y00 = xi[0] / lii[0], y01 = xi[1] / lii[0];
+            const double y10 = (xi[2] - lii[2] * y00) / lii[3], y11 = (xi[3] - lii[2] * y01) / lii[3];
+            xi[0] = xi[1] = xi[2] = xi[3] = 0.0;
+            for (int p = l_ptr_[i] + 1; p < work_next_[i]; ++p) {
+                const double* l = &l_x_[4 * p];
+                double* xr = x + 4 * l_row_[p];
+                xr[0] -= l[0] * y00 + l[1] * y10;
+                xr[1] -= l[0] * y01 + l[1] * y11;
+                xr[2] -= l[2] * y00 + l[3] * y10;
+                xr[3] -= l[2] * y01 + l[3] * y11;
+            }
+            d00 -= y00 * y00 + y10 * y10;
+            d01 -= y00 * y01 + y10 * y11;
+            d11 -= y01 * y01 + y11 * y11;
+            const int p = work_next_[i]++;
+            l_row_[p] = k;
+            double* lki = &l_x_[4 * p];
+            lki[0] = y00;
+            lki[1] = y10;
+            lki[2] = y01;
+            lki[3] = y11;
+        }
+        const double l10 = d00 > settings_.pivot_tolerance * g00 ? d01 / std::sqrt(d00) : 0.0;
+        const double d = d11 - l10 * l10;
+        if (!(d00 > settings_.pivot_tolerance * g00) || !(d > settings_.pivot_tolerance * g11)) {
+            std::fill(work_x_.begin(), work_x_.end(), 0.0);
+            return false;
+        }
+        const int p = work_next_[k]++;
+        l_row_[p] = k;
+        double* lkk = &l_x_[4 * p];
+        lkk[0] = std::sqrt(d00);
+        lkk[1] = 0.0;
+        lkk[2] = l10;
+        lkk[3] = std::sqrt(d);
+    }
+    return true;
+}
+
+void WlsStateEstimator::solve(std::vector<double>& x) const
+{
+    const int n = static_cast<int>(parent_.size());
+    double* y = work_x_.data();
+    for (size_t s = 0; s < x.size(); ++s)
+        y[perm_[s]] = x[s];
+    // 前代 L y = b
+    for (int j = 0; j < n; ++j) {
+        const double* ljj = &l_x_[4 * l_ptr_[j]];
+        const double y0 = y[2 * j] / ljj[0];
+        const double y1 = (y[2 * j + 1] - ljj[2] * y0) / ljj[3];
+        y[2 * j] = y0;
+        y[2 * j + 1] = y1;
+        for (int p = l_ptr_[j] + 1; p < l_ptr_[j + 1]; ++p) {
+            const double* l = &l_x_[4 * p];
+            y[2 * l_row_[p]] -= l[0] * y0 + l[1] * y1;
+            y[2 * l_row_[p] + 1] -= l[2] * y0 + l[3] * y1;
+        }
+    }
+    // 回代 Lᵀ x = y
+    for (int j = n - 1; j >= 0; --j) {
+        double y0 = y[2 * j], y1 = y[2 * j + 1];
+        for (int p = l_ptr_[j] + 1; p < l_ptr_[j + 1]; ++p) {
+            const double* l = &l_x_[4 * p];
+            const double r0 = y[2 * l_row_[p]], r1 = y[2 * l_row_[p] + 1];
+            y0 -= l[0] * r0 + l[2] * r1;
+            y1 -= l[1] * r0 + l[3] * r1;
+        }
+        const double* ljj = &l_x_[4 * l_ptr_[j]];
+        y1 /= ljj[3];
+        y0 = (y0 - ljj[2] * y1) / ljj[0];
+        y[2 * j] = y0;
+        y[2 * j + 1] = y1;
+    }
+    for (size_t s = 0; s < x.size(); ++s) {
+        x[s] = y[perm_[s]];
+        y[perm_[s]] = 0.0;
+    }
+}
+
+SeResult WlsStateEstimator::estimate()
+{
+    SeResult result;
+    ++stats_.estimates;
+    if (structure_dirty_)
+        analyze();
+    const int n = bus_count();
+    std::vector<double> rhs(2 * static_cast<size_t>(n));
+    std::vector<double> h(max_row_);
+    for (int it = 0; it < settings_.max_iterations; ++it) {
+        // 累加 G = HᵀWH 与 HᵀW r，只访问可用的量测，累加位置已由符号分解给出
+        compute_bus_terms(theta_.data(), vmag_.data());
+        std::fill(gain_.begin(), gain_.end(), 0.0);
+        std::fill(rhs.begin(), rhs.end(), 0.0);
+        result.measurements = 0;
+        result.objective = 0.0;
+        result.max_normalized_residual = 0.0;
+        for (uint32_t slot = 0; slot < specs_.size(); ++slot) {
+            if (!available_[slot])
+                continue;
+            const double r = value_[slot] - measure(slot, theta_.data(), vmag_.data(), h.data());
+            const double w = weight_[slot];
+            ++result.measurements;
+            result.objective += w * r * r;
+            const double normalized = std::abs(r) * std::sqrt(w);
+            if (normalized > result.max_normalized_residual) {
+                result.max_normalized_residual = normalized;
+                result.max_residual_slot = slot;
+            }
+            const uint32_t* cols = row_cols_.data() + col_begin_[slot];
+            const uint32_t* pos = row_pos_.data() + pos_begin_[slot];
+            const size_t len = row_length(slot);
+            for (size_t a = 0; a < len; ++a) {
+                const double wa = w * h[a];
+                rhs[cols[a]] += wa * r;
+                for (size_t b = a; b < len; ++b)
+                    gain_[*pos++] += wa * h[b];
+            }
+        }
+
+        ++stats_.numeric_factorizations;
+        if (!factorize()) {
+            result.observable = false;
+            return result;
+        }
+        solve(rhs);
+        double max_step = 0.0;
+        for (int b = 0; b < n; ++b) {
+            theta_[b] += rhs[2 * b];
+            vmag_[b] += rhs[2 * b + 1];
+            max_step = std::max({ max_step, std::abs(rhs[2 * b]), std::abs(rhs[2 * b + 1]) });
+        }
+        result.iterations = it + 1;
+        if (max_step < settings_.tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,183 @@
+// state_estimator.h
+// 加权最小二乘 (WLS) 状态估计: 由带噪声的量测 (母线电压幅值、PMU相角、节点注入功率、支路潮流) 估计全网
+// 母线电压幅值与相角，使各量测与网络模型相互一致，并给出残差以发现坏数据。
+// - 高斯-牛顿迭代: 每轮在当前状态计算量测函数 h(x) 与雅可比矩阵 H，求解正规方程 (HᵀWH) Δx = HᵀW (z - h(x))；
+// - 增益矩阵 G = HᵀWH 稀疏对称正定，以稀疏Cholesky分解求解。G 的非零结构只取决于量测配置在哪里
+//   (注入量测耦合该母线及其全部相邻母线，潮流量测耦合支路两端)，与量测值、状态以及量测是否暂时缺失无关，
+//   因此最小度排序、消去树、L 的列结构和每个量测在 G 中的累加位置只在量测配置改变时计算一次 (符号分解)，
+//   每轮迭代只重新累加数值并做数值分解。同一母线的相角与幅值结构相同，分解以母线为单位按 2x2 块进行；
+// - 量测按槽位登记，传感器上送时 O(1) 更新对应槽位的值；超时或失效的量测权重视为零，不改变结构。
+//   运行中新增的量测若落在已有结构内，只补算它自己的累加位置，否则在下一次估计前重做符号分解。
+#ifndef STATE_ESTIMATOR_H
+#define STATE_ESTIMATOR_H
+
+#include "PowerSystemTopology.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 支路参数 (标幺值): 串联阻抗与全线充电电纳
+struct SeBranchParameters {
+    double r_pu;
+    double x_pu;
+    double b_pu = 0.0;
+};
+
+enum class SeMeasurementType : uint8_t {
+    V_MAGNITUDE, // 母线电压幅值
+    V_ANGLE, // 母线电压相角 (PMU，相对参考母线，弧度)
+    P_INJECTION, // 节点注入有功 (发电 - 负荷)
+    Q_INJECTION, // 节点注入无功
+    P_FLOW, // 支路有功潮流 (由量测端母线流入支路为正)
+    Q_FLOW, // 支路无功潮流
+};
+
+// 量测配置
+struct SeMeasurement {
+    SeMeasurementType type;
+    BusId bus; // 量测所在母线 (潮流量测为量测端)
+    BranchId branch = 0; // 潮流量测所在支路
+    double sigma = 0.01; // 量测误差标准差 (标幺值)，权重为 1/σ²
+};
+
+struct SeSettings {
+    double tolerance = 1e-4; // 收敛判据: 状态修正量的最大绝对值
+    int max_iterations = 10;
+    double reference_sigma = 1e-4; // 参考母线相角伪量测 (0弧度) 的标准差
+    double pivot_tolerance = 1e-12; // 主元不大于 对角元 × 此值 时认为增益矩阵奇异 (量测不足，不可观)
+};
+
+// 一次估计的结果
+struct SeResult {
+    int iterations = 0;
+    bool converged = false;
+    bool observable = true; // 增益矩阵数值分解成功
+    size_t measurements = 0; // 参与估计的量测数 (含参考相角伪量测)
+    double objective = 0.0; // J(x) = Σ (z - h(x))² / σ² (最后一轮)
+    uint32_t max_residual_slot = UINT32_MAX; // 加权残差 |z - h(x)| / σ 最大的量测槽位
+    double max_normalized_residual = 0.0;
+};
+
+struct SeStats {
+    uint64_t estimates = 0;
+    uint64_t symbolic_analyses = 0; // 符号分解次数
+    uint64_t numeric_factorizations = 0; // 数值分解次数 (每轮迭代一次)
+    uint64_t incremental_additions = 0; // 落在已有结构内、未引起符号分解的新增量测数
+    size_t gain_blocks = 0; // G 上三角的 2x2 块数
+    size_t factor_blocks = 0; // L 的 2x2 块数
+};
+
+class WlsStateEstimator {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    // 由拓扑 (CSR 邻接) 与各支路参数建立网络模型，reference_bus 的相角固定为0 (槽位0为其相角伪量测)。
+    // 参考母线不在拓扑中或缺少支路参数时返回 false。状态初始化为平启动 (幅值1、相角0)。
+    bool build(const PowerSystemTopology& topology, const std::unordered_map<BranchId, SeBranchParameters>& branches,
+        BusId reference_bus, SeSettings settings = {});
+
+    // --- 量测 ---
+    // 登记量测槽位，初始为不可用 (首次 set_value 后参与估计)。母线或支路不存在、潮流量测端不在支路上时返回 NO_SLOT。
+    uint32_t add_measurement(const SeMeasurement& measurement);
+    // 传感器上送: 更新量测值并置为可用
+    void set_value(uint32_t slot, double value)
+    {
+        value_[slot] = value;
+        available_[slot] = 1;
+    }
+    // 量测超时或失效时置为不可用 (权重为零)
+    void set_available(uint32_t slot, bool available) { available_[slot] = available ? 1 : 0; }
+    bool available(uint32_t slot) const { return available_[slot] != 0; }
+    double value(uint32_t slot) const { return value_[slot]; }
+    const SeMeasurement& measurement(uint32_t slot) const { return specs_[slot]; }
+    size_t measurement_count() const { return specs_.size(); }
+
+    // --- 估计 ---
+    // 量测登记完成后在建模阶段做符号分解，使第一次 estimate() 不必承担 (结构未变时不做任何事)
+    void prepare()
+    {
+        if (structure_dirty_)
+            analyze();
+    }
+    // 以当前状态 (上一次的估计结果) 为初值迭代。结构改变后尚未 prepare() 时先做符号分解。
+    // 不可观时状态保持为最后一次成功修正后的值。
+    SeResult estimate();
+    // 量测函数: 以给定状态 (按母线序号) 计算全部槽位的量测值，out 的长度为量测数
+    void evaluate(const std::vector<double>& theta, const std::vector<double>& vmag, std::vector<double>& out) const;
+    void flat_start();
+
+    // --- 查询 ---
+    int bus_count() const { return static_cast<int>(bus_ids_.size()); }
+    int index_of(BusId bus) const; // 不在模型中时返回 -1
+    BusId bus_id(int index) const { return bus_ids_[index]; }
+    const std::vector<double>& theta() const { return theta_; } // 按母线序号的相角估计 (弧度)
+    const std::vector<double>& vmag() const { return vmag_; } // 按母线序号的电压幅值估计
+    const SeStats& stats() const { return stats_; }
+
+private:
+    // 量测的雅可比行: 列为状态编号 (母线 b 的相角为 2b，幅值为 2b+1)
+    size_t row_length(uint32_t slot) const { return col_begin_[slot + 1] - col_begin_[slot]; }
+    // 计算一个量测的值与雅可比行 (h 的长度为 row_length)。注入量测使用 compute_bus_terms 对同一状态算出的中间量。
+    double measure(uint32_t slot, const double* theta, const double* vmag, double* h) const;
+    void compute_bus_terms(const double* theta, const double* vmag) const;
+
+    void analyze(); // 符号分解
+    bool locate_positions(uint32_t slot); // 计算量测在 G 中的累加位置，结构不包含时返回 false
+    int elimination_reach(int k); // L 第 k 块行的非零块列 (work_stack_[top..))，返回 top
+    bool factorize(); // 数值分解 gain_ -> l_x_
+    void solve(std::vector<double>& x) const; // 原地求解 G x = b (含置换)
+
+    SeSettings settings_;
+    std::vector<BusId> bus_ids_;
+    std::unordered_map<BusId, int> index_;
+
+    // 节点导纳矩阵 (CSR，不含对角元，相邻母线按序号排序；并联支路已合并) 与对角元
+    std::vector<int> y_ptr_, y_col_;
+    std::vector<double> y_g_, y_b_;
+    std::vector<double> g_ii_, b_ii_;
+    // 每条支路: 两端母线、串联导纳 g + jb、半充电电纳
+    std::unordered_map<BranchId, uint32_t> branch_index_;
+    std::vector<int> br_from_, br_to_;
+    std::vector<double> br_g_, br_b_, br_bsh_;
+
+    // 量测槽位
+    std::vector<SeMeasurement> specs_;
+    std::vector<int> m_bus_, m_other_; // 量测母线序号、潮流量测的对端序号
+    std::vector<uint32_t> m_branch_;
+    std::vector<double> weight_, value_;
+    std::vector<uint8_t> available_;
+    std::vector<uint32_t> row_cols_; // 全部雅可比行的列 (状态编号)
+    std::vector<size_t> col_begin_; // 长度为量测数+1
+    size_t max_row_ = 0; // 最长的雅可比行
+    std::vector<uint32_t> row_pos_; // 每行各列对 (a <= b) 在 gain_ 中的位置
+    std::vector<size_t> pos_begin_; // 已计算位置的量测数+1
+    bool structure_dirty_ = true;
+
+    // 状态
+    std::vector<double> theta_, vmag_;
+    // 每轮迭代的母线中间量: a_ij = G cos θij + B sin θij，b_ij = G sin θij - B cos θij (按导纳CSR)，
+    // 以及 Σ V_j a_ij、Σ V_j b_ij
+    mutable std::vector<double> term_a_, term_b_;
+    mutable std::vector<double> sum_a_, sum_b_;
+
+    // 符号分解: 母线按最小度排序置换，G 与 L 按母线分为 2x2 块 (块内行优先: 相角、幅值)，按块列压缩存放。
+    // G 只存上三角块，对角块只用其上三角。
+    std::vector<int> perm_; // 状态编号 -> 置换后编号
+    std::vector<int> gain_ptr_, gain_row_; // 块列指针、块行号 (置换后的母线序号，列内递增)
+    std::vector<double> gain_; // 每块4个数
+    std::vector<int> parent_; // 块消去树
+    std::vector<int> l_ptr_; // L 的块列指针，每列第一块为对角块
+    // 数值分解
+    std::vector<int> l_row_;
+    std::vector<double> l_x_;
+    mutable std::vector<double> work_x_; // 按块行展开的稠密工作向量 (每条母线4个数)
+    std::vector<int> work_stack_; // 消去树上可达集 (L 第 k 块行的非零块列)
+    std::vector<int> work_next_; // L 各块列下一个块的写入位置
+    std::vector<uint8_t> work_mark_;
+
+    SeStats stats_;
+};
+
+#endif // STATE_ESTIMATOR_H
@@ -0,0 +1,87 @@
+// timing_wheel.h
+// 单层哈希时间轮 (Hashed Timing Wheel)，仅包含头文件。
+// 用于管理大量同构的短时定时器 (如成千上万个低频减载继电器各轮次的动作延时)：
+// - 调度 (schedule) 为 O(1)：按到期节拍对槽数取模放入对应槽；
+// - 推进 (advance) 每个节拍只扫描一个槽，到期项通过回调交给调用者处理；
+// - 到期时间超过一圈的定时器留在槽中，等到对应圈数再触发。
+// 定时器不支持显式取消：调用者通常在定时器项中携带代数 (generation) 字段，
+// 返回时与当前代数比较，不一致即视为已失效 (惰性取消)，从而避免在槽中查找和删除。
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+template <typename T>
+class TimingWheel {
+public:
+    // slot_count: 槽数，必须为2的幂。通常取大于最长定时时长 (以节拍计) 的值，使定时器不必绕圈。
+    explicit TimingWheel(size_t slot_count = 256)
+        : slots_(slot_count)
+        , mask_(slot_count - 1)
+    {
+        if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0) {
+            throw std::invalid_argument("TimingWheel: 槽数必须为2的幂");
+        }
+    }
+
+    // 在节拍 due_tick 到期时触发 item。已过期的节拍 (<= 当前节拍) 会在下一个节拍触发。
+    void schedule(uint64_t due_tick, const T& item)
+    {
+        if (due_tick <= current_tick_)
+            due_tick = current_tick_ + 1;
+        slots_[due_tick & mask_].push_back({ due_tick, item });
+        ++size_;
+    }
+
+    // 将时间轮推进到节拍 target_tick，对期间每个到期项调用 on_expire(item, due_tick)。
+    // 回调中允许再次调用 schedule (新项到期节拍必然晚于正在处理的节拍)。
+    template <typename Fn>
+    void advance(uint64_t target_tick, Fn&& on_expire)
+    {
+        while (current_tick_ < target_tick) {
+            // 空轮时直接跳到目标节拍，避免逐槽空转
+            if (size_ == 0) {
+                current_tick_ = target_tick;
+                break;
+            }
+            ++current_tick_;
+            auto& slot = slots_[current_tick_ & mask_];
+            expired_.clear();
+            // 就地压缩：未到期 (需再绕圈) 的项保留，到期项移入临时缓冲区
+            size_t kept = 0;
+            for (size_t i = 0; i < slot.size(); ++i) {
+                if (slot[i].due_tick <= current_tick_) {
+                    expired_.push_back(slot[i]);
+                } else {
+                    slot[kept++] = slot[i];
+                }
+            }
+            slot.resize(kept);
+            size_ -= expired_.size();
+            for (const auto& entry : expired_) {
+                on_expire(entry.item, entry.due_tick);
+            }
+        }
+    }
+
+    uint64_t current_tick() const { return current_tick_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    struct Entry {
+        uint64_t due_tick;
+        T item;
+    };
+
+    std::vector<std::vector<Entry>> slots_;
+    std::vector<Entry> expired_; // 推进时的临时缓冲区，复用以避免反复分配
+    uint64_t mask_;
+    uint64_t current_tick_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // TIMING_WHEEL_H
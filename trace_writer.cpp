@@ -0,0 +1,377 @@
+// trace_writer.cpp
+// 实现了逐设备时间序列的抽取、死区过滤与 delta + zigzag + varint 压缩输出。
+
+#include "trace_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+uint64_t zigzag(int64_t v)
+{
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v)
+{
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+template <typename T>
+bool read_pod(std::ifstream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void put_varint(std::vector<unsigned char>& buf, uint64_t v)
+{
+    while (v >= 0x80) {
+        buf.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back(static_cast<unsigned char>(v));
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+bool DeviceTraceWriter::open(const std::string& path, size_t record_count, size_t record_stride, const std::vector<TraceColumn>& columns,
+    TraceWriterSettings settings)
+{
+    close();
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_)
+        return false;
+
+    record_count_ = record_count;
+    record_stride_ = record_stride;
+    columns_ = columns;
+    settings_ = settings;
+    if (settings_.decimation == 0)
+        settings_.decimation = 1;
+    if (settings_.block_samples == 0)
+        settings_.block_samples = 1;
+    if (settings_.ring_blocks < 2)
+        settings_.ring_blocks = 2;
+    if (settings_.chunk_size == 0)
+        settings_.chunk_size = record_count_ ? record_count_ : 1;
+    stats_ = {};
+
+    out_.write("CPSTRC01", 8);
+    write_pod(out_, static_cast<uint32_t>(record_count_));
+    write_pod(out_, static_cast<uint32_t>(columns_.size()));
+    write_pod(out_, static_cast<uint32_t>(settings_.decimation));
+    stats_.bytes_written = 8 + 3 * sizeof(uint32_t);
+    for (const auto& col : columns_) {
+        write_pod(out_, static_cast<uint16_t>(col.name.size()));
+        out_.write(col.name.data(), static_cast<std::streamsize>(col.name.size()));
+        write_pod(out_, col.resolution);
+        write_pod(out_, col.deadband);
+        stats_.bytes_written += sizeof(uint16_t) + col.name.size() + 2 * sizeof(double);
+    }
+
+    blocks_.resize(settings_.ring_blocks);
+    for (auto& block : blocks_) {
+        block.records.resize(settings_.block_samples * record_count_ * record_stride_);
+        block.times_s.resize(settings_.block_samples);
+        block.samples = 0;
+    }
+    front_ = 0;
+    queued_ = 0;
+    stop_ = false;
+    last_quantized_.assign(columns_.size() * record_count_, 0);
+    deadband_quantized_.clear();
+    for (const auto& col : columns_)
+        deadband_quantized_.push_back(static_cast<int64_t>(std::floor(col.deadband / col.resolution)));
+    last_time_ms_ = 0;
+
+    // 仿真线程占用一个核，其余核用于编码 (后台线程本身也参与)
+    unsigned threads = settings_.encode_threads;
+    if (threads == 0) {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        threads = hardware > 1 ? hardware - 1 : 1;
+    }
+    executor_ = std::make_unique<ParallelExecutor>(threads);
+    chunks_.assign(ParallelExecutor::chunk_count(record_count_, settings_.chunk_size), ChunkOutput {});
+
+    open_ = true;
+    encoder_ = std::thread(&DeviceTraceWriter::encoder_loop, this);
+    return true;
+}
+
+void DeviceTraceWriter::record(double time_s, const void* records)
+{
+    if (!open_)
+        return;
+    if (stats_.steps_offered++ % settings_.decimation != 0)
+        return;
+
+    auto copy_start = std::chrono::steady_clock::now();
+    Block& block = blocks_[front_];
+    const size_t bytes = record_count_ * record_stride_;
+    std::memcpy(block.records.data() + block.samples * bytes, records, bytes);
+    block.times_s[block.samples] = time_s;
+    ++block.samples;
+    stats_.producer_copy_ms += elapsed_ms(copy_start);
+
+    if (block.samples == settings_.block_samples)
+        hand_off_front();
+}
+
+void DeviceTraceWriter::hand_off_front()
+{
+    auto wait_start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 只有其余各块都在排队 (后台线程持续落后) 时才等待
+    cv_.wait(lock, [this] { return queued_ + 1 < blocks_.size(); });
+    stats_.producer_wait_ms += elapsed_ms(wait_start);
+    ++queued_;
+    front_ = (front_ + 1) % blocks_.size();
+    blocks_[front_].samples = 0;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void DeviceTraceWriter::encoder_loop()
+{
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return queued_ > 0 || stop_; });
+        if (queued_ == 0)
+            return; // stop_ 且没有待处理的块
+        const Block& block = blocks_[(front_ + blocks_.size() - queued_) % blocks_.size()]; // 最早排队的块
+        lock.unlock();
+
+        auto encode_start = std::chrono::steady_clock::now();
+        encode_block(block);
+        double ms = elapsed_ms(encode_start);
+
+        lock.lock();
+        stats_.encode_ms += ms;
+        --queued_;
+        lock.unlock();
+        cv_.notify_all();
+    }
+}
+
+void DeviceTraceWriter::encode_chunk(const Block& block, size_t begin, size_t end, ChunkOutput& chunk)
+{
+    chunk.bytes.clear();
+    chunk.segments.resize(block.samples * columns_.size());
+    const size_t bytes = record_count_ * record_stride_;
+    for (size_t s = 0; s < block.samples; ++s) {
+        const unsigned char* records = block.records.data() + s * bytes;
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            const TraceColumn& col = columns_[c];
+            int64_t* last = last_quantized_.data() + c * record_count_;
+            const int64_t deadband = deadband_quantized_[c];
+            // 乘以倒数的近似量化值与精确值 (除法后取整前) 相差不过几个ulp，明显落在死区内时跳过除法与取整
+            const double inverse = 1.0 / col.resolution;
+            const double reject = static_cast<double>(deadband) + 0.49;
+            ChunkSegment segment;
+            int64_t prev_device = -1;
+            for (size_t d = begin; d < end; ++d) {
+                double value;
+                std::memcpy(&value, records + d * record_stride_ + col.offset, sizeof(double));
+                const double approx = value * inverse;
+                if (std::abs(approx - static_cast<double>(last[d])) < reject && std::abs(approx) < 1.0e12)
+                    continue;
+                int64_t q = std::llround(value / col.resolution);
+                int64_t delta = q - last[d];
+                if (delta == 0 || (delta <= deadband && delta >= -deadband))
+                    continue;
+                if (segment.count == 0)
+                    segment.first_device = static_cast<uint32_t>(d);
+                else
+                    put_varint(chunk.bytes, static_cast<uint64_t>(static_cast<int64_t>(d) - prev_device));
+                put_varint(chunk.bytes, zigzag(delta));
+                last[d] = q;
+                prev_device = static_cast<int64_t>(d);
+                segment.last_device = static_cast<uint32_t>(d);
+                ++segment.count;
+            }
+            segment.end = chunk.bytes.size();
+            chunk.segments[s * columns_.size() + c] = segment;
+        }
+    }
+}
+
+void DeviceTraceWriter::encode_block(const Block& block)
+{
+    if (block.samples == 0)
+        return;
+    // 各设备区间互不相交 (每台设备的上次记录值只由所属区间更新)，可以并行编码
+    executor_->parallel_for(record_count_, settings_.chunk_size,
+        [&](size_t k, size_t begin, size_t end) { encode_chunk(block, begin, end, chunks_[k]); });
+
+    payload_.clear();
+    uint64_t changes = 0;
+    for (size_t s = 0; s < block.samples; ++s) {
+        int64_t time_ms = std::llround(block.times_s[s] * 1000.0);
+        put_varint(payload_, zigzag(time_ms - last_time_ms_));
+        last_time_ms_ = time_ms;
+
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            const size_t index = s * columns_.size() + c;
+            uint64_t count = 0;
+            for (const auto& chunk : chunks_)
+                count += chunk.segments[index].count;
+            put_varint(payload_, count);
+            // 按区间顺序拼接，补写每个区间首个变化相对前一个变化设备的序号差
+            int64_t prev_device = -1;
+            for (const auto& chunk : chunks_) {
+                const ChunkSegment& segment = chunk.segments[index];
+                if (segment.count == 0)
+                    continue;
+                const size_t begin = index == 0 ? 0 : chunk.segments[index - 1].end;
+                put_varint(payload_, static_cast<uint64_t>(static_cast<int64_t>(segment.first_device) - prev_device));
+                payload_.insert(payload_.end(), chunk.bytes.begin() + begin, chunk.bytes.begin() + segment.end);
+                prev_device = segment.last_device;
+            }
+            changes += count;
+        }
+    }
+
+    write_pod(out_, static_cast<uint32_t>(block.samples));
+    write_pod(out_, static_cast<uint32_t>(payload_.size()));
+    out_.write(reinterpret_cast<const char*>(payload_.data()), static_cast<std::streamsize>(payload_.size()));
+
+    // 统计只由后台线程更新 (仿真线程在 close() 汇合之后才读取)
+    stats_.samples_recorded += block.samples;
+    stats_.changes_recorded += changes;
+    stats_.raw_bytes += block.samples * record_count_ * columns_.size() * sizeof(double);
+    stats_.bytes_written += 2 * sizeof(uint32_t) + payload_.size();
+}
+
+void DeviceTraceWriter::close()
+{
+    if (!encoder_.joinable())
+        return;
+    open_ = false;
+    if (blocks_[front_].samples > 0)
+        hand_off_front();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    encoder_.join();
+    executor_.reset();
+    out_.close();
+}
+
+// --- DeviceTraceReader ---
+
+bool DeviceTraceReader::open(const std::string& path)
+{
+    in_.close();
+    in_.clear();
+    in_.open(path, std::ios::binary);
+    if (!in_)
+        return false;
+
+    char magic[8];
+    uint32_t record_count = 0, column_count = 0, decimation = 0;
+    if (!in_.read(magic, sizeof(magic)) || std::memcmp(magic, "CPSTRC01", sizeof(magic)) != 0 || !read_pod(in_, record_count)
+        || !read_pod(in_, column_count) || !read_pod(in_, decimation))
+        return false;
+    record_count_ = record_count;
+    decimation_ = decimation ? decimation : 1;
+    columns_.clear();
+    for (uint32_t c = 0; c < column_count; ++c) {
+        uint16_t name_size = 0;
+        TraceColumn col { {}, c, 0.0, 0.0 };
+        if (!read_pod(in_, name_size))
+            return false;
+        col.name.resize(name_size);
+        if (!in_.read(col.name.data(), name_size) || !read_pod(in_, col.resolution) || !read_pod(in_, col.deadband))
+            return false;
+        columns_.push_back(std::move(col));
+    }
+
+    payload_.clear();
+    position_ = 0;
+    block_samples_left_ = 0;
+    quantized_.assign(columns_.size() * record_count_, 0);
+    time_ms_ = 0;
+    return true;
+}
+
+bool DeviceTraceReader::load_block()
+{
+    if (position_ != payload_.size())
+        throw std::runtime_error("曲线文件损坏: 数据块负载与样本数不符");
+    uint32_t samples = 0, bytes = 0;
+    if (!read_pod(in_, samples))
+        return false; // 文件在块边界处结束
+    if (!read_pod(in_, bytes) || samples == 0)
+        throw std::runtime_error("曲线文件损坏: 数据块头不完整");
+    payload_.resize(bytes);
+    if (!in_.read(reinterpret_cast<char*>(payload_.data()), bytes))
+        throw std::runtime_error("曲线文件损坏: 数据块被截断");
+    position_ = 0;
+    block_samples_left_ = samples;
+    return true;
+}
+
+uint64_t DeviceTraceReader::get_varint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position_ >= payload_.size())
+            throw std::runtime_error("曲线文件损坏: varint 越过数据块末尾");
+        const unsigned char byte = payload_[position_++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw std::runtime_error("曲线文件损坏: varint 过长");
+}
+
+bool DeviceTraceReader::next(double& time_s, std::vector<double>& values)
+{
+    if (!in_.is_open())
+        return false;
+    if (block_samples_left_ == 0 && !load_block())
+        return false;
+    --block_samples_left_;
+
+    time_ms_ += unzigzag(get_varint());
+    time_s = time_ms_ / 1000.0;
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        int64_t* quantized = quantized_.data() + c * record_count_;
+        const uint64_t count = get_varint();
+        int64_t device = -1;
+        for (uint64_t k = 0; k < count; ++k) {
+            const uint64_t gap = get_varint();
+            if (gap == 0 || gap > record_count_ || static_cast<uint64_t>(device + 1) + gap - 1 >= record_count_)
+                throw std::runtime_error("曲线文件损坏: 设备序号越界");
+            device += static_cast<int64_t>(gap);
+            quantized[device] += unzigzag(get_varint());
+        }
+    }
+
+    values.resize(quantized_.size());
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const double resolution = columns_[c].resolution;
+        const int64_t* quantized = quantized_.data() + c * record_count_;
+        double* out = values.data() + c * record_count_;
+        for (size_t d = 0; d < record_count_; ++d)
+            out[d] = static_cast<double>(quantized[d]) * resolution;
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+// trace_writer.h
+// 逐设备时间序列 (功率、SOC 等) 的压缩输出。
+// 10^5 台设备、20毫秒步长的逐设备曲线按原始格式输出每次运行可达数GB。本写入器在仿真线程上只做一次 memcpy
+// (把本步全部设备的记录复制到当前缓冲块)，压缩和写文件由后台线程完成:
+// - 抽取: 每 decimation 个仿真步记录一次；
+// - 死区: 每列每台设备只在数值相对上次记录值的变化超过 deadband 时才记录 (只记变化)；
+// - 压缩: 数值按列的分辨率量化为整数，变化记录为 (设备序号差, 量化值差)，两者均经 zigzag + varint 编码。
+// 缓冲块组成环形队列: 仿真线程写当前块，交出的块按顺序排队，由后台线程逐块压缩。每块按设备区间切分，
+// 由后台线程与 ParallelExecutor 的工作线程并行编码后按区间顺序拼接，文件内容与顺序编码逐字节相同。
+// 队列深度应使后台编码始终跟得上仿真；只有全部块都在排队时仿真线程才会等待，等待时间计入 producer_wait_ms。
+//
+// 文件格式 (小端):
+//   文件头: 魔数 "CPSTRC01" (8字节) | uint32 设备数 | uint32 列数 | uint32 抽取间隔
+//           | 每列: uint16 列名字节数 + 列名 (UTF-8) | double 分辨率 | double 死区
+//   数据块: uint32 样本数 | uint32 负载字节数 | 负载
+//   负载:   逐个样本: varint zigzag(时间差, 毫秒)
+//                     | 逐列: varint 变化数 k | k 组 (varint 设备序号差, varint zigzag(量化值差))
+// 设备序号差为相对本列上一个变化设备的序号之差 (首个相对 -1)；量化值差相对该设备本列上次记录的值 (初始为0)。
+// 解码须从文件开头顺序进行，数值 = 累计量化值 × 分辨率 (DeviceTraceReader)。
+// 解码值与记录时的原始值之差不超过 死区 + 分辨率/2。
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include "parallel_for.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 一列: 设备记录中偏移 offset 处的 double 字段
+struct TraceColumn {
+    std::string name;
+    size_t offset; // 字段在设备记录中的字节偏移
+    double resolution; // 量化分辨率 (例如功率 0.001 kW)
+    double deadband; // 变化不超过此值时不记录 (与数值同单位，0 表示任何变化都记录)
+};
+
+struct TraceWriterSettings {
+    size_t decimation = 1; // 每隔多少个仿真步记录一次
+    size_t block_samples = 8; // 每个缓冲块容纳的样本数
+    size_t ring_blocks = 4; // 环形队列中的缓冲块数 (至少2)
+    unsigned encode_threads = 0; // 编码并行度 (含后台线程)，0 表示硬件并发数减去仿真线程
+    size_t chunk_size = 8192; // 并行编码时每块的设备数
+};
+
+struct TraceWriterStats {
+    uint64_t steps_offered = 0; // record() 的调用次数
+    uint64_t samples_recorded = 0; // 抽取后实际记录的样本数
+    uint64_t changes_recorded = 0; // 超出死区而写入的数值个数
+    uint64_t raw_bytes = 0; // 同样的样本按每个数值8字节原始输出所需的字节数
+    uint64_t bytes_written = 0; // 实际写入文件的字节数
+    double encode_ms = 0.0; // 后台线程的压缩与写文件耗时
+    double producer_copy_ms = 0.0; // 仿真线程的复制耗时
+    double producer_wait_ms = 0.0; // 仿真线程等待后台线程腾出缓冲块的耗时 (队列已满时)
+};
+
+class DeviceTraceWriter {
+public:
+    DeviceTraceWriter() = default;
+    ~DeviceTraceWriter() { close(); }
+
+    DeviceTraceWriter(const DeviceTraceWriter&) = delete;
+    DeviceTraceWriter& operator=(const DeviceTraceWriter&) = delete;
+
+    // 创建 (覆盖) 文件、写入文件头并启动后台线程。
+    // record_count: 设备数；record_stride: 每台设备记录的字节数 (记录按设备连续存放)。失败时返回 false。
+    bool open(const std::string& path, size_t record_count, size_t record_stride, const std::vector<TraceColumn>& columns,
+        TraceWriterSettings settings = {});
+
+    // 提交一个仿真步: records 指向 record_count 条连续的设备记录。按抽取间隔决定是否复制，不做其他计算。
+    void record(double time_s, const void* records);
+
+    // 交出未满的缓冲块，等待后台线程写完并关闭文件
+    void close();
+
+    bool is_open() const { return open_; }
+    // 统计 (close() 之后完整)
+    const TraceWriterStats& stats() const { return stats_; }
+
+private:
+    struct Block {
+        std::vector<unsigned char> records; // block_samples × record_count × record_stride
+        std::vector<double> times_s;
+        size_t samples = 0;
+    };
+
+    // 一个设备区间在一个 (样本, 列) 上的编码结果。区间内首个变化只写量化值差，
+    // 设备序号差在拼接时相对前一区间的最后一个变化设备补写。
+    struct ChunkSegment {
+        uint32_t count = 0;
+        uint32_t first_device = 0;
+        uint32_t last_device = 0;
+        size_t end = 0; // 在所属区间 bytes 中的结束偏移
+    };
+    struct ChunkOutput {
+        std::vector<unsigned char> bytes;
+        std::vector<ChunkSegment> segments; // 按 样本 × 列 排列
+    };
+
+    void hand_off_front(); // 把当前块排入队列并切换到下一个空闲块
+    void encoder_loop();
+    void encode_block(const Block& block);
+    void encode_chunk(const Block& block, size_t begin, size_t end, ChunkOutput& chunk);
+
+    std::ofstream out_; // open() 写完文件头后只由后台线程访问，直至 close() 汇合
+    bool open_ = false; // 仿真线程的打开标志 (open/record/close 均在仿真线程调用)，热路径不触及 out_
+    size_t record_count_ = 0;
+    size_t record_stride_ = 0;
+    std::vector<TraceColumn> columns_;
+    TraceWriterSettings settings_;
+    TraceWriterStats stats_;
+
+    // 环形缓冲队列
+    std::vector<Block> blocks_;
+    size_t front_ = 0; // 仿真线程正在写入的块
+    size_t queued_ = 0; // 已交出、后台线程尚未处理完的块数 (位于 front_ 之前)
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread encoder_;
+
+    // 后台线程的编码状态
+    std::vector<int64_t> last_quantized_; // 每列每台设备上次记录的量化值
+    std::vector<int64_t> deadband_quantized_; // 每列的死区 (量化单位)
+    int64_t last_time_ms_ = 0;
+    std::vector<unsigned char> payload_;
+    std::unique_ptr<ParallelExecutor> executor_;
+    std::vector<ChunkOutput> chunks_;
+};
+
+// 顺序读取 DeviceTraceWriter 写出的文件，逐个样本还原全部设备各列的数值
+class DeviceTraceReader {
+public:
+    // 打开文件并读取文件头。无法打开或文件头不符时返回 false。
+    bool open(const std::string& path);
+
+    size_t record_count() const { return record_count_; }
+    size_t decimation() const { return decimation_; }
+    // 各列的名称、分辨率与死区 (offset 为列序号)
+    const std::vector<TraceColumn>& columns() const { return columns_; }
+
+    // 解码下一个样本。values[c * record_count() + d] 为设备 d 在列 c 上最近一次记录的值 (从未记录过为0)。
+    // 文件结束时返回 false；数据损坏或截断时抛出 std::runtime_error。
+    bool next(double& time_s, std::vector<double>& values);
+
+private:
+    bool load_block();
+    uint64_t get_varint();
+
+    std::ifstream in_;
+    size_t record_count_ = 0;
+    size_t decimation_ = 1;
+    std::vector<TraceColumn> columns_;
+    std::vector<unsigned char> payload_;
+    size_t position_ = 0;
+    uint32_t block_samples_left_ = 0;
+    std::vector<int64_t> quantized_; // 每列每台设备的累计量化值
+    int64_t time_ms_ = 0;
+};
+
+#endif // TRACE_WRITER_H
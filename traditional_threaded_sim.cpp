@@ -9,11 +9,13 @@
 #include <iomanip> // 用于输出格式化 (std::fixed, std::setprecision)
 #include <iostream> // 标准输入输出流 (std::cout)
 #include <mutex> // 用于互斥锁 (std::mutex, std::lock_guard, std::unique_lock)，保护共享数据
-#include <random> // 用于生成随机数 (std::random_device, std::mt19937, std::uniform_real_distribution)
 #include <sstream> // 用于日志中的设备名称
 #include <thread> // C++标准线程库 (std::thread)
 #include <vector> // C++标准动态数组 (std::vector，存储线程对象)
 
+#include "counter_rng.h" // 基于计数器的随机数生成器 (仅头文件，与HECS版本共用)
+#include "phase_profiler.h" // 按仿真阶段的性能统计 (与HECS版本共用)
+
 // 平台相关的头文件，用于内存统计
 #if defined(_WIN32)
 #include <psapi.h>
@@ -312,17 +314,21 @@ int main()
     int total_devices = NUM_EV_STATIONS * PILES_PER_STATION + NUM_ESS_UNITS;
     std::cout << "信息: 即将创建 " << total_devices << " 个设备线程。" << std::endl;
 
+    // CPS_PHASE_PROFILE=1 时按阶段统计。计数器由设备线程继承，各线程的计数在其结束时并入汇合阶段 (run_until)
+    PhaseProfiler& profiler = PhaseProfiler::instance();
+    profiler.enable_from_env(true);
+
     auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    profiler.enter(SimPhase::SETUP);
 
     SharedFrequencyData shared_freq_data;
     std::vector<std::thread> device_threads;
 
     std::thread oracle_thread(frequency_oracle_thread_func, std::ref(shared_freq_data));
 
-    // 用于EV初始SOC的随机数生成器 (同HECS)
-    std::random_device rd_ev_soc;
-    std::mt19937 rng_ev_soc(rd_ev_soc());
-    std::uniform_real_distribution<double> dist_ev_soc(0.25, 0.90);
+    // EV初始SOC的随机数种子 (同HECS)。HECS中EV充电桩是最先创建的实体，实体ID为设备序号+1，
+    // 以相同的 (种子, 实体ID) 抽取即可得到与HECS版本完全相同的初始SOC
+    const uint64_t ev_soc_seed = 20240601;
 
     int device_id_counter = 0;
 
@@ -349,7 +355,7 @@ int main()
             ev_config.soc_min_threshold = 0.10;
             ev_config.soc_max_threshold = 0.95;
             ev_config.battery_capacity_kWh = 50.0;
-            ev_config.initial_soc = dist_ev_soc(rng_ev_soc);
+            ev_config.initial_soc = CounterRng::uniform_at(ev_soc_seed, device_id_counter + 1, RngStream::INITIAL_SOC, 0, 0.25, 0.90);
 
             device_threads.emplace_back(device_thread_func, ev_config, std::ref(shared_freq_data));
             device_id_counter++;
@@ -380,7 +386,9 @@ int main()
 
     std::cout << "信息: 已启动 " << device_threads.size() << " 个设备线程。" << std::endl;
     std::cout << "信息: 仿真将运行 " << SIMULATION_DURATION_SECONDS << " 秒 (模拟时间)..." << std::endl;
+    profiler.leave();
 
+    profiler.enter(SimPhase::RUN_UNTIL);
     if (oracle_thread.joinable()) {
         oracle_thread.join();
     }
@@ -391,6 +399,7 @@ int main()
             th.join();
         }
     }
+    profiler.leave();
     // std::cout << "调试: 所有设备线程已汇合。" << std::endl;
 
     if (g_data_logger.is_open()) {
@@ -412,6 +421,8 @@ int main()
         std::cout << "警告: 未能获取峰值内存使用数据。" << std::endl;
     }
     std::cout << "仿真结果已保存到文件: traditional_threaded_vpp_results.csv" << std::endl;
+    for (const auto& line : profiler.report_lines())
+        std::cout << line << std::endl;
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,267 @@
+// ufls_system.cpp
+// 实现了低频减载子系统的继电器批量判定、延时管理和切负荷逻辑。
+
+#include "ufls_system.h"
+#include "logging_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// 根据最长动作延时确定时间轮槽数 (2的幂)，使定时器不必绕圈
+size_t wheel_slot_count(const UflsSettings& settings)
+{
+    double max_delay_ms = 0.0;
+    for (const auto& stage : settings.stages)
+        max_delay_ms = std::max(max_delay_ms, stage.delay_ms);
+    size_t ticks = static_cast<size_t>(std::ceil(max_delay_ms / settings.step_ms)) + 1;
+    size_t slots = 64;
+    while (slots < ticks)
+        slots <<= 1;
+    return slots;
+}
+
+} // namespace
+
+// FeederLoadComponent 构造函数实现
+FeederLoadComponent::FeederLoadComponent(double load_kW, int priority)
+    : initial_load_kW(load_kW)
+    , connected_load_kW(load_kW)
+    , shed_priority(priority)
+{
+}
+
+UflsSystem::UflsSystem(Registry& registry, cps_coro::Scheduler& scheduler, UflsSettings settings)
+    : registry_(registry)
+    , scheduler_(scheduler)
+    , settings_(std::move(settings))
+    , timers_(wheel_slot_count(settings_))
+{
+}
+
+void UflsSystem::add_feeder(Entity feeder, double threshold_offset_Hz)
+{
+    auto load = registry_.get<FeederLoadComponent>(feeder);
+    if (!load) {
+        if (g_console_logger)
+            g_console_logger->error("[低频减载] 实体 #{} 没有馈线负荷组件，无法装设低频减载继电器。", feeder);
+        return;
+    }
+    feeders_.push_back(feeder);
+    feeder_loads_.push_back(load);
+    threshold_offsets_Hz_.push_back(threshold_offset_Hz);
+}
+
+void UflsSystem::start()
+{
+    const size_t n = feeders_.size();
+    const size_t stage_count = settings_.stages.size();
+
+    thresholds_Hz_.assign(stage_count * n, 0.0);
+    picked_up_.assign(stage_count * n, 0);
+    tripped_.assign(stage_count * n, 0);
+    generation_.assign(stage_count * n, 0);
+    pickup_scratch_.assign(n, 0);
+    stage_max_threshold_Hz_.assign(stage_count, -1.0e9);
+    stage_picked_count_.assign(stage_count, 0);
+    stage_trip_count_.assign(stage_count, 0);
+    stage_delay_ticks_.assign(stage_count, 1);
+
+    for (size_t s = 0; s < stage_count; ++s) {
+        const auto& stage = settings_.stages[s];
+        stage_delay_ticks_[s] = std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(stage.delay_ms / settings_.step_ms)));
+        for (size_t i = 0; i < n; ++i) {
+            double threshold = stage.threshold_Hz + threshold_offsets_Hz_[i];
+            thresholds_Hz_[s * n + i] = threshold;
+            stage_max_threshold_Hz_[s] = std::max(stage_max_threshold_Hz_[s], threshold);
+        }
+    }
+
+    if (g_console_logger) {
+        g_console_logger->info("[低频减载] 已在 {} 条馈线上装设 {} 轮低频减载继电器 (共 {} 个)。",
+            n, stage_count, n * stage_count);
+    }
+
+    frequency_step_task().detach();
+    load_shed_request_task().detach();
+    stability_concern_task().detach();
+}
+
+// 对全部继电器做一次批量判定。
+// 频率高于某轮全部定值且该轮没有已启动的继电器时整轮跳过，因此正常运行时每步只需 O(轮次数) 的开销；
+// 需要判定时，先对整轮做无分支的比较并累计变化标志，只有状态确有变化时才逐个处理启动/返回。
+void UflsSystem::evaluate_relays(double deviation_hz)
+{
+    const size_t n = feeders_.size();
+    for (size_t s = 0; s < settings_.stages.size(); ++s) {
+        if (stage_picked_count_[s] == 0 && deviation_hz > stage_max_threshold_Hz_[s])
+            continue;
+
+        const double* thresholds = thresholds_Hz_.data() + s * n;
+        const uint8_t* tripped = tripped_.data() + s * n;
+        uint8_t* picked = picked_up_.data() + s * n;
+        uint8_t* next = pickup_scratch_.data();
+
+        uint8_t any_change = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t p = static_cast<uint8_t>(deviation_hz <= thresholds[i]) & static_cast<uint8_t>(tripped[i] ^ 1u);
+            next[i] = p;
+            any_change |= static_cast<uint8_t>(p ^ picked[i]);
+        }
+        if (!any_change)
+            continue;
+
+        for (size_t i = 0; i < n; ++i) {
+            if (next[i] == picked[i])
+                continue;
+            const size_t idx = s * n + i;
+            picked[i] = next[i];
+            ++generation_[idx]; // 启动或返回都会使之前的定时器失效
+            if (next[i]) {
+                ++stage_picked_count_[s];
+                timers_.schedule(current_tick_ + stage_delay_ticks_[s], { static_cast<uint32_t>(idx), generation_[idx] });
+            } else {
+                --stage_picked_count_[s];
+            }
+        }
+    }
+}
+
+void UflsSystem::on_timer_expired(const RelayTimer& timer)
+{
+    const size_t idx = timer.relay;
+    if (generation_[idx] != timer.generation || !picked_up_[idx] || tripped_[idx])
+        return; // 延时期间频率已恢复，或继电器已被闭锁
+
+    const size_t n = feeders_.size();
+    const size_t s = idx / n;
+    const size_t i = idx % n;
+    picked_up_[idx] = 0;
+    tripped_[idx] = 1;
+    --stage_picked_count_[s];
+    ++stage_trip_count_[s];
+    shed_feeder(i, settings_.stages[s].shed_fraction * feeder_loads_[i]->initial_load_kW);
+}
+
+double UflsSystem::shed_feeder(size_t feeder_idx, double amount_kW)
+{
+    auto* load = feeder_loads_[feeder_idx];
+    double shed = std::min(amount_kW, load->connected_load_kW);
+    if (shed <= 0.0)
+        return 0.0;
+    load->connected_load_kW -= shed;
+    step_shed_kW_ += shed;
+    total_shed_kW_ += shed;
+    return shed;
+}
+
+// 将本步内累计切除的负荷合并为一条记录，供频率模型叠加
+void UflsSystem::commit_step_shedding(double time_s)
+{
+    if (step_shed_kW_ <= 0.0)
+        return;
+    // 切除负荷相当于负的负荷阶跃
+    shed_response_.add_step(time_s, -step_shed_kW_ / settings_.system_base_kW);
+    if (g_console_logger) {
+        g_console_logger->info("[{}毫秒] [低频减载] 本步切除负荷 {:.1f} kW，累计切除 {:.1f} kW。",
+            scheduler_.now().time_since_epoch().count(), step_shed_kW_, total_shed_kW_);
+    }
+    step_shed_kW_ = 0.0;
+}
+
+double UflsSystem::adjust_deviation(double sim_time_s, double base_deviation_hz)
+{
+    // 各次切负荷的影响已增量叠加，每步查询的开销与切负荷次数无关
+    return base_deviation_hz + shed_response_.deviation(sim_time_s);
+}
+
+// 协程任务：按频率最新值通道的每次发布逐步判定全部继电器并推进动作延时
+cps_coro::Task UflsSystem::frequency_step_task()
+{
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(scheduler_.latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
+    while (true) {
+        const FrequencyInfo& info = co_await frequency_reader.next();
+        current_tick_ = static_cast<uint64_t>(std::llround(info.current_sim_time_seconds * 1000.0 / settings_.step_ms));
+        last_deviation_Hz_ = info.freq_deviation_hz;
+
+        // 先判定启动/返回 (返回会使定时器失效)，再推进时间轮，使到期的继电器以本步频率确认后动作
+        evaluate_relays(info.freq_deviation_hz);
+        timers_.advance(current_tick_, [this](const RelayTimer& timer, uint64_t) { on_timer_expired(timer); });
+        commit_step_shedding(info.current_sim_time_seconds);
+    }
+}
+
+// 协程任务：响应远方切负荷请求，按优先级整条切除馈线，直至满足请求容量
+cps_coro::Task UflsSystem::load_shed_request_task()
+{
+    while (true) {
+        LoadShedRequest request = co_await cps_coro::wait_for_event<LoadShedRequest>(LOAD_SHED_REQUEST_EVENT);
+
+        if (shed_order_.empty()) {
+            shed_order_.resize(feeders_.size());
+            std::iota(shed_order_.begin(), shed_order_.end(), 0);
+            std::stable_sort(shed_order_.begin(), shed_order_.end(), [this](size_t a, size_t b) {
+                return feeder_loads_[a]->shed_priority < feeder_loads_[b]->shed_priority;
+            });
+        }
+
+        const size_t n = feeders_.size();
+        double remaining = request.amount_kW;
+        size_t feeders_shed = 0;
+        for (size_t i : shed_order_) {
+            if (remaining <= 0.0)
+                break;
+            double shed = shed_feeder(i, feeder_loads_[i]->connected_load_kW);
+            if (shed <= 0.0)
+                continue;
+            remaining -= shed;
+            ++feeders_shed;
+            // 已整条切除的馈线闭锁其低频减载继电器
+            for (size_t s = 0; s < settings_.stages.size(); ++s) {
+                const size_t idx = s * n + i;
+                if (picked_up_[idx]) {
+                    picked_up_[idx] = 0;
+                    --stage_picked_count_[s];
+                }
+                tripped_[idx] = 1;
+            }
+        }
+
+        if (g_console_logger) {
+            g_console_logger->info("[{}毫秒] [低频减载] 收到切负荷请求 (请求方实体 #{})：请求 {:.1f} kW，切除 {} 条馈线。",
+                scheduler_.now().time_since_epoch().count(), request.requester_entity, request.amount_kW, feeders_shed);
+        }
+        commit_step_shedding(scheduler_.now().time_since_epoch().count() / 1000.0);
+    }
+}
+
+// 协程任务：响应稳定性告警。频率已明显下降时发起预防性切负荷，否则只记录当前状态。
+cps_coro::Task UflsSystem::stability_concern_task()
+{
+    while (true) {
+        co_await cps_coro::wait_for_event<void>(STABILITY_CONCERN_EVENT);
+
+        size_t picked = std::accumulate(stage_picked_count_.begin(), stage_picked_count_.end(), size_t { 0 });
+        if (g_console_logger) {
+            g_console_logger->info("[{}毫秒] [低频减载] 收到稳定性告警。当前频率偏差 {:.4f} Hz，已启动继电器 {} 个，累计切除 {:.1f} kW。",
+                scheduler_.now().time_since_epoch().count(), last_deviation_Hz_, picked, total_shed_kW_);
+        }
+        if (settings_.preventive_shed_kW > 0.0 && last_deviation_Hz_ < settings_.alert_deviation_Hz) {
+            scheduler_.trigger_event(LOAD_SHED_REQUEST_EVENT, LoadShedRequest { settings_.preventive_shed_kW, 0 });
+        }
+    }
+}
+
+void UflsSystem::log_summary() const
+{
+    if (!g_console_logger)
+        return;
+    for (size_t s = 0; s < settings_.stages.size(); ++s) {
+        const auto& stage = settings_.stages[s];
+        g_console_logger->info("[低频减载] 第{}轮 (定值 {:.2f} Hz, 延时 {:.0f} 毫秒, 切除 {:.0f}%): 动作 {} / {} 条馈线。",
+            s + 1, stage.threshold_Hz, stage.delay_ms, stage.shed_fraction * 100.0, stage_trip_count_[s], feeders_.size());
+    }
+    g_console_logger->info("[低频减载] 累计切除负荷 {:.1f} kW。", total_shed_kW_);
+}
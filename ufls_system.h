@@ -0,0 +1,116 @@
+// ufls_system.h
+// 低频减载 (Under-Frequency Load Shedding, UFLS) 子系统。
+// 在成千上万条馈线负荷上配置分轮次的低频继电器 (频率定值、动作延时、切除比例)，
+// 每个频率步长 (与VPP相同的20ms) 对全部继电器做一次批量判定，各轮次的动作延时由时间轮管理，
+// 切除的负荷通过 FrequencyModelAdjuster 接口反馈到频率模型中。
+// 同时响应 LOAD_SHED_REQUEST_EVENT (远方切负荷请求) 和 STABILITY_CONCERN_EVENT (稳定性告警)。
+#ifndef UFLS_SYSTEM_H
+#define UFLS_SYSTEM_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "frequency_system.h"
+#include "simulation_events_and_data.h"
+#include "timing_wheel.h"
+
+#include <cstdint>
+#include <vector>
+
+// 组件 (Component): 馈线负荷
+// 表示一条可被低频减载或远方切负荷控制的馈线出线负荷。
+struct FeederLoadComponent : public IComponent {
+    double initial_load_kW; // 扰动前的馈线负荷 (kW)
+    double connected_load_kW; // 当前仍在运行的负荷 (kW)
+    int shed_priority; // 远方切负荷顺序，数值越小越先被切除
+
+    FeederLoadComponent(double load_kW, int priority = 0);
+};
+
+// 低频减载轮次定值
+struct UflsStageSetting {
+    double threshold_Hz; // 动作频率偏差定值 (Hz，负值)，例如 -0.5 表示 49.5Hz
+    double delay_ms; // 动作延时 (毫秒)，频率须持续低于定值达到该时长才动作
+    double shed_fraction; // 动作时切除的馈线初始负荷比例 (0~1)
+};
+
+// 低频减载子系统整体配置
+struct UflsSettings {
+    std::vector<UflsStageSetting> stages; // 各轮次定值，按频率由高到低排列
+    double system_base_kW = 1.0e6; // 频率模型的功率基准 (kW)，用于将切除负荷换算为标幺值
+    double step_ms = 20.0; // 判定步长 (毫秒)，应与频率预言机步长一致
+    double alert_deviation_Hz = -0.3; // 稳定性告警时，频率偏差低于此值则发起预防性切负荷
+    double preventive_shed_kW = 0.0; // 预防性切负荷容量 (kW)，0表示告警时只记录状态
+};
+
+// 低频减载子系统
+// 继电器状态按结构数组 (SoA) 存放，下标为 stage * 馈线数 + 馈线序号，
+// 使每一轮次的判定是对连续 double 数组的一次比较，可由编译器自动向量化。
+class UflsSystem : public FrequencyModelAdjuster {
+public:
+    UflsSystem(Registry& registry, cps_coro::Scheduler& scheduler, UflsSettings settings);
+
+    // 为已带有 FeederLoadComponent 的馈线实体装设低频减载继电器。
+    // threshold_offset_Hz: 该馈线继电器相对标准定值的整定偏差 (模拟不同装置的整定误差)。
+    void add_feeder(Entity feeder, double threshold_offset_Hz = 0.0);
+
+    // 按已装设的馈线生成继电器状态数组，并启动子系统的协程任务 (频率判定、远方切负荷请求、稳定性告警)。
+    // 启动后不应再调用 add_feeder。
+    void start();
+
+    // FrequencyModelAdjuster: 在解析频率偏差上叠加已切除负荷的频率恢复效果
+    double adjust_deviation(double sim_time_s, double base_deviation_hz) override;
+
+    size_t feeder_count() const { return feeders_.size(); }
+    double total_shed_kW() const { return total_shed_kW_; }
+    size_t trip_count(size_t stage) const { return stage_trip_count_[stage]; }
+    void log_summary() const;
+
+private:
+    // 定时器项: 继电器下标 + 启动时的代数，代数不一致表示定时器在到期前已返回 (频率恢复)
+    struct RelayTimer {
+        uint32_t relay;
+        uint32_t generation;
+    };
+
+    cps_coro::Task frequency_step_task();
+    cps_coro::Task load_shed_request_task();
+    cps_coro::Task stability_concern_task();
+
+    void evaluate_relays(double deviation_hz);
+    void on_timer_expired(const RelayTimer& timer);
+    double shed_feeder(size_t feeder_idx, double amount_kW);
+    void commit_step_shedding(double time_s);
+
+    Registry& registry_;
+    cps_coro::Scheduler& scheduler_;
+    UflsSettings settings_;
+
+    // 馈线 (按装设顺序)
+    std::vector<Entity> feeders_;
+    std::vector<FeederLoadComponent*> feeder_loads_; // 组件指针在注册表中保持稳定，缓存以避免哈希查找
+    std::vector<double> threshold_offsets_Hz_; // 各馈线继电器的整定偏差
+
+    // 继电器状态 (SoA, 下标 stage * N + i)
+    std::vector<double> thresholds_Hz_; // 动作定值
+    std::vector<uint8_t> picked_up_; // 已启动 (频率低于定值，延时计时中)
+    std::vector<uint8_t> pickup_scratch_; // 本步判定结果，复用以避免分配
+    std::vector<uint8_t> tripped_; // 已动作 (或馈线已被远方切除，闭锁)
+    std::vector<uint32_t> generation_; // 定时器代数
+
+    // 每轮次的汇总量，用于在频率远离定值时跳过整轮判定
+    std::vector<double> stage_max_threshold_Hz_;
+    std::vector<size_t> stage_picked_count_;
+    std::vector<size_t> stage_trip_count_;
+    std::vector<uint64_t> stage_delay_ticks_;
+
+    TimingWheel<RelayTimer> timers_;
+    uint64_t current_tick_ = 0;
+    double last_deviation_Hz_ = 0.0;
+
+    double step_shed_kW_ = 0.0; // 当前步长内累计切除的负荷
+    double total_shed_kW_ = 0.0;
+    LoadStepSuperposition shed_response_; // 已切除负荷在频率模型中的叠加响应
+    std::vector<size_t> shed_order_; // 远方切负荷顺序 (按优先级排序的馈线序号)，首次请求时生成
+};
+
+#endif // UFLS_SYSTEM_H
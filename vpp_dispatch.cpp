@@ -0,0 +1,256 @@
+// vpp_dispatch.cpp
+// 实现了VPP功率分配引擎的分层比例注水算法。
+
+#include "vpp_dispatch.h"
+#include "logging_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+extern cps_coro::Scheduler* g_scheduler;
+
+VppDispatcher::VppDispatcher(Registry& registry, ParallelExecutor& executor, VppDispatchSettings settings)
+    : registry_(registry)
+    , executor_(executor)
+    , settings_(settings)
+{
+}
+
+void VppDispatcher::add_device(Entity device, int priority, double weight)
+{
+    auto config = registry_.get<FrequencyControlConfigComponent>(device);
+    auto state = registry_.get<PhysicalStateComponent>(device);
+    if (!config || !state) {
+        if (g_console_logger)
+            g_console_logger->error("[VPP分配] 实体 #{} 缺少频率控制配置或物理状态组件，无法纳入分配。", device);
+        return;
+    }
+    if (weight <= 0.0)
+        weight = config->max_output_kW - config->min_output_kW;
+
+    entities_.push_back(device);
+    priority_.push_back(priority);
+    configs_.push_back(config);
+    states_.push_back(state);
+    schedule_kW_.push_back(config->base_power_kW);
+    weight_.push_back(std::max(weight, 0.0));
+    setpoint_kW_.push_back(config->base_power_kW);
+    finalized_ = false;
+}
+
+// 按优先级对设备列做稳定排序，使同一优先级的设备连续存放，并划分层
+void VppDispatcher::finalize()
+{
+    const size_t n = entities_.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return priority_[a] < priority_[b]; });
+
+    auto permute = [&order](auto& column) {
+        std::remove_reference_t<decltype(column)> sorted;
+        sorted.reserve(column.size());
+        for (size_t idx : order)
+            sorted.push_back(column[idx]);
+        column.swap(sorted);
+    };
+    permute(entities_);
+    permute(priority_);
+    permute(configs_);
+    permute(states_);
+    permute(schedule_kW_);
+    permute(weight_);
+    permute(setpoint_kW_);
+    lower_kW_.assign(n, 0.0);
+    upper_kW_.assign(n, 0.0);
+    base_kW_.assign(n, 0.0);
+
+    tiers_.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (tiers_.empty() || tiers_.back().priority != priority_[i])
+            tiers_.push_back({ priority_[i], i, i });
+        tiers_.back().end = i + 1;
+    }
+    finalized_ = true;
+}
+
+// 按当前SOC刷新层内各设备的上下限与基准，并统计层内可调容量和饱和水位
+void VppDispatcher::refresh_bounds(Tier& tier)
+{
+    struct Partial {
+        double base_sum = 0.0, up = 0.0, down = 0.0, lambda_up = 0.0, lambda_down = 0.0;
+    };
+    const size_t count = tier.end - tier.begin;
+    std::vector<Partial> partials(ParallelExecutor::chunk_count(count, settings_.chunk_size));
+
+    executor_.parallel_for(count, settings_.chunk_size, [&](size_t chunk, size_t b, size_t e) {
+        Partial p;
+        for (size_t i = tier.begin + b; i < tier.begin + e; ++i) {
+            const auto* config = configs_[i];
+            const double soc = states_[i]->soc;
+            double lo = config->min_output_kW;
+            double hi = config->max_output_kW;
+            if (soc <= config->soc_min_threshold) // SOC过低: 不允许放电
+                hi = std::min(hi, 0.0);
+            if (soc >= config->soc_max_threshold) // SOC过高: 不允许充电
+                lo = std::max(lo, 0.0);
+            const double base = std::clamp(schedule_kW_[i], lo, hi);
+            lower_kW_[i] = lo;
+            upper_kW_[i] = hi;
+            base_kW_[i] = base;
+
+            p.base_sum += base;
+            if (weight_[i] > 0.0) { // 权重为0的设备不参与调节，保持在基准
+                p.up += hi - base;
+                p.down += lo - base;
+                p.lambda_up = std::max(p.lambda_up, (hi - base) / weight_[i]);
+                p.lambda_down = std::min(p.lambda_down, (lo - base) / weight_[i]);
+            }
+        }
+        partials[chunk] = p;
+    });
+
+    tier.base_sum = tier.up_capacity = tier.down_capacity = tier.lambda_up = tier.lambda_down = 0.0;
+    for (const auto& p : partials) { // 按块号顺序合并，结果与线程数无关
+        tier.base_sum += p.base_sum;
+        tier.up_capacity += p.up;
+        tier.down_capacity += p.down;
+        tier.lambda_up = std::max(tier.lambda_up, p.lambda_up);
+        tier.lambda_down = std::min(tier.lambda_down, p.lambda_down);
+    }
+}
+
+VppDispatcher::LevelSample VppDispatcher::evaluate_level(const Tier& tier, double lambda)
+{
+    const size_t count = tier.end - tier.begin;
+    std::vector<LevelSample> partials(ParallelExecutor::chunk_count(count, settings_.chunk_size));
+
+    executor_.parallel_for(count, settings_.chunk_size, [&](size_t chunk, size_t b, size_t e) {
+        LevelSample s;
+        for (size_t i = tier.begin + b; i < tier.begin + e; ++i) {
+            const double raw = base_kW_[i] + lambda * weight_[i];
+            const double p = std::clamp(raw, lower_kW_[i], upper_kW_[i]);
+            s.delta_kW += p - base_kW_[i];
+            if (raw > lower_kW_[i] && raw < upper_kW_[i])
+                s.free_weight += weight_[i];
+        }
+        partials[chunk] = s;
+    });
+
+    LevelSample total;
+    for (const auto& s : partials) {
+        total.delta_kW += s.delta_kW;
+        total.free_weight += s.free_weight;
+    }
+    return total;
+}
+
+// 求水位 λ 使层内总调节量等于 delta_kW (调用者保证 delta_kW 在层的可调范围之内)。
+// 总量关于 λ 单调分段线性：以牛顿步为主，步长越出当前区间或斜率为零时退化为二分。
+double VppDispatcher::solve_level(const Tier& tier, double delta_kW, int& iterations)
+{
+    double lo = delta_kW > 0.0 ? 0.0 : tier.lambda_down;
+    double hi = delta_kW > 0.0 ? tier.lambda_up : 0.0;
+    double lambda = 0.0;
+
+    for (int it = 0; it < settings_.max_iterations; ++it) {
+        ++iterations;
+        LevelSample s = evaluate_level(tier, lambda);
+        double residual = s.delta_kW - delta_kW;
+        if (std::abs(residual) <= settings_.tolerance_kW)
+            return lambda;
+        if (residual < 0.0)
+            lo = lambda;
+        else
+            hi = lambda;
+
+        double next = s.free_weight > 0.0 ? lambda - residual / s.free_weight : 0.5 * (lo + hi);
+        if (!(next > lo && next < hi)) // 牛顿步越界 (包括恰好落在端点) 时改用二分
+            next = 0.5 * (lo + hi);
+        lambda = next;
+    }
+    return lambda;
+}
+
+VppDispatchResult VppDispatcher::dispatch(double target_kW)
+{
+    auto wall_start = std::chrono::steady_clock::now();
+    if (!finalized_)
+        finalize();
+
+    VppDispatchResult result;
+    result.requested_kW = target_kW;
+
+    // 1. 刷新各层上下限，计算调节量 (目标与基准总量之差)
+    double base_total = 0.0;
+    for (auto& tier : tiers_) {
+        refresh_bounds(tier);
+        base_total += tier.base_sum;
+    }
+    double remaining = target_kW - base_total;
+
+    // 2. 按优先级逐层注水：整层饱和则取其上/下限水位，否则求解本层水位后结束
+    for (auto& tier : tiers_) {
+        tier.lambda = 0.0;
+        if (std::abs(remaining) <= settings_.tolerance_kW)
+            continue;
+        if (remaining > 0.0 && remaining >= tier.up_capacity) {
+            tier.lambda = tier.lambda_up;
+            remaining -= tier.up_capacity;
+        } else if (remaining < 0.0 && remaining <= tier.down_capacity) {
+            tier.lambda = tier.lambda_down;
+            remaining -= tier.down_capacity;
+        } else {
+            tier.lambda = solve_level(tier, remaining, result.iterations);
+            remaining = 0.0;
+        }
+    }
+
+    // 3. 并行写回：只有设定值变化超过阈值的设备才写入其组件
+    struct Partial {
+        double achieved = 0.0;
+        size_t changed = 0;
+    };
+    for (const auto& tier : tiers_) {
+        const size_t count = tier.end - tier.begin;
+        std::vector<Partial> partials(ParallelExecutor::chunk_count(count, settings_.chunk_size));
+        executor_.parallel_for(count, settings_.chunk_size, [&](size_t chunk, size_t b, size_t e) {
+            Partial p;
+            for (size_t i = tier.begin + b; i < tier.begin + e; ++i) {
+                const double setpoint = std::clamp(base_kW_[i] + tier.lambda * weight_[i], lower_kW_[i], upper_kW_[i]);
+                p.achieved += setpoint;
+                if (std::abs(setpoint - setpoint_kW_[i]) > settings_.min_change_kW) {
+                    setpoint_kW_[i] = setpoint;
+                    configs_[i]->base_power_kW = setpoint;
+                    ++p.changed;
+                }
+            }
+            partials[chunk] = p;
+        });
+        for (const auto& p : partials) {
+            result.achieved_kW += p.achieved;
+            result.changed_devices += p.changed;
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - wall_start;
+    result.elapsed_ms = elapsed.count();
+    ++dispatch_count_;
+    total_dispatch_ms_ += result.elapsed_ms;
+    max_dispatch_ms_ = std::max(max_dispatch_ms_, result.elapsed_ms);
+    return result;
+}
+
+cps_coro::Task VppDispatcher::run()
+{
+    while (true) {
+        PowerAdjustRequest request = co_await cps_coro::wait_for_event<PowerAdjustRequest>(POWER_ADJUST_REQUEST_EVENT);
+        VppDispatchResult result = dispatch(request.target_kW);
+        if (g_console_logger && g_scheduler) {
+            g_console_logger->info("[{}毫秒] [VPP分配] 目标 {:.1f} kW，实际 {:.1f} kW，{} / {} 台设备设定值变化，迭代 {} 次，耗时 {:.3f} 毫秒。",
+                g_scheduler->now().time_since_epoch().count(), result.requested_kW, result.achieved_kW,
+                result.changed_devices, entities_.size(), result.iterations, result.elapsed_ms);
+        }
+    }
+}
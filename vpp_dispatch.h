@@ -0,0 +1,109 @@
+// vpp_dispatch.h
+// 虚拟电厂 (VPP) 功率分配引擎。
+// 将VPP整体功率目标 (例如来自AGC二次调频的 POWER_ADJUST_REQUEST_EVENT) 分配到每个EV充电桩和储能单元，
+// 满足各设备的 max_output_kW / min_output_kW 以及SOC上下限约束。
+//
+// 分配算法为按优先级分层的比例注水法 (water-filling)：
+// - 设备按优先级分层，优先级高的层先承担调节量，本层达到上/下限后剩余部分再交给下一层；
+// - 层内各设备的设定值为 clamp(基准 + λ·权重, 下限, 上限)，求使层内总量等于调节量的水位 λ。
+//   总量关于 λ 是分段线性的单调函数，用带区间保护的牛顿法求解，通常数次迭代即可精确落在正确的线性段上。
+// 每次迭代是对设备列的一次并行归约，总复杂度 O(N·迭代次数)；最后一次并行遍历只写回设定值确有变化的设备。
+#ifndef VPP_DISPATCH_H
+#define VPP_DISPATCH_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "frequency_system.h"
+#include "parallel_for.h"
+#include "simulation_events_and_data.h"
+
+#include <cstddef>
+#include <vector>
+
+// 分配引擎配置
+struct VppDispatchSettings {
+    double min_change_kW = 0.01; // 设定值变化小于此值的设备不写回
+    double tolerance_kW = 1e-3; // 水位求解的功率容差 (kW)
+    int max_iterations = 60; // 每层水位求解的最大迭代次数
+    size_t chunk_size = 16384; // 并行遍历的块大小 (设备数)
+};
+
+// 一次分配的结果
+struct VppDispatchResult {
+    double requested_kW = 0.0; // 请求的VPP总功率
+    double achieved_kW = 0.0; // 实际分配的总功率 (受设备能力限制时可能小于请求)
+    size_t changed_devices = 0; // 设定值发生变化并被写回的设备数
+    int iterations = 0; // 水位求解的总迭代次数
+    double elapsed_ms = 0.0; // 分配耗时 (物理时间, 毫秒)
+};
+
+class VppDispatcher {
+public:
+    VppDispatcher(Registry& registry, ParallelExecutor& executor, VppDispatchSettings settings = {});
+
+    // 将带有 FrequencyControlConfigComponent 和 PhysicalStateComponent 的设备纳入分配。
+    // priority: 数值越小越先承担调节量；weight: 层内比例权重，<=0 时取设备的可调范围 (max - min)。
+    // 设备的当前 base_power_kW 作为其计划基准。
+    void add_device(Entity device, int priority = 0, double weight = 0.0);
+
+    // 将VPP总功率目标分配到各设备，写回各设备的 base_power_kW (一次调频在此基准上叠加)。
+    VppDispatchResult dispatch(double target_kW);
+
+    // 协程任务：等待 POWER_ADJUST_REQUEST_EVENT 并执行分配
+    cps_coro::Task run();
+
+    size_t device_count() const { return entities_.size(); }
+    size_t dispatch_count() const { return dispatch_count_; }
+    double total_dispatch_ms() const { return total_dispatch_ms_; }
+    double max_dispatch_ms() const { return max_dispatch_ms_; }
+
+private:
+    // 一层 (同一优先级) 设备在列中的连续区间及本次分配结果
+    struct Tier {
+        int priority;
+        size_t begin;
+        size_t end;
+        double base_sum = 0.0; // 层内基准总量
+        double up_capacity = 0.0; // 层内可上调总量
+        double down_capacity = 0.0; // 层内可下调总量 (非正)
+        double lambda_up = 0.0; // 使全层达到上限的最小水位
+        double lambda_down = 0.0; // 使全层达到下限的最大水位 (非正)
+        double lambda = 0.0; // 本次分配的水位
+    };
+
+    // 水位函数在某一 λ 处的取值: 层内总调节量与未受限设备的权重和 (即斜率)
+    struct LevelSample {
+        double delta_kW = 0.0;
+        double free_weight = 0.0;
+    };
+
+    void finalize();
+    void refresh_bounds(Tier& tier);
+    LevelSample evaluate_level(const Tier& tier, double lambda);
+    double solve_level(const Tier& tier, double delta_kW, int& iterations);
+
+    Registry& registry_;
+    ParallelExecutor& executor_;
+    VppDispatchSettings settings_;
+    bool finalized_ = false;
+
+    // 设备列 (SoA)。finalize 后按优先级排序，同一优先级的设备在列中连续。
+    std::vector<Entity> entities_;
+    std::vector<int> priority_;
+    std::vector<FrequencyControlConfigComponent*> configs_; // 组件指针在注册表中保持稳定
+    std::vector<PhysicalStateComponent*> states_;
+    std::vector<double> schedule_kW_; // 计划基准 (纳入分配时的 base_power_kW)
+    std::vector<double> weight_;
+    std::vector<double> lower_kW_; // 本次分配的下限 (计及SOC)
+    std::vector<double> upper_kW_; // 本次分配的上限 (计及SOC)
+    std::vector<double> base_kW_; // 计划基准限制在上下限内的值
+    std::vector<double> setpoint_kW_; // 上一次写回的设定值
+
+    std::vector<Tier> tiers_;
+
+    size_t dispatch_count_ = 0;
+    double total_dispatch_ms_ = 0.0;
+    double max_dispatch_ms_ = 0.0;
+};
+
+#endif // VPP_DISPATCH_H
@@ -5,8 +5,11 @@
 #include "cps_coro_lib.h" // 核心协程库
 #include "ecs_core.h" // 实体组件系统核心
 #include "frequency_system.h" // 频率响应仿真模块
+#include "live_state.h" // 共享内存实时状态导出
 #include "logging_utils.h" // 日志工具模块
 #include "logic_protection_system.h" //保护逻辑仿真
+#include "memory_accounting.h" // 按子系统的内存分配统计
+#include "phase_profiler.h" // 按仿真阶段的性能统计
 #include "protection_system.h" // 继电保护仿真模块
 #include "simulation_events_and_data.h" // 共享的事件ID和数据结构
 
@@ -28,19 +31,102 @@ extern long get_peak_memory_usage_kb();
 
 extern void avc_test_non_realtime();
 extern void avc_test_realtime();
+extern void avc_test_state_estimation(int bus_count, double seconds);
 
-extern void test_vpp();
-int main() // 虚拟电厂频率响应仿真
+extern void test_vpp(const std::string& scenario_image_path, bool packed, const std::string& live_state_name = "");
+extern void compile_vpp_scenario_image(const std::string& image_path);
+extern void test_ufls();
+extern void test_vpp_dispatch(size_t device_count);
+extern void test_vpp_trace(size_t device_count, double seconds, size_t decimation, const std::string& trace_path);
+extern void test_vpp_ensemble(const std::vector<EnsembleVariant>& variants);
+extern void test_ev_sessions(size_t charger_count, double hours);
+extern void test_qsts(int bus_count, double days, double step_s, double chunk_days);
+extern void test_comm_network(size_t ied_count, double seconds);
+extern void test_der_voltage(size_t inverter_count, double seconds);
+extern void test_vpp_surrogate(size_t device_count, size_t evaluations);
+extern void test_engine_equivalence(double seconds, double tolerance);
+
+// 用法:
+//   vpp_demo                               现场构建场景并运行
+//   vpp_demo --compile-scenario <镜像文件>  仅编译场景镜像，不运行仿真
+//   vpp_demo --scenario <镜像文件>          映射预编译的场景镜像并运行
+//   vpp_demo --ufls                        严重扰动下的低频减载仿真
+//   vpp_demo --dispatch [设备数]             大规模VPP功率分配仿真 (默认10^6台设备)
+//   vpp_demo --ev-sessions [桩数] [小时]      EV充电会话随机过程仿真 (默认10^5台桩, 24小时)
+//   vpp_demo --qsts [母线数] [天数] [步长秒] [块天数]  馈线QSTS长时段仿真 (默认1000条母线, 7天, 1秒)
+//   vpp_demo --comm [IED数] [秒]             IED通信网络仿真 (默认10^4台IED, 60秒)
+//   vpp_demo --der-voltage [逆变器数] [秒]    逆变器 Volt-VAR/Volt-Watt 电压控制仿真 (默认10^5台逆变器, 300秒)
+//   vpp_demo --state-estimation [母线数] [秒]  AVC场景的RTU量测与WLS状态估计 (默认10^4条母线, 60秒)
+//   vpp_demo --surrogate [设备数] [研究次数]   VPP聚合响应代理模型的拟合、误差界与外层研究 (默认10^5台设备, 1000次)
+//   vpp_demo --equivalence [秒] [容差]        频率响应引擎与参考引擎的差分等价性校验 (默认70秒, 容差0即逐位一致)
+//   vpp_demo --packed                      同默认场景，设备使用打包存储与批量频率响应
+//   vpp_demo --live [共享内存名]            同默认场景，按物理时钟实时运行并发布实时状态 (cps_live_reader 读取)
+//   vpp_demo --trace [设备数] [秒] [抽取间隔] [文件]  逐设备曲线压缩输出 (默认10^5台设备, 60秒, 每步, device_trace.bin)
+//   vpp_demo --ensemble                    集合仿真: 8个参数变体 (扰动幅值/死区/增益) 在同一次仿真中推进
+int main(int argc, char* argv[]) // 虚拟电厂频率响应仿真
 {
+    std::string mode = argc > 1 ? argv[1] : "";
+    std::string image_path = argc > 2 ? argv[2] : "vpp_scenario.img";
+
     // --- 初始化日志系统 ---
     // 日志文件名设为 "虚拟电厂频率响应数据.csv"，并在每次运行时覆盖旧文件 (truncate_data_log = true)。
     initialize_loggers("虚拟电厂频率响应数据.txt", true);
+    // 设置环境变量 CPS_PHASE_PROFILE=1 时按阶段统计耗时与硬件计数，结束时输出
+    PhaseProfiler::instance().enable_from_env();
 
     std::cout << "========================================================================" << std::endl;
     std::cout << "信息: 即将运行虚拟电厂频率仿真示例..." << std::endl;
     std::cout << "========================================================================" << std::endl;
 
-    test_vpp();
+    try {
+        if (mode == "--compile-scenario") {
+            compile_vpp_scenario_image(image_path);
+        } else if (mode == "--scenario") {
+            test_vpp(image_path, false);
+        } else if (mode == "--ufls") {
+            test_ufls();
+        } else if (mode == "--dispatch") {
+            test_vpp_dispatch(argc > 2 ? std::stoul(argv[2]) : 1000000);
+        } else if (mode == "--ev-sessions") {
+            test_ev_sessions(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stod(argv[3]) : 24.0);
+        } else if (mode == "--qsts") {
+            test_qsts(argc > 2 ? std::stoi(argv[2]) : 1000, argc > 3 ? std::stod(argv[3]) : 7.0, argc > 4 ? std::stod(argv[4]) : 1.0,
+                argc > 5 ? std::stod(argv[5]) : 0.0);
+        } else if (mode == "--packed") {
+            test_vpp("", true);
+        } else if (mode == "--live") {
+            test_vpp("", false, argc > 2 ? argv[2] : LIVE_STATE_DEFAULT_NAME);
+        } else if (mode == "--trace") {
+            test_vpp_trace(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stod(argv[3]) : 60.0,
+                argc > 4 ? std::stoul(argv[4]) : 1, argc > 5 ? argv[5] : "device_trace.bin");
+        } else if (mode == "--ensemble") {
+            // 变体0为基准场景，其余每个变体只改变一个倍数
+            test_vpp_ensemble({ { 1.0, 1.0, 1.0 }, { 0.5, 1.0, 1.0 }, { 1.5, 1.0, 1.0 }, { 2.0, 1.0, 1.0 }, { 1.0, 0.5, 1.0 },
+                { 1.0, 2.0, 1.0 }, { 1.0, 1.0, 0.5 }, { 1.0, 1.0, 2.0 } });
+        } else if (mode == "--comm") {
+            test_comm_network(argc > 2 ? std::stoul(argv[2]) : 10000, argc > 3 ? std::stod(argv[3]) : 60.0);
+        } else if (mode == "--der-voltage") {
+            test_der_voltage(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stod(argv[3]) : 300.0);
+        } else if (mode == "--state-estimation") {
+            avc_test_state_estimation(argc > 2 ? std::stoi(argv[2]) : 10000, argc > 3 ? std::stod(argv[3]) : 60.0);
+        } else if (mode == "--surrogate") {
+            test_vpp_surrogate(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stoul(argv[3]) : 1000);
+        } else if (mode == "--equivalence") {
+            test_engine_equivalence(argc > 2 ? std::stod(argv[2]) : 70.0, argc > 3 ? std::stod(argv[3]) : 0.0);
+        } else {
+            test_vpp("", false);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "错误: " << ex.what() << std::endl;
+        shutdown_loggers();
+        return 1;
+    }
+
+    for (const auto& line : PhaseProfiler::instance().report_lines())
+        g_console_logger->info("{}", line);
+    // 以 -DCPS_MEMORY_ACCOUNTING=ON 构建时输出各子系统的内存占用
+    for (const auto& line : memory_report_lines())
+        g_console_logger->info("{}", line);
 
     // 关闭日志系统，确保所有缓冲日志被刷新并释放资源
     shutdown_loggers();
@@ -0,0 +1,327 @@
+// vpp_surrogate.cpp
+// 实现了VPP聚合响应代理模型的详细模型运行、最小二乘拟合、误差评估与代理模型的逐步推进。
+
+#include "vpp_surrogate.h"
+#include "logging_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+extern cps_coro::Scheduler* g_scheduler;
+
+namespace {
+
+// 对称正定的稠密方程组 A x = b (n 阶，按行存放)，原地Cholesky分解，解写回 b。主元非正时返回 false。
+bool solve_dense_spd(std::vector<double>& a, std::vector<double>& b, size_t n)
+{
+    for (size_t j = 0; j < n; ++j) {
+        double d = a[j * n + j];
+        for (size_t k = 0; k < j; ++k)
+            d -= a[j * n + k] * a[j * n + k];
+        if (!(d > 0.0))
+            return false;
+        const double l = std::sqrt(d);
+        a[j * n + j] = l;
+        for (size_t i = j + 1; i < n; ++i) {
+            double s = a[i * n + j];
+            for (size_t k = 0; k < j; ++k)
+                s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / l;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < i; ++k)
+            b[i] -= a[i * n + k] * b[k];
+        b[i] /= a[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        for (size_t k = i + 1; k < n; ++k)
+            b[i] -= a[k * n + i] * b[k];
+        b[i] /= a[i * n + i];
+    }
+    return true;
+}
+
+// 扰动曲线第 k 步的时刻: 按整毫秒计算后换算为秒，与频率预言机由调度器时钟得到的时刻逐位相同
+double profile_time_s(size_t k, double step_s)
+{
+    return static_cast<double>(k + 1) * std::round(step_s * 1000.0) / 1000.0;
+}
+
+} // namespace
+
+VppDisturbanceProfile make_load_step_profile(std::string name, const std::vector<std::pair<double, double>>& load_steps,
+    double duration_s, double step_s)
+{
+    VppDisturbanceProfile profile;
+    profile.name = std::move(name);
+    const size_t steps = static_cast<size_t>(std::llround(duration_s / step_s));
+    profile.freq_deviation_hz.resize(steps);
+    for (size_t k = 0; k < steps; ++k) {
+        const double t = profile_time_s(k, step_s);
+        double df = 0.0;
+        for (const auto& [start_s, delta_pu] : load_steps)
+            df += calculate_load_step_frequency_response(t - start_s, delta_pu);
+        profile.freq_deviation_hz[k] = df;
+    }
+    return profile;
+}
+
+// --- VppSurrogateModel ---
+
+void VppSurrogateModel::reset()
+{
+    power_kW_ = initial_power_kW_;
+    held_hz_ = 0.0;
+    held_time_s_ = -1.0;
+    extrapolated_steps_ = 0;
+}
+
+double VppSurrogateModel::hold(const FrequencyInfo& info)
+{
+    // 与设备的更新条件相同 (FrequencyResponseFleet::step)
+    const double t = info.current_sim_time_seconds;
+    if (held_time_s_ >= 0) {
+        double dt = t - held_time_s_;
+        if (dt < 0)
+            dt = 0;
+        if (!(std::abs(info.freq_deviation_hz - held_hz_) > hold_frequency_hz_) && !(dt >= hold_interval_s_))
+            return held_hz_;
+    }
+    held_time_s_ = t;
+    held_hz_ = info.freq_deviation_hz;
+    return held_hz_;
+}
+
+double VppSurrogateModel::curve(double freq_deviation_hz) const
+{
+    const int segments = static_cast<int>(segment_kW_.size() / 2);
+    const double x = (freq_deviation_hz - knot0_hz_) / knot_spacing_hz_;
+    // 包络之外沿端段线性外推
+    const int j = std::clamp(static_cast<int>(std::floor(x)), 0, segments - 1);
+    const double t = x - j;
+    return segment_kW_[2 * j] + t * (segment_kW_[2 * j + 1] - segment_kW_[2 * j]);
+}
+
+double VppSurrogateModel::step(const FrequencyInfo& info)
+{
+    if (info.freq_deviation_hz < envelope_min_hz_ || info.freq_deviation_hz > envelope_max_hz_)
+        ++extrapolated_steps_;
+    power_kW_ = lag_ * power_kW_ + curve(hold(info));
+    return power_kW_;
+}
+
+void VppSurrogateModel::simulate(const VppDisturbanceProfile& profile, std::vector<double>& power)
+{
+    reset();
+    power.resize(profile.freq_deviation_hz.size());
+    for (size_t k = 0; k < power.size(); ++k) {
+        FrequencyInfo info;
+        info.current_sim_time_seconds = profile_time_s(k, step_s_);
+        info.freq_deviation_hz = profile.freq_deviation_hz[k];
+        power[k] = step(info);
+    }
+}
+
+double VppSurrogateModel::steady_state_kW(double freq_deviation_hz) const
+{
+    return curve(freq_deviation_hz) / (1.0 - lag_);
+}
+
+cps_coro::Task VppSurrogateModel::run(Registry& registry, Entity aggregate)
+{
+    if (g_console_logger)
+        g_console_logger->info("[VPP代理模型] 任务已激活，静态曲线 {} 段，惯性系数 {:.4f}，误差界 {:.1f} kW (包络 {:.3f} ~ {:.3f} Hz)。",
+            segment_kW_.size() / 2, lag_, error_bound_kW_, envelope_min_hz_, envelope_max_hz_);
+    if (!g_scheduler)
+        co_return;
+    reset();
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
+    while (true) {
+        step(co_await frequency_reader.next());
+        if (auto state = registry.get<PhysicalStateComponent>(aggregate))
+            state->current_power_kW = power_kW_;
+    }
+}
+
+// --- VppSurrogateBuilder ---
+
+VppSurrogateBuilder::VppSurrogateBuilder(Registry& registry, const std::vector<Entity>& devices, VppSurrogateSettings settings)
+    : settings_(settings)
+{
+    configs_.reserve(devices.size());
+    initial_states_.reserve(devices.size());
+    for (Entity device : devices) {
+        auto config = registry.get<FrequencyControlConfigComponent>(device);
+        auto state = registry.get<PhysicalStateComponent>(device);
+        if (!config || !state)
+            continue;
+        configs_.push_back(*config);
+        initial_states_.push_back(*state);
+        initial_power_kW_ += state->current_power_kW;
+    }
+}
+
+void VppSurrogateBuilder::run_detailed(const VppDisturbanceProfile& profile, std::vector<double>& power) const
+{
+    Registry registry;
+    FrequencyResponseFleet fleet(registry);
+    fleet.reserve(configs_.size());
+    for (size_t i = 0; i < configs_.size(); ++i) {
+        Entity device = registry.create();
+        registry.emplace<FrequencyControlConfigComponent>(device, configs_[i]);
+        registry.emplace<PhysicalStateComponent>(device, initial_states_[i]);
+        fleet.add_device(device);
+    }
+    power.resize(profile.freq_deviation_hz.size());
+    for (size_t k = 0; k < power.size(); ++k) {
+        FrequencyInfo info;
+        info.current_sim_time_seconds = profile_time_s(k, settings_.step_s);
+        info.freq_deviation_hz = profile.freq_deviation_hz[k];
+        fleet.step(info);
+        power[k] = fleet.total_power_kW();
+    }
+}
+
+VppSurrogateModel VppSurrogateBuilder::build(const std::vector<VppDisturbanceProfile>& training,
+    const std::vector<VppDisturbanceProfile>& validation, VppSurrogateFit* fit) const
+{
+    VppSurrogateFit report;
+    VppSurrogateModel model;
+    model.step_s_ = settings_.step_s;
+    model.knot_spacing_hz_ = settings_.knot_spacing_hz;
+    model.hold_frequency_hz_ = settings_.hold_frequency_hz;
+    model.hold_interval_s_ = settings_.hold_interval_s;
+    model.initial_power_kW_ = initial_power_kW_;
+
+    // 训练包络与节点: 覆盖包络的等间距节点 (至少两个)
+    double lo = 0.0, hi = 0.0;
+    for (const auto& profile : training) {
+        for (double df : profile.freq_deviation_hz) {
+            lo = std::min(lo, df);
+            hi = std::max(hi, df);
+        }
+    }
+    model.envelope_min_hz_ = lo;
+    model.envelope_max_hz_ = hi;
+    const double h = settings_.knot_spacing_hz;
+    const long first = static_cast<long>(std::floor(lo / h));
+    const long last = std::max(static_cast<long>(std::ceil(hi / h)), first + 1);
+    model.knot0_hz_ = first * h;
+    const size_t segments = static_cast<size_t>(last - first);
+
+    // 详细模型运行与正规方程累加。未知量: [a, 第0段左端, 第0段右端, 第1段左端, ...]，每步的回归量只有3个非零:
+    // P[k-1] 与保持的频率偏差所在段的两端
+    const size_t m = 2 * segments + 1;
+    std::vector<double> ata(m * m, 0.0), atb(m, 0.0);
+    std::vector<std::vector<double>> training_power(training.size());
+    double detailed_ms = 0.0;
+    for (size_t p = 0; p < training.size(); ++p) {
+        auto t0 = std::chrono::steady_clock::now();
+        run_detailed(training[p], training_power[p]);
+        detailed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        const std::vector<double>& y = training_power[p];
+        double previous = initial_power_kW_;
+        model.reset();
+        for (size_t k = 0; k < y.size(); ++k) {
+            FrequencyInfo info;
+            info.current_sim_time_seconds = profile_time_s(k, settings_.step_s);
+            info.freq_deviation_hz = training[p].freq_deviation_hz[k];
+            const double x = (model.hold(info) - model.knot0_hz_) / h;
+            const size_t j = static_cast<size_t>(std::clamp(static_cast<long>(std::floor(x)), 0L, static_cast<long>(segments) - 1));
+            const double t = x - static_cast<double>(j);
+            const size_t idx[3] = { 0, 2 * j + 1, 2 * j + 2 };
+            const double val[3] = { previous, 1.0 - t, t };
+            for (int r = 0; r < 3; ++r) {
+                atb[idx[r]] += val[r] * y[k];
+                for (int c = 0; c < 3; ++c)
+                    ata[idx[r] * m + idx[c]] += val[r] * val[c];
+            }
+            previous = y[k];
+            ++report.samples;
+        }
+    }
+
+    // 相邻两段之间的罚项 λ [(R_j - L_{j+1})² + ((R_{j+1} - L_{j+1}) - (R_j - L_j))²]: 数据充足处可以间断，
+    // 训练数据未覆盖的段按相邻段连续、等斜率延伸
+    double segment_diagonal = 0.0;
+    for (size_t i = 1; i < m; ++i)
+        segment_diagonal += ata[i * m + i];
+    const double lambda = settings_.smoothing * segment_diagonal / (m - 1);
+    auto penalize = [&](const size_t* idx, const double* d, int n) {
+        for (int r = 0; r < n; ++r)
+            for (int c = 0; c < n; ++c)
+                ata[idx[r] * m + idx[c]] += lambda * d[r] * d[c];
+    };
+    for (size_t j = 0; j + 1 < segments; ++j) {
+        const size_t jump_idx[2] = { 2 * j + 2, 2 * j + 3 };
+        const double jump[2] = { 1.0, -1.0 };
+        penalize(jump_idx, jump, 2);
+        const size_t slope_idx[4] = { 2 * j + 1, 2 * j + 2, 2 * j + 3, 2 * j + 4 };
+        const double slope[4] = { 1.0, -1.0, -1.0, 1.0 };
+        penalize(slope_idx, slope, 4);
+    }
+    // 按对角元归一化后求解 (功率为kW量级而基函数不超过1)
+    std::vector<double> scale(m, 1.0);
+    for (size_t i = 0; i < m; ++i)
+        scale[i] = ata[i * m + i] > 0.0 ? 1.0 / std::sqrt(ata[i * m + i]) : 1.0;
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < m; ++j)
+            ata[i * m + j] *= scale[i] * scale[j];
+        atb[i] *= scale[i];
+    }
+    if (solve_dense_spd(ata, atb, m)) {
+        model.lag_ = atb[0] * scale[0];
+        model.segment_kW_.resize(2 * segments);
+        for (size_t i = 0; i < 2 * segments; ++i)
+            model.segment_kW_[i] = atb[i + 1] * scale[i + 1];
+    } else {
+        // 训练数据不足以确定模型: 退化为恒定的初始功率
+        model.lag_ = 0.0;
+        model.segment_kW_.assign(2 * segments, initial_power_kW_);
+    }
+
+    // 训练与验证误差: 代理模型从初始状态独立仿真整条曲线 (不使用详细模型的上一步功率)
+    std::vector<double> detailed, surrogate;
+    for (size_t p = 0; p < training.size(); ++p) {
+        model.simulate(training[p], surrogate);
+        for (size_t k = 0; k < surrogate.size(); ++k)
+            report.training_max_abs_kW = std::max(report.training_max_abs_kW, std::abs(surrogate[k] - training_power[p][k]));
+    }
+    double max_peak = 0.0;
+    for (const auto& profile : validation) {
+        auto t0 = std::chrono::steady_clock::now();
+        run_detailed(profile, detailed);
+        detailed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        model.simulate(profile, surrogate);
+        VppSurrogateError error;
+        error.profile = profile.name;
+        double sum_sq = 0.0;
+        for (size_t k = 0; k < detailed.size(); ++k) {
+            const double e = std::abs(surrogate[k] - detailed[k]);
+            error.max_abs_kW = std::max(error.max_abs_kW, e);
+            error.peak_response_kW = std::max(error.peak_response_kW, std::abs(detailed[k] - initial_power_kW_));
+            sum_sq += e * e;
+        }
+        error.rms_kW = detailed.empty() ? 0.0 : std::sqrt(sum_sq / detailed.size());
+        report.error_bound_kW = std::max(report.error_bound_kW, error.max_abs_kW);
+        max_peak = std::max(max_peak, error.peak_response_kW);
+        report.validation.push_back(error);
+    }
+    if (validation.empty())
+        report.error_bound_kW = report.training_max_abs_kW;
+    model.error_bound_kW_ = report.error_bound_kW;
+    model.reset();
+
+    report.training_profiles = training.size();
+    report.lag_coefficient = model.lag_;
+    report.time_constant_s = model.lag_ > 0.0 && model.lag_ < 1.0 ? -settings_.step_s / std::log(model.lag_) : 0.0;
+    report.relative_error_bound = max_peak > 0.0 ? report.error_bound_kW / max_peak : 0.0;
+    const size_t runs = training.size() + validation.size();
+    report.detailed_ms_per_profile = runs ? detailed_ms / runs : 0.0;
+    if (fit)
+        *fit = std::move(report);
+    return model;
+}
@@ -0,0 +1,131 @@
+// vpp_surrogate.h
+// VPP聚合响应的降阶代理模型: 由设备级详细模型在一组扰动曲线上的运行结果拟合，供需要成千上万次VPP聚合响应的
+// 外层研究 (出清、多区域频率等) 代替逐设备仿真。
+// - 详细模型为 FrequencyResponseFleet (与逐设备 individualDeviceFrequencyResponseTask 结果逐位一致)，每次运行
+//   在独立的注册表中从相同的初始状态开始；
+// - 设备只在频率偏差变化超过阈值或距上次更新超过时间间隔时才更新，全部设备看到同一频率、从同一时刻开始，
+//   因此整个设备群共用一个 "保持" 的频率偏差 Δf_h。代理模型以同样的保持规则得到 Δf_h，再经 Hammerstein 结构:
+//       P[k] = a · P[k-1] + g(Δf_h[k])
+//   静态曲线 g 是死区、下垂与限幅的聚合效果 (含初始SOC下EV的SOC约束)，在等间距节点间分段线性。各段的两端值
+//   独立，允许在节点处间断: EV在欠频侧不叠加计划充电功率，频率越过死区时聚合功率跳变；储能在死区外 0.003Hz
+//   内即达到限幅，节点须足够密。参数对 a 与各段端值是线性的，由训练曲线上的全部步一次最小二乘求得，
+//   另以较小权重惩罚节点处的跳变与斜率变化，使训练数据未覆盖的段按相邻段连续延伸；
+// - 误差界: 在不参与拟合的验证曲线上逐步比较代理模型与详细模型的聚合功率，取最大绝对误差。误差界只在训练曲线
+//   覆盖的频率偏差范围 (包络) 内有效，超出包络的步按端段线性外推并计数；
+// - 代理模型按频率预言机的发布步长离散，一步只有几次乘加，与设备数无关。作为即插即用的聚合组件，它把输出写入
+//   一个聚合实体的 PhysicalStateComponent，该实体可以代替全部设备实体交给 frequencyOracleTask 汇总。
+#ifndef VPP_SURROGATE_H
+#define VPP_SURROGATE_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "frequency_system.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct VppSurrogateSettings {
+    double step_s = 0.02; // 离散步长 (与频率预言机的发布步长相同)
+    double knot_spacing_hz = 0.001; // 静态曲线的节点间距
+    double smoothing = 1e-6; // 节点处跳变与斜率变化罚项相对数据项 (对角元的平均值) 的权重
+    double hold_frequency_hz = 0.005; // 保持规则: 频率偏差变化超过此值时更新 (与设备的更新条件相同)
+    double hold_interval_s = 0.5; // 保持规则: 距上次更新达到此时间时更新
+};
+
+// 扰动曲线: 按 step_s 等间隔的频率偏差序列，第 k 个值对应时刻 (k+1)·step_s (与频率预言机的第 k+1 次发布相同)
+struct VppDisturbanceProfile {
+    std::string name;
+    std::vector<double> freq_deviation_hz;
+};
+
+// 由若干负荷阶跃 (发生时刻秒, 标幺功率缺额) 按线性频率模型叠加生成扰动曲线
+VppDisturbanceProfile make_load_step_profile(std::string name, const std::vector<std::pair<double, double>>& load_steps,
+    double duration_s, double step_s);
+
+// 一条验证曲线上代理模型相对详细模型的误差
+struct VppSurrogateError {
+    std::string profile;
+    double max_abs_kW = 0.0;
+    double rms_kW = 0.0;
+    double peak_response_kW = 0.0; // 详细模型聚合功率相对初始值的最大变化
+};
+
+// 拟合报告
+struct VppSurrogateFit {
+    size_t training_profiles = 0;
+    size_t samples = 0; // 参与最小二乘的步数
+    double lag_coefficient = 0.0; // a
+    double time_constant_s = 0.0; // 一阶惯性的等效时间常数 -step/ln(a) (a 不在 (0,1) 内时为0)
+    double training_max_abs_kW = 0.0; // 训练曲线上的最大绝对误差 (逐曲线从初始状态仿真)
+    double error_bound_kW = 0.0; // 验证曲线上的最大绝对误差
+    double relative_error_bound = 0.0; // 误差界 / 验证曲线的最大响应幅度
+    double detailed_ms_per_profile = 0.0; // 详细模型每条曲线的平均耗时
+    std::vector<VppSurrogateError> validation;
+};
+
+class VppSurrogateModel {
+public:
+    // 回到初始状态 (聚合功率为全部设备的初始功率之和)
+    void reset();
+    // 推进一步 (一次频率发布)，返回聚合功率 (kW)
+    double step(const FrequencyInfo& info);
+    // 从初始状态运行整条扰动曲线，power 输出每步的聚合功率
+    void simulate(const VppDisturbanceProfile& profile, std::vector<double>& power);
+    // 协程任务: 从初始状态开始，读取频率最新值通道 (FREQUENCY_UPDATE_EVENT)，每次发布推进一步并写入聚合实体的 PhysicalStateComponent
+    cps_coro::Task run(Registry& registry, Entity aggregate);
+
+    double total_power_kW() const { return power_kW_; }
+    double initial_power_kW() const { return initial_power_kW_; }
+    // 静态曲线: 频率偏差保持不变时的稳态聚合功率
+    double steady_state_kW(double freq_deviation_hz) const;
+    double error_bound_kW() const { return error_bound_kW_; }
+    double envelope_min_hz() const { return envelope_min_hz_; }
+    double envelope_max_hz() const { return envelope_max_hz_; }
+    uint64_t extrapolated_steps() const { return extrapolated_steps_; } // 自上次 reset 以来超出训练包络的步数
+
+private:
+    friend class VppSurrogateBuilder;
+    double curve(double freq_deviation_hz) const; // g(Δf)
+    // 保持规则: 返回本次发布后设备群保持的频率偏差
+    double hold(const FrequencyInfo& info);
+
+    double step_s_ = 0.02;
+    double hold_frequency_hz_ = 0.005, hold_interval_s_ = 0.5;
+    double knot0_hz_ = 0.0; // 第一个节点的频率偏差
+    double knot_spacing_hz_ = 0.01;
+    std::vector<double> segment_kW_; // 每段左、右端值
+    double lag_ = 0.0; // a
+    double initial_power_kW_ = 0.0;
+    double envelope_min_hz_ = 0.0, envelope_max_hz_ = 0.0;
+    double error_bound_kW_ = 0.0;
+
+    double power_kW_ = 0.0;
+    double held_hz_ = 0.0;
+    double held_time_s_ = -1.0; // 负值表示尚未更新
+    uint64_t extrapolated_steps_ = 0;
+};
+
+class VppSurrogateBuilder {
+public:
+    // 记录设备的 FrequencyControlConfigComponent 与 PhysicalStateComponent (初始状态)，缺少组件的设备被跳过
+    VppSurrogateBuilder(Registry& registry, const std::vector<Entity>& devices, VppSurrogateSettings settings = {});
+
+    // 详细模型: 在独立的注册表中以 FrequencyResponseFleet 运行一条扰动曲线，power 输出每步的聚合功率
+    void run_detailed(const VppDisturbanceProfile& profile, std::vector<double>& power) const;
+    // 在训练曲线上拟合代理模型，并以验证曲线给出误差界 (验证曲线为空时以训练曲线上的误差为界)
+    VppSurrogateModel build(const std::vector<VppDisturbanceProfile>& training, const std::vector<VppDisturbanceProfile>& validation,
+        VppSurrogateFit* fit = nullptr) const;
+
+    size_t device_count() const { return configs_.size(); }
+
+private:
+    VppSurrogateSettings settings_;
+    std::vector<FrequencyControlConfigComponent> configs_;
+    std::vector<PhysicalStateComponent> initial_states_;
+    double initial_power_kW_ = 0.0;
+};
+
+#endif // VPP_SURROGATE_H
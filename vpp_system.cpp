@@ -1,21 +1,49 @@
 // vpp_system.cpp
+#include "comm_network.h" // 二次系统通信网络
+#include "counter_rng.h" // 基于计数器的随机数生成器
+#include "der_voltage_control.h" // 逆变器 Volt-VAR/Volt-Watt 电压控制
 #include "cps_coro_lib.h" // 核心协程库
 #include "ecs_core.h" // 实体组件系统核心
+#include "equivalence_harness.h" // 仿真引擎的差分等价性校验
+#include "ev_session.h" // EV充电会话随机过程
 #include "frequency_system.h" // 频率响应仿真模块
+#include "live_state.h" // 共享内存实时状态导出
 #include "logging_utils.h" // 日志工具模块
 #include "logic_protection_system.h" //保护逻辑仿真
+#include "phase_profiler.h" // 按仿真阶段的性能统计
 #include "protection_system.h" // 继电保护仿真模块
+#include "qsts_engine.h" // 准稳态时间序列 (QSTS) 仿真引擎
+#include "scenario_image.h" // 预编译场景镜像
 #include "simulation_events_and_data.h" // 共享的事件ID和数据结构
+#include "trace_writer.h" // 逐设备曲线的写入与解码
+#include "ufls_system.h" // 低频减载子系统
+#include "vpp_dispatch.h" // VPP功率分配引擎
+#include "vpp_surrogate.h" // VPP聚合响应代理模型
 
+#include <algorithm> // std::max
 #include <chrono> // C++标准时间库
+#include <cmath> // 数学函数
+#include <cstddef> // offsetof
+#include <cstdint> // SIZE_MAX
+#include <cstring> // std::memcpy
+#include <functional> // 等价性校验的采样回调
 #include <iomanip> // 用于输出格式化 (例如 std::fixed, std::setprecision)
 #include <iostream> // 用于标准输入输出 (主要用于spdlog初始化失败时的回退)
-#include <random> // 用于生成随机数 (例如初始化设备SOC)
+#include <memory> // std::unique_ptr
+#include <sstream> // 代理模型扰动曲线名称
+#include <stdexcept> // std::runtime_error
 #include <string> // C++标准字符串
 #include <vector> // C++标准动态数组
 
 extern cps_coro::Scheduler* g_scheduler;
 extern long get_peak_memory_usage_kb();
+
+// 场景随机数种子。所有随机量均由 (种子, 实体, 流编号, 步号) 经 CounterRng 生成，
+// 同一种子下的仿真结果逐位可复现，且与并行线程数和设备的处理顺序无关。
+constexpr uint64_t VPP_SCENARIO_SEED = 20240601;
+// 每个EV充电站的充电桩数量 (充电桩按充电站依次创建，第 k 个充电桩属于第 k / 10 个充电站)
+constexpr uint32_t VPP_PILES_PER_STATION = 10;
+
 // 发电机任务 (Generator Task)
 // 模拟发电机的启动过程和对功率调整请求的响应。
 cps_coro::Task generatorTask()
@@ -29,17 +57,18 @@ cps_coro::Task generatorTask()
     if (g_console_logger && g_scheduler)
         g_console_logger->info("[{}毫秒] [发电机] 已成功并网，运行稳定。", g_scheduler->now().time_since_epoch().count());
 
-    if (g_scheduler)
+    if (g_scheduler) {
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
         g_scheduler->trigger_event(GENERATOR_READY_EVENT); // 触发发电机就绪事件
+    }
 
     // 发电机进入稳定运行状态后，持续监听功率调整请求
     while (true) {
-        // 等待功率调整请求事件 (POWER_ADJUST_REQUEST_EVENT)
-        // 此处假设此事件不携带具体数据 (void 事件)
-        co_await cps_coro::wait_for_event<void>(POWER_ADJUST_REQUEST_EVENT);
+        // 等待功率调整请求事件 (POWER_ADJUST_REQUEST_EVENT)，事件携带AGC给出的功率目标
+        PowerAdjustRequest request = co_await cps_coro::wait_for_event<PowerAdjustRequest>(POWER_ADJUST_REQUEST_EVENT);
 
         if (g_console_logger && g_scheduler)
-            g_console_logger->info("[{}毫秒] [发电机] 收到功率调整请求 (POWER_ADJUST_REQUEST_EVENT)。正在执行调整...", g_scheduler->now().time_since_epoch().count());
+            g_console_logger->info("[{}毫秒] [发电机] 收到功率调整请求 (POWER_ADJUST_REQUEST_EVENT)，目标 {:.1f} kW。正在执行调整...", g_scheduler->now().time_since_epoch().count(), request.target_kW);
 
         co_await cps_coro::delay(cps_coro::Scheduler::duration(300)); // 模拟功率调整过程耗时300毫秒
 
@@ -66,8 +95,10 @@ cps_coro::Task loadTask()
     if (g_console_logger && g_scheduler)
         g_console_logger->info("[{}毫秒] [负荷] 负荷发生变化 (增加)。正在触发负荷变化事件 (LOAD_CHANGE_EVENT)。", g_scheduler->now().time_since_epoch().count());
 
-    if (g_scheduler)
+    if (g_scheduler) {
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
         g_scheduler->trigger_event(LOAD_CHANGE_EVENT); // 触发一个通用的负荷变化事件 (不带数据)
+    }
 
     // 模拟一段时间后负荷再次发生显著变化
     co_await cps_coro::delay(cps_coro::Scheduler::duration(10000)); // 等待10秒 (仿真时间)
@@ -76,76 +107,60 @@ cps_coro::Task loadTask()
         g_console_logger->info("[{}毫秒] [负荷] 负荷发生显著变化 (大幅增加)。正在触发负荷变化事件 (LOAD_CHANGE_EVENT) 及系统稳定性风险事件 (STABILITY_CONCERN_EVENT)。", g_scheduler->now().time_since_epoch().count());
 
     if (g_scheduler) {
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
         g_scheduler->trigger_event(LOAD_CHANGE_EVENT);
         g_scheduler->trigger_event(STABILITY_CONCERN_EVENT); // 同时触发一个稳定性风险事件
     }
     co_return; // 负荷任务的模拟序列结束
 }
 
-void test_vpp()
+// AGC (二次调频) 任务
+// 每隔2~4秒根据最近的频率偏差计算VPP整体功率目标，并通过 POWER_ADJUST_REQUEST_EVENT 发出。
+// 目标 = 计划总功率 + 比例项 (bias × -Δf) + 积分项 (integral_gain × ∫-Δf dt)。
+// 频率偏差按AGC自身的周期直接取自频率最新值通道 (无需常驻的频率监视任务)。
+// 给出通信网络时，功率目标经 channel (调度主站至VPP的通信通道) 下发，否则直接触发事件。
+cps_coro::Task agcTask(double schedule_kW, double bias_kW_per_Hz, double integral_gain_kW_per_Hz_s,
+    const cps_coro::LatestValueChannel<FrequencyInfo>& frequency,
+    CommNetwork* comm = nullptr, Entity channel = 0)
 {
+    double integral_Hz_s = 0.0;
+    for (uint32_t cycle = 0;; ++cycle) {
+        // AGC周期 2~4秒，由周期序号定位随机数 (AGC不属于任何设备实体，实体ID取0)
+        int interval_ms = CounterRng(VPP_SCENARIO_SEED, 0, RngStream::AGC_INTERVAL, cycle).uniform_int(2000, 4000);
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(interval_ms));
+        const double latest_deviation_hz = frequency.latest().freq_deviation_hz;
+        integral_Hz_s += -latest_deviation_hz * (interval_ms / 1000.0);
+        PowerAdjustRequest request;
+        request.target_kW = schedule_kW - bias_kW_per_Hz * latest_deviation_hz + integral_gain_kW_per_Hz_s * integral_Hz_s;
+        PhaseScope phase(SimPhase::EVENT_DISPATCH);
+        if (comm)
+            comm->send(channel, POWER_ADJUST_REQUEST_EVENT, request);
+        else if (g_scheduler)
+            g_scheduler->trigger_event(POWER_ADJUST_REQUEST_EVENT, request);
+    }
+}
 
-    // --- 创建调度器和ECS注册表实例 ---
-    cps_coro::Scheduler scheduler_instance; // 创建标准事件调度器
-    g_scheduler = &scheduler_instance; // 初始化全局调度器指针，使其指向此实例
-    Registry registry; // 创建ECS注册表实例
-
-    if (g_console_logger)
-        g_console_logger->info("--- 主动配电网CPS统一行为建模与高效仿真平台 ---");
-    if (g_console_logger)
-        g_console_logger->info("日志系统: spdlog。仿真模式: 事件驱动VPP, 包含统计数据。");
-
-    // 设置仿真初始时间 (通常为0)
-    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
-    if (g_console_logger)
-        g_console_logger->info("仿真初始时间已设置为: {} 毫秒。", g_scheduler->now().time_since_epoch().count());
-
-    // --- 初始化继电保护系统模块 ---
-    /*
-    ProtectionSystem protection_system(registry, scheduler_instance); // 创建保护系统实例，传入注册表和调度器
-
-    // 创建被保护设备实体，并为其添加保护组件
-    Entity line1_prot = registry.create(); // 模拟一条被保护的线路
-    registry.emplace<OverCurrentProtection>(line1_prot, 5.0, 200, "线路1过流保护-速动段"); // 电流定值5kA, 延时200ms
-    registry.emplace<DistanceProtection>(line1_prot, 5.0, 0, 15.0, 300, 25.0, 700); // I段:5Ω,0ms; II段:15Ω,300ms; III段:25Ω,700ms
-
-    Entity transformer1_prot = registry.create(); // 模拟一台被保护的变压器
-    registry.emplace<OverCurrentProtection>(transformer1_prot, 2.5, 300, "变压器1过流保护-主保护段"); // 电流定值2.5kA, 延时300ms
-
-    if (g_console_logger)
-        g_console_logger->info("已创建保护实体: 线路1_保护 (实体ID #{}), 变压器1_保护 (实体ID #{})。", line1_prot, transformer1_prot);
-
-    // 启动保护系统的核心运行任务和相关的辅助任务 (故障注入器、断路器代理)
-    auto prot_sys_run_task = protection_system.run();
-    prot_sys_run_task.detach(); // 分离任务，让其在调度器中独立运行
-
-    // 注意：faultInjectorTask_prot 和 circuitBreakerAgentTask_prot 现在需要 scheduler_instance 作为参数
-    auto fault_inject_prot_task = faultInjectorTask_prot(protection_system, line1_prot, transformer1_prot, scheduler_instance);
-    fault_inject_prot_task.detach();
-    auto breaker_l1p_task = circuitBreakerAgentTask_prot(line1_prot, "线路1_保护设备", scheduler_instance);
-    breaker_l1p_task.detach();
-    auto breaker_t1p_task = circuitBreakerAgentTask_prot(transformer1_prot, "变压器1_保护设备", scheduler_instance);
-    breaker_t1p_task.detach();
-    if (g_console_logger)
-        g_console_logger->info("继电保护系统相关任务已启动。");
-    */
-
-    // --- 初始化频率响应系统模块 (VPP) ---
-    std::vector<Entity> ev_pile_entities_freq; // 存储所有EV充电桩实体的ID
-    std::vector<Entity> ess_unit_entities_freq; // 存储所有ESS单元实体的ID
-    std::random_device rd_freq; // 用于生成随机数种子
-    std::mt19937 rng_freq(rd_freq()); // Mersenne Twister 随机数引擎
-    std::uniform_real_distribution<double> soc_dist_freq(0.25, 0.90); // SOC在25%到90%之间均匀分布
+// VPP场景: 设备实体列表、名称表以及初始调度状态 (需要启动的协程任务表)。
+// 无论场景是现场构建的还是从预编译镜像加载的，都统一为此结构后再启动任务。
+struct VppScenario {
+    std::vector<Entity> ev_pile_entities; // 所有EV充电桩实体
+    std::vector<Entity> ess_unit_entities; // 所有ESS单元实体
+    std::vector<std::string> names; // 名称表 (任务日志名称)，任务以引用方式使用，需在仿真期间保持有效
+    std::vector<ScenarioTaskRecord> tasks; // 按启动顺序排列的任务表
+};
 
+// 现场构建VPP场景: 创建EV充电桩与ESS单元实体及其组件，并生成任务表。
+static void build_vpp_scenario(Registry& registry, VppScenario& scenario)
+{
     int num_ev_stations = 44; // 模拟的EV充电站数量
-    int piles_per_station = 10; // 每个充电站的充电桩数量
+    int piles_per_station = VPP_PILES_PER_STATION; // 每个充电站的充电桩数量
     int total_ev_piles = num_ev_stations * piles_per_station; // 总EV充电桩数量
 
     // 创建并配置EV充电桩实体
     for (int i = 0; i < total_ev_piles; ++i) {
         Entity pile = registry.create();
-        ev_pile_entities_freq.push_back(pile);
-        double initial_soc = soc_dist_freq(rng_freq); // 随机生成初始SOC
+        scenario.ev_pile_entities.push_back(pile);
+        double initial_soc = CounterRng::uniform_at(VPP_SCENARIO_SEED, pile, RngStream::INITIAL_SOC, 0, 0.25, 0.90); // 初始SOC在25%到90%之间均匀分布
         double scheduled_charging_power_kW; // 计划充电功率
         // 示例：按一定比例设置不同的计划充电功率
         if (i % 3 == 0)
@@ -175,7 +190,7 @@ void test_vpp()
     int num_ess_units = 60; // 模拟的ESS单元数量
     for (int i = 0; i < num_ess_units; ++i) {
         Entity ess = registry.create();
-        ess_unit_entities_freq.push_back(ess);
+        scenario.ess_unit_entities.push_back(ess);
         double ess_gain_kw_per_hz = 1000.0 / 0.03;
         registry.emplace<FrequencyControlConfigComponent>(ess,
             FrequencyControlConfigComponent::DeviceType::ESS_UNIT, // 类型
@@ -192,44 +207,263 @@ void test_vpp()
     if (g_console_logger)
         g_console_logger->info("已初始化 {} 个储能单元 (ESS) 用于频率响应仿真。", num_ess_units);
 
-    // --- 启动频率响应系统的核心任务 ---
-    double freq_sim_step_ms = 20.0;
-    // 频率预言机仍然是单个任务，负责发布频率事件
-    auto freq_oracle_task_main = frequencyOracleTask(registry, ev_pile_entities_freq, ess_unit_entities_freq, 5.0, freq_sim_step_ms);
-    freq_oracle_task_main.detach();
+    // 任务表: 频率预言机 -> 各EV充电桩 -> 各ESS单元 -> 发电机 -> 负荷
+    scenario.tasks.push_back({ 0, static_cast<uint32_t>(ScenarioTaskKind::FREQUENCY_ORACLE), SCENARIO_NO_NAME, 5.0, 20.0 });
+    for (size_t i = 0; i < scenario.ev_pile_entities.size(); ++i) {
+        scenario.names.push_back("EV桩_" + std::to_string(i)); // 为日志生成唯一名称
+        scenario.tasks.push_back({ scenario.ev_pile_entities[i], static_cast<uint32_t>(ScenarioTaskKind::DEVICE_FREQUENCY_RESPONSE),
+            static_cast<uint32_t>(scenario.names.size() - 1), 0.0, 0.0 });
+    }
+    for (size_t i = 0; i < scenario.ess_unit_entities.size(); ++i) {
+        scenario.names.push_back("ESS单元_" + std::to_string(i));
+        scenario.tasks.push_back({ scenario.ess_unit_entities[i], static_cast<uint32_t>(ScenarioTaskKind::DEVICE_FREQUENCY_RESPONSE),
+            static_cast<uint32_t>(scenario.names.size() - 1), 0.0, 0.0 });
+    }
+    scenario.tasks.push_back({ 0, static_cast<uint32_t>(ScenarioTaskKind::GENERATOR), SCENARIO_NO_NAME, 0.0, 0.0 });
+    scenario.tasks.push_back({ 0, static_cast<uint32_t>(ScenarioTaskKind::LOAD), SCENARIO_NO_NAME, 0.0, 0.0 });
+}
+
+// 从已映射的场景镜像恢复VPP场景。
+// 组件按镜像中的稠密数组顺序逐条登记，实体ID保持不变; 不再进行随机数生成和参数推导。
+static void load_vpp_scenario_image(const ScenarioImage& image, Registry& registry, VppScenario& scenario)
+{
+    auto devices = image.devices();
+    auto states = image.states();
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const auto& rec = devices[i];
+        Entity e = registry.create_with_id(rec.entity);
+        auto type = static_cast<FrequencyControlConfigComponent::DeviceType>(rec.device_type);
+        registry.emplace<FrequencyControlConfigComponent>(e, type, rec.base_power_kW, rec.gain_kW_per_Hz, rec.deadband_Hz,
+            rec.max_output_kW, rec.min_output_kW, rec.soc_min_threshold, rec.soc_max_threshold);
+        registry.emplace<PhysicalStateComponent>(e, states[i].current_power_kW, states[i].soc);
+        if (type == FrequencyControlConfigComponent::DeviceType::EV_PILE)
+            scenario.ev_pile_entities.push_back(e);
+        else
+            scenario.ess_unit_entities.push_back(e);
+    }
+    registry.create_with_id(image.header().max_entity_id);
+
+    scenario.names.reserve(image.name_count());
+    for (uint32_t i = 0; i < image.name_count(); ++i)
+        scenario.names.emplace_back(image.name(i));
+    auto tasks = image.tasks();
+    scenario.tasks.assign(tasks.begin(), tasks.end());
+
     if (g_console_logger)
-        g_console_logger->info("频率预言机任务已启动。");
+        g_console_logger->info("已从场景镜像恢复 {} 个EV充电桩和 {} 个储能单元 (映射 {} 字节)。",
+            scenario.ev_pile_entities.size(), scenario.ess_unit_entities.size(), image.mapped_bytes());
+}
 
-    // 为每个EV充电桩启动一个独立的频率响应协程
+// 按任务表启动场景中的所有协程任务
+// adjuster: 传给频率预言机的频率模型修正 (可为空)
+// fleet: 非空时设备不再各自启动协程，而是加入该批量频率响应集群 (打包存储，单个协程批量更新)
+static void spawn_vpp_tasks(Registry& registry, const VppScenario& scenario, FrequencyModelAdjuster* adjuster = nullptr,
+    FrequencyResponseFleet* fleet = nullptr)
+{
+    static const std::vector<Entity> no_entities;
     int ev_task_count = 0;
-    for (Entity ev_entity : ev_pile_entities_freq) {
-        std::ostringstream ev_name_stream;
-        ev_name_stream << "EV桩_" << ev_task_count++; // 为日志生成唯一名称
-        auto individual_ev_task = individualDeviceFrequencyResponseTask(registry, ev_entity, ev_name_stream.str());
-        individual_ev_task.detach(); // 分离任务，使其在调度器中独立运行
+    int ess_task_count = 0;
+    // 集群分区: 每个EV充电站一个分区，全部ESS单元合为其后的一个分区
+    const uint32_t ess_partition = static_cast<uint32_t>((scenario.ev_pile_entities.size() + VPP_PILES_PER_STATION - 1) / VPP_PILES_PER_STATION);
+    if (fleet)
+        fleet->reserve(scenario.ev_pile_entities.size() + scenario.ess_unit_entities.size());
+    for (const auto& task : scenario.tasks) {
+        switch (static_cast<ScenarioTaskKind>(task.kind)) {
+        case ScenarioTaskKind::FREQUENCY_ORACLE:
+            // 频率预言机仍然是单个任务，负责发布频率事件
+            if (fleet)
+                frequencyOracleTask(registry, no_entities, no_entities, task.param0, task.param1, adjuster, fleet).detach();
+            else
+                frequencyOracleTask(registry, scenario.ev_pile_entities, scenario.ess_unit_entities, task.param0, task.param1, adjuster).detach();
+            if (g_console_logger)
+                g_console_logger->info("频率预言机任务已启动。");
+            break;
+        case ScenarioTaskKind::DEVICE_FREQUENCY_RESPONSE: {
+            // 为每个设备启动一个独立的频率响应协程
+            auto config = registry.get<FrequencyControlConfigComponent>(task.entity);
+            uint32_t partition = ess_partition;
+            if (config && config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE)
+                partition = static_cast<uint32_t>(ev_task_count++) / VPP_PILES_PER_STATION;
+            else
+                ++ess_task_count;
+            if (fleet)
+                fleet->add_device(task.entity, partition);
+            else
+                individualDeviceFrequencyResponseTask(registry, task.entity, scenario.names[task.name_index]).detach();
+            break;
+        }
+        case ScenarioTaskKind::GENERATOR:
+            generatorTask().detach();
+            break;
+        case ScenarioTaskKind::LOAD:
+            loadTask().detach();
+            break;
+        }
     }
+    if (fleet) {
+        fleet->sort_by_partition(); // 同一充电站的设备在各打包池中连续存放
+        fleet->run().detach();
+    }
+    if (g_console_logger) {
+        if (fleet) {
+            g_console_logger->info("{} 个EV充电桩和 {} 个ESS单元已加入批量频率响应集群。", ev_task_count, ess_task_count);
+        } else {
+            g_console_logger->info("已为 {} 个EV充电桩分别启动独立的频率响应协程任务。", ev_task_count);
+            g_console_logger->info("已为 {} 个ESS单元分别启动独立的频率响应协程任务。", ess_task_count);
+        }
+        g_console_logger->info("通用后台仿真任务 (发电机、负荷等) 已启动。");
+    }
+}
+
+// 编译场景: 现场构建一次VPP场景，并将其写出为可被 mmap 直接加载的场景镜像。
+void compile_vpp_scenario_image(const std::string& image_path)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+    VppScenario scenario;
+    build_vpp_scenario(registry, scenario);
+
+    ScenarioImageBuilder builder;
+    builder.set_initial_time_ms(scheduler_instance.now().time_since_epoch().count());
+    for (const auto& name : scenario.names)
+        builder.add_name(name);
+
+    auto add_devices = [&](const std::vector<Entity>& entities) {
+        for (Entity e : entities) {
+            auto config = registry.get<FrequencyControlConfigComponent>(e);
+            auto state = registry.get<PhysicalStateComponent>(e);
+            if (!config || !state)
+                continue;
+            ScenarioDeviceRecord rec {};
+            rec.entity = e;
+            rec.device_type = static_cast<uint32_t>(config->type);
+            rec.name_index = SCENARIO_NO_NAME;
+            rec.base_power_kW = config->base_power_kW;
+            rec.gain_kW_per_Hz = config->gain_kW_per_Hz;
+            rec.deadband_Hz = config->deadband_Hz;
+            rec.max_output_kW = config->max_output_kW;
+            rec.min_output_kW = config->min_output_kW;
+            rec.soc_min_threshold = config->soc_min_threshold;
+            rec.soc_max_threshold = config->soc_max_threshold;
+            builder.add_device(rec, { state->current_power_kW, state->soc });
+        }
+    };
+    add_devices(scenario.ev_pile_entities);
+    add_devices(scenario.ess_unit_entities);
+    for (const auto& task : scenario.tasks)
+        builder.add_task(task);
+
+    size_t bytes = builder.write(image_path);
     if (g_console_logger)
-        g_console_logger->info("已为 {} 个EV充电桩分别启动独立的频率响应协程任务。", ev_task_count);
+        g_console_logger->info("场景镜像已写出: {} ({} 个设备, {} 个任务, {} 字节)。",
+            image_path, scenario.ev_pile_entities.size() + scenario.ess_unit_entities.size(), scenario.tasks.size(), bytes);
+    g_scheduler = nullptr;
+}
 
-    // 为每个ESS单元启动一个独立的频率响应协程
-    int ess_task_count = 0;
-    for (Entity ess_entity : ess_unit_entities_freq) {
-        std::ostringstream ess_name_stream;
-        ess_name_stream << "ESS单元_" << ess_task_count++; // 为日志生成唯一名称
-        auto individual_ess_task = individualDeviceFrequencyResponseTask(registry, ess_entity, ess_name_stream.str());
-        individual_ess_task.detach(); // 分离任务
+// 实时状态导出: 每个频率步之后把频率偏差与VPP总功率发布到共享内存
+static cps_coro::Task liveStateVppTask(LiveStatePublisher& publisher, Registry& registry, const VppScenario& scenario,
+    const FrequencyResponseFleet* fleet)
+{
+    LiveStateSnapshot snapshot {};
+    snapshot.valid_fields = LIVE_FIELD_FREQUENCY | LIVE_FIELD_VPP_POWER;
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
+    while (true) {
+        const FrequencyInfo& info = co_await frequency_reader.next();
+        double total_power_kW = 0.0;
+        if (fleet) {
+            total_power_kW = fleet->total_power_kW();
+        } else {
+            for (const auto* entities : { &scenario.ev_pile_entities, &scenario.ess_unit_entities })
+                for (Entity device : *entities)
+                    if (auto state = registry.get<PhysicalStateComponent>(device))
+                        total_power_kW += state->current_power_kW;
+        }
+        snapshot.sim_time_s = info.current_sim_time_seconds;
+        snapshot.freq_deviation_hz = info.freq_deviation_hz;
+        snapshot.vpp_total_power_kW = total_power_kW;
+        publisher.publish(snapshot);
     }
+}
+
+// packed: 设备使用打包存储与批量频率响应 (FrequencyResponseFleet)，而非每台设备一个协程
+// live_state_name: 非空时按物理时钟实时运行，并把频率偏差与VPP总功率发布到该名称的共享内存
+void test_vpp(const std::string& scenario_image_path, bool packed, const std::string& live_state_name)
+{
+
+    // --- 创建调度器和ECS注册表实例 ---
+    cps_coro::RealTimeScheduler scheduler_instance; // 创建事件调度器 (非实时运行时与标准调度器完全相同)
+    g_scheduler = &scheduler_instance; // 初始化全局调度器指针，使其指向此实例
+    Registry registry; // 创建ECS注册表实例
+
+    if (g_console_logger)
+        g_console_logger->info("--- 主动配电网CPS统一行为建模与高效仿真平台 ---");
     if (g_console_logger)
-        g_console_logger->info("已为 {} 个ESS单元分别启动独立的频率响应协程任务。", ess_task_count);
+        g_console_logger->info("日志系统: spdlog。仿真模式: 事件驱动VPP, 包含统计数据。");
 
-    // --- 启动通用后台任务 (发电机、负荷) ---
-    auto gen_task_main = generatorTask();
-    gen_task_main.detach();
-    auto load_task_main = loadTask();
-    load_task_main.detach();
+    // 设置仿真初始时间 (通常为0)
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
     if (g_console_logger)
-        g_console_logger->info("通用后台仿真任务 (发电机、负荷等) 已启动。");
+        g_console_logger->info("仿真初始时间已设置为: {} 毫秒。", g_scheduler->now().time_since_epoch().count());
+
+    // --- 初始化继电保护系统模块 ---
+    /*
+    ProtectionSystem protection_system(registry, scheduler_instance); // 创建保护系统实例，传入注册表和调度器
 
+    // 创建被保护设备实体，并为其添加保护组件
+    Entity line1_prot = registry.create(); // 模拟一条被保护的线路
+    registry.emplace<OverCurrentProtection>(line1_prot, 5.0, 200, "线路1过流保护-速动段"); // 电流定值5kA, 延时200ms
+    registry.emplace<DistanceProtection>(line1_prot, 5.0, 0, 15.0, 300, 25.0, 700); // I段:5Ω,0ms; II段:15Ω,300ms; III段:25Ω,700ms
+
+    Entity transformer1_prot = registry.create(); // 模拟一台被保护的变压器
+    registry.emplace<OverCurrentProtection>(transformer1_prot, 2.5, 300, "变压器1过流保护-主保护段"); // 电流定值2.5kA, 延时300ms
+
+    if (g_console_logger)
+        g_console_logger->info("已创建保护实体: 线路1_保护 (实体ID #{}), 变压器1_保护 (实体ID #{})。", line1_prot, transformer1_prot);
+
+    // 启动保护系统的核心运行任务和相关的辅助任务 (故障注入器、断路器代理)
+    auto prot_sys_run_task = protection_system.run();
+    prot_sys_run_task.detach(); // 分离任务，让其在调度器中独立运行
+
+    // 注意：faultInjectorTask_prot 和 circuitBreakerAgentTask_prot 现在需要 scheduler_instance 作为参数
+    auto fault_inject_prot_task = faultInjectorTask_prot(protection_system, line1_prot, transformer1_prot, scheduler_instance);
+    fault_inject_prot_task.detach();
+    auto breaker_l1p_task = circuitBreakerAgentTask_prot(line1_prot, "线路1_保护设备", scheduler_instance);
+    breaker_l1p_task.detach();
+    auto breaker_t1p_task = circuitBreakerAgentTask_prot(transformer1_prot, "变压器1_保护设备", scheduler_instance);
+    breaker_t1p_task.detach();
+    if (g_console_logger)
+        g_console_logger->info("继电保护系统相关任务已启动。");
+    */
+
+    // --- 初始化频率响应系统模块 (VPP) ---
+    // 场景既可以现场构建，也可以从预编译的场景镜像直接映射加载
+    VppScenario scenario;
+    ScenarioImage scenario_image;
+    FrequencyResponseFleet fleet(registry);
+    {
+        PhaseScope phase(SimPhase::SETUP);
+        if (scenario_image_path.empty()) {
+            build_vpp_scenario(registry, scenario);
+        } else {
+            scenario_image.open(scenario_image_path);
+            g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(scenario_image.header().initial_time_ms) });
+            load_vpp_scenario_image(scenario_image, registry, scenario);
+        }
+
+        // --- 启动频率响应系统的核心任务以及通用后台任务 (发电机、负荷) ---
+        spawn_vpp_tasks(registry, scenario, nullptr, packed ? &fleet : nullptr);
+    }
+    LiveStatePublisher live_state;
+    if (!live_state_name.empty()) {
+        if (live_state.open(live_state_name)) {
+            liveStateVppTask(live_state, registry, scenario, packed ? &fleet : nullptr).detach();
+            if (g_console_logger)
+                g_console_logger->info("实时状态已发布到共享内存 {} (每个频率步)，仿真按物理时钟实时运行。", live_state_name);
+        } else if (g_console_logger) {
+            g_console_logger->warn("无法创建共享内存 {}，不发布实时状态。", live_state_name);
+        }
+    }
     // --- 运行仿真 ---
     auto real_time_sim_start = std::chrono::high_resolution_clock::now(); // 记录仿真开始时的物理时钟时间
 
@@ -241,7 +475,13 @@ void test_vpp()
         g_console_logger->info("\n--- 即将开始运行主仿真循环，直至仿真时间到达 {} 毫秒 --- \n", end_time.time_since_epoch().count());
 
     // 执行仿真循环
-    g_scheduler->run_until(end_time);
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        if (!live_state_name.empty())
+            scheduler_instance.run_real_time_until(end_time);
+        else
+            g_scheduler->run_until(end_time);
+    }
 
     auto real_time_sim_end = std::chrono::high_resolution_clock::now(); // 记录仿真结束时的物理时钟时间
     std::chrono::duration<double> real_time_elapsed_seconds = real_time_sim_end - real_time_sim_start; // 计算总物理耗时
@@ -252,6 +492,24 @@ void test_vpp()
         g_console_logger->info("最终仿真时间: {} 毫秒。", g_scheduler->now().time_since_epoch().count());
         g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒。", real_time_elapsed_seconds.count());
     }
+    if (packed) {
+        fleet.sync_to_components();
+        // 按充电站汇总: 每个分区是打包池中的一段连续区间
+        auto station_power = fleet.partition_power_kW();
+        const auto& ranges = fleet.partition_ranges();
+        if (g_console_logger && !ranges.empty()) {
+            size_t max_idx = 0;
+            for (size_t r = 1; r < ranges.size(); ++r)
+                if (std::abs(station_power[r]) > std::abs(station_power[max_idx]))
+                    max_idx = r;
+            g_console_logger->info("按分区汇总: {} 个分区 (充电站及储能)，功率绝对值最大的分区 #{} ({} 台设备) 为 {:.1f} kW。", ranges.size(),
+                ranges[max_idx].partition, ranges[max_idx].end - ranges[max_idx].begin, station_power[max_idx]);
+        }
+        if (g_console_logger)
+            g_console_logger->info("打包存储: 每台设备 {} 字节，其中每步遍历的热数据 {} 字节 (多态组件为 {} + {} 字节，另加各自的堆块与哈希节点)。",
+                FrequencyResponseFleet::bytes_per_device(), FrequencyResponseFleet::hot_bytes_per_device(),
+                sizeof(PhysicalStateComponent), sizeof(FrequencyControlConfigComponent));
+    }
 
     // 获取并打印峰值内存使用情况
     long peak_mem_kb = get_peak_memory_usage_kb();
@@ -263,4 +521,1100 @@ void test_vpp()
 
     if (g_console_logger)
         g_console_logger->info("VPP频率响应仿真数据已保存至: {}", "虚拟电厂频率响应数据_HECS_细粒度.txt");
+}
+
+// 严重扰动频率模型: 将解析模型的初始功率缺额放大 severity 倍，并叠加低频减载切除负荷的恢复效果。
+// 原始扰动的频率最低点约为 -0.18 Hz，不足以触及低频减载定值。
+class SevereDisturbanceModel : public FrequencyModelAdjuster {
+public:
+    SevereDisturbanceModel(double severity, UflsSystem& ufls)
+        : severity_(severity)
+        , ufls_(ufls)
+    {
+    }
+
+    double adjust_deviation(double sim_time_s, double base_deviation_hz) override
+    {
+        return ufls_.adjust_deviation(sim_time_s, base_deviation_hz * severity_);
+    }
+
+private:
+    double severity_;
+    UflsSystem& ufls_;
+};
+
+// 低频减载仿真: 在VPP场景的基础上增加数千条馈线负荷及其分轮次低频减载继电器，
+// 施加严重功率缺额扰动，观察低频减载动作及其对频率的恢复作用。
+void test_ufls()
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+
+    if (g_console_logger)
+        g_console_logger->info("--- 低频减载 (UFLS) 仿真: 严重功率缺额扰动 ---");
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    VppScenario scenario;
+    build_vpp_scenario(registry, scenario);
+
+    // --- 馈线负荷 ---
+    const int num_feeders = 4000;
+    std::vector<Entity> feeders;
+    std::vector<double> offsets;
+    double total_feeder_load_kW = 0.0;
+    for (int i = 0; i < num_feeders; ++i) {
+        Entity feeder = registry.create();
+        double load_kW = CounterRng::uniform_at(VPP_SCENARIO_SEED, feeder, RngStream::FEEDER_LOAD, 0, 200.0, 800.0); // 馈线负荷 (kW)
+        registry.emplace<FeederLoadComponent>(feeder, load_kW, i % 4); // 远方切负荷按4档优先级轮换
+        feeders.push_back(feeder);
+        offsets.push_back(CounterRng::uniform_at(VPP_SCENARIO_SEED, feeder, RngStream::RELAY_OFFSET, 0, -0.02, 0.02)); // 继电器整定偏差 (Hz)
+        total_feeder_load_kW += load_kW;
+    }
+
+    // --- 低频减载子系统 ---
+    UflsSettings settings;
+    settings.stages = {
+        { -0.5, 200.0, 0.15 }, // 第1轮: 49.5Hz, 0.2秒, 切15%
+        { -0.7, 300.0, 0.15 }, // 第2轮: 49.3Hz, 0.3秒, 切15%
+        { -0.9, 500.0, 0.15 }, // 第3轮: 49.1Hz, 0.5秒, 切15%
+    };
+    settings.system_base_kW = total_feeder_load_kW;
+    settings.step_ms = 20.0;
+    settings.alert_deviation_Hz = -0.3;
+    settings.preventive_shed_kW = 0.02 * total_feeder_load_kW;
+
+    UflsSystem ufls(registry, scheduler_instance, settings);
+    for (size_t i = 0; i < feeders.size(); ++i)
+        ufls.add_feeder(feeders[i], offsets[i]);
+    ufls.start();
+
+    SevereDisturbanceModel disturbance_model(6.0, ufls);
+    spawn_vpp_tasks(registry, scenario, &disturbance_model);
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    cps_coro::Scheduler::time_point end_time = g_scheduler->now() + std::chrono::milliseconds(30000); // 模拟30秒
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(end_time);
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    ufls.log_summary();
+    if (g_console_logger) {
+        g_console_logger->info("馈线总负荷 {:.1f} kW，切除比例 {:.2f}%。", total_feeder_load_kW, 100.0 * ufls.total_shed_kW() / total_feeder_load_kW);
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒。", real_time_elapsed_seconds.count());
+    }
+    g_scheduler = nullptr;
+}
+
+// VPP功率分配仿真: 大规模设备集群 (默认10^6台) 在AGC每2~4秒一次的功率目标下进行分层比例分配。
+// 本场景只关注分配引擎的开销，设备不启动各自的一次调频协程。
+void test_vpp_dispatch(size_t device_count)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+
+    if (g_console_logger)
+        g_console_logger->info("--- VPP功率分配仿真: {} 台设备, AGC周期2~4秒 ---", device_count);
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    ParallelExecutor executor;
+    VppDispatcher dispatcher(registry, executor);
+    CommNetwork comm(registry, scheduler_instance, VPP_SCENARIO_SEED);
+
+    // --- 设备集群: 每10台中1台为储能单元 (优先承担调节)，其余为EV充电桩 ---
+    // 初始SOC (包含越过SOC上下限的设备) 按实体ID由计数器随机数并行生成，结果与并行度无关
+    std::vector<Entity> devices(device_count);
+    for (auto& device : devices)
+        device = registry.create();
+    std::vector<double> initial_soc(device_count);
+    executor.parallel_for(device_count, 65536, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            initial_soc[i] = CounterRng::uniform_at(VPP_SCENARIO_SEED, devices[i], RngStream::INITIAL_SOC, 0, 0.05, 0.98);
+    });
+
+    double schedule_kW = 0.0;
+    double up_capacity_kW = 0.0;
+    for (size_t i = 0; i < device_count; ++i) {
+        Entity device = devices[i];
+        if (i % 10 == 0) {
+            registry.emplace<FrequencyControlConfigComponent>(device, FrequencyControlConfigComponent::DeviceType::ESS_UNIT,
+                0.0, 1000.0 / 0.03, 0.03, 100.0, -100.0, 0.05, 0.95);
+            registry.emplace<PhysicalStateComponent>(device, 0.0, initial_soc[i]);
+            dispatcher.add_device(device, 0);
+            up_capacity_kW += 100.0;
+        } else {
+            double scheduled_kW = (i % 3 == 0) ? -5.0 : ((i % 3 == 1) ? -3.5 : 0.0);
+            registry.emplace<FrequencyControlConfigComponent>(device, FrequencyControlConfigComponent::DeviceType::EV_PILE,
+                scheduled_kW, 4.0, 0.03, 5.0, -5.0, 0.1, 0.95);
+            registry.emplace<PhysicalStateComponent>(device, scheduled_kW, initial_soc[i]);
+            dispatcher.add_device(device, 1);
+            schedule_kW += scheduled_kW;
+            up_capacity_kW += 5.0 - scheduled_kW;
+        }
+    }
+    if (g_console_logger)
+        g_console_logger->info("设备集群已创建: 计划总功率 {:.1f} kW，上调容量 {:.1f} kW，并行度 {}。", schedule_kW, up_capacity_kW, executor.concurrency());
+
+    // --- 任务: 频率预言机 (不统计设备功率)、AGC、分配引擎、发电机 ---
+    static const std::vector<Entity> no_entities;
+    frequencyOracleTask(registry, no_entities, no_entities, 5.0, 20.0).detach();
+    // 频率偏差系数取 0.5Hz 对应全部上调容量，积分增益为其二十分之一
+    double bias_kW_per_Hz = up_capacity_kW / 0.5;
+    // AGC功率目标经调度主站至VPP聚合平台的IEC104通道下发
+    Entity agc_channel = comm.add_channel(CommChannelParams::iec104());
+    comm.start();
+    auto& frequency_channel = g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT);
+    agcTask(schedule_kW, bias_kW_per_Hz, 0.05 * bias_kW_per_Hz, frequency_channel, &comm, agc_channel).detach();
+    dispatcher.run().detach();
+    generatorTask().detach();
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(g_scheduler->now() + std::chrono::milliseconds(60000)); // 模拟60秒
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    if (g_console_logger) {
+        g_console_logger->info("共执行 {} 次分配，平均耗时 {:.3f} 毫秒，最大 {:.3f} 毫秒。", dispatcher.dispatch_count(),
+            dispatcher.dispatch_count() ? dispatcher.total_dispatch_ms() / dispatcher.dispatch_count() : 0.0, dispatcher.max_dispatch_ms());
+        auto comm_stats = comm.stats();
+        g_console_logger->info("AGC指令: 发送 {} 帧，送达 {} 帧，平均通信时延 {:.1f} 毫秒。", comm_stats.sent, comm_stats.delivered, comm_stats.mean_latency_ms);
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒。", real_time_elapsed_seconds.count());
+    }
+    long peak_mem_kb = get_peak_memory_usage_kb();
+    if (peak_mem_kb != -1 && g_console_logger)
+        g_console_logger->info("本次仿真峰值内存使用 (近似值): {} KB (约 {:.2f} MB)。", peak_mem_kb, peak_mem_kb / 1024.0);
+    g_scheduler = nullptr;
+}
+
+// 大规模设备群: 每10台中1台为储能单元，其余为EV充电桩 (计划充电功率按序号轮换)，初始SOC在5%~98%之间均匀分布
+static std::vector<Entity> create_device_population(Registry& registry, size_t device_count)
+{
+    std::vector<Entity> devices;
+    devices.reserve(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        Entity device = registry.create();
+        double soc = CounterRng::uniform_at(VPP_SCENARIO_SEED, device, RngStream::INITIAL_SOC, 0, 0.05, 0.98);
+        if (i % 10 == 0) {
+            registry.emplace<FrequencyControlConfigComponent>(device, FrequencyControlConfigComponent::DeviceType::ESS_UNIT,
+                0.0, 1000.0 / 0.03, 0.03, 100.0, -100.0, 0.05, 0.95);
+            registry.emplace<PhysicalStateComponent>(device, 0.0, soc);
+        } else {
+            double scheduled_kW = (i % 3 == 0) ? -5.0 : ((i % 3 == 1) ? -3.5 : 0.0);
+            registry.emplace<FrequencyControlConfigComponent>(device, FrequencyControlConfigComponent::DeviceType::EV_PILE,
+                scheduled_kW, 4.0, 0.03, 5.0, -5.0, 0.1, 0.95);
+            registry.emplace<PhysicalStateComponent>(device, scheduled_kW, soc);
+        }
+        devices.push_back(device);
+    }
+    return devices;
+}
+
+// 逐设备曲线输出仿真: 大规模设备集群 (默认10^5台) 由批量频率响应集群更新，每个20毫秒频率步的全部设备功率与SOC
+// 经 DeviceTraceWriter 抽取、死区过滤与压缩后写入 trace_path。仿真线程只付出每步一次的 memcpy。
+// 曲线仿真的设备集群: 每10台为一个分区。写曲线的运行与校验运行用同一组设备，结果逐位相同。
+static void populate_trace_fleet(Registry& registry, FrequencyResponseFleet& fleet, size_t device_count)
+{
+    fleet.reserve(device_count);
+    const std::vector<Entity> devices = create_device_population(registry, device_count);
+    for (size_t i = 0; i < devices.size(); ++i)
+        fleet.add_device(devices[i], static_cast<uint32_t>(i / VPP_PILES_PER_STATION));
+    fleet.sort_by_partition();
+}
+
+// 曲线校验的进度与结果
+struct TraceVerifyState {
+    DeviceTraceReader& reader;
+    const PackedPool<DeviceResponseHot>& hot;
+    const std::vector<TraceColumn>& columns;
+    size_t decimation;
+    double last_time_s = -1.0;
+    size_t steps = 0;
+    size_t samples_checked = 0;
+    size_t values_checked = 0;
+    size_t violations = 0;
+    size_t time_mismatches = 0;
+    size_t missing_samples = 0;
+    double worst_error_ratio = 0.0; // 最大的 |原始值 - 解码值| / 容限
+    std::vector<double> decoded;
+
+    // 当前热数据应与文件中的下一个样本一致: 时刻相同，各值之差不超过 死区 + 分辨率/2
+    void check(double time_s)
+    {
+        double sample_time_s = 0.0;
+        if (!reader.next(sample_time_s, decoded)) {
+            ++missing_samples;
+            return;
+        }
+        ++samples_checked;
+        if (std::llround(sample_time_s * 1000.0) != std::llround(time_s * 1000.0))
+            ++time_mismatches;
+
+        const size_t n = hot.size();
+        const char* records = reinterpret_cast<const char*>(hot.data());
+        for (size_t c = 0; c < columns.size(); ++c) {
+            const double tolerance = columns[c].deadband + 0.5 * columns[c].resolution;
+            const double* values = decoded.data() + c * n;
+            for (size_t d = 0; d < n; ++d) {
+                double raw;
+                std::memcpy(&raw, records + d * sizeof(DeviceResponseHot) + columns[c].offset, sizeof(raw));
+                const double error = std::abs(raw - values[d]);
+                worst_error_ratio = std::max(worst_error_ratio, error / tolerance);
+                if (error > tolerance * (1.0 + 1e-9))
+                    ++violations;
+            }
+            values_checked += n;
+        }
+    }
+};
+
+// 与集群读同一个频率通道，在集群处理完每一步后 (延后 1 毫秒) 按写入器的抽取规则比较
+static cps_coro::Task traceVerifierTask(TraceVerifyState& state)
+{
+    cps_coro::LatestValueReader<FrequencyInfo> frequency_reader(g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT));
+    while (true) {
+        const double time_s = (co_await frequency_reader.next()).current_sim_time_seconds;
+        co_await cps_coro::delay(std::chrono::milliseconds(1));
+        if (time_s <= state.last_time_s)
+            continue; // 集群同样跳过不前进的频率步
+        state.last_time_s = time_s;
+        if (state.steps++ % state.decimation == 0)
+            state.check(time_s);
+    }
+}
+
+// 解码曲线文件并与原始热数据比较: 不带曲线输出重新运行一遍相同的仿真，逐个样本校验。
+static void verify_vpp_trace(size_t device_count, double seconds, const std::string& trace_path, const std::vector<TraceColumn>& columns)
+{
+    DeviceTraceReader reader;
+    if (!reader.open(trace_path))
+        throw std::runtime_error("无法读取曲线文件: " + trace_path);
+
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+    FrequencyResponseFleet fleet(registry);
+    populate_trace_fleet(registry, fleet, device_count);
+    if (reader.record_count() != fleet.size() || reader.columns().size() != columns.size())
+        throw std::runtime_error("曲线文件的设备数或列数与仿真不符: " + trace_path);
+
+    TraceVerifyState state { reader, registry.pool<DeviceResponseHot>(), columns, reader.decimation() };
+    auto data_file_logger = g_data_file_logger; // 校验运行不重复写数据文件
+    g_data_file_logger = nullptr;
+    static const std::vector<Entity> no_entities;
+    frequencyOracleTask(registry, no_entities, no_entities, 5.0, 20.0, nullptr, &fleet).detach();
+    fleet.run().detach();
+    traceVerifierTask(state).detach();
+    // 多推进 1 毫秒，让最后一步的比较也能执行
+    g_scheduler->run_until(g_scheduler->now() + std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000.0) + 1));
+    g_data_file_logger = data_file_logger;
+
+    double unused_time_s;
+    size_t extra_samples = 0;
+    while (reader.next(unused_time_s, state.decoded))
+        ++extra_samples;
+
+    const bool passed = state.samples_checked > 0 && state.violations == 0 && state.time_mismatches == 0 && state.missing_samples == 0
+        && extra_samples == 0;
+    if (g_console_logger) {
+        g_console_logger->info("曲线校验: 解码 {} 个样本共 {} 个数值，与原始热数据之差最大为容限 (死区 + 分辨率/2) 的 {:.3f} 倍。",
+            state.samples_checked, state.values_checked, state.worst_error_ratio);
+        g_console_logger->info("曲线校验{}: 超出容限 {} 个，时刻不符 {} 个，缺少样本 {} 个，多出样本 {} 个。", passed ? "通过" : "失败",
+            state.violations, state.time_mismatches, state.missing_samples, extra_samples);
+    }
+    g_scheduler = nullptr;
+}
+
+void test_vpp_trace(size_t device_count, double seconds, size_t decimation, const std::string& trace_path)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+
+    if (g_console_logger)
+        g_console_logger->info("--- 逐设备曲线输出仿真: {} 台设备, {:.0f} 秒, 每 {} 步记录一次 ---", device_count, seconds, decimation);
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    FrequencyResponseFleet fleet(registry);
+    populate_trace_fleet(registry, fleet, device_count);
+
+    // 功率量化到 1W、变化超过 10W 才记录；SOC 量化到 1e-6、变化超过 1e-4 才记录
+    DeviceTraceWriter trace;
+    std::vector<TraceColumn> columns = {
+        { "power_kW", offsetof(DeviceResponseHot, current_power_kW), 0.001, 0.01 },
+        { "soc", offsetof(DeviceResponseHot, soc), 1.0e-6, 1.0e-4 },
+    };
+    TraceWriterSettings settings;
+    settings.decimation = decimation;
+    if (!trace.open(trace_path, fleet.size(), FrequencyResponseFleet::hot_bytes_per_device(), columns, settings))
+        throw std::runtime_error("无法创建曲线文件: " + trace_path);
+    fleet.set_trace(&trace);
+
+    static const std::vector<Entity> no_entities;
+    frequencyOracleTask(registry, no_entities, no_entities, 5.0, 20.0, nullptr, &fleet).detach();
+    fleet.run().detach();
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(g_scheduler->now() + std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000.0)));
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+    fleet.set_trace(nullptr);
+    trace.close();
+
+    const TraceWriterStats& stats = trace.stats();
+    if (g_console_logger) {
+        g_console_logger->info("曲线记录: {} 个频率步中记录 {} 个样本，写入 {} 个超出死区的数值 (占 {:.2f}%)。", stats.steps_offered,
+            stats.samples_recorded, stats.changes_recorded,
+            stats.samples_recorded ? 100.0 * stats.changes_recorded / (stats.samples_recorded * fleet.size() * columns.size()) : 0.0);
+        g_console_logger->info("曲线文件 {}: {:.2f} MB (原始 double 输出为 {:.2f} MB，压缩比 {:.1f})。", trace_path,
+            stats.bytes_written / 1048576.0, stats.raw_bytes / 1048576.0,
+            stats.bytes_written ? static_cast<double>(stats.raw_bytes) / stats.bytes_written : 0.0);
+        g_console_logger->info("仿真线程复制耗时 {:.3f} 毫秒，等待后台线程 {:.3f} 毫秒；后台压缩与写文件耗时 {:.3f} 毫秒。",
+            stats.producer_copy_ms, stats.producer_wait_ms, stats.encode_ms);
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒。", real_time_elapsed_seconds.count());
+    }
+    g_scheduler = nullptr;
+
+    verify_vpp_trace(device_count, seconds, trace_path, columns);
+}
+
+// 集合仿真: 默认VPP场景的全部设备加入集合频率响应集群，一次仿真同时推进全部参数变体。
+// 各变体的频率偏差与VPP总功率按列写入数据文件；倍数全为1的变体与 vpp_demo (--packed) 的输出逐位一致。
+void test_vpp_ensemble(const std::vector<EnsembleVariant>& variants)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+
+    if (g_console_logger)
+        g_console_logger->info("--- VPP集合仿真: {} 个参数变体在同一次仿真中推进 ---", variants.size());
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    VppScenario scenario;
+    EnsembleFrequencyFleet fleet(registry, variants);
+    {
+        PhaseScope phase(SimPhase::SETUP);
+        build_vpp_scenario(registry, scenario);
+        fleet.reserve(scenario.ev_pile_entities.size() + scenario.ess_unit_entities.size());
+        for (Entity e : scenario.ev_pile_entities)
+            fleet.add_device(e);
+        for (Entity e : scenario.ess_unit_entities)
+            fleet.add_device(e);
+        // 频率预言机的参数取自任务表 (扰动开始时间、步长)
+        for (const auto& task : scenario.tasks)
+            if (static_cast<ScenarioTaskKind>(task.kind) == ScenarioTaskKind::FREQUENCY_ORACLE)
+                ensembleFrequencyOracleTask(fleet, task.param0, task.param1).detach();
+        fleet.run().detach();
+    }
+    for (size_t k = 0; k < variants.size(); ++k)
+        if (g_console_logger)
+            g_console_logger->info("变体 {}: 扰动幅值 x{:.2f}, 死区 x{:.2f}, 增益 x{:.2f}。", k, variants[k].disturbance_scale,
+                variants[k].deadband_scale, variants[k].gain_scale);
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(g_scheduler->now() + std::chrono::milliseconds(70000));
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    if (g_console_logger) {
+        auto total_power_kw = fleet.total_power_kW();
+        for (size_t k = 0; k < variants.size(); ++k)
+            g_console_logger->info("变体 {} 最终VPP总功率: {:.2f} kW。", k, total_power_kw[k]);
+        g_console_logger->info("{} 台设备 x {} 个变体，每台设备热数据 {} 字节。仿真实际物理执行耗时: {:.3f} 秒 (每个变体 {:.3f} 秒)。",
+            fleet.size(), variants.size(), EnsembleFrequencyFleet::hot_bytes_per_device(), real_time_elapsed_seconds.count(),
+            real_time_elapsed_seconds.count() / variants.size());
+    }
+    g_scheduler = nullptr;
+}
+
+// VPP代理模型: 大规模设备群 (默认10^5台) 的详细模型在一组负荷阶跃扰动上运行，拟合聚合响应的降阶代理模型并在
+// 验证扰动上给出误差界；随后以代理模型完成一次外层研究 (evaluations 次随机扰动下的VPP最大响应)，抽取其中几次与
+// 详细模型比较，最后把代理模型作为聚合组件接入频率预言机运行70秒。
+void test_vpp_surrogate(size_t device_count, size_t evaluations)
+{
+    Registry registry;
+    if (g_console_logger)
+        g_console_logger->info("--- VPP代理模型: {} 台设备，外层研究 {} 次扰动 ---", device_count, evaluations);
+    const std::vector<Entity> devices = create_device_population(registry, device_count);
+    VppSurrogateBuilder builder(registry, devices);
+
+    // 扰动: 第5秒的负荷阶跃，0.0862pu 即基准频率模型的功率缺额 (负值为甩负荷引起的过频)；部分曲线叠加第二次阶跃
+    constexpr double BASE_STEP_PU = 0.0862;
+    constexpr double DURATION_S = 70.0;
+    constexpr double STEP_S = 0.02;
+    auto profile = [&](const std::string& name, const std::vector<std::pair<double, double>>& steps) {
+        return make_load_step_profile(name, steps, DURATION_S, STEP_S);
+    };
+    auto single_step = [&](double scale) {
+        std::ostringstream name;
+        name << "阶跃x" << scale;
+        return profile(name.str(), { { 5.0, scale * BASE_STEP_PU } });
+    };
+    std::vector<VppDisturbanceProfile> training;
+    for (double scale : { 0.2, 0.25, 0.5, 1.0, 1.5, 2.0, -0.2, -0.5, -1.0 })
+        training.push_back(single_step(scale));
+    training.push_back(profile("两次阶跃 (x1.0, 30秒 x-0.5)", { { 5.0, BASE_STEP_PU }, { 30.0, -0.5 * BASE_STEP_PU } }));
+    std::vector<VppDisturbanceProfile> validation;
+    for (double scale : { 0.75, 1.75, -0.75 })
+        validation.push_back(single_step(scale));
+    validation.push_back(profile("两次阶跃 (x0.5, 20秒 x1.0)", { { 5.0, 0.5 * BASE_STEP_PU }, { 20.0, BASE_STEP_PU } }));
+
+    VppSurrogateFit fit;
+    auto build_start = std::chrono::steady_clock::now();
+    VppSurrogateModel model = builder.build(training, validation, &fit);
+    std::chrono::duration<double> build_elapsed = std::chrono::steady_clock::now() - build_start;
+    if (g_console_logger) {
+        g_console_logger->info("拟合: {} 条训练曲线 ({} 步)，惯性系数 {:.4f} (时间常数 {:.3f} 秒)，训练曲线最大误差 {:.1f} kW；"
+                               "建模耗时 {:.2f} 秒 (详细模型每条曲线 {:.1f} 毫秒)。",
+            fit.training_profiles, fit.samples, fit.lag_coefficient, fit.time_constant_s, fit.training_max_abs_kW, build_elapsed.count(),
+            fit.detailed_ms_per_profile);
+        for (const auto& e : fit.validation)
+            g_console_logger->info("验证 {}: 最大误差 {:.1f} kW，均方根误差 {:.1f} kW，详细模型最大响应 {:.1f} kW。", e.profile, e.max_abs_kW,
+                e.rms_kW, e.peak_response_kW);
+        g_console_logger->info("误差界 {:.1f} kW (验证曲线最大响应的 {:.3f}%)，适用于频率偏差 {:.3f} ~ {:.3f} Hz。", fit.error_bound_kW,
+            100.0 * fit.relative_error_bound, model.envelope_min_hz(), model.envelope_max_hz());
+    }
+
+    // 外层研究: 每次一个随机负荷阶跃，并在 15~40 秒之间叠加第二次随机阶跃，求VPP的最大功率响应
+    std::vector<VppDisturbanceProfile> studies;
+    studies.reserve(evaluations);
+    for (size_t e = 0; e < evaluations; ++e) {
+        const double first = CounterRng::uniform_at(VPP_SCENARIO_SEED, e, RngStream::SURROGATE_STUDY, 0, -1.0, 2.0) * BASE_STEP_PU;
+        const double second = CounterRng::uniform_at(VPP_SCENARIO_SEED, e, RngStream::SURROGATE_STUDY, 1, -0.5, 0.5) * BASE_STEP_PU;
+        const double second_at = CounterRng::uniform_at(VPP_SCENARIO_SEED, e, RngStream::SURROGATE_STUDY, 2, 15.0, 40.0);
+        studies.push_back(profile("研究" + std::to_string(e), { { 5.0, first }, { second_at, second } }));
+    }
+    std::vector<double> surrogate_power, detailed_power;
+    double max_peak_kW = 0.0, sum_peak_kW = 0.0;
+    uint64_t extrapolated = 0;
+    auto surrogate_start = std::chrono::steady_clock::now();
+    for (const auto& study : studies) {
+        model.simulate(study, surrogate_power);
+        double peak = 0.0;
+        for (double p : surrogate_power)
+            peak = std::max(peak, std::abs(p - model.initial_power_kW()));
+        max_peak_kW = std::max(max_peak_kW, peak);
+        sum_peak_kW += peak;
+        extrapolated += model.extrapolated_steps();
+    }
+    std::chrono::duration<double, std::milli> surrogate_elapsed = std::chrono::steady_clock::now() - surrogate_start;
+
+    const size_t detailed_checks = std::min<size_t>(evaluations, 3);
+    double detailed_ms = 0.0, check_max_error_kW = 0.0;
+    for (size_t e = 0; e < detailed_checks; ++e) {
+        auto t0 = std::chrono::steady_clock::now();
+        builder.run_detailed(studies[e], detailed_power);
+        detailed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        model.simulate(studies[e], surrogate_power);
+        for (size_t k = 0; k < detailed_power.size(); ++k)
+            check_max_error_kW = std::max(check_max_error_kW, std::abs(surrogate_power[k] - detailed_power[k]));
+    }
+    if (g_console_logger && evaluations > 0) {
+        const double surrogate_ms_per = surrogate_elapsed.count() / evaluations;
+        const double detailed_ms_per = detailed_checks ? detailed_ms / detailed_checks : fit.detailed_ms_per_profile;
+        g_console_logger->info("外层研究: {} 次扰动，VPP最大响应平均 {:.1f} kW、最大 {:.1f} kW；超出训练包络的步 {} 个。", evaluations,
+            sum_peak_kW / evaluations, max_peak_kW, extrapolated);
+        g_console_logger->info("代理模型每次 {:.4f} 毫秒，详细模型每次 {:.1f} 毫秒 (抽取 {} 次)，加速 {:.0f} 倍；抽取的研究上最大误差 {:.1f} kW (误差界 {:.1f} kW)。",
+            surrogate_ms_per, detailed_ms_per, detailed_checks, detailed_ms_per / surrogate_ms_per, check_max_error_kW, fit.error_bound_kW);
+    }
+
+    // 即插即用: 一个聚合实体代替全部设备交给频率预言机 (扰动于第5秒，步长20毫秒，与默认场景相同)
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+    static const std::vector<Entity> no_entities;
+    const std::vector<Entity> aggregate_entities = { registry.create() };
+    registry.emplace<PhysicalStateComponent>(aggregate_entities[0], model.initial_power_kW(), 0.5);
+    frequencyOracleTask(registry, no_entities, aggregate_entities, 5.0, STEP_S * 1000.0).detach();
+    model.run(registry, aggregate_entities[0]).detach();
+    auto run_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(g_scheduler->now() + std::chrono::milliseconds(static_cast<int64_t>(DURATION_S * 1000.0)));
+    }
+    std::chrono::duration<double> run_elapsed = std::chrono::high_resolution_clock::now() - run_start;
+    builder.run_detailed(single_step(1.0), detailed_power);
+    if (g_console_logger)
+        g_console_logger->info("聚合组件接入频率预言机: 70秒仿真物理耗时 {:.3f} 秒，最终VPP总功率 {:.2f} kW (详细模型 {:.2f} kW)。",
+            run_elapsed.count(), registry.get<PhysicalStateComponent>(aggregate_entities[0])->current_power_kW, detailed_power.back());
+    g_scheduler = nullptr;
+}
+
+// 引擎差分等价性校验: 默认VPP场景 (固定种子) 分别由以下引擎运行，每个频率步 (发布后半个步长) 记录频率偏差与
+// 全部设备的功率、SOC，逐项与参考引擎比较并给出第一个分歧点:
+//   参考: 每台设备一个 individualDeviceFrequencyResponseTask，Scheduler::run_until；
+//   候选: 批量集群 FrequencyResponseFleet (含按分区重排)、集合仿真 (变体0为基准参数，变体1扰动x1.5 同时推进)、
+//         逐次 run_one_step 推进 (实时调度器的路径)；
+//   自检: 批量集群，但一台储能单元的死区加 0.1mHz，校验应在该设备上报告分歧。
+// tolerance: 数值的绝对容差 (0 表示要求逐位一致)
+void test_engine_equivalence(double seconds, double tolerance)
+{
+    enum class Engine { DEVICE_TASKS, FLEET, ENSEMBLE };
+    if (g_console_logger)
+        g_console_logger->info("--- 引擎差分等价性校验: 默认VPP场景 {:.0f} 秒，数值容差 {} ---", seconds, tolerance);
+
+    auto make_engine = [seconds](Engine engine, SchedulerDrive drive, size_t perturbed_ess) {
+        return [=](EquivalenceTrace& trace) {
+            cps_coro::Scheduler scheduler_instance;
+            g_scheduler = &scheduler_instance;
+            g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+            Registry registry;
+            VppScenario scenario;
+            build_vpp_scenario(registry, scenario);
+            if (perturbed_ess < scenario.ess_unit_entities.size())
+                registry.get<FrequencyControlConfigComponent>(scenario.ess_unit_entities[perturbed_ess])->deadband_Hz += 1.0e-4;
+
+            std::vector<Entity> devices = scenario.ev_pile_entities;
+            devices.insert(devices.end(), scenario.ess_unit_entities.begin(), scenario.ess_unit_entities.end());
+            const uint32_t freq_field = trace.field("freq_deviation_hz");
+            const uint32_t power_field = trace.field("power_kW");
+            const uint32_t soc_field = trace.field("soc");
+            trace.add_series(0, freq_field);
+            trace.name_entity(0, "频率预言机");
+            for (size_t i = 0; i < devices.size(); ++i) {
+                trace.add_series(devices[i], power_field);
+                trace.add_series(devices[i], soc_field);
+                trace.name_entity(devices[i], scenario.names[i]);
+            }
+
+            double disturbance_start_s = 5.0, step_ms = 20.0;
+            for (const auto& task : scenario.tasks) {
+                if (static_cast<ScenarioTaskKind>(task.kind) == ScenarioTaskKind::FREQUENCY_ORACLE) {
+                    disturbance_start_s = task.param0;
+                    step_ms = task.param1;
+                }
+            }
+            static const std::vector<Entity> no_entities;
+            FrequencyResponseFleet fleet(registry);
+            std::unique_ptr<EnsembleFrequencyFleet> ensemble;
+            std::vector<CompactHandle> handles;
+            std::function<void(double*)> fill;
+            switch (engine) {
+            case Engine::DEVICE_TASKS:
+                frequencyOracleTask(registry, scenario.ev_pile_entities, scenario.ess_unit_entities, disturbance_start_s, step_ms).detach();
+                for (size_t i = 0; i < devices.size(); ++i)
+                    individualDeviceFrequencyResponseTask(registry, devices[i], scenario.names[i]).detach();
+                fill = [&](double* row) {
+                    row[0] = g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT).latest().freq_deviation_hz;
+                    for (size_t i = 0; i < devices.size(); ++i) {
+                        const PhysicalStateComponent* state = registry.get<PhysicalStateComponent>(devices[i]);
+                        row[1 + 2 * i] = state->current_power_kW;
+                        row[2 + 2 * i] = state->soc;
+                    }
+                };
+                break;
+            case Engine::FLEET: {
+                // 分区与 spawn_vpp_tasks 相同: 每个充电站一个分区，全部储能单元一个分区
+                const uint32_t ess_partition = static_cast<uint32_t>(
+                    (scenario.ev_pile_entities.size() + VPP_PILES_PER_STATION - 1) / VPP_PILES_PER_STATION);
+                fleet.reserve(devices.size());
+                for (size_t i = 0; i < devices.size(); ++i) {
+                    const bool is_ev = i < scenario.ev_pile_entities.size();
+                    handles.push_back(fleet.add_device(devices[i], is_ev ? static_cast<uint32_t>(i / VPP_PILES_PER_STATION) : ess_partition));
+                }
+                fleet.sort_by_partition();
+                frequencyOracleTask(registry, no_entities, no_entities, disturbance_start_s, step_ms, nullptr, &fleet).detach();
+                fleet.run().detach();
+                fill = [&](double* row) {
+                    row[0] = g_scheduler->latest_value_channel<FrequencyInfo>(FREQUENCY_UPDATE_EVENT).latest().freq_deviation_hz;
+                    auto& hot = registry.pool<DeviceResponseHot>();
+                    for (size_t i = 0; i < handles.size(); ++i) {
+                        const DeviceResponseHot* h = hot.get(handles[i]);
+                        row[1 + 2 * i] = h->current_power_kW;
+                        row[2 + 2 * i] = h->soc;
+                    }
+                };
+                break;
+            }
+            case Engine::ENSEMBLE:
+                ensemble = std::make_unique<EnsembleFrequencyFleet>(registry, std::vector<EnsembleVariant> { {}, { 1.5, 1.0, 1.0 } });
+                ensemble->reserve(devices.size());
+                for (Entity device : devices)
+                    handles.push_back(ensemble->add_device(device));
+                ensembleFrequencyOracleTask(*ensemble, disturbance_start_s, step_ms).detach();
+                ensemble->run().detach();
+                fill = [&](double* row) {
+                    row[0] = g_scheduler->latest_value_channel<EnsembleFrequencyInfo>(ENSEMBLE_FREQUENCY_UPDATE_EVENT).latest().freq_deviation_hz[0];
+                    auto& hot = registry.pool<EnsembleDeviceHot>();
+                    for (size_t i = 0; i < handles.size(); ++i) {
+                        const EnsembleDeviceHot* h = hot.get(handles[i]);
+                        row[1 + 2 * i] = h->current_power_kW[0];
+                        row[2 + 2 * i] = h->soc[0];
+                    }
+                };
+                break;
+            }
+            const auto step = std::chrono::milliseconds(static_cast<int64_t>(step_ms));
+            equivalenceSamplerTask(scheduler_instance, trace, step / 2, step, fill).detach();
+            drive_scheduler(scheduler_instance, g_scheduler->now() + std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000.0)), drive);
+            g_scheduler = nullptr;
+        };
+    };
+
+    constexpr size_t NONE = SIZE_MAX;
+    constexpr size_t PERTURBED_ESS = 30;
+    const std::vector<EquivalenceEngine> engines = {
+        { "逐设备协程 (参考)", make_engine(Engine::DEVICE_TASKS, SchedulerDrive::RUN_UNTIL, NONE) },
+        { "批量集群", make_engine(Engine::FLEET, SchedulerDrive::RUN_UNTIL, NONE) },
+        { "集合仿真通道0", make_engine(Engine::ENSEMBLE, SchedulerDrive::RUN_UNTIL, NONE) },
+        { "逐设备协程 + 逐步推进", make_engine(Engine::DEVICE_TASKS, SchedulerDrive::STEP, NONE) },
+        { "自检: 批量集群, ESS单元_30 死区+0.1mHz", make_engine(Engine::FLEET, SchedulerDrive::RUN_UNTIL, PERTURBED_ESS) },
+    };
+    EquivalenceTolerance settings;
+    settings.absolute = tolerance;
+    settings.horizon_s = seconds;
+    const auto reports = run_equivalence_suite(engines, settings);
+
+    size_t equivalent = 0;
+    bool self_check_located = false;
+    for (size_t r = 0; r < reports.size(); ++r) {
+        const EquivalenceReport& report = reports[r];
+        const bool self_check = r + 1 == reports.size();
+        if (self_check)
+            self_check_located = !report.equivalent && report.first_divergence && report.first_divergence->entity_label == "ESS单元_30";
+        else
+            equivalent += report.equivalent;
+        if (g_console_logger) {
+            g_console_logger->info("{} (物理耗时: 参考 {:.3f} 秒，候选 {:.3f} 秒)", report.describe(), report.reference_elapsed_s,
+                report.candidate_elapsed_s);
+        }
+    }
+    if (g_console_logger) {
+        g_console_logger->info("等价性校验: {}/{} 个优化引擎与参考一致；自检偏差{}。", equivalent, reports.size() - 1,
+            self_check_located ? "已定位到被修改的设备" : "未被正确定位");
+    }
+}
+
+// EV充电会话仿真: 大量充电站 (每站10桩) 在24小时内的随机接入/离开过程，统计充电负荷曲线。
+void test_ev_sessions(size_t charger_count, double hours)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    if (g_console_logger)
+        g_console_logger->info("--- EV充电会话仿真: {} 台充电桩, {:.1f} 小时 ---", charger_count, hours);
+
+    EvSessionEngine engine(scheduler_instance, VPP_SCENARIO_SEED, 900.0);
+    const int chargers_per_station = 10;
+    size_t station_count = (charger_count + chargers_per_station - 1) / chargers_per_station;
+    for (size_t i = 0; i < station_count; ++i) {
+        EvStationConfig config;
+        config.station_entity = registry.create();
+        config.charger_count = chargers_per_station;
+        config.charger_power_kW = (i % 5 == 0) ? 60.0 : 7.0; // 每5个站中有1个直流快充站
+        config.arrivals_per_charger_hour = (i % 5 == 0) ? 1.2 : 0.5;
+        if (i % 5 == 0) {
+            config.dwell_log_mean = -0.7; // 快充站停留约半小时
+            config.dwell_log_sigma = 0.4;
+        }
+        engine.add_station(config);
+    }
+
+    double horizon_s = hours * 3600.0;
+    engine.run(horizon_s).detach();
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(static_cast<long long>(horizon_s * 1000.0)) });
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    engine.log_summary();
+    if (g_console_logger) {
+        const auto& profile = engine.load_profile_kW();
+        for (size_t h = 0; h * 4 < profile.size(); h += 3) // 每3小时输出一次该时刻所在15分钟的平均负荷
+            g_console_logger->info("[EV会话] {:02d}:00 充电负荷 {:.1f} MW", h, profile[h * 4] / 1000.0);
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒 (约为实时的 {:.0f} 倍)。", real_time_elapsed_seconds.count(),
+            horizon_s / std::max(real_time_elapsed_seconds.count(), 1e-9));
+    }
+    long peak_mem_kb = get_peak_memory_usage_kb();
+    if (peak_mem_kb != -1 && g_console_logger)
+        g_console_logger->info("本次仿真峰值内存使用 (近似值): {} KB (约 {:.2f} MB)。", peak_mem_kb, peak_mem_kb / 1024.0);
+    g_scheduler = nullptr;
+}
+
+// 合成辐射状馈线: 母线1为变电站，母线 2..trunk_buses 构成主干线，其余母线组成挂在主干线上的分支线。
+// 返回主干线母线数；建立馈线失败时返回 0。
+int build_synthetic_feeder(int bus_count, RadialFeeder& feeder)
+{
+    const int trunk_buses = std::max(2, bus_count / 16);
+    std::vector<BusId> bus_ids;
+    std::vector<BranchId> branch_ids;
+    std::vector<std::pair<BusId, BusId>> endpoints;
+    std::unordered_map<BranchId, QstsBranchImpedance> impedances;
+    // 主干线的压降约与母线数的平方成正比 (长度与负荷同时增长)，主干线阻抗按 (1000/母线数)² 缩放以保持相近的电压水平
+    const double trunk_scale = std::pow(1000.0 / bus_count, 2);
+    int lateral_remaining = 0;
+    bus_ids.push_back(1);
+    for (BusId bus = 2; bus <= bus_count; ++bus) {
+        CounterRng rng(VPP_SCENARIO_SEED, bus, RngStream::FEEDER_TOPOLOGY);
+        BusId parent;
+        QstsBranchImpedance z;
+        if (bus <= trunk_buses) {
+            parent = bus - 1;
+            z = { 0.0002 * trunk_scale, 0.0003 * trunk_scale }; // 主干线段
+        } else {
+            if (lateral_remaining > 0) {
+                parent = bus - 1;
+                --lateral_remaining;
+            } else {
+                parent = rng.uniform_int(2, trunk_buses);
+                lateral_remaining = rng.uniform_int(4, 20);
+            }
+            z = { 0.004, 0.002 }; // 分支线段
+        }
+        bus_ids.push_back(bus);
+        branch_ids.push_back(bus);
+        endpoints.emplace_back(parent, bus);
+        impedances[bus] = z;
+    }
+    PowerSystemTopology topology;
+    topology.buildTopology(bus_ids, branch_ids, endpoints);
+    return feeder.build(topology, 1, impedances, 1000.0) ? trunk_buses : 0;
+}
+
+// QSTS长时段仿真: 合成的辐射状馈线 (主干线 + 分支线，默认1000条母线)，带居民负荷、屋顶光伏、家用EV充电桩，
+// 沿主干线分布储能 (削峰填谷)，主干线末端电压由变电站有载调压变压器调节。
+// 以 step_s 为步长仿真 days 天；chunk_days 为并行时间块长度 (0 表示按并行度自动划分)。
+void test_qsts(int bus_count, double days, double step_s, double chunk_days)
+{
+    if (g_console_logger)
+        g_console_logger->info("--- QSTS仿真: {} 条母线, {:.1f} 天, 步长 {:.1f} 秒 ---", bus_count, days, step_s);
+
+    bus_count = std::max(bus_count, 2);
+    RadialFeeder feeder;
+    const int trunk_buses = build_synthetic_feeder(bus_count, feeder);
+    if (trunk_buses == 0)
+        return;
+
+    // --- 母线负荷与分布式资源: 负荷 3~9 kW，每3条母线1套光伏，每4条母线1台7kW充电桩 ---
+    std::vector<double> load_kW(bus_count + 1, 0.0), pv_kW(bus_count + 1, 0.0), ev_kW(bus_count + 1, 0.0);
+    double total_load_kW = 0.0, total_pv_kW = 0.0;
+    int ev_count = 0;
+    for (BusId bus = 2; bus <= bus_count; ++bus) {
+        CounterRng rng(VPP_SCENARIO_SEED, bus, RngStream::FEEDER_LOAD);
+        load_kW[bus] = rng.uniform(3.0, 9.0);
+        pv_kW[bus] = (bus % 3 == 0) ? rng.uniform(3.0, 8.0) : 0.0;
+        ev_kW[bus] = (bus % 4 == 0) ? 7.0 : 0.0;
+        total_load_kW += load_kW[bus];
+        total_pv_kW += pv_kW[bus];
+        ev_count += ev_kW[bus] > 0.0;
+    }
+
+    ParallelExecutor executor;
+    QstsSettings settings;
+    settings.seed = VPP_SCENARIO_SEED;
+    settings.step_s = step_s;
+    settings.chunk_s = 86400.0 * (chunk_days > 0.0 ? chunk_days : std::max(1.0, std::ceil(days / executor.concurrency())));
+    settings.output_dir = "qsts_output";
+    settings.ess_discharge_above_kW = 0.80 * total_load_kW; // 首端功率高于峰值负荷的80%时储能放电
+    settings.ess_charge_below_kW = 0.45 * total_load_kW; // 低于45%时充电
+    QstsEngine engine(feeder, executor, settings);
+    for (BusId bus = 2; bus <= bus_count; ++bus)
+        engine.set_bus(bus, load_kW[bus], pv_kW[bus], ev_kW[bus]);
+    const int ess_count = 8;
+    for (int k = 1; k <= ess_count; ++k)
+        engine.add_ess(1 + k * (trunk_buses - 1) / ess_count, 250.0, 1000.0, 0.5);
+    engine.set_regulation_bus(trunk_buses);
+    if (g_console_logger)
+        g_console_logger->info("馈线: 主干线 {} 条母线，峰值负荷 {:.1f} MW，光伏 {:.1f} MW，EV充电桩 {} 台，储能 {} 台。", trunk_buses,
+            total_load_kW / 1000.0, total_pv_kW / 1000.0, ev_count, ess_count);
+
+    QstsSummary summary = engine.run(0.0, days * 86400.0);
+    if (g_console_logger) {
+        g_console_logger->info("[QSTS] 共 {} 步，平均潮流迭代 {:.2f} 次 (最多 {} 次，未收敛 {} 步)。", summary.steps,
+            summary.steps ? static_cast<double>(summary.iterations) / summary.steps : 0.0, summary.max_iterations, summary.unconverged_steps);
+        g_console_logger->info("[QSTS] 电压范围 {:.4f} ~ {:.4f} pu，分接头动作 {} 次，首端峰值 {:.1f} MW。", summary.min_voltage_pu,
+            summary.max_voltage_pu, summary.tap_changes, summary.peak_head_kW / 1000.0);
+        g_console_logger->info("[QSTS] 首端供电 {:.1f} MWh，线损 {:.1f} MWh，光伏 {:.1f} MWh，EV充电 {:.1f} MWh。", summary.energy_MWh,
+            summary.losses_MWh, summary.pv_MWh, summary.ev_MWh);
+        g_console_logger->info("[QSTS] 时间块 {} 个，计算 {} 次 (状态交接 {} 轮)，输出 {:.1f} MB 至 {}。", summary.chunks, summary.chunk_runs,
+            summary.handoff_passes, summary.bytes_written / 1048576.0, settings.output_dir);
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒 (约为实时的 {:.0f} 倍，按此推算全年约 {:.1f} 分钟)。", summary.elapsed_s,
+            days * 86400.0 / std::max(summary.elapsed_s, 1e-9), summary.elapsed_s * 365.0 / days / 60.0);
+    }
+}
+
+// --- 逆变器电压控制仿真: 午间轻载、光伏大发时馈线上的 Volt-VAR / Volt-Watt ---
+
+// DER电压控制统计 (控制任务逐步累计)
+struct DerVoltageRunStats {
+    uint64_t steps = 0;
+    uint64_t iterations = 0;
+    int max_iterations = 0;
+    uint64_t unconverged_steps = 0;
+    uint64_t damped_steps = 0; // 残差不再减小、减小了阻尼的步数
+    double max_voltage_pu = 0.0; // 控制后的最高电压 (全部步)
+    double q_kvarh = 0.0; // 逆变器吸收的无功电量
+    double curtailed_kWh = 0.0; // Volt-Watt 限制的光伏电量
+    double pv_kWh = 0.0;
+};
+
+// 控制任务: 每个控制步更新光伏可用功率 (按10秒时段的云量插值)，求解控制与潮流的不动点
+cps_coro::Task derVoltageControlTask(DerVoltageFleet& fleet, const std::vector<double>& load_kW, const std::vector<double>& load_kvar,
+    double source_voltage_pu, double step_s, DerVoltageRunStats& stats)
+{
+    std::vector<double> v_re(load_kW.size(), source_voltage_pu), v_im(load_kW.size(), 0.0);
+    const auto step = cps_coro::Scheduler::duration(std::llround(step_s * 1000.0));
+    auto cloud_at = [](long long slot) {
+        CounterRng rng(VPP_SCENARIO_SEED, 0, RngStream::DER_CLOUD, static_cast<uint32_t>(slot));
+        return rng.uniform() < 0.7 ? 1.0 : rng.uniform(0.3, 0.9);
+    };
+    while (true) {
+        const double t = g_scheduler->now().time_since_epoch().count() / 1000.0;
+        const long long slot = static_cast<long long>(std::floor(t / 10.0));
+        const double f = (t - slot * 10.0) / 10.0;
+        const double pv_factor = 0.95 * (cloud_at(slot) + (cloud_at(slot + 1) - cloud_at(slot)) * f);
+
+        DerStepResult r = fleet.step(load_kW.data(), load_kvar.data(), pv_factor, source_voltage_pu, v_re.data(), v_im.data());
+        ++stats.steps;
+        stats.iterations += r.iterations;
+        stats.max_iterations = std::max(stats.max_iterations, r.iterations);
+        stats.unconverged_steps += !r.converged;
+        stats.damped_steps += r.damping < fleet.settings().damping;
+        stats.max_voltage_pu = std::max(stats.max_voltage_pu, r.solution.max_voltage_pu);
+        stats.q_kvarh -= r.q_kvar * step_s / 3600.0;
+        stats.curtailed_kWh += std::max(r.curtailed_kW, 0.0) * step_s / 3600.0; // 光伏骤降后出力按阻尼回落，可暂时略高于可用功率
+        stats.pv_kWh += (r.p_kW + r.curtailed_kW) * step_s / 3600.0;
+        co_await cps_coro::delay(step);
+    }
+}
+
+// 合成馈线 (与QSTS仿真相同的拓扑生成) 上每条非电源母线接一台逆变器: 每3条母线中2台为屋顶光伏 (4~10kW，
+// 逆变器容量为光伏的1.1倍)，1台为待机的户用储能 (10kVA)。光伏与储能使用不同的曲线组。
+// 变电站出口电压 1.04pu，午间负荷为峰值的35%。仿真 seconds 秒，控制步长1秒。
+void test_der_voltage(size_t inverter_count, double seconds)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+    Registry registry;
+
+    if (g_console_logger)
+        g_console_logger->info("--- 逆变器电压控制仿真: {} 台逆变器, {:.0f} 秒 ---", inverter_count, seconds);
+
+    const int bus_count = static_cast<int>(std::max<size_t>(inverter_count, 1)) + 1;
+    RadialFeeder feeder;
+    if (build_synthetic_feeder(bus_count, feeder) == 0)
+        return;
+
+    DerCurveSet pv_curves; // IEEE 1547 B类默认曲线
+    DerCurveSet ess_curves;
+    ess_curves.volt_var = { { 0.95, 0.99, 1.01, 1.05 }, { 0.6, 0.0, 0.0, -0.6 } }; // 储能无有功出力，用较窄死区与较陡斜率提供更多无功
+    std::vector<double> load_kW(feeder.bus_count(), 0.0), load_kvar(feeder.bus_count(), 0.0);
+    double pv_rated_kW = 0.0;
+    std::vector<Entity> inverters;
+    inverters.reserve(inverter_count);
+
+    DerVoltageFleet fleet(registry, feeder);
+    const uint32_t pv_set = fleet.add_curve_set(pv_curves);
+    const uint32_t ess_set = fleet.add_curve_set(ess_curves);
+    fleet.reserve(inverter_count);
+    for (BusId bus = 2; bus <= bus_count; ++bus) {
+        CounterRng rng(VPP_SCENARIO_SEED, bus, RngStream::FEEDER_LOAD);
+        const int b = feeder.index_of(bus);
+        load_kW[b] = 0.35 * rng.uniform(3.0, 9.0);
+        load_kvar[b] = 0.3 * load_kW[b];
+        Entity inverter = registry.create();
+        if (bus % 3 != 0) {
+            const double pv_kW = rng.uniform(4.0, 10.0);
+            registry.emplace<DerInverterComponent>(inverter, DerInverterComponent::Kind::PV, bus, 1.1 * pv_kW, pv_kW, pv_set);
+            pv_rated_kW += pv_kW;
+        } else {
+            registry.emplace<DerInverterComponent>(inverter, DerInverterComponent::Kind::ESS, bus, 10.0, 0.0, ess_set);
+        }
+        fleet.add_inverter(inverter);
+        inverters.push_back(inverter);
+    }
+    fleet.finalize();
+    if (g_console_logger)
+        g_console_logger->info("馈线 {} 条母线，光伏 {:.1f} MW，逆变器 {} 台 (曲线组 2 个)。", feeder.bus_count(), pv_rated_kW / 1000.0, fleet.size());
+
+    const double source_voltage_pu = 1.04;
+    // 以同一初始状态 (出力为0)、光伏满发求解一个控制步: 不投电压控制 (Volt-VAR 恒为0，Volt-Watt 不动作) 作为对照，
+    // 再分别以阻尼系数1与默认阻尼投入控制，比较不动点迭代的轮数
+    double uncontrolled_max_voltage_pu = 0.0;
+    {
+        DerCurveSet no_control;
+        no_control.volt_var.q_frac[0] = no_control.volt_var.q_frac[3] = 0.0;
+        no_control.volt_watt.v_start_pu = no_control.volt_watt.v_end_pu = 10.0;
+        std::vector<double> v_re(feeder.bus_count()), v_im(feeder.bus_count());
+        for (double damping : { 0.0, 1.0, fleet.settings().damping }) {
+            DerVoltageFleet probe(registry, feeder, fleet.settings());
+            probe.add_curve_set(damping == 0.0 ? no_control : pv_curves);
+            probe.add_curve_set(damping == 0.0 ? no_control : ess_curves);
+            probe.reserve(inverters.size());
+            for (Entity inverter : inverters)
+                probe.add_inverter(inverter);
+            probe.finalize();
+            probe.set_damping(damping == 0.0 ? 1.0 : damping);
+            std::fill(v_re.begin(), v_re.end(), source_voltage_pu);
+            std::fill(v_im.begin(), v_im.end(), 0.0);
+            DerStepResult r = probe.step(load_kW.data(), load_kvar.data(), 0.95, source_voltage_pu, v_re.data(), v_im.data());
+            if (damping == 0.0)
+                uncontrolled_max_voltage_pu = r.solution.max_voltage_pu;
+            else if (g_console_logger)
+                g_console_logger->info("[DER] 阻尼系数 {:.2f}: 首个控制步迭代 {} 轮{}，最高电压 {:.4f} pu (不投控制时 {:.4f} pu)。", damping,
+                    r.iterations, r.converged ? "后收敛" : " 未收敛", r.solution.max_voltage_pu, uncontrolled_max_voltage_pu);
+        }
+    }
+
+    DerVoltageRunStats stats;
+    const double step_s = 1.0;
+    derVoltageControlTask(fleet, load_kW, load_kvar, source_voltage_pu, step_s, stats).detach();
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(static_cast<long long>(seconds * 1000.0) - 1) });
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+    fleet.sync_to_components();
+
+    if (g_console_logger) {
+        g_console_logger->info("[DER] 共 {} 个控制步，平均迭代 {:.2f} 轮 (最多 {} 轮，未收敛 {} 步，减小阻尼 {} 步)。", stats.steps,
+            stats.steps ? static_cast<double>(stats.iterations) / stats.steps : 0.0, stats.max_iterations, stats.unconverged_steps,
+            stats.damped_steps);
+        g_console_logger->info("[DER] 控制后最高电压 {:.4f} pu (光伏满发且不投控制时 {:.4f} pu)。", stats.max_voltage_pu, uncontrolled_max_voltage_pu);
+        g_console_logger->info("[DER] 光伏可发 {:.1f} kWh，Volt-Watt 限发 {:.2f} kWh，Volt-VAR 吸收无功 {:.1f} kvarh。", stats.pv_kWh,
+            stats.curtailed_kWh, stats.q_kvarh);
+        const double elapsed = real_time_elapsed_seconds.count();
+        g_console_logger->info("仿真实际物理执行耗时: {:.3f} 秒 (每个控制步 {:.2f} ms，约为实时的 {:.0f} 倍)。", elapsed,
+            stats.steps ? elapsed * 1000.0 / stats.steps : 0.0, seconds / std::max(elapsed, 1e-9));
+    }
+    g_scheduler = nullptr;
+}
+
+// --- 通信网络仿真: 大规模IED经通信通道与主站、断路器智能终端通信 ---
+
+// IED状态上送任务: 每秒向主站上送一次状态报告，起始相位按IED实体随机错开
+cps_coro::Task iedReportTask(Entity ied, CommNetwork* comm, Entity channel)
+{
+    int phase_ms = CounterRng(VPP_SCENARIO_SEED, ied, RngStream::IED_REPORT_PHASE).uniform_int(0, 999);
+    co_await cps_coro::delay(cps_coro::Scheduler::duration(phase_ms));
+    while (true) {
+        IedStatusReport report { ied, static_cast<double>(g_scheduler->now().time_since_epoch().count()) };
+        if (comm)
+            comm->send(channel, IED_STATUS_REPORT_EVENT, report);
+        else
+            g_scheduler->trigger_event(IED_STATUS_REPORT_EVENT, report);
+        co_await cps_coro::delay(std::chrono::milliseconds(1000));
+    }
+}
+
+// 保护IED任务: 检测到故障后经20ms保护动作时间，经GOOSE通道向断路器智能终端发跳闸命令
+cps_coro::Task iedProtectionTask(Entity ied, CommNetwork* comm, Entity channel)
+{
+    co_await cps_coro::wait_for_event<FaultInfo>(FAULT_INFO_EVENT_PROT);
+    double fault_time_ms = static_cast<double>(g_scheduler->now().time_since_epoch().count());
+    co_await cps_coro::delay(std::chrono::milliseconds(20));
+    IedTripCommand command { ied, fault_time_ms };
+    if (comm)
+        comm->send(channel, IED_TRIP_COMMAND_EVENT, command);
+    else
+        g_scheduler->trigger_event(IED_TRIP_COMMAND_EVENT, command);
+}
+
+// 主站任务: 接收全部IED的状态报告，累计报告数与端到端时延
+cps_coro::Task masterStationTask(uint64_t& reports, double& total_age_ms)
+{
+    while (true) {
+        IedStatusReport report = co_await cps_coro::wait_for_event<IedStatusReport>(IED_STATUS_REPORT_EVENT);
+        ++reports;
+        total_age_ms += g_scheduler->now().time_since_epoch().count() - report.sent_time_ms;
+    }
+}
+
+// 断路器智能终端任务: 接收跳闸命令，记录最长的故障切除命令时间 (故障发生至命令到达)
+cps_coro::Task breakerTerminalTask(uint64_t& trips, double& max_trip_ms)
+{
+    while (true) {
+        IedTripCommand command = co_await cps_coro::wait_for_event<IedTripCommand>(IED_TRIP_COMMAND_EVENT);
+        ++trips;
+        max_trip_ms = std::max(max_trip_ms, g_scheduler->now().time_since_epoch().count() - command.fault_time_ms);
+    }
+}
+
+// 运行一次IED通信场景。use_comm 为 false 时所有报文直接触发事件 (瞬时送达)，作为开销对比的基准。
+static void run_comm_scenario(size_t ied_count, double seconds, bool use_comm)
+{
+    cps_coro::Scheduler scheduler_instance;
+    g_scheduler = &scheduler_instance;
+    Registry registry;
+    g_scheduler->set_time(cps_coro::Scheduler::time_point { std::chrono::milliseconds(0) });
+
+    CommNetwork comm(registry, scheduler_instance, VPP_SCENARIO_SEED);
+    CommNetwork* network = use_comm ? &comm : nullptr;
+    Entity master_station = registry.create();
+
+    // 每4台IED中1台为经DNP3串口接入的配网终端，其余经IEC104接入；每100台中1台为保护IED，另有至断路器的GOOSE通道
+    size_t protection_ieds = 0;
+    for (size_t i = 0; i < ied_count; ++i) {
+        Entity ied = registry.create();
+        Entity report_channel = comm.add_channel(i % 4 == 3 ? CommChannelParams::dnp3_serial() : CommChannelParams::iec104(),
+            ied, master_station);
+        iedReportTask(ied, network, report_channel).detach();
+        if (i % 100 == 0) {
+            Entity breaker_terminal = registry.create();
+            Entity trip_channel = comm.add_channel(CommChannelParams::goose(), ied, breaker_terminal);
+            iedProtectionTask(ied, network, trip_channel).detach();
+            ++protection_ieds;
+        }
+    }
+    comm.start();
+
+    uint64_t reports = 0, trips = 0;
+    double total_age_ms = 0.0, max_trip_ms = 0.0;
+    masterStationTask(reports, total_age_ms).detach();
+    breakerTerminalTask(trips, max_trip_ms).detach();
+
+    // 仿真中点发生故障，所有保护IED同时动作
+    [](double fault_at_ms) -> cps_coro::Task {
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(static_cast<long long>(fault_at_ms)));
+        g_scheduler->trigger_event(FAULT_INFO_EVENT_PROT, FaultInfo {});
+    }(seconds * 500.0).detach();
+
+    auto real_time_sim_start = std::chrono::high_resolution_clock::now();
+    {
+        PhaseScope phase(SimPhase::RUN_UNTIL);
+        g_scheduler->run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(static_cast<long long>(seconds * 1000.0)) });
+    }
+    std::chrono::duration<double> real_time_elapsed_seconds = std::chrono::high_resolution_clock::now() - real_time_sim_start;
+
+    if (g_console_logger) {
+        g_console_logger->info("[{}] 主站收到状态报告 {} 份 (平均时延 {:.1f} 毫秒)，断路器收到跳闸命令 {}/{} 条 (最长故障切除命令时间 {:.1f} 毫秒)。",
+            use_comm ? "经通信网络" : "直接触发", reports, reports ? total_age_ms / reports : 0.0, trips, protection_ieds, max_trip_ms);
+        if (use_comm) {
+            auto stats = comm.stats();
+            g_console_logger->info("[经通信网络] 通道 {} 条，发送 {} 帧 ({:.1f} MB)，送达 {} 帧，途中丢失 {} 帧，队列溢出 {} 帧，最大时延 {:.1f} 毫秒，报文槽位池峰值 {} 个。",
+                stats.channels, stats.sent, stats.bytes_sent / 1.0e6, stats.delivered, stats.lost, stats.dropped, stats.max_latency_ms,
+                stats.pool_capacity);
+        }
+        g_console_logger->info("[{}] 仿真实际物理执行耗时: {:.3f} 秒。", use_comm ? "经通信网络" : "直接触发", real_time_elapsed_seconds.count());
+    }
+    g_scheduler = nullptr;
+}
+
+// 通信网络仿真: ied_count 台IED经IEC104/DNP3通道向主站周期上送状态，保护IED在故障时经GOOSE通道发跳闸命令。
+// 分别以直接触发事件和经通信网络两种方式运行同一场景，对比通信建模带来的开销。
+void test_comm_network(size_t ied_count, double seconds)
+{
+    if (g_console_logger)
+        g_console_logger->info("--- 通信网络仿真: {} 台IED, {:.1f} 秒 ---", ied_count, seconds);
+    run_comm_scenario(ied_count, seconds, false);
+    run_comm_scenario(ied_count, seconds, true);
+    long peak_mem_kb = get_peak_memory_usage_kb();
+    if (peak_mem_kb != -1 && g_console_logger)
+        g_console_logger->info("本次仿真峰值内存使用 (近似值): {} KB (约 {:.2f} MB)。", peak_mem_kb, peak_mem_kb / 1024.0);
 }
\ No newline at end of file